@@ -1110,6 +1110,33 @@ AC_DEFUN([LC_HAVE_USER_NAMESPACE_ARG], [
 	])
 ]) # LC_HAVE_USER_NAMESPACE_ARG
 
+#
+# LC_HAVE_MAP_PAGES_VM_FAULT_T
+#
+# kernel 5.12 commit f9ce0be71d1fbb038ada15ced83474b0e63f264d
+# mm: Cleanup faultaround and finish_fault() codepaths
+# vm_operations_struct->map_pages() returns vm_fault_t instead of void.
+#
+AC_DEFUN([LC_SRC_HAVE_MAP_PAGES_VM_FAULT_T], [
+	LB2_LINUX_TEST_SRC([map_pages_returns_vm_fault_t], [
+		#include <linux/mm.h>
+	],[
+		struct vm_operations_struct *vm_ops = NULL;
+		vm_fault_t ret;
+
+		ret = vm_ops->map_pages(NULL, 0, 0);
+		(void)ret;
+	],[-Werror])
+])
+AC_DEFUN([LC_HAVE_MAP_PAGES_VM_FAULT_T], [
+	LB2_MSG_LINUX_TEST_RESULT(
+	[if 'vm_operations_struct.map_pages' returns vm_fault_t],
+	[map_pages_returns_vm_fault_t], [
+		AC_DEFINE(HAVE_MAP_PAGES_VM_FAULT_T, 1,
+			['vm_operations_struct.map_pages' returns vm_fault_t])
+	])
+]) # LC_HAVE_MAP_PAGES_VM_FAULT_T
+
 #
 # LC_HAVE_ACCOUNT_PAGE_DIRTIED
 #
@@ -3460,6 +3487,7 @@ AC_DEFUN([LC_PROG_LINUX_SRC], [
 
 	# 5.12
 	LC_SRC_HAVE_USER_NAMESPACE_ARG
+	LC_SRC_HAVE_MAP_PAGES_VM_FAULT_T
 
 	# 5.13
 	LC_SRC_HAVE_ACCOUNT_PAGE_DIRTIED
@@ -3662,6 +3690,7 @@ AC_DEFUN([LC_PROG_LINUX_RESULTS], [
 
 	# 5.12
 	LC_HAVE_USER_NAMESPACE_ARG
+	LC_HAVE_MAP_PAGES_VM_FAULT_T
 
 	# 5.13
 	LC_HAVE_ACCOUNT_PAGE_DIRTIED
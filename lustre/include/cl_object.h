@@ -281,6 +281,12 @@ struct cl_layout {
 	bool		cl_is_released;
 	/** Whether layout is a readonly one */
 	bool		cl_is_rdonly;
+	/** FLR state of the layout, LCM_FL_NONE if it is not mirrored */
+	u32		cl_flr_state;
+	/** number of valid entries in cl_mirror_ids */
+	u16		cl_mirror_count;
+	/** IDs of the data mirrors with no stale component */
+	u16		cl_mirror_ids[LUSTRE_MIRROR_COUNT_MAX];
 };
 
 struct cl_dio_pages;
@@ -1097,6 +1103,18 @@ static inline bool __page_in_use(const struct cl_page *page, int refc)
  * description of interaction with DLM.
  */
 
+/**
+ * Strided access pattern of the IO a lock is taken for: cls_bytes are
+ * accessed every cls_length bytes starting at cls_offset. All in bytes, in
+ * the offset space of the object the lock descriptor belongs to. Zeroed when
+ * no pattern was detected.
+ */
+struct cl_lock_stride {
+	loff_t			cls_offset;
+	__u64			cls_length;
+	__u64			cls_bytes;
+};
+
 /**
  * Lock description.
  */
@@ -1116,6 +1134,8 @@ struct cl_lock_descr {
 	 * enum cl_enq_flags.
 	 */
 	__u32             cld_enq_flags;
+	/** Access stride hint for the lock server, if any. */
+	struct cl_lock_stride cld_stride;
 };
 
 #define DDESCR "%s(%d):[%lu, %lu]:%x"
@@ -343,6 +343,11 @@ enum {
 	PTLRPC_REQACTIVE_CNTR,
 	PTLRPC_TIMEOUT,
 	PTLRPC_REQBUF_AVAIL_CNTR,
+	PTLRPC_REQBUF_LOW_CNTR,
+	PTLRPC_REQBUF_EMPTY_CNTR,
+	PTLRPC_REQBUF_REUSE_CNTR,
+	PTLRPC_REQBUF_TRIM_CNTR,
+	PTLRPC_REPSTATE_MISS_CNTR,
 	PTLRPC_LAST_CNTR
 };
 
@@ -444,6 +449,8 @@ enum ojb_info_flags {
 typedef void (*cntr_init_callback)(struct lprocfs_stats *stats,
 				   unsigned int offset,
 				   enum lprocfs_counter_config cntr_umask);
+typedef void (*job_show_callback)(struct seq_file *p, struct obd_device *obd,
+				  const char *jobid);
 struct obd_job_stats {
 	struct rb_root		ojs_idtree;	/* root sorted on js_jobid */
 	struct rb_root		ojs_postree;	/* unique id (temporal) root */
@@ -457,6 +464,8 @@ struct obd_job_stats {
 	ktime_t			ojs_cleanup_interval;/* 1/2 expiry seconds */
 	ktime_t			ojs_cleanup_last;/* previous cleanup time */
 	cntr_init_callback	ojs_cntr_init_fn;/* lprocfs_stats initializer */
+	job_show_callback	ojs_show_fn;	/* extra per-job output */
+	struct obd_device	*ojs_obd;	/* device the stats belong to */
 	unsigned short		ojs_cntr_num;	/* number of stats in struct */
 	atomic64_t		ojs_jobs;	/* number of jobs */
 };
@@ -669,6 +678,8 @@ void lprocfs_oh_tally(struct obd_histogram *oh, unsigned int value);
 void lprocfs_oh_tally_log2(struct obd_histogram *oh, unsigned int value);
 void lprocfs_oh_clear(struct obd_histogram *oh);
 unsigned long lprocfs_oh_sum(struct obd_histogram *oh);
+void lprocfs_oh_halve(struct obd_histogram *oh);
+unsigned int lprocfs_oh_pct_log2(struct obd_histogram *oh, unsigned int pct);
 
 void lprocfs_oh_tally_pcpu(struct obd_hist_pcpu *oh, unsigned int value);
 void lprocfs_oh_tally_log2_pcpu(struct obd_hist_pcpu *oh, unsigned int value);
@@ -1232,6 +1243,17 @@ unsigned long lprocfs_oh_sum(struct obd_histogram *oh)
 	return 0;
 }
 
+static inline
+void lprocfs_oh_halve(struct obd_histogram *oh)
+{
+}
+
+static inline
+unsigned int lprocfs_oh_pct_log2(struct obd_histogram *oh, unsigned int pct)
+{
+	return 0;
+}
+
 static inline
 void lprocfs_stats_collect(struct lprocfs_stats *stats, int idx,
 			   struct lprocfs_counter *cnt)
@@ -613,6 +613,8 @@ int llapi_path2parent(const char *path, unsigned int linkno,
 		      struct lu_fid *parent_fid, char *name, size_t name_size);
 int llapi_fd2parent(int fd, unsigned int linkno, struct lu_fid *parent_fid,
 		    char *name, size_t name_size);
+/* look up all components of a path with batched RPCs to warm the cache */
+int llapi_path_walk(const char *path, int *count);
 int llapi_rmfid(const char *path, struct fid_array *fa);
 int llapi_rmfid_at(int fd, struct fid_array *fa);
 int llapi_root_path_open(const char *device, int *outfd);
@@ -25,6 +25,8 @@
 #ifndef _LUSTRE_DLM_H__
 #define _LUSTRE_DLM_H__
 
+#include <linux/hashtable.h>
+#include <linux/rhashtable.h>
 #include <cfs_hash.h>
 #include <lustre_lib.h>
 #include <lustre_net.h>
@@ -53,6 +55,8 @@ extern struct kset *ldlm_svc_kset;
  */
 #define LDLM_DIRTY_AGE_LIMIT (10)
 #define LDLM_DEFAULT_PARALLEL_AST_LIMIT 1024
+/* Maximum number of branches blocking ASTs are sent from, see ast_fanout */
+#define LDLM_AST_FANOUT_MAX 16
 #define LDLM_DEFAULT_LRU_SHRINK_BATCH (16)
 #define LDLM_DEFAULT_SLV_RECALC_PCT (10)
 
@@ -188,7 +192,7 @@ static inline int lockmode_compat(enum ldlm_mode exist_mode,
  * lr_lock
  *
  * lr_lock
- *     waiting_locks_spinlock
+ *     ldlm_waiting_locks::wl_lock
  *
  * lr_lock
  *     led_lock
@@ -218,6 +222,7 @@ struct ldlm_pool;
 struct ldlm_lock;
 struct ldlm_resource;
 struct ldlm_namespace;
+struct ldlm_reclaim_job;
 
 /**
  * Operations on LDLM pools.
@@ -341,6 +346,12 @@ enum ldlm_appetite {
 #define NS_DEFAULT_CONTENTION_SECONDS 2
 #define NS_DEFAULT_CONTENDED_LOCKS 32
 
+/**
+ * Per-namespace slot shared by all resources whose name hashes to it. The
+ * resources themselves live in ldlm_namespace::ns_rs_hash; the slots only
+ * keep the adaptive timeout estimate and resource count, so that they are
+ * not tied to the layout of the (resizable) hash table.
+ */
 struct ldlm_ns_bucket {
 	/** back pointer to namespace */
 	struct ldlm_namespace      *nsb_namespace;
@@ -350,11 +361,7 @@ struct ldlm_ns_bucket {
 	 * fact the network or overall system load is at fault
 	 */
 	struct adaptive_timeout     nsb_at_estimate;
-	/**
-	 * Which res in the bucket should we start with the reclaim.
-	 */
-	int			    nsb_reclaim_start;
-	/* counter of entries in this bucket */
+	/* counter of resources mapped to this bucket */
 	atomic_t		    nsb_count;
 };
 
@@ -363,6 +370,8 @@ enum {
 	LDLM_NSS_LOCKS          = 0,
 	LDLM_NSS_LRU_PRIV_HITS	= 1,
 	LDLM_NSS_LRU_HITS	= 2,
+	LDLM_NSS_LRU_GHOST_HITS	= 3,
+	LDLM_NSS_STRIDE_GRANTS	= 4,
 	LDLM_NSS_LAST
 };
 
@@ -399,6 +408,7 @@ enum ldlm_namespace_flags {
 enum ldlm_lock_cache_policy {
 	LDLM_LOCK_CACHE_LRU = 0,
 	LDLM_LOCK_CACHE_LFRU,
+	LDLM_LOCK_CACHE_ARC,
 };
 
 struct ldlm_lock_cache_ops {
@@ -420,6 +430,12 @@ struct ldlm_lock_cache_ops {
 	 */
 	int (*llco_try_batch_demote_locks)(struct ldlm_namespace *ns,
 					   int batch_size);
+	/**
+	 * (optional) @lock was picked from the LRU to be cancelled.
+	 * Prereq: hold ns->ns_lock
+	 */
+	void (*llco_evict_lock)(struct ldlm_namespace *ns,
+				struct ldlm_lock *lock);
 };
 
 /*
@@ -453,8 +469,15 @@ struct ldlm_namespace {
 	/** name of this namespace */
 	char			*ns_name;
 
-	/** Resource hash table for namespace. */
-	struct cfs_hash		*ns_rs_hash;
+	/**
+	 * Resource hash table for namespace, lookups are done under RCU and
+	 * only take a reference on the resource found.
+	 */
+	struct rhashtable	ns_rs_hash;
+	/** Per-namespace buckets, see struct ldlm_ns_bucket. */
+	struct ldlm_ns_bucket	*ns_rs_buckets;
+	/** log2 of the number of ns_rs_buckets */
+	unsigned int		ns_rs_bkt_bits;
 
 	/** serialize */
 	spinlock_t		ns_lock;
@@ -547,6 +570,21 @@ struct ldlm_namespace {
 	 */
 	__u8			ns_lfru_priv_ratio_limit_256;
 
+	/**
+	 * Adaptive Replacement Cache (ARC) policy, reusing the normal list
+	 * for locks put in the LRU once and the privileged list for locks
+	 * reused from it. The ghost lists remember the resources of locks
+	 * recently cancelled from either list, so that a new lock on such
+	 * a resource can move \a ns_arc_target, the number of LRU locks the
+	 * normal list aims for, towards the list which lost it.
+	 */
+	struct rhashtable	ns_arc_ghost_hash;
+	struct list_head	ns_arc_ghost_recent;
+	struct list_head	ns_arc_ghost_frequent;
+	unsigned int		ns_arc_nr_ghost_recent;
+	unsigned int		ns_arc_nr_ghost_frequent;
+	unsigned int		ns_arc_target;
+
 	enum ldlm_lock_cache_policy ns_lock_cache_policy : 3;
 	/**
 	 * LRU cache operations for this namespace.
@@ -644,6 +682,14 @@ struct ldlm_namespace {
 	/** Limit of parallel AST RPC count. */
 	unsigned int		ns_max_parallel_ast;
 
+	/**
+	 * Number of branches to split blocking ASTs into when more than
+	 * ns_max_parallel_ast locks are to be revoked at once, 0 or 1 sends
+	 * them all from the conflicting thread. The branches share the
+	 * ns_max_parallel_ast limit.
+	 */
+	unsigned int		ns_ast_fanout;
+
 	/**
 	 * Callback to check if a lock is good to be canceled by ELC or
 	 * during recovery.
@@ -660,9 +706,36 @@ struct ldlm_namespace {
 	struct lprocfs_stats	*ns_stats;
 
 	/**
-	 * Which bucket should we start with the lock reclaim.
+	 * Position of the lock reclaim scan in ns_rs_hash, kept between
+	 * scans so that successive ones go round-robin over the namespace.
+	 * Protected by ns_reclaim_mutex.
 	 */
-	int			ns_reclaim_start;
+	struct rhashtable_iter	ns_reclaim_iter;
+	struct mutex		ns_reclaim_mutex;
+	/**
+	 * Server only: per-JobID granted lock accounting used by the lock
+	 * reclaim, see struct ldlm_reclaim_job. Entries are inserted and
+	 * removed under ns_reclaim_lock.
+	 */
+	struct rhashtable	ns_reclaim_jobs;
+	spinlock_t		ns_reclaim_lock;
+	/**
+	 * Server only: revocation of the idle locks of the exports and jobs
+	 * over their lock limit, run from the ldlm_ast workqueue rather than
+	 * from the enqueue handler. The exports to handle are linked by
+	 * obd_export::exp_reclaim_list, both fields are protected by
+	 * ns_reclaim_lock.
+	 */
+	struct work_struct	ns_reclaim_work;
+	struct list_head	ns_reclaim_exports;
+	bool			ns_reclaim_jobs_over;
+
+	/**
+	 * Server only: blocked flock locks by client NID and owner, each one
+	 * pointing at the owner it waits for. This is the wait-for graph
+	 * walked by the flock deadlock detection.
+	 */
+	struct rhltable		ns_flock_waiters;
 
 	struct kobject		ns_kobj; /* sysfs object */
 	struct completion	ns_kobj_unregister;
@@ -758,6 +831,38 @@ struct ldlm_bl_desc {
 					 */
 };
 
+/** Maximum number of locks carried by one batched blocking AST RPC */
+#define LDLM_BL_BATCH_MAX	32
+/** Pending blocking AST batches of one AST set are hashed by export */
+#define LDLM_BL_BATCH_HASH_BITS	5
+
+/**
+ * Blocking ASTs being aggregated for a single export.
+ *
+ * Clients connected with OBD_CONNECT2_BATCH_BL_AST get one LDLM_BL_CALLBACK
+ * RPC for all of their locks which are blocked by the same lock during one
+ * ldlm_run_ast_work() pass, instead of one RPC per lock. All locks in a
+ * batch share the lock descriptor and AST flags sent to the client.
+ *
+ * The RPC is allocated together with the batch, before any lock is added
+ * to it, so that a batch can always be sent once locks are committed to it.
+ */
+struct ldlm_bl_batch {
+	/** Link to ldlm_cb_set_arg::bl_batches */
+	struct list_head	 lbb_list;
+	/** Link to ldlm_cb_set_arg::bl_batch_hash */
+	struct hlist_node	 lbb_hash;
+	struct obd_export	*lbb_exp;
+	/** Blocking AST RPC, owned by the batch until it is sent */
+	struct ptlrpc_request	*lbb_req;
+	struct ldlm_lock_desc	 lbb_desc;
+	__u64			 lbb_flags;
+	/** Longest callback timeout of the batched locks, in seconds */
+	time64_t		 lbb_timeout;
+	int			 lbb_count;
+	struct ldlm_lock	*lbb_locks[LDLM_BL_BATCH_MAX];
+};
+
 struct ldlm_cb_set_arg {
 	struct ptlrpc_request_set	*set;
 	int				 type; /* LDLM_{CP,BL,GL}_CALLBACK */
@@ -767,11 +872,16 @@ struct ldlm_cb_set_arg {
 	ptlrpc_interpterer_t		 gl_interpret_reply;
 	void				*gl_interpret_data;
 	struct ldlm_bl_desc		*bl_desc;
+	/** Partially filled blocking AST batches, see ldlm_bl_batch */
+	struct list_head		 bl_batches;
+	DECLARE_HASHTABLE(bl_batch_hash, LDLM_BL_BATCH_HASH_BITS);
 };
 
 struct ldlm_cb_async_args {
 	struct ldlm_cb_set_arg	*ca_set_arg;
 	struct ldlm_lock	*ca_lock;
+	/** set instead of ca_lock for a batched blocking AST */
+	struct ldlm_bl_batch	*ca_batch;
 };
 
 /** The ldlm_glimpse_work was slab allocated & must be freed accordingly.*/
@@ -824,8 +934,8 @@ struct ldlm_flock {
 	__u64 end;
 	__u64 owner;
 	__u64 blocking_owner;
+	/* referenced while the lock is in ns_flock_waiters */
 	struct obd_export *blocking_export;
-	atomic_t blocking_refs;
 	__u32 pid;
 };
 
@@ -928,10 +1038,11 @@ struct ldlm_lock {
 		};
 		struct { /* LDLM_FLOCK locks */
 			/**
-			 * Per export hash of flock locks.
-			 * Protected by per-bucket exp->exp_flock_hash locks.
+			 * Linkage of a blocked flock lock into the namespace
+			 * wait-for graph, keyed by the client NID and owner.
+			 * Added and removed under the resource lock.
 			 */
-			struct hlist_node	l_exp_flock_hash;
+			struct rhlist_head	l_fl_waiter;
 			struct ldlm_lock	*l_same_owner;
 			/* interval tree */
 			struct rb_node		l_fl_rb;
@@ -1071,10 +1182,10 @@ struct ldlm_lock {
 
 	/**
 	 * List item for locks waiting for cancellation from clients.
-	 * The lists this could be linked into are:
-	 * waiting_locks_list (protected by waiting_locks_spinlock),
-	 * then if the lock timed out, it is moved to
-	 * expired_lock_list for further processing.
+	 * The lists this could be linked into are the slots of a per-CPT
+	 * waiting locks wheel (protected by its wl_lock), then if the lock
+	 * timed out, it is moved to the wheel's expired list for further
+	 * processing.
 	 */
 	struct list_head	l_pending_chain;
 
@@ -1089,7 +1200,11 @@ struct ldlm_lock {
 
 	/** Local PID of process which created this lock. */
 	__u32			l_pid;
-	/* __u32		l_unused; */
+	/**
+	 * Server only: lock is charged to the granted lock counts of its
+	 * export and job, see ldlm_reclaim_add().
+	 */
+	__u32			l_reclaim_charged;
 
 	/** List item ldlm_add_ast_work_item() for case of blocking ASTs. */
 	struct list_head	l_bl_ast;
@@ -1104,6 +1219,9 @@ struct ldlm_lock {
 	 */
 	struct ldlm_lock	*l_blocking_lock;
 
+	/** Server only: JobID of the client process which enqueued the lock */
+	struct ldlm_reclaim_job	*l_reclaim_job;
+
 #if LUSTRE_TRACKS_LOCK_EXP_REFS
 	/* Debugging stuff for bug 20498, for tracking export references. */
 	/** number of export references taken */
@@ -1185,14 +1303,11 @@ struct ldlm_resource {
 	struct ldlm_ns_bucket	*lr_ns_bucket;
 
 	/**
-	 * List item for list in namespace hash.
-	 * protected by ns_lock.
-	 * Shared with linkage for RCU-delayed free.
+	 * Linkage in the namespace hash. It is walked by RCU readers, so it
+	 * must stay intact until the RCU-delayed free.
 	 */
-	union {
-		struct hlist_node	lr_hash;
-		struct rcu_head		lr_rcu;
-	};
+	struct rhash_head	lr_hash;
+	struct rcu_head		lr_rcu;
 
 	/** Reference count for this resource */
 	refcount_t		lr_refcount;
@@ -1217,8 +1332,18 @@ struct ldlm_resource {
 	struct ldlm_res_id	lr_name;
 
 	union {
-		 /* Interval trees (for extent locks) all modes of resource */
-		struct ldlm_interval_tree *lr_itree;
+		struct { /* LDLM_EXTENT resources */
+			/* Interval trees (for extent locks) all modes */
+			struct ldlm_interval_tree *lr_itree;
+			/**
+			 * Chunk size and offset modulo the chunk size of the
+			 * strided IO reported with the last extent enqueue,
+			 * see ldlm_extent_stride_hint(). Server only,
+			 * protected by lr_lock.
+			 */
+			__u64			lr_stride_bytes;
+			__u64			lr_stride_phase;
+		};
 		struct ldlm_ibits_queues *lr_ibits_queues;
 		struct ldlm_flock_node lr_flock_node;
 	};
@@ -1388,6 +1513,8 @@ struct ldlm_enqueue_info {
 	unsigned int	ei_enq_slave:1;	/** whether enqueue slave stripes */
 	unsigned int	ei_req_slot:1;	/** whether acquire rpc slot */
 	unsigned int	ei_mod_slot:1;	/** whether acquire mod rpc slot */
+	/** client access stride to report with an extent enqueue, or NULL */
+	const struct ldlm_extent_stride *ei_stride;
 };
 
 #define ei_res_id	ei_cb_gl
@@ -1537,6 +1664,8 @@ void ldlm_namespace_foreach(struct ldlm_namespace *ns, ldlm_iterator_t iter,
 int ldlm_resource_iterate(struct ldlm_namespace *ln,
 			  const struct ldlm_res_id *lri,
 			  ldlm_iterator_t iter, void *data);
+int ldlm_namespace_res_walk(struct ldlm_namespace *ns,
+			    ldlm_res_iterator_t iter, void *arg);
 /** @} ldlm_iterator */
 
 int ldlm_replay_locks(struct obd_import *imp);
@@ -1842,6 +1971,9 @@ int ldlm_prep_elc_req(struct obd_export *exp, struct ptlrpc_request *req,
 		      struct list_head *cancels, int count);
 
 struct ptlrpc_request *ldlm_enqueue_pack(struct obd_export *exp, int lvb_len);
+struct ptlrpc_request *
+ldlm_enqueue_stride_pack(struct obd_export *exp, int lvb_len,
+			 const struct ldlm_extent_stride *stride);
 int ldlm_handle_enqueue(struct ldlm_namespace *ns, struct req_capsule *pill,
 			const struct ldlm_request *dlm_req,
 			const struct ldlm_callback_suite *cbs);
@@ -1971,6 +2103,13 @@ void ldlm_pool_add(struct ldlm_pool *pl, struct ldlm_lock *lock);
 void ldlm_pool_del(struct ldlm_pool *pl, struct ldlm_lock *lock);
 /** @} */
 
+/* ldlm_reclaim.c */
+#ifdef CONFIG_LUSTRE_FS_SERVER
+void ldlm_reclaim_attach(struct ldlm_lock *lock, const char *jobid);
+void ldlm_reclaim_job_seq_show(struct seq_file *p, struct obd_device *obd,
+			       const char *jobid);
+#endif
+
 static inline int ldlm_extent_overlap(const struct ldlm_extent *ex1,
 				      const struct ldlm_extent *ex2)
 {
@@ -175,6 +175,12 @@ struct obd_export {
 	/** Number of queued replay requests to be processes */
 	atomic_t		exp_replay_count;
 	atomic_t		exp_locks_count; /** Lock references */
+	/** Number of reclaimable locks granted to this export */
+	atomic_t		exp_granted_locks;
+	/** Link to ldlm_namespace::ns_reclaim_exports */
+	struct list_head	exp_reclaim_list;
+	/** Last time the locks of the export over its limit were revoked */
+	ktime_t			exp_reclaim_time;
 #if LUSTRE_TRACKS_LOCK_EXP_REFS
 	struct list_head	exp_locks_list;
 	spinlock_t		exp_locks_list_guard;
@@ -211,11 +217,6 @@ struct obd_export {
 	__u32			  exp_conn_cnt;
 	/** Hash list of all ldlm locks granted on this export */
 	struct cfs_hash		 *exp_lock_hash;
-	/**
-	 * Hash list for Posix lock deadlock detection, added with
-	 * ldlm_lock::l_exp_flock_hash.
-	 */
-	struct cfs_hash		*exp_flock_hash;
 	struct list_head	exp_outstanding_replies;
 	struct list_head	exp_uncommitted_replies;
 	spinlock_t		exp_uncommitted_replies_lock;
@@ -542,6 +543,80 @@ static inline int exp_connect_open_readdir(struct obd_export *exp)
 	return !!(exp_connect_flags2(exp) & OBD_CONNECT2_READDIR_OPEN);
 }
 
+static inline bool exp_connect_batch_bl_ast(struct obd_export *exp)
+{
+	return (exp_connect_flags2(exp) & OBD_CONNECT2_BATCH_BL_AST);
+}
+
+static inline bool exp_connect_lock_stride(struct obd_export *exp)
+{
+	return (exp_connect_flags2(exp) & OBD_CONNECT2_LOCK_STRIDE);
+}
+
+static inline bool exp_connect_readdir_plus(struct obd_export *exp)
+{
+	return (exp_connect_flags2(exp) & OBD_CONNECT2_READDIR_PLUS);
+}
+
+static inline bool exp_connect_path_walk(struct obd_export *exp)
+{
+	return (exp_connect_flags2(exp) & OBD_CONNECT2_PATH_WALK);
+}
+
+static inline bool exp_connect_xattr_prefetch(struct obd_export *exp)
+{
+	return (exp_connect_flags2(exp) & OBD_CONNECT2_XATTR_PREFETCH);
+}
+
+/* reply budget for xattrs piggybacked on a getattr/lookup intent reply,
+ * names get a quarter of the room of the values
+ */
+#define XATTR_PREFETCH_VALS_DEFAULT	512
+#define XATTR_PREFETCH_NAMES_MAX	1024
+#define XATTR_PREFETCH_VALS_MAX		4096
+#define XATTR_PREFETCH_COUNT_MAX	32
+
+/**
+ * exp_xattr_prefetch_name() - can xattr be piggybacked in getattr reply
+ * @name: xattr name
+ *
+ * Security labels, default ACLs and trusted xattrs are read on nearly every
+ * first access of a file, so the MDT returns them together with the
+ * attributes when the client supports OBD_CONNECT2_XATTR_PREFETCH. The access
+ * ACL and internal trusted xattrs are either already returned in their own
+ * reply buffer or are never read by the client, so they are left out.
+ *
+ * Return: true if @name is prefetched, false otherwise
+ */
+static inline bool exp_xattr_prefetch_name(const char *name)
+{
+	static const char * const skip[] = {
+		XATTR_NAME_LOV, XATTR_NAME_LMV, XATTR_NAME_DEFAULT_LMV,
+		XATTR_NAME_LMA, XATTR_NAME_LINK, XATTR_NAME_SOM,
+		XATTR_NAME_FID, XATTR_NAME_VERSION, XATTR_NAME_HSM,
+		XATTR_NAME_LFSCK_NAMESPACE, XATTR_NAME_LFSCK_BITMAP,
+		XATTR_NAME_PROJID, XATTR_NAME_DATAVER, XATTR_NAME_PIN,
+	};
+	int i;
+
+	if (!strncmp(name, XATTR_SECURITY_PREFIX,
+		     sizeof(XATTR_SECURITY_PREFIX) - 1))
+		return true;
+
+	if (!strcmp(name, XATTR_NAME_ACL_DEFAULT))
+		return true;
+
+	if (strncmp(name, XATTR_TRUSTED_PREFIX,
+		    sizeof(XATTR_TRUSTED_PREFIX) - 1))
+		return false;
+
+	for (i = 0; i < ARRAY_SIZE(skip); i++)
+		if (!strcmp(name, skip[i]))
+			return false;
+
+	return true;
+}
+
 enum {
 	/* archive_ids in array format */
 	KKUC_CT_DATA_ARRAY_MAGIC	= 0x092013cea,
@@ -16,10 +16,19 @@
 #define _LUSTRE_LMV_H
 #include <uapi/linux/lustre/lustre_idl.h>
 
+/* lmo_ra_flags bits */
+enum lmv_oinfo_ra_flags {
+	LMO_RA_BUSY,		/* readahead of the stripe is running */
+	LMO_RA_VALID,		/* lmo_ra_hash is set */
+};
+
 struct lmv_oinfo {
 	struct lu_fid	lmo_fid;
 	u32		lmo_mds;
 	struct inode	*lmo_root;
+	/* start hash of the dir pages last read ahead for this stripe */
+	__u64		lmo_ra_hash;
+	unsigned long	lmo_ra_flags;
 };
 
 struct lmv_stripe_md {
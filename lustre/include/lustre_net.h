@@ -689,6 +689,7 @@ struct ptlrpc_reply_state {
 	unsigned long		rs_sent:1; /* Got LNET_EVENT_SEND? */
 	unsigned long		rs_unlinked:1; /* Reply MD unlinked? */
 	unsigned long		rs_prealloc:1; /* rs from prealloc list */
+	unsigned long		rs_cached:1; /* rs from scp_rep_cache */
 	/* transaction committed and rs dispatched by ptlrpc_commit_replies */
 	unsigned long		rs_committed:1;
 	struct kref		rs_refcount; /* number of users */
@@ -1026,7 +1027,11 @@ struct ptlrpc_request {
 		rq_unstable:1,
 		rq_early_free_repbuf:1, /* free reply buffer in advance */
 		rq_allow_intr:1,
-		rq_pause_after_reply:1;
+		rq_pause_after_reply:1,
+		/* another replica can serve this request: early replies do not
+		 * extend the deadline and expiry does not fail the import
+		 */
+		rq_hedged:1;
 	/** @} */
 
 	/** server-side flags are serialized by rq_lock @{ */
@@ -1726,6 +1731,13 @@ struct ptlrpc_service_part {
 	int				scp_nreqs_incoming;
 	/** request buffers to be reposted */
 	struct list_head		scp_rqbd_idle;
+	/**
+	 * unposted request buffers kept for reuse instead of being freed
+	 * when a burst is over, so the next burst does not go to the slab
+	 */
+	struct list_head		scp_rqbd_cache;
+	/** # request buffers in scp_rqbd_cache */
+	int				scp_nrqbds_cached;
 	/** req buffers receiving */
 	struct list_head		scp_rqbd_posted;
 	/** incoming reqs */
@@ -1797,6 +1809,13 @@ struct ptlrpc_service_part {
 	struct list_head		scp_rep_active;
 	/** List of free reply_states */
 	struct list_head		scp_rep_idle;
+	/**
+	 * CPT-local small reply state buffers of PTLRPC_RS_CACHE_SIZE bytes,
+	 * reused by sptlrpc_svc_alloc_rs() for the NULL flavor
+	 */
+	struct list_head		scp_rep_cache;
+	/** # reply states in scp_rep_cache */
+	int				scp_nreps_cached;
 	/** waitq to run, when adding stuff to srv_free_rs_list */
 	wait_queue_head_t		scp_rep_waitq;
 	/** # 'difficult' replies */
@@ -686,6 +686,7 @@ struct binheap_node {
 #include <lustre_nrs_tbf.h>
 #include <lustre_nrs_crr.h>
 #include <lustre_nrs_orr.h>
+#include <lustre_nrs_wfq.h>
 #endif /* CONFIG_LUSTRE_FS_SERVER */
 #include <lustre_nrs_delay.h>
 
@@ -735,6 +736,10 @@ struct ptlrpc_nrs_request {
 		 * TBF request definition
 		 */
 		struct nrs_tbf_req	tbf;
+		/**
+		 * WFQ request definition
+		 */
+		struct nrs_wfq_req	wfq;
 #endif /* CONFIG_LUSTRE_FS_SERVER */
 		/**
 		 * Fields for the delay policy
@@ -0,0 +1,130 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ *
+ * Network Request Scheduler (NRS) Weighted Fair Queueing (WFQ) policy
+ */
+
+#ifndef _LUSTRE_NRS_WFQ_H
+#define _LUSTRE_NRS_WFQ_H
+
+/**
+ * \name WFQ
+ *
+ * WFQ, byte-weighted Fair Queueing over client NIDs or JobIDs
+ * @{
+ */
+
+/**
+ * Flow classification used by a WFQ policy instance; selected by the
+ * argument given when starting the policy, e.g.
+ * "lctl set_param ost.OSS.ost_io.nrs_policies='wfq jobid'"
+ */
+enum nrs_wfq_flow_type {
+	NRS_WFQ_FLOW_NID	= 0,
+	NRS_WFQ_FLOW_JOBID	= 1,
+};
+
+/**
+ * Key identifying a WFQ flow; only the member matching the policy's
+ * nrs_wfq_flow_type is set, the other one is left zeroed so that the whole
+ * key can be hashed and compared as a blob.
+ */
+struct nrs_wfq_key {
+	struct lnet_nid		wk_nid;
+	char			wk_jobid[LUSTRE_JOBID_SIZE];
+};
+
+/**
+ * private data structure for WFQ NRS
+ */
+struct nrs_wfq_net {
+	struct ptlrpc_nrs_resource	wn_res;
+	struct binheap		       *wn_binheap;
+	/* WFQ NRS - flow hash body */
+	struct rhashtable		wn_flow_hash;
+	/**
+	 * System virtual time; set to the finish tag of the last request
+	 * dispatched from this policy instance, in bytes.
+	 */
+	__u64				wn_vtime;
+	/**
+	 * Orders requests with identical finish tags by arrival.
+	 */
+	__u64				wn_sequence;
+	/**
+	 * Fixed cost in bytes charged to every RPC in addition to the bulk
+	 * bytes it moves, so that small and non-bulk RPCs are not free.
+	 */
+	__u32				wn_rpc_cost;
+	enum nrs_wfq_flow_type		wn_flow_type;
+	/**
+	 * Flows without queued or in-service requests, oldest first; they
+	 * are freed once there are more than wfq_flow_cache_size of them.
+	 */
+	struct list_head		wn_lru_list;
+	spinlock_t			wn_lru_lock;
+	unsigned int			wn_lru_cnt;
+};
+
+/**
+ * Object representing a flow in WFQ, as identified by its NID or JobID
+ */
+struct nrs_wfq_flow {
+	struct ptlrpc_nrs_resource	wf_res;
+	struct rhash_head		wf_rhead;
+	struct nrs_wfq_key		wf_key;
+	/**
+	 * The finish tag of the last request enqueued by this flow; the next
+	 * request of the flow cannot start before it in virtual time.
+	 */
+	__u64				wf_finish;
+	/**
+	 * Total bytes charged to this flow, for debugging
+	 */
+	__u64				wf_charged;
+	atomic_t			wf_ref;
+	/**
+	 * # of pending requests for this flow
+	 */
+	__u32				wf_active;
+	/**
+	 * Linkage into nrs_wfq_net::wn_lru_list while wf_ref is 0
+	 */
+	struct list_head		wf_lru;
+	struct rcu_head			wf_rcu_head;
+	/**
+	 * Set under nrs_wfq_net::wn_lru_lock when the flow is being freed
+	 */
+	bool				wf_dead;
+};
+
+/**
+ * WFQ NRS request definition
+ */
+struct nrs_wfq_req {
+	/**
+	 * Virtual start and finish tags of the request
+	 */
+	__u64			wr_start;
+	__u64			wr_finish;
+	/**
+	 * Arrival sequence, to break ties between equal finish tags
+	 */
+	__u64			wr_sequence;
+};
+
+/**
+ * WFQ policy operations.
+ *
+ * Read the per-RPC cost of a WFQ policy.
+ */
+#define NRS_CTL_WFQ_RD_RPC_COST PTLRPC_NRS_CTL_POL_SPEC_01
+/**
+ * Write the per-RPC cost of a WFQ policy.
+ */
+#define NRS_CTL_WFQ_WR_RPC_COST PTLRPC_NRS_CTL_POL_SPEC_02
+
+/** @} WFQ */
+#endif
@@ -85,6 +85,7 @@ struct osc_device {
 		ktime_t		os_init;
 		uint64_t	os_lockless_writes;    /* by bytes */
 		uint64_t	os_lockless_reads;     /* by bytes */
+		uint64_t	os_hedged_reads;       /* given up as slow */
 	} osc_stats;
 
 	/* configuration item(s) */
@@ -391,6 +392,8 @@ struct osc_lock {
 	/** osc_lock::ols_lock handle */
 	struct lustre_handle	ols_handle;
 	struct ldlm_enqueue_info ols_einfo;
+	/** client access stride sent with the enqueue, see ei_stride */
+	struct ldlm_extent_stride ols_stride;
 	enum osc_lock_state	ols_state;
 	/** lock value block */
 	struct ost_lvb		ols_lvb;
@@ -621,8 +624,7 @@ int osc_cleanup_common(struct obd_device *obd);
 int osc_set_info_async(const struct lu_env *env, struct obd_export *exp,
 		       u32 keylen, void *key, u32 vallen, void *val,
 		       struct ptlrpc_request_set *set);
-int osc_ldlm_resource_invalidate(struct cfs_hash *hs, struct cfs_hash_bd *bd,
-				 struct hlist_node *hnode, void *arg);
+int osc_ldlm_resource_invalidate(struct ldlm_resource *res, void *arg);
 int osc_reconnect(const struct lu_env *env, struct obd_export *exp,
 		  struct obd_device *obd, struct obd_uuid *cluuid,
 		  struct obd_connect_data *data, void *localdata);
@@ -917,6 +919,10 @@ struct osc_extent {
 				oe_urgent:1,
 	/** Non-delay RPC should be used for this extent. */
 				oe_ndelay:1,
+	/** non-delay read that may give up early on a slow OST, as another
+	 * mirror is still left to try
+	 */
+				oe_hedge:1,
 	/** direct IO pages */
 				oe_dio:1,
 	/** this extent consists of pages that are not directly accessible
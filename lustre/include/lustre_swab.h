@@ -79,6 +79,7 @@ void lustre_swab_ldlm_intent(struct ldlm_intent *i);
 void lustre_swab_ldlm_resource_desc(struct ldlm_resource_desc *r);
 void lustre_swab_ldlm_lock_desc(struct ldlm_lock_desc *l);
 void lustre_swab_ldlm_request(struct ldlm_request *rq);
+void lustre_swab_ldlm_extent_stride(struct ldlm_extent_stride *s);
 void lustre_swab_ldlm_reply(struct ldlm_reply *r);
 void lustre_swab_mgs_target_info(struct mgs_target_info *oinfo);
 void lustre_swab_mgs_target_nidlist(struct mgs_target_nidlist *mtn);
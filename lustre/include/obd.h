@@ -138,6 +138,8 @@ struct timeout_item {
 #define OSC_MAX_DIRTY_DEFAULT	2000	 /* Arbitrary large value */
 #define OSC_MAX_DIRTY_MB_MAX	2048     /* arbitrary, but < MAX_LONG bytes */
 #define OSC_DEFAULT_RESENDS	10
+#define OSC_READ_LAT_DECAY	1024	/* samples between halving */
+#define OSC_READ_LAT_MIN	64	/* samples before latency is trusted */
 
 /* possible values for lut_sync_lock_cancel */
 enum tgt_sync_lock_cancel {
@@ -210,6 +212,13 @@ struct client_obd {
 	 */
 	__u32			 cl_dom_min_inline_repsize;
 
+	/* Room for xattr values piggybacked on getattr/lookup intent replies
+	 * by the MDT. It starts at XATTR_PREFETCH_VALS_DEFAULT and doubles,
+	 * up to XATTR_PREFETCH_VALS_MAX, each time the MDT reports that the
+	 * xattrs of a file did not fit.
+	 */
+	__u32			 cl_xattr_prefetch_size;
+
 	unsigned int		 cl_checksum:1, /* 0 = disabled, 1 = enabled */
 				 cl_checksum_dump:1, /* same */
 				 cl_ocd_grant_param:1,
@@ -296,6 +305,22 @@ struct client_obd {
 	ktime_t			cl_io_latency_stats_init;
 	struct obd_histogram	*cl_read_io_latency_by_size;
 	struct obd_histogram	*cl_write_io_latency_by_size;
+	/* recent read RPC latency in "binary usec", halved every
+	 * OSC_READ_LAT_DECAY samples so that it follows the OST's current
+	 * behaviour rather than its lifetime average
+	 */
+	struct obd_histogram	cl_read_lat_recent;
+	atomic_t		cl_read_lat_samples;
+	/* moving average of read RPC throughput, in bytes per second */
+	u64			cl_read_bw;
+	/* estimated cost of a 1MiB read from this OST in usec, from the
+	 * two above, used to pick the fastest mirror; 0 until known
+	 */
+	u32			cl_read_cost_us;
+	/* percentile of cl_read_lat_recent after which a non-delay read of
+	 * a mirrored file gives up and tries another mirror, 0 disables it
+	 */
+	u32			cl_read_hedge_pct;
 	ktime_t			cl_batch_stats_init;
 	struct obd_histogram	cl_batch_rpc_hist;
 
@@ -438,6 +463,12 @@ struct lov_obd {
 	struct lov_md_tgt_desc	*lov_mdc_tgts;
 
 	struct kobject		*lov_tgts_kobj;
+
+	/* FLR: read from the mirror measured fastest */
+	bool			lov_mirror_read_select;
+	/* FLR: percent by which another mirror must be faster to switch */
+	unsigned int		lov_mirror_hysteresis;
+	atomic_t		lov_mirror_switches;
 };
 
 #define lmv_tgt_desc lu_tgt_desc
@@ -466,6 +497,13 @@ struct lmv_obd {
 	__u32			lmv_qos_rr_index; /* next round-robin MDT idx */
 	struct rhashtable	lmv_qos_exclude_hash;
 	struct list_head	lmv_qos_exclude_list;
+
+	/* readahead of the dir pages of striped directories */
+	struct workqueue_struct	*lmv_readdir_wq;
+	bool			lmv_readdir_readahead;
+	atomic_t		lmv_ra_rpcs;	/* readpage RPCs read ahead */
+	atomic_t		lmv_ra_pages;	/* pages read ahead */
+	atomic_t		lmv_ra_misses;	/* readpage RPCs waited for */
 };
 
 #define lmv_mdt_count	lmv_mdt_descs.ltd_lmv_desc.ld_tgt_count
@@ -939,6 +977,8 @@ enum md_op_flags {
 	MF_OPNAME_KMALLOCED	= BIT(8),
 	MF_SERVER_ENCCTX	= BIT(9),
 	MF_SERVER_SECCTX	= BIT(10),
+	/* batched getattr in the object found by the previous one */
+	MF_PATH_WALK		= BIT(11),
 };
 
 enum md_cli_flags {
@@ -951,6 +991,10 @@ enum md_cli_flags {
 	CLI_NO_SLOT     = BIT(6),
 	/**< read on open (used for directory for now) */
 	CLI_READ_ON_OPEN = BIT(7),
+	/**< ask for LUDA_ATTRS in readdir pages */
+	CLI_READDIR_PLUS = BIT(8),
+	/**< ask for xattrs in getattr/lookup intent replies */
+	CLI_XATTR_PREFETCH = BIT(9),
 };
 
 enum md_op_code {
@@ -1058,8 +1102,15 @@ struct md_readdir_info {
 	int (*mr_blocking_ast)(struct ldlm_lock *lock,
 			       struct ldlm_lock_desc *desc,
 			       void *data, int flag);
+	/* with CLI_READDIR_PLUS, called for each page read from the MDT once
+	 * it is up to date in the page cache
+	 */
+	void (*mr_readdir_plus)(struct md_readdir_info *mrinfo,
+				struct page *page);
 	/* if striped directory is partially read, the result is stored here */
 	int mr_partial_readdir_rc;
+	/* pages read from the MDT, rather than found in the cache */
+	int mr_pages_read;
 };
 
 struct md_op_item;
@@ -392,6 +392,8 @@ enum lu_dirent_attrs {
 	LUDA_FID		= 0x0001,
 	LUDA_TYPE		= 0x0002,
 	LUDA_64BITHASH		= 0x0004,
+	/* inode attributes, only with OBD_CONNECT2_READDIR_PLUS */
+	LUDA_ATTRS		= 0x0008,
 
 	/* for MDT internal use only, not visible to client */
 
@@ -462,6 +464,32 @@ struct luda_type {
 	__u16 lt_type;
 };
 
+/**
+ * Inode attributes of the entry target, in the same units as struct mdt_body.
+ * Only packed for local non-directory targets, \a lda_valid is a mask of
+ * OBD_MD_FL* flags telling which fields are filled.
+ *
+ * Placed after the (8-byte aligned) record without this attribute, see
+ * lu_dirent_attrs_get().
+ */
+struct luda_attrs {
+	__u64 lda_valid;
+	__u64 lda_size;
+	__u64 lda_blocks;
+	__s64 lda_mtime;
+	__s64 lda_atime;
+	__s64 lda_ctime;
+	__s64 lda_btime;
+	__u32 lda_mode;
+	__u32 lda_uid;
+	__u32 lda_gid;
+	__u32 lda_projid;
+	__u32 lda_nlink;
+	__u32 lda_flags;
+	__u32 lda_rdev;
+	__u32 lda_padding;
+};
+
 struct lu_dirpage {
 	__u64            ldp_hash_start;
 	__u64            ldp_hash_end;
@@ -509,7 +537,11 @@ static inline __kernel_size_t lu_dirent_calc_size(size_t namelen, __u16 attr)
 		size = sizeof(struct lu_dirent) + namelen + 1;
 	}
 
-	return (size + 7) & ~7;
+	size = (size + 7) & ~7;
+	if (attr & LUDA_ATTRS)
+		size += sizeof(struct luda_attrs);
+
+	return size;
 }
 
 static inline __u16 lu_dirent_type_get(struct lu_dirent *ent)
@@ -530,6 +562,18 @@ static inline __u16 lu_dirent_type_get(struct lu_dirent *ent)
 	return type;
 }
 
+static inline struct luda_attrs *lu_dirent_attrs_get(struct lu_dirent *ent)
+{
+	__u32 attrs = __le32_to_cpu(ent->lde_attrs);
+
+	if (!(attrs & LUDA_ATTRS))
+		return NULL;
+
+	return (void *)ent +
+	       lu_dirent_calc_size(__le16_to_cpu(ent->lde_namelen),
+				   attrs & LUDA_TYPE);
+}
+
 #define MDS_DIR_END_OFF 0xfffffffffffffffeULL
 
 /**
@@ -855,6 +899,11 @@ struct ptlrpc_body_v2 {
 #define OBD_CONNECT2_FLR_IMMED_MIRROR 0x20000000000ULL /* client writes mirror*/
 #define OBD_CONNECT2_NO_APPEND        0x40000000000ULL /* O_APPEND locking fix*/
 #define OBD_CONNECT2_FLR_EC_WR        0x80000000000ULL /* write EC support */
+#define OBD_CONNECT2_BATCH_BL_AST    0x100000000000ULL /* multi-lock BL AST */
+#define OBD_CONNECT2_LOCK_STRIDE     0x200000000000ULL /* stride lock hint */
+#define OBD_CONNECT2_READDIR_PLUS    0x400000000000ULL /* LUDA_ATTRS dirents */
+#define OBD_CONNECT2_PATH_WALK       0x800000000000ULL /* batched path lookup */
+#define OBD_CONNECT2_XATTR_PREFETCH 0x1000000000000ULL /* xattrs in getattr */
 /* XXX README XXX README XXX README XXX README XXX README XXX README XXX
  * Please DO NOT add OBD_CONNECT flags before first ensuring that this value
  * is not in use by some other branch/patch.
@@ -928,7 +977,11 @@ struct ptlrpc_body_v2 {
 				OBD_CONNECT2_UNALIGNED_DIO | \
 				OBD_CONNECT2_PCCRO | \
 				OBD_CONNECT2_MIRROR_ID_FIX |\
-				OBD_CONNECT2_READDIR_OPEN)
+				OBD_CONNECT2_READDIR_OPEN | \
+				OBD_CONNECT2_BATCH_BL_AST | \
+				OBD_CONNECT2_READDIR_PLUS | \
+				OBD_CONNECT2_PATH_WALK | \
+				OBD_CONNECT2_XATTR_PREFETCH)
 
 #define OST_CONNECT_SUPPORTED  (OBD_CONNECT_SRVLOCK | OBD_CONNECT_GRANT | \
 				OBD_CONNECT_VERSION | OBD_CONNECT_INDEX | \
@@ -952,7 +1005,9 @@ struct ptlrpc_body_v2 {
 				OBD_CONNECT2_ENCRYPT | OBD_CONNECT2_LSEEK |\
 				OBD_CONNECT2_REP_MBITS |\
 				OBD_CONNECT2_REPLAY_CREATE |\
-				OBD_CONNECT2_UNALIGNED_DIO)
+				OBD_CONNECT2_UNALIGNED_DIO |\
+				OBD_CONNECT2_BATCH_BL_AST |\
+				OBD_CONNECT2_LOCK_STRIDE)
 
 #define ECHO_CONNECT_SUPPORTED (OBD_CONNECT_FID | OBD_CONNECT_FLAGS2)
 #define ECHO_CONNECT_SUPPORTED2 OBD_CONNECT2_REP_MBITS
@@ -2104,6 +2159,12 @@ enum mds_op_bias {
 	/* rename must retry again with target ACLs */
 	MDS_RENAME_AGAIN	= 1 << 26,
 	MDS_NAMEHASH		= 1 << 27,
+	/* intent mkdir: grant EX lock on the new directory, under which the
+	 * client caches creates of its children
+	 */
+	MDS_WBC_LOCK		= 1 << 28,
+	/* create cached by the client under its EX lock on the parent */
+	MDS_WBC_FLUSH		= 1 << 29,
 };
 
 #define MDS_CLOSE_INTENT (MDS_HSM_RELEASE | MDS_CLOSE_LAYOUT_SWAP |         \
@@ -2611,6 +2672,18 @@ static inline bool ldlm_extent_equal(const struct ldlm_extent *ex1,
 	return ex1->start == ex2->start && ex1->end == ex2->end;
 }
 
+/*
+ * Strided access pattern observed by the client, sent along with an extent
+ * lock enqueue (RMF_DLM_STRIDE) to servers supporting OBD_CONNECT2_LOCK_STRIDE.
+ * The client accesses les_bytes at les_offset + N * les_length, in object
+ * offsets.
+ */
+struct ldlm_extent_stride {
+	__u64 les_offset;
+	__u64 les_length;
+	__u64 les_bytes;
+};
+
 struct ldlm_inodebits {
 	enum mds_ibits_locks bits;
 	union {
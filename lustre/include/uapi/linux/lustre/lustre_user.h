@@ -698,6 +698,7 @@ struct ll_ioc_lease_id {
 #define LL_IOC_PCC_STATE		_IOR('f', 252, struct lu_pcc_state)
 #define LL_IOC_PROJECT			_IOW('f', 253, struct lu_project)
 #define LL_IOC_HSM_DATA_VERSION		_IOW('f', 254, struct ioc_data_version)
+#define LL_IOC_PATH_WALK		_IOWR('f', 255, struct lu_path_walk)
 
 #ifndef	FS_IOC_FSGETXATTR
 /*
@@ -2941,6 +2942,13 @@ struct lu_heat {
 	__u64 lh_heat[];
 };
 
+/* LL_IOC_PATH_WALK: look up a path below a directory with a single RPC */
+struct lu_path_walk {
+	__u32	lpw_path_size;	/* size of lpw_path, including the NUL */
+	__u32	lpw_count;	/* out: components looked up on the MDT */
+	char	lpw_path[];	/* path relative to the directory */
+};
+
 enum lu_pcc_type {
 	LU_PCC_NONE		= 0x0,
 	LU_PCC_READWRITE	= 0x01,
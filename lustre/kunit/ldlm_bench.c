@@ -0,0 +1,550 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/completion.h>
+#include <linux/kthread.h>
+#ifdef HAVE_PRANDOM_H
+#include <linux/prandom.h>
+#endif
+#include <lustre_dlm.h>
+#include <obd_support.h>
+#include <obd.h>
+#include <obd_class.h>
+#include <lustre_lib.h>
+#include "../../ldlm/ldlm_internal.h"
+
+#define LUSTRE_TEST_LDLM_DEVICE "ldlm_bench_test"
+
+/*
+ * Multi-threaded microbenchmarks of the lock manager hot paths.
+ *
+ * Every benchmark is run with 10^3 locks and then ten times more, up to
+ * max_locks, each time by 1, 2, 4, ... up to max_threads threads sharing
+ * one namespace. The locks are split evenly between the threads. Results
+ * are reported as ns/op, aggregate ops/s and the speedup over one thread,
+ * giving a scalability curve per lock count.
+ */
+
+static unsigned int max_locks = 1000000;
+module_param(max_locks, uint, 0644);
+MODULE_PARM_DESC(max_locks, "largest number of locks to test, up to 10^7");
+
+static unsigned int max_threads;
+module_param(max_threads, uint, 0644);
+MODULE_PARM_DESC(max_threads, "largest number of threads, default all CPUs");
+
+#define LDLM_BENCH_MIN_LOCKS		1000
+#define LDLM_BENCH_MAX_LOCKS		10000000
+#define LDLM_BENCH_MAX_THREADS		256
+/* locks per resource in the inodebits benchmark */
+#define LDLM_BENCH_IBITS_PER_RES	4
+/* locks cancelled by one LRU scan, as done by the pool shrinker */
+#define LDLM_BENCH_LRU_BATCH		64
+
+static const struct lu_device_type_operations ldlm_test_type_ops;
+
+static struct lu_device_type ldlm_test_device_type = {
+	.ldt_tags     = LU_DEVICE_MISC,
+	.ldt_name     = LUSTRE_TEST_LDLM_DEVICE,
+	.ldt_ops      = &ldlm_test_type_ops,
+	.ldt_ctx_tags = LCT_LOCAL
+};
+
+static const struct obd_ops bench_ops = {
+	.o_owner       = THIS_MODULE,
+};
+
+enum bench {
+	/* grant disjoint PW extent locks, ldlm_process_extent_lock() */
+	BENCH_EXTENT_ENQUEUE,
+	/* check a PW request against granted PR extent locks, this is
+	 * ldlm_extent_compat_queue() on the interval tree
+	 */
+	BENCH_EXTENT_COMPAT,
+	/* enqueue and cancel PR inodebits locks over many resources */
+	BENCH_IBITS,
+	/* cancel unused locks from the namespace LRU */
+	BENCH_LRU_CANCEL,
+
+	NUM_BENCH,
+};
+
+static const char * const bench_names[] = {
+	[BENCH_EXTENT_ENQUEUE]	= "extent_enqueue",
+	[BENCH_EXTENT_COMPAT]	= "extent_compat",
+	[BENCH_IBITS]		= "ibits_enqueue_cancel",
+	[BENCH_LRU_CANCEL]	= "lru_cancel",
+};
+
+struct ldlm_bench;
+
+struct ldlm_bench_thread {
+	struct ldlm_bench	*lbt_bench;
+	unsigned int		 lbt_index;
+	/* operations done and time spent in the measured part */
+	u64			 lbt_ops;
+	s64			 lbt_nsec;
+	int			 lbt_rc;
+};
+
+struct ldlm_bench {
+	struct ldlm_namespace	*lb_ns;
+	enum bench		 lb_bench;
+	/* locks handled by every thread */
+	unsigned int		 lb_locks;
+	struct completion	 lb_ready;
+	struct completion	 lb_start;
+	struct completion	 lb_done;
+	struct ldlm_bench_thread lb_threads[LDLM_BENCH_MAX_THREADS];
+};
+
+/* Start the measured part in all threads at once. */
+static void bench_barrier(struct ldlm_bench *lb)
+{
+	complete(&lb->lb_ready);
+	wait_for_completion(&lb->lb_start);
+}
+
+static void bench_res_id(struct ldlm_res_id *res_id, enum ldlm_type type,
+			 unsigned int thread, u64 idx)
+{
+	memset(res_id, 0, sizeof(*res_id));
+	res_id->name[0] = thread + 1;
+	res_id->name[1] = idx;
+	res_id->name[2] = type;
+}
+
+/* Ask for and grant the lock, true if it was granted. */
+static bool bench_enqueue(struct ldlm_lock *lock, enum ldlm_process_intention
+			  intention)
+{
+	struct ldlm_resource *res = lock->l_resource;
+	ldlm_processing_policy pol = ldlm_get_processing_policy(res);
+	enum ldlm_error err;
+	__u64 flags = 0;
+	int rc;
+
+	lock_res(res);
+	rc = pol(lock, &flags, intention, &err, NULL);
+	unlock_res(res);
+
+	return rc == LDLM_ITER_CONTINUE && ldlm_is_granted(lock);
+}
+
+static void bench_cancel(struct ldlm_lock *lock)
+{
+	ldlm_lock_cancel(lock);
+	ldlm_lock_put(lock);
+}
+
+static void bench_cancel_list(struct list_head *list)
+{
+	struct ldlm_lock *lock;
+
+	while ((lock = list_first_entry_or_null(list, struct ldlm_lock,
+						l_lru)) != NULL) {
+		list_del_init(&lock->l_lru);
+		bench_cancel(lock);
+	}
+}
+
+static struct ldlm_lock *bench_extent_lock(struct ldlm_resource *res,
+					   enum ldlm_mode mode,
+					   u64 start, u64 end)
+{
+	struct ldlm_lock *lock = ldlm_lock_new_testing(res);
+
+	if (!lock)
+		return NULL;
+
+	/* dropped when the lock is freed */
+	refcount_inc(&res->lr_refcount);
+	lock->l_req_mode = mode;
+	lock->l_policy_data.l_extent.start = start;
+	lock->l_policy_data.l_extent.end = end;
+	lock->l_policy_data.l_extent.gid = 0;
+	lock->l_req_extent = lock->l_policy_data.l_extent;
+
+	return lock;
+}
+
+/* Grant @count disjoint one page locks with a one page gap between them. */
+static int bench_extent_fill(struct ldlm_resource *res, enum ldlm_mode mode,
+			     unsigned int count, struct list_head *list)
+{
+	struct ldlm_lock *lock;
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		u64 start = (u64)i * 2 * PAGE_SIZE;
+
+		lock = bench_extent_lock(res, mode, start,
+					 start + PAGE_SIZE - 1);
+		if (!lock)
+			return -ENOMEM;
+
+		if (!bench_enqueue(lock, LDLM_PROCESS_ENQUEUE)) {
+			bench_cancel(lock);
+			return -EINVAL;
+		}
+		list_add_tail(&lock->l_lru, list);
+	}
+
+	return 0;
+}
+
+static int bench_extent_enqueue(struct ldlm_bench_thread *lbt,
+				struct ldlm_resource *res)
+{
+	LIST_HEAD(list);
+	ktime_t start;
+	int rc;
+
+	start = ktime_get();
+	rc = bench_extent_fill(res, LCK_PW, lbt->lbt_bench->lb_locks, &list);
+	lbt->lbt_nsec = ktime_to_ns(ktime_sub(ktime_get(), start));
+	lbt->lbt_ops = lbt->lbt_bench->lb_locks;
+
+	bench_cancel_list(&list);
+
+	return rc;
+}
+
+static int bench_extent_compat(struct ldlm_bench_thread *lbt,
+			       struct ldlm_resource *res)
+{
+	unsigned int count = lbt->lbt_bench->lb_locks;
+	struct ldlm_lock *req;
+	struct rnd_state rstate;
+	LIST_HEAD(list);
+	ktime_t start;
+	unsigned int i;
+	int rc;
+
+	prandom_seed_state(&rstate, 42 + lbt->lbt_index);
+
+	rc = bench_extent_fill(res, LCK_PR, count, &list);
+	if (rc)
+		GOTO(out, rc);
+
+	req = bench_extent_lock(res, LCK_PW, 0, 0);
+	if (!req)
+		GOTO(out, rc = -ENOMEM);
+
+	/* every request overlaps one granted lock, so it is never granted
+	 * and the same lock can be checked again
+	 */
+	start = ktime_get();
+	for (i = 0; i < count; i++) {
+		u64 pos = (u64)(prandom_u32_state(&rstate) % count) * 2 *
+			  PAGE_SIZE;
+
+		req->l_policy_data.l_extent.start = pos;
+		req->l_policy_data.l_extent.end = pos + PAGE_SIZE - 1;
+		req->l_req_extent = req->l_policy_data.l_extent;
+		if (bench_enqueue(req, LDLM_PROCESS_RESCAN)) {
+			rc = -EINVAL;
+			break;
+		}
+	}
+	lbt->lbt_nsec = ktime_to_ns(ktime_sub(ktime_get(), start));
+	lbt->lbt_ops = i;
+
+	bench_cancel(req);
+out:
+	bench_cancel_list(&list);
+
+	return rc;
+}
+
+static int bench_ibits(struct ldlm_bench_thread *lbt)
+{
+	struct ldlm_namespace *ns = lbt->lbt_bench->lb_ns;
+	unsigned int count = lbt->lbt_bench->lb_locks;
+	struct ldlm_resource *res;
+	struct ldlm_res_id res_id;
+	struct ldlm_lock *lock;
+	LIST_HEAD(list);
+	ktime_t start;
+	unsigned int i;
+	int rc = 0;
+
+	start = ktime_get();
+	for (i = 0; i < count; i++) {
+		bench_res_id(&res_id, LDLM_IBITS, lbt->lbt_index,
+			     i / LDLM_BENCH_IBITS_PER_RES);
+		res = ldlm_resource_get(ns, &res_id, LDLM_IBITS, 1);
+		if (IS_ERR(res)) {
+			rc = PTR_ERR(res);
+			break;
+		}
+
+		/* the lock takes over the resource reference */
+		lock = ldlm_lock_new_testing(res);
+		if (!lock) {
+			ldlm_resource_putref(res);
+			rc = -ENOMEM;
+			break;
+		}
+		lock->l_req_mode = LCK_PR;
+		lock->l_policy_data.l_inodebits.bits = MDS_INODELOCK_LOOKUP |
+						       MDS_INODELOCK_UPDATE;
+		if (!bench_enqueue(lock, LDLM_PROCESS_ENQUEUE)) {
+			bench_cancel(lock);
+			rc = -EINVAL;
+			break;
+		}
+		list_add_tail(&lock->l_lru, &list);
+	}
+	bench_cancel_list(&list);
+	lbt->lbt_nsec = ktime_to_ns(ktime_sub(ktime_get(), start));
+	lbt->lbt_ops = i;
+
+	return rc;
+}
+
+static int bench_lru_cancel(struct ldlm_bench_thread *lbt,
+			    struct ldlm_resource *res)
+{
+	struct ldlm_namespace *ns = lbt->lbt_bench->lb_ns;
+	struct lustre_handle lockh;
+	struct ldlm_lock *lock;
+	LIST_HEAD(list);
+	ktime_t start;
+	int rc;
+
+	rc = bench_extent_fill(res, LCK_PR, lbt->lbt_bench->lb_locks, &list);
+	if (rc)
+		bench_cancel_list(&list);
+
+	/* the last decref puts the lock into the LRU, the lock is then only
+	 * referenced until it is cancelled
+	 */
+	while ((lock = list_first_entry_or_null(&list, struct ldlm_lock,
+						l_lru)) != NULL) {
+		list_del_init(&lock->l_lru);
+		ldlm_lock2handle(lock, &lockh);
+		ldlm_lock_addref(&lockh, LCK_PR);
+		ldlm_lock_decref(&lockh, LCK_PR);
+		ldlm_lock_put(lock);
+	}
+
+	/* wait for all threads to fill the LRU, then drain it together */
+	bench_barrier(lbt->lbt_bench);
+	if (rc)
+		return rc;
+
+	start = ktime_get();
+	while (READ_ONCE(ns->ns_nr_unused) > 0) {
+		LIST_HEAD(cancels);
+
+		ldlm_cancel_lru_local(ns, &cancels, LDLM_BENCH_LRU_BATCH,
+				      LDLM_BENCH_LRU_BATCH, LCF_LOCAL, 0);
+		cond_resched();
+	}
+	lbt->lbt_nsec = ktime_to_ns(ktime_sub(ktime_get(), start));
+	lbt->lbt_ops = lbt->lbt_bench->lb_locks;
+
+	return 0;
+}
+
+static int ldlm_bench_thread_main(void *data)
+{
+	struct ldlm_bench_thread *lbt = data;
+	struct ldlm_bench *lb = lbt->lbt_bench;
+	struct ldlm_resource *res = NULL;
+	struct ldlm_res_id res_id;
+	int rc;
+
+	if (lb->lb_bench != BENCH_IBITS) {
+		bench_res_id(&res_id, LDLM_EXTENT, lbt->lbt_index, 0);
+		res = ldlm_resource_get(lb->lb_ns, &res_id, LDLM_EXTENT, 1);
+		if (IS_ERR(res)) {
+			lbt->lbt_rc = PTR_ERR(res);
+			res = NULL;
+		}
+	}
+
+	/* the LRU benchmark has to fill the LRU before the start */
+	if (lb->lb_bench != BENCH_LRU_CANCEL || !res)
+		bench_barrier(lb);
+	if (lb->lb_bench != BENCH_IBITS && !res)
+		GOTO(out, rc = lbt->lbt_rc);
+
+	switch (lb->lb_bench) {
+	case BENCH_EXTENT_ENQUEUE:
+		rc = bench_extent_enqueue(lbt, res);
+		break;
+	case BENCH_EXTENT_COMPAT:
+		rc = bench_extent_compat(lbt, res);
+		break;
+	case BENCH_IBITS:
+		rc = bench_ibits(lbt);
+		break;
+	case BENCH_LRU_CANCEL:
+		rc = bench_lru_cancel(lbt, res);
+		break;
+	default:
+		rc = -EINVAL;
+		break;
+	}
+
+	if (res)
+		ldlm_resource_putref(res);
+out:
+	lbt->lbt_rc = rc;
+	complete(&lb->lb_done);
+
+	return 0;
+}
+
+/* Run one benchmark with @threads threads, return the wall clock time. */
+static s64 ldlm_bench_run(struct ldlm_bench *lb, unsigned int threads,
+			  u64 *ops, int *rc)
+{
+	struct task_struct *task;
+	unsigned int started = 0;
+	s64 nsec = 0;
+	unsigned int i;
+
+	init_completion(&lb->lb_ready);
+	init_completion(&lb->lb_start);
+	init_completion(&lb->lb_done);
+	*ops = 0;
+	*rc = 0;
+
+	for (i = 0; i < threads; i++) {
+		struct ldlm_bench_thread *lbt = &lb->lb_threads[i];
+
+		memset(lbt, 0, sizeof(*lbt));
+		lbt->lbt_bench = lb;
+		lbt->lbt_index = i;
+		task = kthread_run(ldlm_bench_thread_main, lbt,
+				   "ldlm_bench_%02u", i);
+		if (IS_ERR(task)) {
+			*rc = PTR_ERR(task);
+			break;
+		}
+		started++;
+	}
+
+	for (i = 0; i < started; i++)
+		wait_for_completion(&lb->lb_ready);
+	complete_all(&lb->lb_start);
+	for (i = 0; i < started; i++)
+		wait_for_completion(&lb->lb_done);
+
+	for (i = 0; i < started; i++) {
+		struct ldlm_bench_thread *lbt = &lb->lb_threads[i];
+
+		if (lbt->lbt_rc && !*rc)
+			*rc = lbt->lbt_rc;
+		*ops += lbt->lbt_ops;
+		/* the threads start together, the slowest one ends the run */
+		nsec = max(nsec, lbt->lbt_nsec);
+	}
+
+	return nsec ?: 1;
+}
+
+static void ldlm_bench_one(struct ldlm_bench *lb, unsigned int locks,
+			   unsigned int nthreads)
+{
+	u64 base_rate = 0;
+	unsigned int threads;
+	unsigned int next;
+
+	for (threads = 1; threads <= nthreads; threads = next) {
+		u64 ops, rate;
+		s64 nsec;
+		int rc;
+
+		lb->lb_locks = max(locks / threads, 1U);
+		nsec = ldlm_bench_run(lb, threads, &ops, &rc);
+		if (rc) {
+			pr_info("ldlm_bench: %s locks=%u threads=%u failed: rc = %d\n",
+				bench_names[lb->lb_bench], locks, threads, rc);
+			return;
+		}
+
+		rate = div64_u64(ops * NSEC_PER_SEC, nsec);
+		if (threads == 1)
+			base_rate = rate ?: 1;
+		pr_info("ldlm_bench: %s locks=%u threads=%u ns/op=%llu ops/s=%llu speedup=%llu.%02llu\n",
+			bench_names[lb->lb_bench], locks, threads,
+			div64_u64((u64)nsec * threads, ops ?: 1), rate,
+			div64_u64(rate, base_rate),
+			div64_u64(rate * 100, base_rate) % 100);
+
+		/* always end the curve with all the threads */
+		next = threads * 2;
+		if (threads < nthreads && next > nthreads)
+			next = nthreads;
+		cond_resched();
+	}
+}
+
+static int ldlm_bench_init(void)
+{
+	char *name, *uuid;
+	struct obd_device *obd;
+	struct ldlm_bench *lb;
+	unsigned int nthreads;
+	unsigned int locks;
+
+	max_locks = clamp_t(unsigned int, max_locks, LDLM_BENCH_MIN_LOCKS,
+			    LDLM_BENCH_MAX_LOCKS);
+	nthreads = max_threads ?: num_online_cpus();
+	nthreads = clamp_t(unsigned int, nthreads, 1, LDLM_BENCH_MAX_THREADS);
+
+	OBD_ALLOC_PTR(lb);
+	if (!lb)
+		return -ENOMEM;
+
+	class_register_type(&bench_ops, NULL, false,
+			    LUSTRE_TEST_LDLM_DEVICE,
+			    &ldlm_test_device_type);
+
+	OBD_ALLOC(name, MAX_OBD_NAME);
+	OBD_ALLOC(uuid, MAX_OBD_NAME);
+	strscpy(name, "test", MAX_OBD_NAME);
+	snprintf(uuid, MAX_OBD_NAME, "%s_UUID", name);
+
+	obd = class_attach_name(LUSTRE_TEST_LDLM_DEVICE, name, uuid);
+	lb->lb_ns = ldlm_namespace_new(obd, "bench-test",
+				       LDLM_NAMESPACE_CLIENT,
+				       LDLM_NAMESPACE_MODEST,
+				       LDLM_NS_TYPE_MDT);
+
+	pr_info("ldlm_bench: max_locks=%u max_threads=%u sizeof(struct ldlm_lock)=%lu\n",
+		max_locks, nthreads, sizeof(struct ldlm_lock));
+	for (lb->lb_bench = 0; lb->lb_bench < NUM_BENCH; lb->lb_bench++) {
+		pr_info("ldlm_bench: start %s\n", bench_names[lb->lb_bench]);
+		for (locks = LDLM_BENCH_MIN_LOCKS; locks <= max_locks;
+		     locks *= 10)
+			ldlm_bench_one(lb, locks, nthreads);
+		pr_info("ldlm_bench: %s ended\n", bench_names[lb->lb_bench]);
+	}
+
+	class_detach(obd);
+
+	OBD_FREE(name, MAX_OBD_NAME);
+	OBD_FREE(uuid, MAX_OBD_NAME);
+
+	ldlm_namespace_free_post(lb->lb_ns);
+	class_unregister_type(LUSTRE_TEST_LDLM_DEVICE);
+	OBD_FREE_PTR(lb);
+
+	return 0;
+}
+
+static void ldlm_bench_exit(void)
+{
+}
+
+MODULE_DESCRIPTION("Lustre ldlm multi-threaded performance test");
+MODULE_LICENSE("GPL");
+
+module_init(ldlm_bench_init);
+module_exit(ldlm_bench_exit);
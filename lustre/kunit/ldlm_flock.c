@@ -0,0 +1,381 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <lustre_dlm.h>
+#include <lustre_net.h>
+#include <obd_support.h>
+#include <obd.h>
+#include <obd_class.h>
+#include <lustre_lib.h>
+#include "../../ldlm/ldlm_internal.h"
+
+#define LUSTRE_TEST_LDLM_DEVICE "ldlm_flock_test"
+
+/*
+ * Performance tests for the server side of ldlm_flock with blocked owners.
+ *
+ * A wait-for chain of length N is built on one resource: owners 1..N+1
+ * each hold a write lock on their own record, and owners 1..N each wait
+ * for the record of the next owner. Owners are spread over a few fake
+ * client exports, so the deadlock detection hashes them by NID and owner
+ * like it does for real clients. Every test then times one request that
+ * conflicts with owner 1:
+ *  - nowait:   F_SETLK, refused without looking at the wait-for graph;
+ *  - block:    F_SETLKW from a new owner, walks the whole chain, finds no
+ *              deadlock and is queued, then cancelled;
+ *  - deadlock: F_SETLKW from owner N+1, walks the whole chain back to
+ *              itself and is refused with -EDEADLK.
+ */
+
+static const struct lu_device_type_operations ldlm_test_type_ops;
+
+static struct lu_device_type ldlm_test_device_type = {
+	.ldt_tags     = LU_DEVICE_MISC,
+	.ldt_name     = LUSTRE_TEST_LDLM_DEVICE,
+	.ldt_ops      = &ldlm_test_type_ops,
+	.ldt_ctx_tags = LCT_LOCAL
+};
+
+static const struct obd_ops flock_ops = {
+	.o_owner       = THIS_MODULE,
+};
+
+static struct ldlm_res_id RES_ID = {
+	.name = {1, 2, 3, 4},
+};
+
+/* size of the record every owner locks */
+#define RECORD_SIZE		4096
+/* fake client nodes the owners are spread over */
+#define FLOCK_CLIENTS		16
+#define FLOCK_MIN_CHAIN		10
+#define FLOCK_MAX_CHAIN		10000
+#define FLOCK_LOOPS		5
+/* time every loop runs for */
+#define FLOCK_LOOP_MS		1000
+
+enum tests {
+	TEST_NOWAIT,
+	TEST_BLOCK,
+	TEST_DEADLOCK,
+
+	NUM_TESTS,
+};
+
+static const char * const test_names[NUM_TESTS] = {
+	[TEST_NOWAIT]	= "nowait",
+	[TEST_BLOCK]	= "block",
+	[TEST_DEADLOCK]	= "deadlock",
+};
+
+struct flock_bench {
+	struct ldlm_namespace		*fb_ns;
+	struct ldlm_resource		*fb_res;
+	ldlm_processing_policy		 fb_policy;
+	struct obd_export		*fb_exp[FLOCK_CLIENTS];
+	struct ptlrpc_connection	 fb_conn[FLOCK_CLIENTS];
+	/* indexed by owner, owner 0 is unused */
+	struct ldlm_lock		**fb_granted;
+	struct ldlm_lock		**fb_blocked;
+};
+
+/*
+ * Exports of fake clients. They only need what the flock code and the lock
+ * reference tracking look at, and are never put to zero: the benchmark
+ * frees them once all locks are gone.
+ */
+static struct obd_export *flock_export_new(struct obd_device *obd,
+					   struct ptlrpc_connection *conn,
+					   unsigned int client)
+{
+	struct obd_export *exp;
+
+	OBD_ALLOC_PTR(exp);
+	if (!exp)
+		return NULL;
+
+	refcount_set(&exp->exp_handle.h_ref, 1);
+	atomic_set(&exp->exp_locks_count, 0);
+#if LUSTRE_TRACKS_LOCK_EXP_REFS
+	INIT_LIST_HEAD(&exp->exp_locks_list);
+	spin_lock_init(&exp->exp_locks_list_guard);
+#endif
+	spin_lock_init(&exp->exp_lock);
+	exp->exp_obd = obd;
+	exp->exp_connect_data.ocd_connect_flags = OBD_CONNECT_FLOCK_DEAD;
+
+	atomic_set(&conn->c_refcount, 1);
+	lnet_nid4_to_nid(LNET_MKNID(LNET_MKNET(SOCKLND, 0), client + 1),
+			 &conn->c_peer.nid);
+	exp->exp_connection = conn;
+
+	return exp;
+}
+
+/*
+ * Enqueue a write lock of \a owner on record \a rec.
+ *
+ * \retval 0 the lock is granted or blocked, returned in \a lockp
+ * \retval negative the request was refused and destroyed
+ */
+static int flock_enqueue(struct flock_bench *fb, __u64 owner, u64 rec,
+			 __u64 flags, struct ldlm_lock **lockp)
+{
+	struct obd_export *exp = fb->fb_exp[owner % FLOCK_CLIENTS];
+	struct ldlm_lock *lock;
+	enum ldlm_error err;
+
+	lock = ldlm_lock_new_testing(fb->fb_res);
+	if (!lock)
+		return -ENOMEM;
+
+	refcount_inc(&fb->fb_res->lr_refcount);
+	lock->l_export = class_export_lock_get(exp, lock);
+	lock->l_req_mode = LCK_PW;
+	lock->l_policy_data.l_flock.owner = owner;
+	lock->l_policy_data.l_flock.pid = owner;
+	lock->l_policy_data.l_flock.start = rec * RECORD_SIZE;
+	lock->l_policy_data.l_flock.end = (rec + 1) * RECORD_SIZE - 1;
+
+	lock_res_and_lock(lock);
+	fb->fb_policy(lock, &flags, LDLM_PROCESS_ENQUEUE, &err, NULL);
+	unlock_res_and_lock(lock);
+
+	if (err != ELDLM_OK) {
+		ldlm_lock_put(lock);
+		return err;
+	}
+
+	*lockp = lock;
+	return 0;
+}
+
+static void flock_cancel(struct ldlm_lock *lock)
+{
+	ldlm_lock_cancel(lock);
+	ldlm_lock_put(lock);
+}
+
+static void flock_chain_fini(struct flock_bench *fb, unsigned int chain)
+{
+	unsigned int i;
+
+	/* waiters first, granted locks are not reprocessed on cancel */
+	for (i = 1; i <= chain + 1; i++) {
+		if (fb->fb_blocked[i]) {
+			flock_cancel(fb->fb_blocked[i]);
+			fb->fb_blocked[i] = NULL;
+		}
+	}
+	for (i = 1; i <= chain + 1; i++) {
+		if (fb->fb_granted[i]) {
+			flock_cancel(fb->fb_granted[i]);
+			fb->fb_granted[i] = NULL;
+		}
+	}
+}
+
+static int flock_chain_init(struct flock_bench *fb, unsigned int chain)
+{
+	unsigned int i;
+	int rc;
+
+	for (i = 1; i <= chain + 1; i++) {
+		rc = flock_enqueue(fb, i, i, 0, &fb->fb_granted[i]);
+		if (rc)
+			GOTO(out, rc);
+		if (!ldlm_is_granted(fb->fb_granted[i]))
+			GOTO(out, rc = -EBUSY);
+	}
+
+	/* owner i waits for owner i + 1 */
+	for (i = 1; i <= chain; i++) {
+		rc = flock_enqueue(fb, i, i + 1, 0, &fb->fb_blocked[i]);
+		if (rc)
+			GOTO(out, rc);
+		if (ldlm_is_granted(fb->fb_blocked[i]))
+			GOTO(out, rc = -EINVAL);
+	}
+
+	return 0;
+out:
+	flock_chain_fini(fb, chain);
+	return rc;
+}
+
+/* One request conflicting with the head of the chain */
+static int flock_test_one(struct flock_bench *fb, enum tests tnum,
+			  unsigned int chain)
+{
+	struct ldlm_lock *lock = NULL;
+	int rc;
+
+	switch (tnum) {
+	case TEST_NOWAIT:
+		rc = flock_enqueue(fb, chain + 2, 1, LDLM_FL_BLOCK_NOWAIT,
+				   &lock);
+		if (rc == -EAGAIN)
+			return 0;
+		if (rc == 0)
+			flock_cancel(lock);
+		return -EINVAL;
+	case TEST_BLOCK:
+		rc = flock_enqueue(fb, chain + 2, 1, 0, &lock);
+		if (rc)
+			return rc;
+		rc = ldlm_is_granted(lock) ? -EINVAL : 0;
+		flock_cancel(lock);
+		return rc;
+	case TEST_DEADLOCK:
+		rc = flock_enqueue(fb, chain + 1, 1, 0, &lock);
+		if (rc == -EDEADLK)
+			return 0;
+		if (rc == 0)
+			flock_cancel(lock);
+		return -EINVAL;
+	case NUM_TESTS:
+		break;
+	}
+
+	return -EINVAL;
+}
+
+static void flock_test(struct flock_bench *fb, enum tests tnum,
+		       unsigned int chain)
+{
+	u64 sum = 0, sumsq = 0, ops = 0;
+	unsigned long stddev;
+	int loops;
+	int rc;
+
+	rc = flock_chain_init(fb, chain);
+	if (rc) {
+		pr_info("ldlm_flock: %s chain=%u setup failed: rc = %d\n",
+			test_names[tnum], chain, rc);
+		return;
+	}
+
+	for (loops = 0; loops < FLOCK_LOOPS; loops++) {
+		ktime_t start, now;
+		u64 nsec;
+		u64 i;
+
+		start = ktime_get();
+		for (i = 0; ; i++) {
+			rc = flock_test_one(fb, tnum, chain);
+			if (rc) {
+				pr_info("ldlm_flock: %s chain=%u unexpected result: rc = %d\n",
+					test_names[tnum], chain, rc);
+				GOTO(out, rc);
+			}
+			now = ktime_get();
+			if (ktime_ms_delta(now, start) > FLOCK_LOOP_MS)
+				break;
+			cond_resched();
+		}
+		i++;
+		nsec = ktime_to_ns(ktime_sub(now, start)) / i;
+		sum += nsec;
+		sumsq += nsec * nsec;
+		ops += i;
+	}
+
+	stddev = int_sqrt((sumsq - sum * sum / loops) / (loops - 1));
+	pr_info("ldlm_flock: %s chain=%u waiters=%u ops=%llu mean=%llu stddev=%lu ns/op\n",
+		test_names[tnum], chain,
+		atomic_read(&fb->fb_ns->ns_flock_waiters.ht.nelems), ops,
+		sum / loops, stddev);
+out:
+	flock_chain_fini(fb, chain);
+}
+
+static int ldlm_flock_init(void)
+{
+	struct flock_bench *fb;
+	struct obd_device *obd;
+	char *name, *uuid;
+	enum tests tnum;
+	unsigned int chain;
+	int rc = 0;
+	int i;
+
+	OBD_ALLOC_PTR(fb);
+	if (!fb)
+		return -ENOMEM;
+	OBD_ALLOC_PTR_ARRAY_LARGE(fb->fb_granted, FLOCK_MAX_CHAIN + 2);
+	OBD_ALLOC_PTR_ARRAY_LARGE(fb->fb_blocked, FLOCK_MAX_CHAIN + 2);
+	if (!fb->fb_granted || !fb->fb_blocked)
+		GOTO(out_free, rc = -ENOMEM);
+
+	class_register_type(&flock_ops, NULL, false,
+			    LUSTRE_TEST_LDLM_DEVICE,
+			    &ldlm_test_device_type);
+
+	OBD_ALLOC(name, MAX_OBD_NAME);
+	OBD_ALLOC(uuid, MAX_OBD_NAME);
+	strscpy(name, "test", MAX_OBD_NAME);
+	snprintf(uuid, MAX_OBD_NAME, "%s_UUID", name);
+
+	obd = class_attach_name(LUSTRE_TEST_LDLM_DEVICE, name, uuid);
+	/* the wait-for graph only exists on the server */
+	fb->fb_ns = ldlm_namespace_new(obd, "flock-test",
+				       LDLM_NAMESPACE_SERVER,
+				       LDLM_NAMESPACE_MODEST,
+				       LDLM_NS_TYPE_MDT);
+	fb->fb_res = ldlm_resource_get(fb->fb_ns, &RES_ID, LDLM_FLOCK, 1);
+	fb->fb_policy = ldlm_get_processing_policy(fb->fb_res);
+
+	for (i = 0; i < FLOCK_CLIENTS; i++) {
+		fb->fb_exp[i] = flock_export_new(obd, &fb->fb_conn[i], i);
+		if (!fb->fb_exp[i])
+			GOTO(out_exp, rc = -ENOMEM);
+	}
+
+	for (tnum = 0; tnum < NUM_TESTS; tnum++) {
+		pr_info("ldlm_flock: start %s\n", test_names[tnum]);
+		for (chain = FLOCK_MIN_CHAIN; chain <= FLOCK_MAX_CHAIN;
+		     chain *= 10)
+			flock_test(fb, tnum, chain);
+		pr_info("ldlm_flock: %s ended\n", test_names[tnum]);
+	}
+
+out_exp:
+	for (i = 0; i < FLOCK_CLIENTS; i++) {
+		struct obd_export *exp = fb->fb_exp[i];
+
+		if (!exp)
+			continue;
+		/* a leaked lock would still point here */
+		if (atomic_read(&exp->exp_locks_count))
+			pr_info("ldlm_flock: client %d leaked %d locks\n", i,
+				atomic_read(&exp->exp_locks_count));
+		else
+			OBD_FREE_PTR(exp);
+	}
+
+	ldlm_resource_putref(fb->fb_res);
+	class_detach(obd);
+
+	OBD_FREE(name, MAX_OBD_NAME);
+	OBD_FREE(uuid, MAX_OBD_NAME);
+
+	ldlm_namespace_free_post(fb->fb_ns);
+	class_unregister_type(LUSTRE_TEST_LDLM_DEVICE);
+out_free:
+	OBD_FREE_PTR_ARRAY_LARGE(fb->fb_granted, FLOCK_MAX_CHAIN + 2);
+	OBD_FREE_PTR_ARRAY_LARGE(fb->fb_blocked, FLOCK_MAX_CHAIN + 2);
+	OBD_FREE_PTR(fb);
+
+	return rc;
+}
+
+static void ldlm_flock_exit(void)
+{
+}
+
+MODULE_DESCRIPTION("Lustre ldlm_flock wait-for graph performance test");
+MODULE_LICENSE("GPL");
+
+module_init(ldlm_flock_init);
+module_exit(ldlm_flock_exit);
@@ -21,6 +21,7 @@
   * Currently supported policies:
   * - LRU (Least Recently Used)
   * - LFRU (Least Frequently and Recently Used)
+  * - ARC (Adaptive Replacement Cache)
   */
 
  #define DEBUG_SUBSYSTEM S_LDLM
@@ -216,3 +217,259 @@ struct ldlm_lock_cache_ops ldlm_lfru_cache_ops = {
 	.llco_demote_lock = ldlm_lfru_demote_lock,
 	.llco_try_batch_demote_locks = ldlm_lfru_try_batch_demote_locks,
 };
+
+/* ==================== ARC Implementation ==================== */
+
+/*
+ * Adaptive Replacement Cache, see Megiddo & Modha, "ARC: A Self-Tuning, Low
+ * Overhead Replacement Cache", FAST '03.
+ *
+ * - T1 is ns_unused_normal_list, locks put in the LRU for the first time;
+ * - T2 is ns_unused_priv_list, locks reused or matched while in the LRU
+ *   (l_lru_score > 1);
+ * - B1 and B2 are the ghost lists, with the resource IDs of locks cancelled
+ *   from T1 and T2.
+ *
+ * A lock on a resource found in B1 means T1 was too small, so the recency
+ * target ns_arc_target grows; found in B2 the target shrinks in favour of T2.
+ * Either way the lock goes straight to T2 as it was seen before. A scan over
+ * the LRU (find, backup, rsync) only ever fills T1 and B1, so it cannot push
+ * the reused locks of T2 out unless B1 hits say that T1 needs the room.
+ *
+ * ldlm_prepare_lru_list() only cancels locks from T1, so once T1 is within
+ * its target the LRU end of T2 is moved to the head of T1 to be cancelled
+ * next.
+ */
+struct ldlm_arc_ghost {
+	struct rhash_head	ag_hash;
+	struct list_head	ag_list;
+	struct ldlm_res_id	ag_name;
+	bool			ag_frequent;
+	struct rcu_head		ag_rcu;
+};
+
+static const struct rhashtable_params ldlm_arc_ghost_params = {
+	.key_len	= sizeof(struct ldlm_res_id),
+	.key_offset	= offsetof(struct ldlm_arc_ghost, ag_name),
+	.head_offset	= offsetof(struct ldlm_arc_ghost, ag_hash),
+	.automatic_shrinking = true,
+};
+
+/* number of locks ARC assumes the LRU can hold */
+static unsigned int ldlm_arc_capacity(struct ldlm_namespace *ns)
+{
+	return max(ns->ns_max_unused ?: LDLM_DEFAULT_LRU_SIZE,
+		   ns->ns_nr_unused);
+}
+
+static void ldlm_arc_ghost_del(struct ldlm_namespace *ns,
+			       struct ldlm_arc_ghost *ag)
+{
+	rhashtable_remove_fast(&ns->ns_arc_ghost_hash, &ag->ag_hash,
+			       ldlm_arc_ghost_params);
+	list_del(&ag->ag_list);
+	if (ag->ag_frequent)
+		ns->ns_arc_nr_ghost_frequent--;
+	else
+		ns->ns_arc_nr_ghost_recent--;
+	OBD_FREE_RCU(ag, sizeof(*ag), ag_rcu);
+}
+
+/* Keep |T1| + |B1| <= c and |T1| + |T2| + |B1| + |B2| <= 2c */
+static void ldlm_arc_ghost_trim(struct ldlm_namespace *ns)
+{
+	unsigned int c = ldlm_arc_capacity(ns);
+	unsigned int t1 = ns->ns_nr_unused - ns->ns_nr_priv;
+
+	while (ns->ns_arc_nr_ghost_recent > 0 &&
+	       t1 + ns->ns_arc_nr_ghost_recent > c)
+		ldlm_arc_ghost_del(ns,
+				   list_first_entry(&ns->ns_arc_ghost_recent,
+						    struct ldlm_arc_ghost,
+						    ag_list));
+
+	while (ns->ns_arc_nr_ghost_frequent > 0 &&
+	       ns->ns_nr_unused + ns->ns_arc_nr_ghost_recent +
+	       ns->ns_arc_nr_ghost_frequent > 2 * c)
+		ldlm_arc_ghost_del(ns,
+				   list_first_entry(&ns->ns_arc_ghost_frequent,
+						    struct ldlm_arc_ghost,
+						    ag_list));
+}
+
+/* Adapt the T1 target to a ghost hit, then forget the ghost */
+static void ldlm_arc_ghost_hit(struct ldlm_namespace *ns,
+			       struct ldlm_arc_ghost *ag)
+{
+	unsigned int c = ldlm_arc_capacity(ns);
+	unsigned int delta;
+
+	if (ag->ag_frequent) {
+		delta = max(ns->ns_arc_nr_ghost_recent /
+			    ns->ns_arc_nr_ghost_frequent, 1U);
+		ns->ns_arc_target -= min(delta, ns->ns_arc_target);
+	} else {
+		delta = max(ns->ns_arc_nr_ghost_frequent /
+			    ns->ns_arc_nr_ghost_recent, 1U);
+		ns->ns_arc_target = min(ns->ns_arc_target + delta, c);
+	}
+	lprocfs_counter_incr(ns->ns_stats, LDLM_NSS_LRU_GHOST_HITS);
+	ldlm_arc_ghost_del(ns, ag);
+}
+
+static void ldlm_arc_add_lock(struct ldlm_namespace *ns,
+			      struct ldlm_lock *lock)
+{
+	struct ldlm_arc_ghost *ag;
+
+	if (lock->l_lru_score == 0) {
+		ag = rhashtable_lookup_fast(&ns->ns_arc_ghost_hash,
+					    &lock->l_resource->lr_name,
+					    ldlm_arc_ghost_params);
+		if (ag) {
+			ldlm_arc_ghost_hit(ns, ag);
+			lock->l_lru_score = 1;
+		}
+	}
+
+	ns->ns_nr_unused++;
+	lock->l_lru_score = min_t(int, lock->l_lru_score + 1,
+				  LDLM_LFRU_PRIV_THRESH_CAP);
+	if (lock->l_lru_score > 1) {
+		list_add_tail(&lock->l_lru, &ns->ns_unused_priv_list);
+		ns->ns_nr_priv++;
+		lock->l_lru_type = LRU_PRIV;
+	} else {
+		list_add_tail(&lock->l_lru, &ns->ns_unused_normal_list);
+		lock->l_lru_type = LRU_NORMAL_LIST;
+	}
+}
+
+static void ldlm_arc_demote_lock(struct ldlm_namespace *ns,
+				 struct ldlm_lock *lock)
+{
+	LASSERT(lock->l_lru_type == LRU_PRIV);
+	ldlm_lfru_remove_lock(ns, lock);
+	/*
+	 * Put it at the head of T1 to be cancelled next, l_lru_score is kept
+	 * so that it is remembered in B2 and goes back to T2 if reused.
+	 */
+	ns->ns_nr_unused++;
+	list_add(&lock->l_lru, &ns->ns_unused_normal_list);
+	lock->l_lru_type = LRU_NORMAL_LIST;
+}
+
+static int ldlm_arc_try_batch_demote_locks(struct ldlm_namespace *ns,
+					   int batch_size)
+{
+	int evicts = 0;
+
+	while (evicts < batch_size &&
+	       !list_empty(&ns->ns_unused_priv_list)) {
+		/* T1 is above its target, cancel from T1 */
+		if (batch_size != INT_MAX &&
+		    ns->ns_nr_unused - ns->ns_nr_priv > ns->ns_arc_target)
+			break;
+
+		ldlm_arc_demote_lock(ns,
+				     list_first_entry(&ns->ns_unused_priv_list,
+						      struct ldlm_lock, l_lru));
+		evicts++;
+	}
+
+	return evicts;
+}
+
+static void ldlm_arc_evict_lock(struct ldlm_namespace *ns,
+				struct ldlm_lock *lock)
+{
+	struct ldlm_res_id *name = &lock->l_resource->lr_name;
+	bool frequent = lock->l_lru_score > 1;
+	struct ldlm_arc_ghost *ag;
+
+	ag = rhashtable_lookup_fast(&ns->ns_arc_ghost_hash, name,
+				    ldlm_arc_ghost_params);
+	if (ag) {
+		/* another lock of the resource was cancelled before */
+		if (ag->ag_frequent != frequent) {
+			if (frequent) {
+				ns->ns_arc_nr_ghost_recent--;
+				ns->ns_arc_nr_ghost_frequent++;
+			} else {
+				ns->ns_arc_nr_ghost_frequent--;
+				ns->ns_arc_nr_ghost_recent++;
+			}
+			ag->ag_frequent = frequent;
+		}
+	} else {
+		/* ghosts are only a hint, nothing is lost if out of memory */
+		OBD_ALLOC_GFP(ag, sizeof(*ag), GFP_ATOMIC);
+		if (!ag)
+			return;
+
+		ag->ag_name = *name;
+		ag->ag_frequent = frequent;
+		if (rhashtable_insert_fast(&ns->ns_arc_ghost_hash,
+					   &ag->ag_hash,
+					   ldlm_arc_ghost_params)) {
+			OBD_FREE_PTR(ag);
+			return;
+		}
+		INIT_LIST_HEAD(&ag->ag_list);
+		if (frequent)
+			ns->ns_arc_nr_ghost_frequent++;
+		else
+			ns->ns_arc_nr_ghost_recent++;
+	}
+
+	list_move_tail(&ag->ag_list, frequent ? &ns->ns_arc_ghost_frequent :
+						&ns->ns_arc_ghost_recent);
+	ldlm_arc_ghost_trim(ns);
+}
+
+struct ldlm_lock_cache_ops ldlm_arc_cache_ops = {
+	.llco_add_lock = ldlm_arc_add_lock,
+	.llco_remove_lock = ldlm_lfru_remove_lock,
+	.llco_demote_lock = ldlm_arc_demote_lock,
+	.llco_try_batch_demote_locks = ldlm_arc_try_batch_demote_locks,
+	.llco_evict_lock = ldlm_arc_evict_lock,
+};
+
+/**
+ * Forget all ghosts of \a ns and reset its ARC target.
+ * Prereq: hold ns->ns_lock
+ */
+void ldlm_arc_ghost_flush(struct ldlm_namespace *ns)
+{
+	struct ldlm_arc_ghost *ag, *tmp;
+
+	list_for_each_entry_safe(ag, tmp, &ns->ns_arc_ghost_recent, ag_list)
+		ldlm_arc_ghost_del(ns, ag);
+	list_for_each_entry_safe(ag, tmp, &ns->ns_arc_ghost_frequent, ag_list)
+		ldlm_arc_ghost_del(ns, ag);
+	ns->ns_arc_target = 0;
+}
+
+int ldlm_arc_init(struct ldlm_namespace *ns)
+{
+	INIT_LIST_HEAD(&ns->ns_arc_ghost_recent);
+	INIT_LIST_HEAD(&ns->ns_arc_ghost_frequent);
+	ns->ns_arc_nr_ghost_recent = 0;
+	ns->ns_arc_nr_ghost_frequent = 0;
+	ns->ns_arc_target = 0;
+
+	return rhashtable_init(&ns->ns_arc_ghost_hash, &ldlm_arc_ghost_params);
+}
+
+static void ldlm_arc_ghost_free(void *obj, void *data)
+{
+	struct ldlm_arc_ghost *ag = obj;
+
+	OBD_FREE_PTR(ag);
+}
+
+void ldlm_arc_fini(struct ldlm_namespace *ns)
+{
+	rhashtable_free_and_destroy(&ns->ns_arc_ghost_hash,
+				    ldlm_arc_ghost_free, NULL);
+}
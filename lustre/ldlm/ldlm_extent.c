@@ -344,6 +344,83 @@ ldlm_extent_internal_policy_waiting(struct ldlm_lock *req,
 	EXIT;
 }
 
+/**
+ * Record the access stride reported with an extent enqueue on \a res.
+ *
+ * The hint is kept on the resource rather than on each lock. Clients doing
+ * interleaved strided IO to a shared file all access chunks of the same
+ * size, laid out on a grid of that size, so only the chunk size and the
+ * offset of the grid are kept. An enqueue without a usable stride clears
+ * the hint, so that it does not outlive the strided IO.
+ */
+void ldlm_extent_stride_hint(struct ldlm_resource *res,
+			     const struct ldlm_extent_stride *stride)
+{
+	__u64 bytes = 0;
+	__u64 phase = 0;
+
+	if (stride && stride->les_bytes != 0 &&
+	    stride->les_length > stride->les_bytes) {
+		bytes = stride->les_bytes;
+		div64_u64_rem(stride->les_offset, bytes, &phase);
+	}
+
+	if (res->lr_stride_bytes == bytes && res->lr_stride_phase == phase)
+		return;
+
+	lock_res(res);
+	res->lr_stride_bytes = bytes;
+	res->lr_stride_phase = phase;
+	unlock_res(res);
+}
+
+/**
+ * Trim the expanded extent to the current stride chunk of the resource.
+ *
+ * A client doing strided IO reports its pattern with the enqueue, so that
+ * once the resource is shared the grant covers only the chunk holding the
+ * request instead of reaching into chunks accessed by other clients, which
+ * would otherwise be revoked on their next access.  The hint is ignored when
+ * the request does not fall inside a single chunk of the reported pattern.
+ *
+ * \retval true if \a new_ex was trimmed
+ */
+static bool ldlm_extent_internal_policy_stride(struct ldlm_lock *req,
+					       struct ldlm_extent *new_ex)
+{
+	struct ldlm_resource *res = req->l_resource;
+	__u64 bytes = res->lr_stride_bytes;
+	__u64 req_start = req->l_req_extent.start;
+	__u64 req_end = req->l_req_extent.end;
+	__u64 chunk_start, chunk_end, skew;
+
+	if (bytes == 0)
+		return false;
+
+	/* an uncontended resource keeps the full expansion */
+	if (new_ex->start == 0 && new_ex->end == OBD_OBJECT_EOF)
+		return false;
+
+	if (req_start < res->lr_stride_phase)
+		return false;
+
+	div64_u64_rem(req_start - res->lr_stride_phase, bytes, &skew);
+	chunk_start = req_start - skew;
+	chunk_end = chunk_start + bytes - 1;
+	if (chunk_end < chunk_start || req_end > chunk_end)
+		return false;
+
+	if (new_ex->start >= chunk_start && new_ex->end <= chunk_end)
+		return false;
+
+	new_ex->start = max(new_ex->start, chunk_start);
+	new_ex->end = min(new_ex->end, chunk_end);
+	ldlm_extent_internal_policy_fixup(req, new_ex, 0);
+
+	LDLM_DEBUG(req, "stride %llu@%llu trimmed grant to [%llu, %llu]",
+		   bytes, res->lr_stride_phase, new_ex->start, new_ex->end);
+	return true;
+}
 
 /* In order to determine the largest possible extent we can grant, we need
  * to scan all of the queues.
@@ -374,6 +451,9 @@ static void ldlm_extent_policy(struct ldlm_resource *res,
 	if (likely(!(lock->l_flags & LDLM_FL_NO_EXPANSION))) {
 		ldlm_extent_internal_policy_granted(lock, &new_ex);
 		ldlm_extent_internal_policy_waiting(lock, &new_ex);
+		if (ldlm_extent_internal_policy_stride(lock, &new_ex))
+			lprocfs_counter_incr(ldlm_res_to_ns(res)->ns_stats,
+					     LDLM_NSS_STRIDE_GRANTS);
 	} else {
 		LDLM_DEBUG(lock, "Not expanding manually requested lock");
 		new_ex.start = lock->l_policy_data.l_extent.start;
@@ -33,6 +33,7 @@
 
 #define DEBUG_SUBSYSTEM S_LDLM
 
+#include <linux/jhash.h>
 #include <linux/list.h>
 #ifdef HAVE_LINUX_FILELOCK_HEADER
 #include <linux/filelock.h>
@@ -79,38 +80,130 @@ static int ldlm_flocks_are_equal(struct ldlm_lock *l1, struct ldlm_lock *l2)
 	       l2->l_policy_data.l_flock.end;
 }
 
+/*
+ * Wait-for graph of blocked POSIX locks.
+ *
+ * A blocked flock request is hashed in ns_flock_waiters by the NID of its
+ * client and its owner, and records the owner it waits for. The same owner
+ * may use several exports of one client node, so the NID is used instead
+ * of the export.
+ *
+ * The rhltable does its own bucket locking and lookups are RCU-safe, so
+ * the graph has no lock of its own: entries are added and removed under
+ * the lock of their resource only, and the deadlock walk runs under
+ * rcu_read_lock(). Locks and exports are freed after a grace period, but
+ * a lock found by the walk may be unlinked concurrently, so its export
+ * pointers are read once and the walk stops when they are gone.
+ */
+struct ldlm_flock_wait_key {
+	struct lnet_nid		fwk_nid;
+	__u64			fwk_owner;
+};
+
+static inline void ldlm_flock_wait_key_init(struct ldlm_flock_wait_key *key,
+					    struct obd_export *exp,
+					    __u64 owner)
+{
+	/* hashed as a blob, clear the padding */
+	memset(key, 0, sizeof(*key));
+	key->fwk_nid = exp->exp_connection->c_peer.nid;
+	key->fwk_owner = owner;
+}
+
+static u32 ldlm_flock_wait_keyhash(const void *data, u32 len, u32 seed)
+{
+	return jhash(data, len, seed);
+}
+
+static u32 ldlm_flock_wait_objhash(const void *data, u32 len, u32 seed)
+{
+	const struct ldlm_lock *lock = data;
+	struct ldlm_flock_wait_key key;
+
+	ldlm_flock_wait_key_init(&key, lock->l_export,
+				 lock->l_policy_data.l_flock.owner);
+	return jhash(&key, sizeof(key), seed);
+}
+
+static int ldlm_flock_wait_cmp(struct rhashtable_compare_arg *arg,
+			       const void *obj)
+{
+	const struct ldlm_flock_wait_key *key = arg->key;
+	const struct ldlm_lock *lock = obj;
+
+	return !(lock->l_policy_data.l_flock.owner == key->fwk_owner &&
+		 nid_same(&lock->l_export->exp_connection->c_peer.nid,
+			  &key->fwk_nid));
+}
+
+static const struct rhashtable_params ldlm_flock_wait_params = {
+	.key_len	= sizeof(struct ldlm_flock_wait_key),
+	.head_offset	= offsetof(struct ldlm_lock, l_fl_waiter),
+	.hashfn		= ldlm_flock_wait_keyhash,
+	.obj_hashfn	= ldlm_flock_wait_objhash,
+	.obj_cmpfn	= ldlm_flock_wait_cmp,
+	.automatic_shrinking = true,
+};
+
 static inline void ldlm_flock_blocking_link(struct ldlm_lock *req,
 					    struct ldlm_lock *lock)
 {
+	struct ldlm_namespace *ns = ldlm_lock_to_ns(req);
+	struct ldlm_flock *flock = &req->l_policy_data.l_flock;
+	int rc;
+
 	/* For server only */
-	if (req->l_export == NULL)
+	if (req->l_export == NULL || lock->l_export == NULL)
 		return;
 
-	LASSERT(hlist_unhashed(&req->l_exp_flock_hash));
+	LASSERT(flock->blocking_export == NULL);
 
-	req->l_policy_data.l_flock.blocking_owner =
-		lock->l_policy_data.l_flock.owner;
-	req->l_policy_data.l_flock.blocking_export =
-		lock->l_export;
-	atomic_set(&req->l_policy_data.l_flock.blocking_refs, 0);
+	flock->blocking_owner = lock->l_policy_data.l_flock.owner;
+	flock->blocking_export = class_export_get(lock->l_export);
 
-	cfs_hash_add(req->l_export->exp_flock_hash,
-		     &req->l_policy_data.l_flock.owner,
-		     &req->l_exp_flock_hash);
+	rc = rhltable_insert(&ns->ns_flock_waiters, &req->l_fl_waiter,
+			     ldlm_flock_wait_params);
+	if (rc) {
+		/* only the deadlock detection through this lock is lost */
+		LDLM_DEBUG(req, "cannot add to wait-for graph: rc = %d", rc);
+		class_export_put(flock->blocking_export);
+		flock->blocking_export = NULL;
+		flock->blocking_owner = 0;
+	}
 }
 
 static inline void ldlm_flock_blocking_unlink(struct ldlm_lock *req)
 {
+	struct ldlm_namespace *ns = ldlm_lock_to_ns(req);
+	struct ldlm_flock *flock = &req->l_policy_data.l_flock;
+	struct obd_export *exp = flock->blocking_export;
+
 	/* For server only */
 	if (req->l_export == NULL)
 		return;
 
 	check_res_locked(req->l_resource);
-	if (req->l_export->exp_flock_hash != NULL &&
-	    !hlist_unhashed(&req->l_exp_flock_hash))
-		cfs_hash_del(req->l_export->exp_flock_hash,
-			     &req->l_policy_data.l_flock.owner,
-			     &req->l_exp_flock_hash);
+	if (exp == NULL)
+		return;
+
+	rhltable_remove(&ns->ns_flock_waiters, &req->l_fl_waiter,
+			ldlm_flock_wait_params);
+
+	/* a concurrent deadlock walk may still look at this lock */
+	WRITE_ONCE(flock->blocking_export, NULL);
+	flock->blocking_owner = 0;
+	class_export_put(exp);
+}
+
+int ldlm_flock_ns_init(struct ldlm_namespace *ns)
+{
+	return rhltable_init(&ns->ns_flock_waiters, &ldlm_flock_wait_params);
+}
+
+void ldlm_flock_ns_fini(struct ldlm_namespace *ns)
+{
+	/* every blocked lock is unlinked before being destroyed */
+	rhltable_destroy(&ns->ns_flock_waiters);
 }
 
 /* Remove cancelled lock from resource interval tree. */
@@ -132,8 +225,8 @@ ldlm_flock_destroy(struct ldlm_lock *lock, enum ldlm_mode mode, __u64 flags)
 
 	LDLM_DEBUG(lock, "%s(mode: %d, flags: %#llx)", __func__, mode, flags);
 
-	/* Safe to not lock here, since it should be empty anyway */
-	LASSERT(hlist_unhashed(&lock->l_exp_flock_hash));
+	/* Safe to not lock here, since it should be unlinked anyway */
+	LASSERT(lock->l_policy_data.l_flock.blocking_export == NULL);
 
 	list_del_init(&lock->l_res_link);
 	if (flags == LDLM_FL_WAIT_NOREPROC) {
@@ -156,100 +249,78 @@ ldlm_flock_destroy(struct ldlm_lock *lock, enum ldlm_mode mode, __u64 flags)
  * POSIX locks deadlock detection code.
  *
  * Given a new lock \a req and an existing lock \a bl_lock it conflicts
- * with, we need to iterate through all blocked POSIX locks for this
- * export and see if there is a deadlock condition arising. (i.e. when
- * one client holds a lock on something and want a lock on something
- * else and at the same time another client has the opposite situation).
+ * with, follow the wait-for graph from the owner of \a bl_lock and see if
+ * it leads back to the owner of \a req (i.e. when one client holds a lock
+ * on something and want a lock on something else and at the same time
+ * another client has the opposite situation). Every hop is a single hash
+ * lookup, independent of the number of locks and exports.
+ *
+ * The walk takes no lock, so it races with requests joining and leaving
+ * the graph on other resources. Like before, a deadlock formed by such a
+ * race is found by whichever request closes the cycle last.
  */
-struct ldlm_flock_lookup_cb_data {
-	__u64 *bl_owner;
-	struct ldlm_lock *lock;
-	struct obd_export *exp;
-};
-
-static int ldlm_flock_lookup_cb(struct obd_export *exp, void *data)
-{
-	struct ldlm_flock_lookup_cb_data *cb_data = data;
-	struct ldlm_lock *lock;
-
-	if (exp->exp_failed)
-		return 0;
-
-	lock = cfs_hash_lookup(exp->exp_flock_hash, cb_data->bl_owner);
-	if (lock == NULL)
-		return 0;
-
-	/* Stop on first found lock. Same process can't sleep twice */
-	cb_data->lock = lock;
-	cb_data->exp = class_export_get(exp);
-
-	return 1;
-}
-
 static int
 ldlm_flock_deadlock(struct ldlm_lock *req, struct ldlm_lock *bl_lock)
 {
+	struct ldlm_namespace *ns = ldlm_lock_to_ns(req);
 	struct obd_export *req_exp = req->l_export;
-	struct obd_export *bl_exp = bl_lock->l_export;
 	__u64 req_owner = req->l_policy_data.l_flock.owner;
-	__u64 bl_owner = bl_lock->l_policy_data.l_flock.owner;
+	struct ldlm_flock_wait_key key;
+	unsigned int hops = 0;
+	int deadlock = 0;
 
 	/* For server only */
-	if (req_exp == NULL)
+	if (req_exp == NULL || bl_lock->l_export == NULL)
 		return 0;
 
-	class_export_get(bl_exp);
-	while (1) {
-		struct ldlm_flock_lookup_cb_data cb_data = {
-			.bl_owner = &bl_owner,
-			.lock = NULL,
-			.exp = NULL,
-		};
-		struct ptlrpc_connection *bl_exp_conn;
-		struct obd_export *bl_exp_new;
-		struct ldlm_lock *lock = NULL;
+	ldlm_flock_wait_key_init(&key, bl_lock->l_export,
+				 bl_lock->l_policy_data.l_flock.owner);
+
+	rcu_read_lock();
+	/* a chain can't be longer than the graph, don't spin on a cycle
+	 * which does not involve \a req
+	 */
+	while (hops++ <= atomic_read(&ns->ns_flock_waiters.ht.nelems)) {
+		struct rhlist_head *list;
+		struct ldlm_lock *lock;
+		struct obd_export *lock_exp;
+		struct obd_export *bl_exp;
 		struct ldlm_flock *flock;
 
-		bl_exp_conn = bl_exp->exp_connection;
-		if (bl_exp->exp_flock_hash != NULL) {
-			obd_nid_export_for_each(bl_exp->exp_obd,
-						&bl_exp_conn->c_peer.nid,
-						ldlm_flock_lookup_cb,
-						&cb_data);
-			lock = cb_data.lock;
-		}
-		if (lock == NULL)
+		list = rhltable_lookup(&ns->ns_flock_waiters, &key,
+				       ldlm_flock_wait_params);
+		if (list == NULL)
 			break;
 
-		class_export_put(bl_exp);
-		bl_exp = cb_data.exp;
+		/* Same process can't sleep twice, follow the first one */
+		lock = container_of(list, struct ldlm_lock, l_fl_waiter);
+		if (lock == req) {
+			deadlock = 1;
+			break;
+		}
 
 		flock = &lock->l_policy_data.l_flock;
-		LASSERT(flock->owner == bl_owner);
-		bl_owner = flock->blocking_owner;
-		bl_exp_new = class_export_get(flock->blocking_export);
-		class_export_put(bl_exp);
-
-		cfs_hash_put(bl_exp->exp_flock_hash, &lock->l_exp_flock_hash);
-		bl_exp = bl_exp_new;
+		lock_exp = READ_ONCE(lock->l_export);
+		bl_exp = READ_ONCE(flock->blocking_export);
+		/* unlinked under us, the chain is broken here */
+		if (lock_exp == NULL || bl_exp == NULL)
+			break;
 
-		if (req == lock) {
-			class_export_put(bl_exp);
-			return 1;
-		}
-		if (bl_exp->exp_failed)
+		if (lock_exp->exp_failed || bl_exp->exp_failed)
 			break;
 
-		if (bl_owner == req_owner &&
-		    nid_same(&bl_exp_conn->c_peer.nid,
+		ldlm_flock_wait_key_init(&key, bl_exp,
+					 READ_ONCE(flock->blocking_owner));
+		if (key.fwk_owner == req_owner &&
+		    nid_same(&key.fwk_nid,
 			     &req_exp->exp_connection->c_peer.nid)) {
-			class_export_put(bl_exp);
-			return 1;
+			deadlock = 1;
+			break;
 		}
 	}
-	class_export_put(bl_exp);
+	rcu_read_unlock();
 
-	return 0;
+	return deadlock;
 }
 
 static void ldlm_flock_cancel_on_deadlock(struct ldlm_lock *lock,
@@ -1043,106 +1114,3 @@ void ldlm_flock_policy_local_to_wire(const union ldlm_policy_data *lpolicy,
 	wpolicy->l_flock.lfw_pid = lpolicy->l_flock.pid;
 	wpolicy->l_flock.lfw_owner = lpolicy->l_flock.owner;
 }
-
-/*
- * Export handle<->flock hash operations.
- */
-static unsigned int
-ldlm_export_flock_hash(struct cfs_hash *hs, const void *key,
-		       const unsigned int bits)
-{
-	return hash_64(*(__u64 *)key, bits);
-}
-
-static void *
-ldlm_export_flock_key(struct hlist_node *hnode)
-{
-	struct ldlm_lock *lock;
-
-	lock = hlist_entry(hnode, struct ldlm_lock, l_exp_flock_hash);
-	return &lock->l_policy_data.l_flock.owner;
-}
-
-static int
-ldlm_export_flock_keycmp(const void *key, struct hlist_node *hnode)
-{
-	return !memcmp(ldlm_export_flock_key(hnode), key, sizeof(__u64));
-}
-
-static void *
-ldlm_export_flock_object(struct hlist_node *hnode)
-{
-	return hlist_entry(hnode, struct ldlm_lock, l_exp_flock_hash);
-}
-
-static void
-ldlm_export_flock_get(struct cfs_hash *hs, struct hlist_node *hnode)
-{
-	struct ldlm_lock *lock;
-	struct ldlm_flock *flock;
-
-	lock = hlist_entry(hnode, struct ldlm_lock, l_exp_flock_hash);
-	ldlm_lock_get(lock);
-
-	flock = &lock->l_policy_data.l_flock;
-	LASSERT(flock->blocking_export != NULL);
-	class_export_get(flock->blocking_export);
-	atomic_inc(&flock->blocking_refs);
-}
-
-static void
-ldlm_export_flock_put(struct cfs_hash *hs, struct hlist_node *hnode)
-{
-	struct ldlm_lock *lock;
-	struct ldlm_flock *flock;
-
-	lock = hlist_entry(hnode, struct ldlm_lock, l_exp_flock_hash);
-
-	flock = &lock->l_policy_data.l_flock;
-	LASSERT(flock->blocking_export != NULL);
-	class_export_put(flock->blocking_export);
-	if (atomic_dec_and_test(&flock->blocking_refs)) {
-		flock->blocking_owner = 0;
-		flock->blocking_export = NULL;
-	}
-	ldlm_lock_put(lock);
-}
-
-static struct cfs_hash_ops ldlm_export_flock_ops = {
-	.hs_hash        = ldlm_export_flock_hash,
-	.hs_key         = ldlm_export_flock_key,
-	.hs_keycmp      = ldlm_export_flock_keycmp,
-	.hs_object      = ldlm_export_flock_object,
-	.hs_get         = ldlm_export_flock_get,
-	.hs_put         = ldlm_export_flock_put,
-	.hs_put_locked  = ldlm_export_flock_put,
-};
-
-int ldlm_init_flock_export(struct obd_export *exp)
-{
-	if (strcmp(exp->exp_obd->obd_type->typ_name, LUSTRE_MDT_NAME) != 0)
-		RETURN(0);
-
-	exp->exp_flock_hash =
-		cfs_hash_create(obd_uuid2str(&exp->exp_client_uuid),
-				HASH_EXP_LOCK_CUR_BITS,
-				HASH_EXP_LOCK_MAX_BITS,
-				HASH_EXP_LOCK_BKT_BITS, 0,
-				CFS_HASH_MIN_THETA, CFS_HASH_MAX_THETA,
-				&ldlm_export_flock_ops,
-				CFS_HASH_DEFAULT | CFS_HASH_NBLK_CHANGE);
-	if (!exp->exp_flock_hash)
-		RETURN(-ENOMEM);
-
-	RETURN(0);
-}
-
-void ldlm_destroy_flock_export(struct obd_export *exp)
-{
-	ENTRY;
-	if (exp->exp_flock_hash) {
-		cfs_hash_putref(exp->exp_flock_hash);
-		exp->exp_flock_hash = NULL;
-	}
-	EXIT;
-}
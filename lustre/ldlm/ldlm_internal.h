@@ -93,6 +93,8 @@ void ldlm_resource_insert_lock_after(struct ldlm_lock *original,
 				     struct ldlm_lock *new);
 void ldlm_resource_insert_lock_before(struct ldlm_lock *original,
 				      struct ldlm_lock *new);
+int ldlm_namespace_res_walk_resume(struct rhashtable_iter *hti,
+				   ldlm_res_iterator_t iter, void *arg);
 
 /* ldlm_lock.c */
 
@@ -137,6 +139,11 @@ void ldlm_clear_blocking_data(struct ldlm_lock *lock);
 #endif
 int ldlm_run_ast_work(struct ldlm_namespace *ns, struct list_head *rpc_list,
 		      ldlm_desc_ast_t ast_type);
+#ifdef CONFIG_LUSTRE_FS_SERVER
+int ldlm_ast_fanout_init(void);
+void ldlm_ast_fanout_fini(void);
+bool ldlm_ast_queue_work(struct work_struct *work);
+#endif
 int ldlm_work_gl_ast_lock(struct ptlrpc_request_set *rqset, void *opaq);
 int ldlm_lock_remove_from_lru_check(struct ldlm_lock *lock, ktime_t last_use,
 				    bool reuse);
@@ -160,6 +167,9 @@ int ldlm_bl_to_thread_list(struct ldlm_namespace *ns,
 			   struct list_head *cancels, int count,
 			   enum ldlm_cancel_flags cancel_flags);
 int ldlm_bl_to_thread_ns(struct ldlm_namespace *ns);
+#ifdef CONFIG_LUSTRE_FS_SERVER
+int ldlm_bl_batch_flush(struct ldlm_cb_set_arg *arg);
+#endif
 int ldlm_bl_thread_wakeup(void);
 
 void ldlm_handle_bl_callback(struct ldlm_namespace *ns,
@@ -186,6 +196,8 @@ int ldlm_reprocess_inodebits_queue(struct ldlm_resource *res,
 int ldlm_process_extent_lock(struct ldlm_lock *lock, __u64 *flags,
 			     enum ldlm_process_intention intention,
 			     enum ldlm_error *err, struct list_head *work_list);
+void ldlm_extent_stride_hint(struct ldlm_resource *res,
+			     const struct ldlm_extent_stride *stride);
 #endif
 void ldlm_extent_add_lock(struct ldlm_resource *res, struct ldlm_lock *lock);
 void ldlm_extent_unlink_lock(struct ldlm_lock *lock);
@@ -203,8 +215,8 @@ void ldlm_inodebits_unlink_lock(struct ldlm_lock *lock);
 int ldlm_process_flock_lock(struct ldlm_lock *req, __u64 *flags,
 			    enum ldlm_process_intention intention,
 			    enum ldlm_error *err, struct list_head *work_list);
-int ldlm_init_flock_export(struct obd_export *exp);
-void ldlm_destroy_flock_export(struct obd_export *exp);
+int ldlm_flock_ns_init(struct ldlm_namespace *ns);
+void ldlm_flock_ns_fini(struct ldlm_namespace *ns);
 void ldlm_flock_add_lock(struct ldlm_resource *req, struct list_head *head,
 			 struct ldlm_lock *lock);
 void ldlm_flock_unlink_lock(struct ldlm_lock *lock);
@@ -387,12 +399,21 @@ extern u64 ldlm_lock_limit;
 extern u64 ldlm_reclaim_threshold_mb;
 extern u64 ldlm_lock_limit_mb;
 extern struct percpu_counter ldlm_granted_total;
+extern unsigned int ldlm_job_lock_soft_limit;
+extern unsigned int ldlm_job_lock_hard_limit;
+extern unsigned int ldlm_exp_lock_soft_limit;
+extern unsigned int ldlm_exp_lock_hard_limit;
+bool ldlm_reclaim_limit_full(struct ldlm_namespace *ns, struct obd_export *exp,
+			     const char *jobid);
 #endif
 extern unsigned int ldlm_dump_granted_max;
 int ldlm_reclaim_setup(void);
 void ldlm_reclaim_cleanup(void);
 void ldlm_reclaim_add(struct ldlm_lock *lock);
 void ldlm_reclaim_del(struct ldlm_lock *lock);
+void ldlm_reclaim_release(struct ldlm_lock *lock);
+int ldlm_reclaim_ns_init(struct ldlm_namespace *ns);
+void ldlm_reclaim_ns_fini(struct ldlm_namespace *ns);
 bool ldlm_reclaim_full(void);
 
 static inline bool ldlm_res_eq(const struct ldlm_res_id *res0,
@@ -407,3 +428,7 @@ struct ldlm_lock *ldlm_lock_new_testing(struct ldlm_resource *resource);
 /* ldlm_cache_policy.c */
 extern struct ldlm_lock_cache_ops ldlm_lru_cache_ops;
 extern struct ldlm_lock_cache_ops ldlm_lfru_cache_ops;
+extern struct ldlm_lock_cache_ops ldlm_arc_cache_ops;
+int ldlm_arc_init(struct ldlm_namespace *ns);
+void ldlm_arc_fini(struct ldlm_namespace *ns);
+void ldlm_arc_ghost_flush(struct ldlm_namespace *ns);
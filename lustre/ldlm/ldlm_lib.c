@@ -410,6 +410,7 @@ int client_obd_setup(struct obd_device *obd, struct lustre_cfg *lcfg)
 	spin_lock_init(&cli->cl_read_io_latency_hist.oh_lock);
 	spin_lock_init(&cli->cl_write_io_latency_hist.oh_lock);
 	spin_lock_init(&cli->cl_batch_rpc_hist.oh_lock);
+	spin_lock_init(&cli->cl_read_lat_recent.oh_lock);
 
 	/* Initialize RPC latency by size histograms */
 	{
@@ -16,6 +16,7 @@
 
 #define DEBUG_SUBSYSTEM S_LDLM
 
+#include <linux/hash.h>
 #include <lustre_swab.h>
 #include <obd_class.h>
 
@@ -200,6 +201,7 @@ void ldlm_lock_put(struct ldlm_lock *lock)
 
 		lprocfs_counter_decr(ldlm_res_to_ns(res)->ns_stats,
 				     LDLM_NSS_LOCKS);
+		ldlm_reclaim_release(lock);
 		if (lock->l_export) {
 			class_export_lock_put(lock->l_export, lock);
 			lock->l_export = NULL;
@@ -458,7 +460,6 @@ static struct ldlm_lock *ldlm_lock_new(struct ldlm_resource *resource)
 		INIT_LIST_HEAD(&lock->l_sl_policy);
 		break;
 	case LDLM_FLOCK:
-		INIT_HLIST_NODE(&lock->l_exp_flock_hash);
 		RB_CLEAR_NODE(&lock->l_fl_rb);
 		break;
 	case LDLM_EXTENT:
@@ -2129,8 +2130,9 @@ ldlm_work_bl_ast_lock(struct ptlrpc_request_set *rqset, void *opaq)
 
 	ENTRY;
 
+	/* send the batched ASTs once no more locks can join them */
 	if (list_empty(arg->list))
-		RETURN(-ENOENT);
+		RETURN(ldlm_bl_batch_flush(arg));
 
 	lock = list_first_entry(arg->list, struct ldlm_lock, l_bl_ast);
 
@@ -2204,7 +2206,7 @@ ldlm_work_revoke_ast_lock(struct ptlrpc_request_set *rqset, void *opaq)
 	ENTRY;
 
 	if (list_empty(arg->list))
-		RETURN(-ENOENT);
+		RETURN(ldlm_bl_batch_flush(arg));
 
 	lock = list_first_entry(arg->list, struct ldlm_lock, l_rk_ast);
 	list_del_init(&lock->l_rk_ast);
@@ -2307,6 +2309,215 @@ ldlm_work_cp_ast_lock(struct ptlrpc_request_set *rqset, void *opaq)
 	RETURN(rc);
 }
 
+/**
+ * Send the ASTs for all locks on \a rpc_list from a single request set,
+ * keeping up to \a max_ast RPCs in flight, 0 meaning no limit.
+ */
+static int ldlm_run_ast_set(struct list_head *rpc_list, int type,
+			    set_producer_func work_ast_lock,
+			    unsigned int max_ast)
+{
+	struct ldlm_cb_set_arg *arg;
+	int rc;
+
+	OBD_ALLOC_PTR(arg);
+	if (arg == NULL)
+		return -ENOMEM;
+
+	atomic_set(&arg->restart, 0);
+	arg->type = type;
+	arg->list = rpc_list;
+	INIT_LIST_HEAD(&arg->bl_batches);
+	hash_init(arg->bl_batch_hash);
+
+	/* We create a ptlrpc request set with flow control extension.
+	 * This request set will use the work_ast_lock function to produce new
+	 * requests and will send a new request each time one completes in order
+	 * to keep the number of requests in flight to max_ast
+	 */
+	arg->set = ptlrpc_prep_fcset(max_ast ? : UINT_MAX, work_ast_lock, arg);
+	if (arg->set == NULL)
+		GOTO(out, rc = -ENOMEM);
+
+	ptlrpc_set_wait(NULL, arg->set);
+	ptlrpc_set_destroy(arg->set);
+	LASSERT(list_empty(&arg->bl_batches));
+
+	rc = atomic_read(&arg->restart) ? -ERESTART : 0;
+out:
+	OBD_FREE_PTR(arg);
+	return rc;
+}
+
+#ifdef CONFIG_LUSTRE_FS_SERVER
+static struct workqueue_struct *ldlm_ast_fanout_wq;
+
+/**
+ * One branch of a blocking AST fanout, see ldlm_run_ast_fanout().
+ */
+struct ldlm_ast_branch {
+	struct work_struct	 lab_work;
+	struct list_head	 lab_list;
+	set_producer_func	 lab_producer;
+	/* share of ns_max_parallel_ast given to this branch */
+	unsigned int		 lab_max_ast;
+	struct completion	 lab_done;
+	int			 lab_rc;
+};
+
+static void ldlm_ast_branch_work(struct work_struct *work)
+{
+	struct ldlm_ast_branch *lab = container_of(work, struct ldlm_ast_branch,
+						   lab_work);
+
+	lab->lab_rc = ldlm_run_ast_set(&lab->lab_list, LDLM_BL_CALLBACK,
+				       lab->lab_producer, lab->lab_max_ast);
+	complete(&lab->lab_done);
+}
+
+/**
+ * Send blocking ASTs for a large number of locks as a tree.
+ *
+ * A lock cached by thousands of clients makes the conflicting request wait
+ * until one thread has packed and sent every single blocking AST, with at
+ * most ns_max_parallel_ast of them in flight. Instead, the locks are split
+ * by export into ns_ast_fanout branches, each one driven by its own request
+ * set from the ldlm_ast workqueue, so that the callbacks are packed and sent
+ * from several CPUs at once. Locks of one export stay in the same branch so
+ * that they can still share a batched blocking AST.
+ *
+ * ns_max_parallel_ast still bounds the number of ASTs in flight for the
+ * whole fanout: it is split between the branches which have locks to send.
+ *
+ * \retval -EAGAIN if the list is too short to be worth splitting, the caller
+ *	   is expected to send it from a single set then
+ */
+static int ldlm_run_ast_fanout(struct ldlm_namespace *ns,
+			       struct list_head *rpc_list,
+			       set_producer_func work_ast_lock, bool revoke)
+{
+	unsigned int fanout = min_t(unsigned int, ns->ns_ast_fanout,
+				    LDLM_AST_FANOUT_MAX);
+	unsigned int max_ast = READ_ONCE(ns->ns_max_parallel_ast);
+	struct ldlm_ast_branch *branches;
+	struct list_head *pos, *tmp;
+	unsigned int count = 0;
+	unsigned int busy = 0;
+	unsigned int k = 0;
+	int rc = 0;
+	int i;
+
+	ENTRY;
+
+	/* every branch needs at least one AST in flight */
+	if (max_ast != 0)
+		fanout = min(fanout, max_ast);
+	if (fanout < 2 || !ldlm_ast_fanout_wq)
+		RETURN(-EAGAIN);
+
+	list_for_each(pos, rpc_list) {
+		if (++count > max_ast)
+			break;
+	}
+	if (count <= max_ast)
+		RETURN(-EAGAIN);
+
+	OBD_ALLOC_PTR_ARRAY(branches, fanout);
+	if (branches == NULL)
+		RETURN(-EAGAIN);
+
+	for (i = 0; i < fanout; i++) {
+		INIT_WORK(&branches[i].lab_work, ldlm_ast_branch_work);
+		INIT_LIST_HEAD(&branches[i].lab_list);
+		init_completion(&branches[i].lab_done);
+		branches[i].lab_producer = work_ast_lock;
+	}
+
+	/* the list is private to this thread, and l_bl_ast never becomes
+	 * empty while moving, so ldlm_add_bl_work_item() is not confused
+	 */
+	list_for_each_safe(pos, tmp, rpc_list) {
+		struct ldlm_lock *lock;
+
+		if (revoke)
+			lock = list_entry(pos, struct ldlm_lock, l_rk_ast);
+		else
+			lock = list_entry(pos, struct ldlm_lock, l_bl_ast);
+		i = hash_ptr(lock->l_export, 32) % fanout;
+		list_move_tail(pos, &branches[i].lab_list);
+	}
+
+	for (i = 0; i < fanout; i++)
+		if (!list_empty(&branches[i].lab_list))
+			busy++;
+	for (i = 0; i < fanout && max_ast != 0; i++) {
+		if (list_empty(&branches[i].lab_list))
+			continue;
+		branches[i].lab_max_ast = max_ast / busy +
+					  (k++ < max_ast % busy);
+	}
+
+	CDEBUG(D_DLMTRACE, "%s: sending %s ASTs for %u+ locks in %u branches\n",
+	       ldlm_ns_name(ns), revoke ? "revoke" : "blocking", count, fanout);
+
+	for (i = 1; i < fanout; i++) {
+		if (list_empty(&branches[i].lab_list))
+			complete(&branches[i].lab_done);
+		else
+			queue_work(ldlm_ast_fanout_wq, &branches[i].lab_work);
+	}
+	/* the caller thread drives the first branch itself */
+	if (!list_empty(&branches[0].lab_list))
+		ldlm_ast_branch_work(&branches[0].lab_work);
+
+	for (i = 0; i < fanout; i++) {
+		if (i > 0)
+			wait_for_completion(&branches[i].lab_done);
+		LASSERT(list_empty(&branches[i].lab_list));
+		if (branches[i].lab_rc == -ERESTART ||
+		    (branches[i].lab_rc < 0 && rc == 0))
+			rc = branches[i].lab_rc;
+	}
+
+	OBD_FREE_PTR_ARRAY(branches, fanout);
+	RETURN(rc);
+}
+
+int ldlm_ast_fanout_init(void)
+{
+	ldlm_ast_fanout_wq = cfs_cpt_bind_workqueue("ldlm_ast", cfs_cpt_tab,
+						    0, CFS_CPT_ANY,
+						    LDLM_AST_FANOUT_MAX);
+	if (IS_ERR(ldlm_ast_fanout_wq)) {
+		int rc = PTR_ERR(ldlm_ast_fanout_wq);
+
+		ldlm_ast_fanout_wq = NULL;
+		return rc;
+	}
+	return 0;
+}
+
+/**
+ * Queue \a work, which sends ASTs and waits for their replies, on the
+ * ldlm_ast workqueue.
+ */
+bool ldlm_ast_queue_work(struct work_struct *work)
+{
+	if (!ldlm_ast_fanout_wq)
+		return false;
+
+	return queue_work(ldlm_ast_fanout_wq, work);
+}
+
+void ldlm_ast_fanout_fini(void)
+{
+	if (ldlm_ast_fanout_wq) {
+		destroy_workqueue(ldlm_ast_fanout_wq);
+		ldlm_ast_fanout_wq = NULL;
+	}
+}
+#endif /* CONFIG_LUSTRE_FS_SERVER */
+
 /**
  * Process list of locks in need of ASTs being sent.
  *
@@ -2316,36 +2527,29 @@ ldlm_work_cp_ast_lock(struct ptlrpc_request_set *rqset, void *opaq)
 int ldlm_run_ast_work(struct ldlm_namespace *ns, struct list_head *rpc_list,
 		      ldlm_desc_ast_t ast_type)
 {
-	struct ldlm_cb_set_arg *arg;
 	set_producer_func work_ast_lock;
+	int type;
 	int rc;
 
 	if (list_empty(rpc_list))
 		RETURN(0);
 
-	OBD_ALLOC_PTR(arg);
-	if (arg == NULL)
-		RETURN(-ENOMEM);
-
-	atomic_set(&arg->restart, 0);
-	arg->list = rpc_list;
-
 	switch (ast_type) {
 	case LDLM_WORK_CP_AST:
-		arg->type = LDLM_CP_CALLBACK;
+		type = LDLM_CP_CALLBACK;
 		work_ast_lock = ldlm_work_cp_ast_lock;
 		break;
 #ifdef CONFIG_LUSTRE_FS_SERVER
 	case LDLM_WORK_BL_AST:
-		arg->type = LDLM_BL_CALLBACK;
+		type = LDLM_BL_CALLBACK;
 		work_ast_lock = ldlm_work_bl_ast_lock;
 		break;
 	case LDLM_WORK_REVOKE_AST:
-		arg->type = LDLM_BL_CALLBACK;
+		type = LDLM_BL_CALLBACK;
 		work_ast_lock = ldlm_work_revoke_ast_lock;
 		break;
 	case LDLM_WORK_GL_AST:
-		arg->type = LDLM_GL_CALLBACK;
+		type = LDLM_GL_CALLBACK;
 		work_ast_lock = ldlm_work_gl_ast_lock;
 		break;
 #endif
@@ -2353,23 +2557,17 @@ int ldlm_run_ast_work(struct ldlm_namespace *ns, struct list_head *rpc_list,
 		LBUG();
 	}
 
-	/* We create a ptlrpc request set with flow control extension.
-	 * This request set will use the work_ast_lock function to produce new
-	 * requests and will send a new request each time one completes in order
-	 * to keep the number of requests in flight to ns_max_parallel_ast
-	 */
-	arg->set = ptlrpc_prep_fcset(ns->ns_max_parallel_ast ? : UINT_MAX,
-				     work_ast_lock, arg);
-	if (arg->set == NULL)
-		GOTO(out, rc = -ENOMEM);
-
-	ptlrpc_set_wait(NULL, arg->set);
-	ptlrpc_set_destroy(arg->set);
+#ifdef CONFIG_LUSTRE_FS_SERVER
+	if (ast_type == LDLM_WORK_BL_AST || ast_type == LDLM_WORK_REVOKE_AST) {
+		rc = ldlm_run_ast_fanout(ns, rpc_list, work_ast_lock,
+					 ast_type == LDLM_WORK_REVOKE_AST);
+		if (rc != -EAGAIN)
+			return rc;
+	}
+#endif
+	rc = ldlm_run_ast_set(rpc_list, type, work_ast_lock,
+			      ns->ns_max_parallel_ast);
 
-	rc = atomic_read(&arg->restart) ? -ERESTART : 0;
-	GOTO(out, rc);
-out:
-	OBD_FREE_PTR(arg);
 	return rc;
 }
 
@@ -2434,11 +2632,8 @@ void ldlm_reprocess_all(struct ldlm_resource *res, enum mds_ibits_locks hint)
 }
 EXPORT_SYMBOL(ldlm_reprocess_all);
 
-static int ldlm_reprocess_res(struct cfs_hash *hs, struct cfs_hash_bd *bd,
-			      struct hlist_node *hnode, void *arg)
+static int ldlm_reprocess_res(struct ldlm_resource *res, void *arg)
 {
-	struct ldlm_resource *res = cfs_hash_object(hs, hnode);
-
 	/* This is only called once after recovery done. LU-8306. */
 	__ldlm_reprocess_all(res, LDLM_PROCESS_RECOVERY, 0);
 	return 0;
@@ -2450,8 +2645,7 @@ void ldlm_reprocess_recovery_done(struct ldlm_namespace *ns)
 	ENTRY;
 
 	if (ns != NULL) {
-		cfs_hash_for_each_nolock(ns->ns_rs_hash,
-					 ldlm_reprocess_res, NULL, 0);
+		ldlm_namespace_res_walk(ns, ldlm_reprocess_res, NULL);
 	}
 	EXIT;
 }
@@ -16,6 +16,7 @@
 
 #define DEBUG_SUBSYSTEM S_LDLM
 
+#include <linux/hash.h>
 #include <linux/kthread.h>
 #include <linux/list.h>
 #include <lustre_errno.h>
@@ -100,25 +101,46 @@ struct ldlm_bl_work_item {
 
 #ifdef CONFIG_LUSTRE_FS_SERVER
 
-/**
- * Protects both waiting_locks_list and expired_lock_thread.
- */
-static DEFINE_SPINLOCK(waiting_locks_spinlock); /* BH lock (timer) */
-
-/**
- * List for contended locks.
+/*
+ * Waiting locks timer wheels.
  *
- * As soon as a lock is contended, it gets placed on this list and
- * expected time to get a response is filled in the lock. A special
- * thread walks the list looking for locks that should be released and
- * schedules client evictions for those that have not been released in
- * time.
+ * As soon as a lock is contended, it gets placed on a timer wheel and the
+ * expected time to get a response is filled in the lock. The wheel timer
+ * moves the locks that have not been released in time to the wheel's
+ * expired list, and the expired lock thread schedules client evictions for
+ * them.
  *
- * All access to it should be under waiting_locks_spinlock.
+ * There is one hierarchical wheel per CPT, each with its own BH lock and
+ * timer, and a lock is always kept on the wheel selected by its handle
+ * cookie, so that sending blocking ASTs and handling cancels for many locks
+ * at once does not serialize on a single spinlock. Slots of the lowest level
+ * are one second wide, each upper level slot covers a whole lower level, so
+ * adding, refreshing and removing a lock are O(1) and expiry moves a whole
+ * slot at once.
  */
-static LIST_HEAD(waiting_locks_list);
-static void waiting_locks_callback(struct timer_list *unused);
-static DEFINE_TIMER(waiting_locks_timer, waiting_locks_callback);
+#define LDLM_WL_BITS		6
+#define LDLM_WL_SIZE		(1 << LDLM_WL_BITS)
+#define LDLM_WL_MASK		(LDLM_WL_SIZE - 1)
+#define LDLM_WL_LEVELS		3
+/* farthest deadline the wheel can hold, about 3 days */
+#define LDLM_WL_MAX_DELTA	((1LL << (LDLM_WL_BITS * LDLM_WL_LEVELS)) - 1)
+
+struct ldlm_waiting_locks {
+	/** BH lock (timer), protects the lists of this wheel */
+	spinlock_t		wl_lock;
+	struct timer_list	wl_timer;
+	/** next second to be expired, all slots before it are empty */
+	time64_t		wl_clock;
+	/** time wl_timer is armed for, 0 if the wheel is empty */
+	time64_t		wl_next;
+	/** group locks are never timed out, they are just parked here */
+	struct list_head	wl_group;
+	/** locks timed out or with a failed AST, for expired_lock_main() */
+	struct list_head	wl_expired;
+	struct list_head	wl_slots[LDLM_WL_LEVELS][LDLM_WL_SIZE];
+};
+
+static struct ldlm_waiting_locks **ldlm_waiting_locks;
 
 enum elt_state {
 	ELT_STOPPED,
@@ -129,32 +151,130 @@ enum elt_state {
 static DECLARE_WAIT_QUEUE_HEAD(expired_lock_wait_queue);
 static enum elt_state expired_lock_thread_state = ELT_STOPPED;
 static int expired_lock_dump;
-static LIST_HEAD(expired_lock_list);
 
 static int ldlm_lock_busy(struct ldlm_lock *lock);
 static int ldlm_add_waiting_lock(struct ldlm_lock *lock, timeout_t timeout);
-static int __ldlm_add_waiting_lock(struct ldlm_lock *lock, timeout_t timeout);
+static int __ldlm_add_waiting_lock(struct ldlm_waiting_locks *wl,
+				   struct ldlm_lock *lock, timeout_t timeout);
+
+static inline struct ldlm_waiting_locks *ldlm_lock_wl(struct ldlm_lock *lock)
+{
+	return ldlm_waiting_locks[hash_64(lock->l_handle.h_cookie, 32) %
+				  cfs_percpt_number(ldlm_waiting_locks)];
+}
 
 static inline int have_expired_locks(void)
 {
-	int need_to_run;
+	struct ldlm_waiting_locks *wl;
+	int need_to_run = 0;
+	int i;
 
 	ENTRY;
-	spin_lock_bh(&waiting_locks_spinlock);
-	need_to_run = !list_empty(&expired_lock_list);
-	spin_unlock_bh(&waiting_locks_spinlock);
+	cfs_percpt_for_each(wl, i, ldlm_waiting_locks) {
+		spin_lock_bh(&wl->wl_lock);
+		need_to_run = !list_empty(&wl->wl_expired);
+		spin_unlock_bh(&wl->wl_lock);
+		if (need_to_run)
+			break;
+	}
 
 	RETURN(need_to_run);
 }
 
 /**
- * Check expired lock list for expired locks and time them out.
+ * Handle the expired locks of one wheel, one at a time, as cancels may still
+ * take them off the expired list while earlier ones are being processed.
+ */
+static void expired_lock_wheel(struct ldlm_waiting_locks *wl, int *do_dump)
+{
+	struct list_head *expired = &wl->wl_expired;
+
+	spin_lock_bh(&wl->wl_lock);
+	while (!list_empty(expired)) {
+		struct obd_export *export;
+		struct ldlm_lock *lock;
+
+		lock = list_first_entry(expired, struct ldlm_lock,
+					l_pending_chain);
+		if ((void *)lock < LP_POISON + PAGE_SIZE &&
+		    (void *)lock >= LP_POISON) {
+			spin_unlock_bh(&wl->wl_lock);
+			CERROR("free lock on elt list %p\n", lock);
+			LBUG();
+		}
+		list_del_init(&lock->l_pending_chain);
+		if ((void *)lock->l_export <
+		     LP_POISON + PAGE_SIZE &&
+		    (void *)lock->l_export >= LP_POISON) {
+			CERROR("lock with free export on elt list %p\n",
+			       lock->l_export);
+			lock->l_export = NULL;
+			LDLM_ERROR(lock, "free export");
+			/*
+			 * release extra ref grabbed by
+			 * ldlm_add_waiting_lock() or
+			 * ldlm_failed_ast()
+			 */
+			ldlm_lock_put(lock);
+			continue;
+		}
+
+		if (ldlm_is_destroyed(lock)) {
+			/*
+			 * release the lock refcount where
+			 * waiting_locks_callback() founds
+			 */
+			ldlm_lock_put(lock);
+			continue;
+		}
+		export = class_export_lock_get(lock->l_export, lock);
+		spin_unlock_bh(&wl->wl_lock);
+
+		/* Check if we need to prolong timeout */
+		if (!CFS_FAIL_CHECK(OBD_FAIL_PTLRPC_HPREQ_TIMEOUT) &&
+		    lock->l_callback_timestamp != 0 && /* not AST err */
+		    ldlm_lock_busy(lock)) {
+			LDLM_DEBUG(lock, "prolong the busy lock");
+			lock_res_and_lock(lock);
+			ldlm_add_waiting_lock(lock,
+					ldlm_bl_timeout(lock) >> 1);
+			unlock_res_and_lock(lock);
+		} else {
+			spin_lock_bh(&export->exp_bl_list_lock);
+			list_del_init(&lock->l_exp_list);
+			spin_unlock_bh(&export->exp_bl_list_lock);
+
+			LDLM_ERROR(lock,
+				   "lock callback timer expired after %llds: evicting client at %s ",
+				   ktime_get_seconds() -
+				   lock->l_blast_sent,
+				   obd_export_nid2str(export));
+			ldlm_lock_to_ns(lock)->ns_timeouts++;
+			if (do_dump_on_eviction(export->exp_obd,
+						DUMP_LDLM_LOCK))
+				(*do_dump)++;
+			class_fail_export(export);
+		}
+		class_export_lock_put(export, lock);
+		/*
+		 * release extra ref grabbed by ldlm_add_waiting_lock()
+		 * or ldlm_failed_ast()
+		 */
+		ldlm_lock_put(lock);
+
+		spin_lock_bh(&wl->wl_lock);
+	}
+	spin_unlock_bh(&wl->wl_lock);
+}
+
+/**
+ * Check expired lock lists for expired locks and time them out.
  */
 static int expired_lock_main(void *arg)
 {
-	struct list_head *expired = &expired_lock_list;
+	struct ldlm_waiting_locks *wl;
 	struct lu_env env;
-	int rc, do_dump;
+	int rc, do_dump, i;
 
 	ENTRY;
 
@@ -180,95 +300,13 @@ static int expired_lock_main(void *arg)
 			continue;
 		}
 
-		spin_lock_bh(&waiting_locks_spinlock);
-
-		if (expired_lock_dump) {
-			spin_unlock_bh(&waiting_locks_spinlock);
-
-			/* from waiting_locks_callback, but not in timer */
+		/* from waiting_locks_callback, but not in timer */
+		if (xchg(&expired_lock_dump, 0))
 			libcfs_debug_dumplog();
 
-			spin_lock_bh(&waiting_locks_spinlock);
-			expired_lock_dump = 0;
-		}
-
 		do_dump = 0;
-
-		while (!list_empty(expired)) {
-			struct obd_export *export;
-			struct ldlm_lock *lock;
-
-			lock = list_first_entry(expired, struct ldlm_lock,
-						l_pending_chain);
-			if ((void *)lock < LP_POISON + PAGE_SIZE &&
-			    (void *)lock >= LP_POISON) {
-				spin_unlock_bh(&waiting_locks_spinlock);
-				CERROR("free lock on elt list %p\n", lock);
-				LBUG();
-			}
-			list_del_init(&lock->l_pending_chain);
-			if ((void *)lock->l_export <
-			     LP_POISON + PAGE_SIZE &&
-			    (void *)lock->l_export >= LP_POISON) {
-				CERROR("lock with free export on elt list %p\n",
-				       lock->l_export);
-				lock->l_export = NULL;
-				LDLM_ERROR(lock, "free export");
-				/*
-				 * release extra ref grabbed by
-				 * ldlm_add_waiting_lock() or
-				 * ldlm_failed_ast()
-				 */
-				ldlm_lock_put(lock);
-				continue;
-			}
-
-			if (ldlm_is_destroyed(lock)) {
-				/*
-				 * release the lock refcount where
-				 * waiting_locks_callback() founds
-				 */
-				ldlm_lock_put(lock);
-				continue;
-			}
-			export = class_export_lock_get(lock->l_export, lock);
-			spin_unlock_bh(&waiting_locks_spinlock);
-
-			/* Check if we need to prolong timeout */
-			if (!CFS_FAIL_CHECK(OBD_FAIL_PTLRPC_HPREQ_TIMEOUT) &&
-			    lock->l_callback_timestamp != 0 && /* not AST err */
-			    ldlm_lock_busy(lock)) {
-				LDLM_DEBUG(lock, "prolong the busy lock");
-				lock_res_and_lock(lock);
-				ldlm_add_waiting_lock(lock,
-						ldlm_bl_timeout(lock) >> 1);
-				unlock_res_and_lock(lock);
-			} else {
-				spin_lock_bh(&export->exp_bl_list_lock);
-				list_del_init(&lock->l_exp_list);
-				spin_unlock_bh(&export->exp_bl_list_lock);
-
-				LDLM_ERROR(lock,
-					   "lock callback timer expired after %llds: evicting client at %s ",
-					   ktime_get_seconds() -
-					   lock->l_blast_sent,
-					   obd_export_nid2str(export));
-				ldlm_lock_to_ns(lock)->ns_timeouts++;
-				if (do_dump_on_eviction(export->exp_obd,
-							DUMP_LDLM_LOCK))
-					do_dump++;
-				class_fail_export(export);
-			}
-			class_export_lock_put(export, lock);
-			/*
-			 * release extra ref grabbed by ldlm_add_waiting_lock()
-			 * or ldlm_failed_ast()
-			 */
-			ldlm_lock_put(lock);
-
-			spin_lock_bh(&waiting_locks_spinlock);
-		}
-		spin_unlock_bh(&waiting_locks_spinlock);
+		cfs_percpt_for_each(wl, i, ldlm_waiting_locks)
+			expired_lock_wheel(wl, &do_dump);
 
 		if (do_dump) {
 			CERROR("dump the log upon eviction\n");
@@ -317,30 +355,130 @@ static int ldlm_lock_busy(struct ldlm_lock *lock)
 	RETURN(match);
 }
 
-/* This is called from within a timer interrupt and cannot schedule */
-static void waiting_locks_callback(struct timer_list *unused)
+/* Put @lock on the wheel slot matching its l_callback_timestamp. */
+static void ldlm_wl_insert(struct ldlm_waiting_locks *wl,
+			   struct ldlm_lock *lock)
+{
+	time64_t expire = lock->l_callback_timestamp;
+	time64_t delta;
+	int level = 0;
+
+	if (expire < wl->wl_clock)
+		expire = wl->wl_clock;
+	delta = expire - wl->wl_clock;
+	if (delta > LDLM_WL_MAX_DELTA) {
+		delta = LDLM_WL_MAX_DELTA;
+		expire = wl->wl_clock + delta;
+	}
+	while (delta >= (1LL << (LDLM_WL_BITS * (level + 1))))
+		level++;
+
+	list_add_tail(&lock->l_pending_chain,
+		      &wl->wl_slots[level][(expire >> (LDLM_WL_BITS * level)) &
+					   LDLM_WL_MASK]);
+}
+
+/* Move the locks of an upper level slot to the lower levels. */
+static void ldlm_wl_cascade(struct ldlm_waiting_locks *wl, int level, int idx)
 {
 	struct ldlm_lock *lock;
-	int need_dump = 0;
+	struct ldlm_lock *tmp;
+	LIST_HEAD(list);
 
-	spin_lock_bh(&waiting_locks_spinlock);
-	while (!list_empty(&waiting_locks_list)) {
-		lock = list_first_entry(&waiting_locks_list, struct ldlm_lock,
-					l_pending_chain);
-		if (lock->l_callback_timestamp > ktime_get_seconds() ||
-		    lock->l_req_mode == LCK_GROUP)
+	list_splice_init(&wl->wl_slots[level][idx], &list);
+	list_for_each_entry_safe(lock, tmp, &list, l_pending_chain) {
+		list_del(&lock->l_pending_chain);
+		ldlm_wl_insert(wl, lock);
+	}
+}
+
+/* Return the time the wheel timer has to fire at next, or 0 if empty. */
+static time64_t ldlm_wl_next(struct ldlm_waiting_locks *wl)
+{
+	time64_t next = 0;
+	time64_t slot;
+	int level;
+	int i;
+
+	for (i = 0; i < LDLM_WL_SIZE; i++) {
+		slot = wl->wl_clock + i;
+		if (!list_empty(&wl->wl_slots[0][slot & LDLM_WL_MASK])) {
+			next = slot;
 			break;
+		}
+	}
+
+	/* upper levels need to be cascaded at the start of their slot */
+	for (level = 1; level < LDLM_WL_LEVELS; level++) {
+		int shift = LDLM_WL_BITS * level;
+
+		for (i = 1; i <= LDLM_WL_SIZE; i++) {
+			slot = (wl->wl_clock >> shift) + i;
+			if (list_empty(&wl->wl_slots[level][slot & LDLM_WL_MASK]))
+				continue;
+			slot <<= shift;
+			if (!next || slot < next)
+				next = slot;
+			break;
+		}
+	}
+
+	return next;
+}
+
+static void ldlm_wl_arm(struct ldlm_waiting_locks *wl, time64_t next)
+{
+	time64_t now = ktime_get_seconds();
+
+	wl->wl_next = next;
+	mod_timer(&wl->wl_timer,
+		  jiffies + cfs_time_seconds(next > now ? next - now : 0));
+}
+
+/* This is called from within a timer interrupt and cannot schedule */
+static void waiting_locks_callback(cfs_timer_cb_arg_t data)
+{
+	struct ldlm_waiting_locks *wl = cfs_from_timer(wl, data, wl_timer);
+	time64_t now = ktime_get_seconds();
+	int need_dump = 0;
+	time64_t next;
+
+	spin_lock_bh(&wl->wl_lock);
+	while (wl->wl_clock <= now) {
+		int idx = wl->wl_clock & LDLM_WL_MASK;
+		struct list_head *slot = &wl->wl_slots[0][idx];
+
+		if (idx == 0) {
+			int idx1 = (wl->wl_clock >> LDLM_WL_BITS) &
+				   LDLM_WL_MASK;
+
+			if (idx1 == 0)
+				ldlm_wl_cascade(wl, 2,
+						(wl->wl_clock >>
+						 (2 * LDLM_WL_BITS)) &
+						LDLM_WL_MASK);
+			ldlm_wl_cascade(wl, 1, idx1);
+		}
 
 		/*
-		 * no needs to take an extra ref on the lock since it was in
-		 * the waiting_locks_list and ldlm_add_waiting_lock()
-		 * already grabbed a ref
+		 * no needs to take an extra ref on the locks since they were
+		 * on the wheel and ldlm_add_waiting_lock() already grabbed
+		 * a ref
 		 */
-		list_move(&lock->l_pending_chain, &expired_lock_list);
-		need_dump = 1;
+		if (!list_empty(slot)) {
+			list_splice_tail_init(slot, &wl->wl_expired);
+			need_dump = 1;
+		}
+
+		/* skip the empty seconds up to the next slot to expire or
+		 * to cascade, rather than stepping through each of them
+		 */
+		wl->wl_clock++;
+		next = ldlm_wl_next(wl);
+		wl->wl_clock = next && next <= now ? next : now + 1;
 	}
 
-	if (!list_empty(&expired_lock_list)) {
+	if (!list_empty(&wl->wl_expired)) {
 		if (obd_dump_on_timeout && need_dump)
 			expired_lock_dump = __LINE__;
 
@@ -351,37 +489,30 @@ static void waiting_locks_callback(struct timer_list *unused)
 	 * Make sure the timer will fire again if we have any locks
 	 * left.
 	 */
-	if (!list_empty(&waiting_locks_list)) {
-		time64_t now = ktime_get_seconds();
-		timeout_t delta = 0;
-
-		lock = list_first_entry(&waiting_locks_list, struct ldlm_lock,
-					l_pending_chain);
-		if (lock->l_callback_timestamp - now > 0)
-			delta = lock->l_callback_timestamp - now;
-		mod_timer(&waiting_locks_timer,
-			  jiffies + cfs_time_seconds(delta));
-	}
-	spin_unlock_bh(&waiting_locks_spinlock);
+	next = ldlm_wl_next(wl);
+	if (next)
+		ldlm_wl_arm(wl, next);
+	else
+		wl->wl_next = 0;
+	spin_unlock_bh(&wl->wl_lock);
 }
 
 /**
  * Add lock to the list of contended locks.
  *
  * Indicate that we're waiting for a client to call us back cancelling a given
- * lock.  We add it to the pending-callback chain, and schedule the lock-timeout
- * timer to fire appropriately.  (We round up to the next second, to avoid
- * floods of timer firings during periods of high lock contention and traffic).
+ * lock.  We add it to the pending-callback wheel, and schedule the wheel timer
+ * to fire appropriately.  (Deadlines are in seconds, to avoid floods of timer
+ * firings during periods of high lock contention and traffic).
  * As done by ldlm_add_waiting_lock(), the caller must grab a lock reference
  * if it has been added to the waiting list (1 is returned).
  *
- * Called with the namespace lock held.
+ * Called with the namespace lock and wl->wl_lock held.
  */
-static int __ldlm_add_waiting_lock(struct ldlm_lock *lock, timeout_t delay)
+static int __ldlm_add_waiting_lock(struct ldlm_waiting_locks *wl,
+				   struct ldlm_lock *lock, timeout_t delay)
 {
-	unsigned long timeout_jiffies = jiffies;
 	time64_t deadline;
-	timeout_t timeout;
 
 	lock->l_blast_sent = ktime_get_seconds();
 	if (!list_empty(&lock->l_pending_chain))
@@ -394,22 +525,21 @@ static int __ldlm_add_waiting_lock(struct ldlm_lock *lock, timeout_t delay)
 	deadline = lock->l_blast_sent + delay;
 	if (likely(deadline > lock->l_callback_timestamp))
 		lock->l_callback_timestamp = deadline;
+	deadline = lock->l_callback_timestamp;
 
-	timeout = clamp_t(timeout_t,
-			  lock->l_callback_timestamp - lock->l_blast_sent,
-			  0, delay);
-	timeout_jiffies += cfs_time_seconds(timeout);
+	/* group locks are never timed out */
+	if (lock->l_req_mode == LCK_GROUP) {
+		list_add_tail(&lock->l_pending_chain, &wl->wl_group);
+		return 1;
+	}
 
-	if (time_before(timeout_jiffies, waiting_locks_timer.expires) ||
-	    !timer_pending(&waiting_locks_timer))
-		mod_timer(&waiting_locks_timer, timeout_jiffies);
+	/* the wheel was empty, start its clock from now */
+	if (!wl->wl_next)
+		wl->wl_clock = lock->l_blast_sent;
+	ldlm_wl_insert(wl, lock);
 
-	/*
-	 * if the new lock has a shorter timeout than something earlier on
-	 * the list, we'll wait the longer amount of time; no big deal.
-	 */
-	/* FIFO */
-	list_add_tail(&lock->l_pending_chain, &waiting_locks_list);
+	if (!wl->wl_next || deadline < wl->wl_next)
+		ldlm_wl_arm(wl, max(deadline, wl->wl_clock));
 	return 1;
 }
 
@@ -439,6 +569,7 @@ static void ldlm_add_blocked_lock(struct ldlm_lock *lock)
 
 static int ldlm_add_waiting_lock(struct ldlm_lock *lock, timeout_t timeout)
 {
+	struct ldlm_waiting_locks *wl = ldlm_lock_wl(lock);
 	struct obd_device *obd = NULL;
 	int at_off, ret;
 
@@ -457,16 +588,16 @@ static int ldlm_add_waiting_lock(struct ldlm_lock *lock, timeout_t timeout)
 			return 0;
 	}
 
-	spin_lock_bh(&waiting_locks_spinlock);
+	spin_lock_bh(&wl->wl_lock);
 	if (ldlm_is_cancel(lock)) {
-		spin_unlock_bh(&waiting_locks_spinlock);
+		spin_unlock_bh(&wl->wl_lock);
 		return 0;
 	}
 
 	if (ldlm_is_destroyed(lock)) {
 		static time64_t next;
 
-		spin_unlock_bh(&waiting_locks_spinlock);
+		spin_unlock_bh(&wl->wl_lock);
 		LDLM_ERROR(lock, "not waiting on destroyed lock (b=5653)");
 		if (ktime_get_seconds() > next) {
 			next = ktime_get_seconds() + 14400;
@@ -476,7 +607,7 @@ static int ldlm_add_waiting_lock(struct ldlm_lock *lock, timeout_t timeout)
 	}
 
 	ldlm_set_waited(lock);
-	ret = __ldlm_add_waiting_lock(lock, timeout);
+	ret = __ldlm_add_waiting_lock(wl, lock, timeout);
 	if (ret) {
 		/*
 		 * grab ref on the lock if it has been added to the
@@ -484,7 +615,7 @@ static int ldlm_add_waiting_lock(struct ldlm_lock *lock, timeout_t timeout)
 		 */
 		ldlm_lock_get(lock);
 	}
-	spin_unlock_bh(&waiting_locks_spinlock);
+	spin_unlock_bh(&wl->wl_lock);
 
 	if (ret)
 		ldlm_add_blocked_lock(lock);
@@ -498,40 +629,19 @@ static int ldlm_add_waiting_lock(struct ldlm_lock *lock, timeout_t timeout)
 
 /**
  * Remove a lock from the pending list, likely because it had its cancellation
- * callback arrive without incident.  This adjusts the lock-timeout timer if
- * needed.  Returns 0 if the lock wasn't pending after all, 1 if it was.
+ * callback arrive without incident.  The wheel timer is left alone, it just
+ * finds nothing to expire if it fires for this lock.  Returns 0 if the lock
+ * wasn't pending after all, 1 if it was.
  * As done by ldlm_del_waiting_lock(), the caller must release the lock
  * reference when the lock is removed from any list (1 is returned).
  *
- * Called with namespace lock held.
+ * Called with namespace lock and the lock's wl_lock held.
  */
 static int __ldlm_del_waiting_lock(struct ldlm_lock *lock)
 {
-	struct list_head *list_next;
-
 	if (list_empty(&lock->l_pending_chain))
 		return 0;
 
-	list_next = lock->l_pending_chain.next;
-	if (lock->l_pending_chain.prev == &waiting_locks_list) {
-		/* Removing the head of the list, adjust timer. */
-		if (list_next == &waiting_locks_list) {
-			/* No more, just cancel. */
-			timer_delete(&waiting_locks_timer);
-		} else {
-			time64_t now = ktime_get_seconds();
-			struct ldlm_lock *next;
-			timeout_t delta = 0;
-
-			next = list_entry(list_next, struct ldlm_lock,
-					  l_pending_chain);
-			if (next->l_callback_timestamp - now > 0)
-				delta = next->l_callback_timestamp - now;
-
-			mod_timer(&waiting_locks_timer,
-				  jiffies + cfs_time_seconds(delta));
-		}
-	}
 	list_del_init(&lock->l_pending_chain);
 
 	return 1;
@@ -539,6 +649,7 @@ static int __ldlm_del_waiting_lock(struct ldlm_lock *lock)
 
 int ldlm_del_waiting_lock(struct ldlm_lock *lock)
 {
+	struct ldlm_waiting_locks *wl;
 	int ret;
 
 	if (lock->l_export == NULL) {
@@ -547,10 +658,11 @@ int ldlm_del_waiting_lock(struct ldlm_lock *lock)
 		return 0;
 	}
 
-	spin_lock_bh(&waiting_locks_spinlock);
+	wl = ldlm_lock_wl(lock);
+	spin_lock_bh(&wl->wl_lock);
 	ret = __ldlm_del_waiting_lock(lock);
 	ldlm_clear_waited(lock);
-	spin_unlock_bh(&waiting_locks_spinlock);
+	spin_unlock_bh(&wl->wl_lock);
 
 	/* remove the lock out of export blocking list */
 	spin_lock_bh(&lock->l_export->exp_bl_list_lock);
@@ -576,6 +688,8 @@ int ldlm_del_waiting_lock(struct ldlm_lock *lock)
  */
 int ldlm_refresh_waiting_lock(struct ldlm_lock *lock, timeout_t timeout)
 {
+	struct ldlm_waiting_locks *wl;
+
 	if (lock->l_export == NULL) {
 		/* We don't have a "waiting locks list" on clients. */
 		LDLM_DEBUG(lock, "client lock: no-op");
@@ -588,10 +702,11 @@ int ldlm_refresh_waiting_lock(struct ldlm_lock *lock, timeout_t timeout)
 		return 0;
 	}
 
-	spin_lock_bh(&waiting_locks_spinlock);
+	wl = ldlm_lock_wl(lock);
+	spin_lock_bh(&wl->wl_lock);
 
 	if (list_empty(&lock->l_pending_chain)) {
-		spin_unlock_bh(&waiting_locks_spinlock);
+		spin_unlock_bh(&wl->wl_lock);
 		LDLM_DEBUG(lock, "wasn't waiting");
 		return 0;
 	}
@@ -601,8 +716,8 @@ int ldlm_refresh_waiting_lock(struct ldlm_lock *lock, timeout_t timeout)
 	 * release/take a lock reference
 	 */
 	__ldlm_del_waiting_lock(lock);
-	__ldlm_add_waiting_lock(lock, timeout);
-	spin_unlock_bh(&waiting_locks_spinlock);
+	__ldlm_add_waiting_lock(wl, lock, timeout);
+	spin_unlock_bh(&wl->wl_lock);
 
 	LDLM_DEBUG(lock, "refreshed to %ds", timeout);
 	return 1;
@@ -654,19 +769,61 @@ timeout_t ldlm_bl_timeout(struct ldlm_lock *lock)
 }
 EXPORT_SYMBOL(ldlm_bl_timeout);
 
+static int ldlm_waiting_locks_init(void)
+{
+	struct ldlm_waiting_locks *wl;
+	int level;
+	int i, j;
+
+	ldlm_waiting_locks = cfs_percpt_alloc(cfs_cpt_tab, sizeof(*wl));
+	if (!ldlm_waiting_locks)
+		return -ENOMEM;
+
+	cfs_percpt_for_each(wl, i, ldlm_waiting_locks) {
+		spin_lock_init(&wl->wl_lock);
+		cfs_timer_setup(&wl->wl_timer, waiting_locks_callback,
+				(unsigned long)wl, 0);
+		wl->wl_clock = ktime_get_seconds();
+		wl->wl_next = 0;
+		INIT_LIST_HEAD(&wl->wl_group);
+		INIT_LIST_HEAD(&wl->wl_expired);
+		for (level = 0; level < LDLM_WL_LEVELS; level++)
+			for (j = 0; j < LDLM_WL_SIZE; j++)
+				INIT_LIST_HEAD(&wl->wl_slots[level][j]);
+	}
+
+	return 0;
+}
+
+static void ldlm_waiting_locks_fini(void)
+{
+	struct ldlm_waiting_locks *wl;
+	int i;
+
+	if (!ldlm_waiting_locks)
+		return;
+
+	cfs_percpt_for_each(wl, i, ldlm_waiting_locks)
+		timer_delete_sync(&wl->wl_timer);
+	cfs_percpt_free(ldlm_waiting_locks);
+	ldlm_waiting_locks = NULL;
+}
+
 /**
  * Perform lock cleanup if AST sending failed.
  */
 static void ldlm_failed_ast(struct ldlm_lock *lock, int rc,
 			    const char *ast_type)
 {
+	struct ldlm_waiting_locks *wl = ldlm_lock_wl(lock);
+
 	LCONSOLE_ERROR("%s: A client on nid %s was evicted due to a lock %s callback time out: rc %d\n",
 		       lock->l_export->exp_obd->obd_name,
 		       obd_export_nid2str(lock->l_export), ast_type, rc);
 
 	if (obd_dump_on_timeout)
 		libcfs_debug_dumplog();
-	spin_lock_bh(&waiting_locks_spinlock);
+	spin_lock_bh(&wl->wl_lock);
 	if (__ldlm_del_waiting_lock(lock) == 0)
 		/*
 		 * the lock was not in any list, grab an extra ref before adding
@@ -675,9 +832,9 @@ static void ldlm_failed_ast(struct ldlm_lock *lock, int rc,
 		ldlm_lock_get(lock);
 	/* differentiate it from expired locks */
 	lock->l_callback_timestamp = 0;
-	list_add(&lock->l_pending_chain, &expired_lock_list);
+	list_add(&lock->l_pending_chain, &wl->wl_expired);
 	wake_up(&expired_lock_wait_queue);
-	spin_unlock_bh(&waiting_locks_spinlock);
+	spin_unlock_bh(&wl->wl_lock);
 }
 
 /**
@@ -755,6 +912,59 @@ static int ldlm_handle_ast_error(struct ldlm_lock *lock,
 	return rc;
 }
 
+static void ldlm_bl_batch_free(struct ldlm_bl_batch *batch)
+{
+	int i;
+
+	for (i = 0; i < batch->lbb_count; i++)
+		ldlm_lock_put(batch->lbb_locks[i]);
+	if (batch->lbb_req)
+		ptlrpc_request_free(batch->lbb_req);
+	OBD_FREE_PTR(batch);
+}
+
+/**
+ * Handle the reply to a batched blocking AST.
+ *
+ * A client replies to a multi-lock blocking AST with one status per lock in
+ * RMF_RCS, so that a lock which is already gone on the client (-EINVAL) does
+ * not make the other locks of the batch look failed. If the RPC as a whole
+ * failed, its status applies to every lock of the batch.
+ */
+static int ldlm_bl_batch_interpret(struct ptlrpc_request *req,
+				   struct ldlm_cb_set_arg *arg,
+				   struct ldlm_bl_batch *batch, int rc)
+{
+	__u32 *rcs = NULL;
+	int i;
+
+	ENTRY;
+
+	if (rc == 0 && batch->lbb_count > 1) {
+		rcs = req_capsule_server_sized_get(&req->rq_pill, &RMF_RCS,
+						   batch->lbb_count *
+						   sizeof(*rcs));
+		if (rcs == NULL)
+			rc = -EPROTO;
+	}
+
+	for (i = 0; i < batch->lbb_count; i++) {
+		struct ldlm_lock *lock = batch->lbb_locks[i];
+		int lock_rc = rcs ? (int)rcs[i] : rc;
+
+		if (lock_rc != 0)
+			lock_rc = ldlm_handle_ast_error(lock, req, lock_rc,
+							"blocking");
+		if (lock_rc == -ERESTART)
+			atomic_inc(&arg->restart);
+	}
+
+	/* release extra references taken in ldlm_bl_batch_add() */
+	ldlm_bl_batch_free(batch);
+
+	RETURN(0);
+}
+
 static int ldlm_cb_interpret(const struct lu_env *env,
 			     struct ptlrpc_request *req, void *args, int rc)
 {
@@ -764,6 +974,9 @@ static int ldlm_cb_interpret(const struct lu_env *env,
 
 	ENTRY;
 
+	if (ca->ca_batch)
+		RETURN(ldlm_bl_batch_interpret(req, arg, ca->ca_batch, rc));
+
 	LASSERT(lock != NULL);
 
 	switch (arg->type) {
@@ -817,6 +1030,15 @@ static void ldlm_update_resend(struct ptlrpc_request *req, void *data)
 {
 	struct ldlm_cb_async_args *ca = data;
 	struct ldlm_lock *lock = ca->ca_lock;
+	int i;
+
+	if (ca->ca_batch) {
+		for (i = 0; i < ca->ca_batch->lbb_count; i++) {
+			lock = ca->ca_batch->lbb_locks[i];
+			ldlm_refresh_waiting_lock(lock, ldlm_bl_timeout(lock));
+		}
+		return;
+	}
 
 	ldlm_refresh_waiting_lock(lock, ldlm_bl_timeout(lock));
 }
@@ -877,6 +1099,264 @@ static void ldlm_lock_reorder_req(struct ldlm_lock *lock)
 	EXIT;
 }
 
+/**
+ * Check if a blocking AST still has to be sent for a server lock.
+ *
+ * Called with the lock's resource locked. If no AST is needed because the
+ * lock is destroyed or not granted yet, the resource is unlocked and false
+ * is returned.
+ */
+static bool ldlm_bl_ast_needed(struct ldlm_lock *lock)
+{
+	if (ldlm_is_destroyed(lock)) {
+		/* What's the point? */
+		unlock_res_and_lock(lock);
+		return false;
+	}
+
+	if (!ldlm_is_granted(lock)) {
+		/*
+		 * this blocking AST will be communicated as part of the
+		 * completion AST instead
+		 */
+		ldlm_add_blocked_lock(lock);
+		ldlm_set_waited(lock);
+		unlock_res_and_lock(lock);
+
+		LDLM_DEBUG(lock, "lock not granted, not sending blocking AST");
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Allocate a blocking AST batch for \a exp along with its RPC.
+ *
+ * The request is packed for LDLM_BL_BATCH_MAX locks and shrunk to the
+ * actual number of locks once the batch is sent, so that nothing can fail
+ * after the locks are marked CBPENDING and put on the waiting list.
+ */
+static struct ldlm_bl_batch *ldlm_bl_batch_alloc(struct obd_export *exp)
+{
+	struct ldlm_bl_batch *batch;
+	struct ptlrpc_request *req;
+	int rc;
+
+	OBD_ALLOC_PTR(batch);
+	if (batch == NULL)
+		return ERR_PTR(-ENOMEM);
+
+	req = ptlrpc_request_alloc(exp->exp_imp_reverse,
+				   &RQF_LDLM_BL_CALLBACK);
+	if (req == NULL) {
+		OBD_FREE_PTR(batch);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	req_capsule_set_size(&req->rq_pill, &RMF_DLM_REQ, RCL_CLIENT,
+			     offsetof(struct ldlm_request,
+				      lock_handle[2 * LDLM_BL_BATCH_MAX]));
+	rc = ptlrpc_request_pack(req, LUSTRE_DLM_VERSION, LDLM_BL_CALLBACK);
+	if (rc) {
+		ptlrpc_request_free(req);
+		OBD_FREE_PTR(batch);
+		return ERR_PTR(rc);
+	}
+
+	INIT_LIST_HEAD(&batch->lbb_list);
+	INIT_HLIST_NODE(&batch->lbb_hash);
+	batch->lbb_exp = exp;
+	batch->lbb_req = req;
+
+	return batch;
+}
+
+static struct ldlm_bl_batch *ldlm_bl_batch_find(struct ldlm_cb_set_arg *arg,
+						struct obd_export *exp,
+						struct ldlm_lock_desc *desc,
+						__u64 flags)
+{
+	struct ldlm_bl_batch *batch;
+
+	hash_for_each_possible(arg->bl_batch_hash, batch, lbb_hash,
+			       (unsigned long)exp) {
+		if (batch->lbb_exp == exp && batch->lbb_flags == flags &&
+		    memcmp(&batch->lbb_desc, desc, sizeof(*desc)) == 0)
+			return batch;
+	}
+
+	return NULL;
+}
+
+/**
+ * Send the blocking AST RPC for all locks of \a batch.
+ *
+ * The locks are packed as pairs of handles in lock_handle[]: the client
+ * handle of the lock followed by the server one, with lock_count set to the
+ * number of locks. A batch of a single lock is sent in the regular format.
+ */
+static void ldlm_bl_batch_send(struct ldlm_cb_set_arg *arg,
+			       struct ldlm_bl_batch *batch)
+{
+	struct ptlrpc_request *req = batch->lbb_req;
+	struct obd_export *exp = batch->lbb_exp;
+	struct ldlm_cb_async_args *ca;
+	struct ldlm_request *body;
+	int count = batch->lbb_count;
+	int i;
+
+	ENTRY;
+
+	list_del_init(&batch->lbb_list);
+	hash_del(&batch->lbb_hash);
+	batch->lbb_req = NULL;
+
+	req_capsule_shrink(&req->rq_pill, &RMF_DLM_REQ,
+			   offsetof(struct ldlm_request,
+				    lock_handle[2 * count]), RCL_CLIENT);
+
+	body = req_capsule_client_get(&req->rq_pill, &RMF_DLM_REQ);
+	body->lock_flags = batch->lbb_flags;
+	body->lock_count = count;
+	body->lock_desc = batch->lbb_desc;
+	for (i = 0; i < count; i++) {
+		struct ldlm_lock *lock = batch->lbb_locks[i];
+
+		body->lock_handle[2 * i] = lock->l_remote_handle;
+		body->lock_handle[2 * i + 1].cookie = lock->l_handle.h_cookie;
+	}
+
+	if (count > 1) {
+		req_capsule_extend(&req->rq_pill, &RQF_LDLM_BL_CALLBACK_BATCH);
+		req_capsule_set_size(&req->rq_pill, &RMF_RCS, RCL_SERVER,
+				     count * sizeof(__u32));
+	}
+	ptlrpc_request_set_replen(req);
+
+	ca = ptlrpc_req_async_args(ca, req);
+	ca->ca_set_arg = arg;
+	ca->ca_lock = NULL;
+	ca->ca_batch = batch;
+
+	req->rq_interpret_reply = ldlm_cb_interpret;
+	/* Do not resend after lock callback timeout */
+	req->rq_delay_limit_ns = ktime_set(batch->lbb_timeout, 0);
+	req->rq_resend_cb = ldlm_update_resend;
+	req->rq_send_state = LUSTRE_IMP_FULL;
+	/* ptlrpc_request_pack already set timeout */
+	if (obd_at_off(exp->exp_obd))
+		req->rq_timeout = ldlm_get_rq_timeout();
+
+	CDEBUG(D_DLMTRACE, "%s: sending blocking AST for %d locks to %s\n",
+	       exp->exp_obd->obd_name, count, obd_export_nid2str(exp));
+
+	ptlrpc_set_add_req(arg->set, req);
+
+	EXIT;
+}
+
+/**
+ * Queue a blocking AST for \a lock into the batch of its export.
+ *
+ * The lock is prepared exactly as for a single blocking AST, but instead of
+ * sending an RPC for it right away it is added to the pending batch of the
+ * export which has the same lock descriptor and AST flags. A batch is sent
+ * once it is full, or by ldlm_bl_batch_flush() when the AST work list of the
+ * current ldlm_run_ast_work() is exhausted.
+ *
+ * A new batch and its RPC are only allocated if no batch matches, before
+ * the lock is marked CBPENDING.
+ *
+ * \retval negative	no batch could be allocated, the lock is untouched
+ *			and its AST has to be sent on its own
+ */
+static int ldlm_bl_batch_add(struct ldlm_lock *lock,
+			     struct ldlm_lock_desc *desc,
+			     struct ldlm_cb_set_arg *arg)
+{
+	struct obd_export *exp = lock->l_export;
+	struct ldlm_bl_batch *batch;
+	struct ldlm_bl_batch *new = NULL;
+	time64_t timeout;
+	__u64 flags;
+
+	ENTRY;
+
+again:
+	lock_res_and_lock(lock);
+	if (!ldlm_bl_ast_needed(lock))
+		GOTO(out, 0);
+
+	flags = ldlm_flags_to_wire(lock->l_flags & LDLM_FL_AST_MASK);
+	batch = ldlm_bl_batch_find(arg, exp, desc, flags);
+	if (batch == NULL && new == NULL) {
+		unlock_res_and_lock(lock);
+		new = ldlm_bl_batch_alloc(exp);
+		if (IS_ERR(new))
+			RETURN(PTR_ERR(new));
+		goto again;
+	}
+
+	if (batch == NULL) {
+		batch = new;
+		new = NULL;
+		batch->lbb_desc = *desc;
+		batch->lbb_flags = flags;
+		list_add_tail(&batch->lbb_list, &arg->bl_batches);
+		hash_add(arg->bl_batch_hash, &batch->lbb_hash,
+			 (unsigned long)exp);
+	}
+
+	timeout = ldlm_bl_timeout(lock);
+
+	LDLM_DEBUG(lock, "server batching blocking AST");
+
+	ldlm_set_cbpending(lock);
+	ldlm_add_waiting_lock(lock, timeout);
+	unlock_res_and_lock(lock);
+
+	/* released in ldlm_bl_batch_interpret() */
+	batch->lbb_locks[batch->lbb_count++] = ldlm_lock_get(lock);
+	batch->lbb_timeout = max(batch->lbb_timeout, timeout);
+
+	if (exp->exp_nid_stats && exp->exp_nid_stats->nid_ldlm_stats)
+		lprocfs_counter_incr(exp->exp_nid_stats->nid_ldlm_stats,
+				     LDLM_BL_CALLBACK - LDLM_FIRST_OPC);
+
+	if (batch->lbb_count == LDLM_BL_BATCH_MAX)
+		ldlm_bl_batch_send(arg, batch);
+out:
+	/* another batch matched after the resource lock was dropped */
+	if (new != NULL)
+		ldlm_bl_batch_free(new);
+
+	RETURN(0);
+}
+
+/**
+ * Send one of the pending blocking AST batches of \a arg.
+ *
+ * Called by the AST producers once their work list is empty, so that batches
+ * are only sent when no more locks can be added to them.
+ *
+ * \retval 0		a batch was sent
+ * \retval -ENOENT	no batch is pending
+ */
+int ldlm_bl_batch_flush(struct ldlm_cb_set_arg *arg)
+{
+	struct ldlm_bl_batch *batch;
+
+	if (list_empty(&arg->bl_batches))
+		return -ENOENT;
+
+	batch = list_first_entry(&arg->bl_batches, struct ldlm_bl_batch,
+				 lbb_list);
+	ldlm_bl_batch_send(arg, batch);
+
+	return 0;
+}
+
 /**
  * ->l_blocking_ast() method for server-side locks. This is invoked when newly
  * enqueued server lock conflicts with given one.
@@ -916,6 +1396,15 @@ int ldlm_server_blocking_ast(struct ldlm_lock *lock,
 
 	ldlm_lock_reorder_req(lock);
 
+	if (arg->type == LDLM_BL_CALLBACK && !ldlm_is_cancel_on_block(lock) &&
+	    exp_connect_batch_bl_ast(lock->l_export)) {
+		rc = ldlm_bl_batch_add(lock, desc, arg);
+		if (rc == 0)
+			RETURN(0);
+		/* fall back to a blocking AST of its own */
+		rc = 0;
+	}
+
 	req = ptlrpc_request_alloc_pack(lock->l_export->exp_imp_reverse,
 					&RQF_LDLM_BL_CALLBACK,
 					LUSTRE_DLM_VERSION, LDLM_BL_CALLBACK);
@@ -929,27 +1418,11 @@ int ldlm_server_blocking_ast(struct ldlm_lock *lock,
 	req->rq_interpret_reply = ldlm_cb_interpret;
 
 	lock_res_and_lock(lock);
-	if (ldlm_is_destroyed(lock)) {
-		/* What's the point? */
-		unlock_res_and_lock(lock);
+	if (!ldlm_bl_ast_needed(lock)) {
 		ptlrpc_req_put(req);
 		RETURN(0);
 	}
 
-	if (!ldlm_is_granted(lock)) {
-		/*
-		 * this blocking AST will be communicated as part of the
-		 * completion AST instead
-		 */
-		ldlm_add_blocked_lock(lock);
-		ldlm_set_waited(lock);
-		unlock_res_and_lock(lock);
-
-		ptlrpc_req_put(req);
-		LDLM_DEBUG(lock, "lock not granted, not sending blocking AST");
-		RETURN(0);
-	}
-
 	if (ldlm_is_cancel_on_block(lock))
 		instant_cancel = 1;
 
@@ -1326,6 +1799,12 @@ int ldlm_handle_enqueue(struct ldlm_namespace *ns,
 				  "Too many granted locks, reject current enqueue request and let the client retry later");
 			GOTO(out, rc = -EINPROGRESS);
 		}
+		if (ldlm_reclaim_limit_full(ns, req->rq_export,
+				lustre_msg_get_jobid(req->rq_reqmsg))) {
+			DEBUG_REQ(D_WARNING | D_RPCTRACE, req,
+				  "Too many locks granted to the export or job, reject current enqueue request and let the client retry later");
+			GOTO(out, rc = -EINPROGRESS);
+		}
 	}
 
 	/* The lock's callback data might be set in the policy function */
@@ -1371,6 +1850,7 @@ int ldlm_handle_enqueue(struct ldlm_namespace *ns,
 	}
 
 	lock->l_export = class_export_lock_get(req->rq_export, lock);
+	ldlm_reclaim_attach(lock, lustre_msg_get_jobid(req->rq_reqmsg));
 	if (lock->l_export->exp_lock_hash)
 		cfs_hash_add(lock->l_export->exp_lock_hash,
 			     &lock->l_remote_handle,
@@ -1389,7 +1869,20 @@ int ldlm_handle_enqueue(struct ldlm_namespace *ns,
 				     &dlm_req->lock_desc.l_policy_data,
 				     &lock->l_policy_data);
 	if (dlm_req->lock_desc.l_resource.lr_type == LDLM_EXTENT) {
+		struct ldlm_extent_stride *stride = NULL;
+
 		lock->l_req_extent = lock->l_policy_data.l_extent;
+		/* the stride is sent in RQF_LDLM_ENQUEUE_STRIDE format */
+		if (exp_connect_lock_stride(req->rq_export) &&
+		    pill->rc_fmt == &RQF_LDLM_ENQUEUE) {
+			req_capsule_extend(pill, &RQF_LDLM_ENQUEUE_STRIDE);
+			if (req_capsule_field_present(pill, &RMF_DLM_STRIDE,
+						      RCL_CLIENT))
+				stride = req_capsule_client_sized_get(pill,
+							&RMF_DLM_STRIDE,
+							sizeof(*stride));
+		}
+		ldlm_extent_stride_hint(lock->l_resource, stride);
 	} else if (dlm_req->lock_desc.l_resource.lr_type == LDLM_IBITS) {
 		lock->l_policy_data.l_inodebits.try_bits =
 			dlm_req->lock_desc.l_policy_data.l_inodebits.try_bits;
@@ -2349,6 +2842,152 @@ static inline void ldlm_callback_errmsg(struct ptlrpc_request *req,
 		CWARN("Send reply failed, maybe cause b=21636.\n");
 }
 
+/**
+ * Prepare a lock named in a blocking AST for cancellation.
+ *
+ * Unused extent locks are marked for cancel right here and added to
+ * \a cancels, so that all of them are cancelled by a single LDLM_CANCEL RPC
+ * from ldlm_bl_thread_blwi(), as is done for LRU cancellation. Other locks
+ * still have to go through their own ->l_blocking_ast() and false is
+ * returned for them.
+ *
+ * The caller reference on \a lock is transferred to \a cancels on success.
+ */
+static bool ldlm_bl_batch_prep_cancel(struct ldlm_lock *lock,
+				      struct ldlm_lock_desc *ld,
+				      struct list_head *cancels)
+{
+	bool added = false;
+
+	if (lock->l_resource->lr_type != LDLM_EXTENT)
+		return false;
+
+	lock_res_and_lock(lock);
+	if (!lock->l_readers && !lock->l_writers &&
+	    !ldlm_is_canceling(lock) && list_empty(&lock->l_bl_ast)) {
+		ldlm_bl_desc2lock(ld, lock);
+		ldlm_clear_cancel_on_block(lock);
+		/* see ldlm_prepare_lru_list() for why CBPENDING is set */
+		lock->l_flags |= LDLM_FL_CBPENDING | LDLM_FL_CANCELING;
+		list_add(&lock->l_bl_ast, cancels);
+		added = true;
+	}
+	unlock_res_and_lock(lock);
+
+	return added;
+}
+
+/**
+ * Handle a blocking AST carrying several locks.
+ *
+ * Servers send one LDLM_BL_CALLBACK for several locks of a client when it
+ * was connected with OBD_CONNECT2_BATCH_BL_AST, see ldlm_bl_batch_send().
+ * A single reply is sent with the status of each lock in RMF_RCS, then the
+ * unused extent locks are cancelled together in one batched cancel RPC and
+ * the remaining locks are handed to the blocking threads one by one.
+ */
+static void ldlm_handle_bl_callback_batch(struct ptlrpc_request *req,
+					  struct ldlm_namespace *ns,
+					  struct ldlm_request *dlm_req)
+{
+	struct ldlm_lock *locks[LDLM_BL_BATCH_MAX] = { NULL };
+	struct lustre_handle *lockh;
+	LIST_HEAD(cancels);
+	__u32 count = dlm_req->lock_count;
+	int ncancel = 0;
+	__u32 *rcs;
+	int rc;
+	int i;
+
+	ENTRY;
+
+	if (count > LDLM_BL_BATCH_MAX ||
+	    req_capsule_get_size(&req->rq_pill, &RMF_DLM_REQ, RCL_CLIENT) <
+	    offsetof(struct ldlm_request, lock_handle[2 * count])) {
+		rc = ldlm_callback_reply(req, -EPROTO);
+		ldlm_callback_errmsg(req, "invalid batched blocking AST", rc,
+				     NULL);
+		RETURN_EXIT;
+	}
+
+	req_capsule_extend(&req->rq_pill, &RQF_LDLM_BL_CALLBACK_BATCH);
+	req_capsule_set_size(&req->rq_pill, &RMF_RCS, RCL_SERVER,
+			     count * sizeof(*rcs));
+	rc = req_capsule_server_pack(&req->rq_pill);
+	if (rc) {
+		rc = ldlm_callback_reply(req, rc);
+		ldlm_callback_errmsg(req, "Batched blocking AST", rc, NULL);
+		RETURN_EXIT;
+	}
+	rcs = req_capsule_server_get(&req->rq_pill, &RMF_RCS);
+
+	for (i = 0; i < count; i++) {
+		struct ldlm_lock *lock;
+
+		lockh = &dlm_req->lock_handle[2 * i];
+		rcs[i] = -EINVAL;
+		lock = ldlm_handle2lock_long(lockh, 0);
+		if (!lock) {
+			CDEBUG(D_DLMTRACE,
+			       "callback on lock %#llx - lock disappeared\n",
+			       lockh->cookie);
+			continue;
+		}
+
+		lock_res_and_lock(lock);
+		lock->l_flags |= ldlm_flags_from_wire(dlm_req->lock_flags &
+						      LDLM_FL_AST_MASK);
+		if ((ldlm_is_canceling(lock) && ldlm_is_bl_done(lock)) ||
+		     ldlm_is_failed(lock)) {
+			unlock_res_and_lock(lock);
+			LDLM_DEBUG(lock,
+				   "callback on lock %llx - lock disappeared",
+				   lockh->cookie);
+			ldlm_lock_put(lock);
+			continue;
+		}
+		ldlm_lock_remove_from_lru(lock);
+		ldlm_set_bl_ast(lock);
+		if (lock->l_remote_handle.cookie == 0)
+			lock->l_remote_handle = dlm_req->lock_handle[2 * i + 1];
+		unlock_res_and_lock(lock);
+
+		LDLM_DEBUG(lock, "blocking ast (batch of %u)", count);
+		rcs[i] = 0;
+		locks[i] = lock;
+	}
+
+	rc = ldlm_callback_reply(req, 0);
+	if (req->rq_no_reply || rc)
+		ldlm_callback_errmsg(req, "Batched blocking AST", rc, NULL);
+
+	for (i = 0; i < count; i++) {
+		if (!locks[i])
+			continue;
+
+		if (ldlm_bl_batch_prep_cancel(locks[i], &dlm_req->lock_desc,
+					      &cancels)) {
+			ncancel++;
+			continue;
+		}
+
+		if (ldlm_bl_to_thread_lock(ns, &dlm_req->lock_desc, locks[i]))
+			ldlm_handle_bl_callback(ns, &dlm_req->lock_desc,
+						locks[i]);
+	}
+
+	if (ncancel > 0 &&
+	    ldlm_bl_to_thread_list(ns, NULL, &cancels, ncancel, LCF_ASYNC)) {
+		/* no memory for the work item, cancel from this thread */
+		ncancel = ldlm_cli_cancel_list_local(&cancels, ncancel,
+						     LCF_BL_AST);
+		ldlm_cli_cancel_list(&cancels, ncancel, NULL, NULL,
+				     LCF_ASYNC);
+	}
+
+	EXIT;
+}
+
 /* TODO: handle requests in a similar way as MDT: see mdt_handle_common() */
 static int ldlm_callback_handler(struct ptlrpc_request *req)
 {
@@ -2430,6 +3069,12 @@ static int ldlm_callback_handler(struct ptlrpc_request *req)
 		RETURN(0);
 	}
 
+	if (lustre_msg_get_opc(req->rq_reqmsg) == LDLM_BL_CALLBACK &&
+	    dlm_req->lock_count > 1) {
+		ldlm_handle_bl_callback_batch(req, ns, dlm_req);
+		RETURN(0);
+	}
+
 	/*
 	 * Force a known safe race, send a cancel to the server for a lock
 	 * which the server has already started a blocking callback on.
@@ -3127,8 +3772,6 @@ static struct cfs_hash_ops ldlm_export_lock_ops = {
 
 int ldlm_init_export(struct obd_export *exp)
 {
-	int rc;
-
 	ENTRY;
 
 	exp->exp_lock_hash =
@@ -3144,14 +3787,7 @@ int ldlm_init_export(struct obd_export *exp)
 	if (!exp->exp_lock_hash)
 		RETURN(-ENOMEM);
 
-	rc = ldlm_init_flock_export(exp);
-	if (rc)
-		GOTO(err, rc);
-
 	RETURN(0);
-err:
-	ldlm_destroy_export(exp);
-	RETURN(rc);
 }
 EXPORT_SYMBOL(ldlm_init_export);
 
@@ -3160,8 +3796,6 @@ void ldlm_destroy_export(struct obd_export *exp)
 	ENTRY;
 	cfs_hash_putref(exp->exp_lock_hash);
 	exp->exp_lock_hash = NULL;
-
-	ldlm_destroy_flock_export(exp);
 	EXIT;
 }
 EXPORT_SYMBOL(ldlm_destroy_export);
@@ -3312,7 +3946,107 @@ static ssize_t lock_granted_count_show(struct kobject *kobj,
 	return scnprintf(buf, PAGE_SIZE, "%llu\n", sum);
 }
 LUSTRE_RO_ATTR(lock_granted_count);
-#endif
+
+/* set the soft or hard limit of a soft/hard granted lock count pair */
+static ssize_t ldlm_lock_count_limit_store(const char *buffer, size_t count,
+					   const char *name,
+					   unsigned int *soft,
+					   unsigned int *hard,
+					   bool set_soft)
+{
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 10, &val);
+	if (rc) {
+		CERROR("Failed to set %s, rc = %d.\n", name, rc);
+		return rc;
+	}
+
+	if (set_soft) {
+		if (*hard != 0 && val > *hard) {
+			CERROR("%s must not be greater than the hard limit %u.\n",
+			       name, *hard);
+			return -EINVAL;
+		}
+		*soft = val;
+	} else {
+		if (val != 0 && val < *soft) {
+			CERROR("%s must not be smaller than the soft limit %u.\n",
+			       name, *soft);
+			return -EINVAL;
+		}
+		*hard = val;
+	}
+
+	return count;
+}
+
+static ssize_t lock_job_soft_limit_show(struct kobject *kobj,
+					struct attribute *attr, char *buf)
+{
+	return scnprintf(buf, PAGE_SIZE, "%u\n", ldlm_job_lock_soft_limit);
+}
+
+static ssize_t lock_job_soft_limit_store(struct kobject *kobj,
+					 struct attribute *attr,
+					 const char *buffer, size_t count)
+{
+	return ldlm_lock_count_limit_store(buffer, count, "lock_job_soft_limit",
+					   &ldlm_job_lock_soft_limit,
+					   &ldlm_job_lock_hard_limit, true);
+}
+LUSTRE_RW_ATTR(lock_job_soft_limit);
+
+static ssize_t lock_job_hard_limit_show(struct kobject *kobj,
+					struct attribute *attr, char *buf)
+{
+	return scnprintf(buf, PAGE_SIZE, "%u\n", ldlm_job_lock_hard_limit);
+}
+
+static ssize_t lock_job_hard_limit_store(struct kobject *kobj,
+					 struct attribute *attr,
+					 const char *buffer, size_t count)
+{
+	return ldlm_lock_count_limit_store(buffer, count, "lock_job_hard_limit",
+					   &ldlm_job_lock_soft_limit,
+					   &ldlm_job_lock_hard_limit, false);
+}
+LUSTRE_RW_ATTR(lock_job_hard_limit);
+
+static ssize_t lock_export_soft_limit_show(struct kobject *kobj,
+					   struct attribute *attr, char *buf)
+{
+	return scnprintf(buf, PAGE_SIZE, "%u\n", ldlm_exp_lock_soft_limit);
+}
+
+static ssize_t lock_export_soft_limit_store(struct kobject *kobj,
+					    struct attribute *attr,
+					    const char *buffer, size_t count)
+{
+	return ldlm_lock_count_limit_store(buffer, count,
+					   "lock_export_soft_limit",
+					   &ldlm_exp_lock_soft_limit,
+					   &ldlm_exp_lock_hard_limit, true);
+}
+LUSTRE_RW_ATTR(lock_export_soft_limit);
+
+static ssize_t lock_export_hard_limit_show(struct kobject *kobj,
+					   struct attribute *attr, char *buf)
+{
+	return scnprintf(buf, PAGE_SIZE, "%u\n", ldlm_exp_lock_hard_limit);
+}
+
+static ssize_t lock_export_hard_limit_store(struct kobject *kobj,
+					    struct attribute *attr,
+					    const char *buffer, size_t count)
+{
+	return ldlm_lock_count_limit_store(buffer, count,
+					   "lock_export_hard_limit",
+					   &ldlm_exp_lock_soft_limit,
+					   &ldlm_exp_lock_hard_limit, false);
+}
+LUSTRE_RW_ATTR(lock_export_hard_limit);
 
 static ssize_t ldlm_enqueue_min_show(struct kobject *kobj,
 				     struct attribute *attr,
@@ -3329,6 +4063,10 @@ static struct attribute *ldlm_attrs[] = {
 	&lustre_attr_lock_reclaim_threshold_mb.attr,
 	&lustre_attr_lock_limit_mb.attr,
 	&lustre_attr_lock_granted_count.attr,
+	&lustre_attr_lock_job_soft_limit.attr,
+	&lustre_attr_lock_job_hard_limit.attr,
+	&lustre_attr_lock_export_soft_limit.attr,
+	&lustre_attr_lock_export_hard_limit.attr,
 #endif
 	&lustre_attr_ldlm_enqueue_min.attr,
 	NULL,
@@ -3493,6 +4231,12 @@ static int ldlm_setup(void)
 	}
 
 #ifdef CONFIG_LUSTRE_FS_SERVER
+	rc = ldlm_waiting_locks_init();
+	if (rc) {
+		CERROR("Cannot allocate waiting locks wheels: rc = %d\n", rc);
+		GOTO(out, rc);
+	}
+
 	task = kthread_run(expired_lock_main, NULL, "ldlm_elt");
 	if (IS_ERR(task)) {
 		rc = PTR_ERR(task);
@@ -3502,6 +4246,12 @@ static int ldlm_setup(void)
 
 	wait_event(expired_lock_wait_queue,
 		   expired_lock_thread_state == ELT_READY);
+
+	rc = ldlm_ast_fanout_init();
+	if (rc) {
+		CERROR("Cannot start ldlm AST fanout workqueue: rc = %d\n", rc);
+		GOTO(out, rc);
+	}
 #endif /* CONFIG_LUSTRE_FS_SERVER */
 
 	rc = ldlm_pools_init();
@@ -3581,6 +4331,8 @@ static int ldlm_cleanup(void)
 		wait_event(expired_lock_wait_queue,
 			   expired_lock_thread_state == ELT_STOPPED);
 	}
+	ldlm_waiting_locks_fini();
+	ldlm_ast_fanout_fini();
 #endif
 
 	OBD_FREE(ldlm_state, sizeof(*ldlm_state));
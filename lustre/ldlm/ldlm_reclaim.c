@@ -33,6 +33,29 @@
  * ldlm_reclaim_threshold & ldlm_lock_limit is set to 20% & 30% of the
  * total memory by default. It is tunable via proc entry, when it's set
  * to 0, the feature is disabled.
+ *
+ * Granted locks are also accounted per export and, when the client sends
+ * its JobID, per job in each namespace, so that a single client or job
+ * hoarding locks can be dealt with before the global watermarks hurt
+ * everyone else:
+ *
+ * - a reclaim round first revokes locks of the exports holding more than
+ *   their fair share of the namespace locks, or of the exports and jobs
+ *   over their soft limit, before falling back to all the locks;
+ *
+ * - ldlm_{job,exp}_lock_soft_limit: when an export or a job holding more
+ *   locks than this enqueues a new one, its idle locks are revoked. This
+ *   is done from the ldlm_ast workqueue so that the enqueue handler does
+ *   not wait for the blocking ASTs. The locks of an export are found in
+ *   its exp_lock_hash, the ones of a job by a scan of the namespace;
+ *
+ * - ldlm_{job,exp}_lock_hard_limit: enqueue requests from an export or a
+ *   job holding more locks than this get -EINPROGRESS, as for
+ *   ldlm_lock_limit.
+ *
+ * The per-job limits apply to each namespace (target) separately, and all
+ * four are disabled (0) by default. The per-job lock count is reported in
+ * the job_stats of the target.
  */
 
 #ifdef CONFIG_LUSTRE_FS_SERVER
@@ -46,20 +69,68 @@ __u64 ldlm_lock_limit;
 __u64 ldlm_reclaim_threshold_mb;
 __u64 ldlm_lock_limit_mb;
 
+/* Per-job and per-export granted lock limits, 0 means no limit */
+unsigned int ldlm_job_lock_soft_limit;
+unsigned int ldlm_job_lock_hard_limit;
+unsigned int ldlm_exp_lock_soft_limit;
+unsigned int ldlm_exp_lock_hard_limit;
+
 struct percpu_counter		ldlm_granted_total;
 static atomic_t			ldlm_nr_reclaimer;
 static s64			ldlm_last_reclaim_age_ns;
 static ktime_t			ldlm_last_reclaim_time;
+static ktime_t			ldlm_last_limit_reclaim_time;
+
+/* how often the idle locks of a consumer over its limit are revoked */
+#define LDLM_RECLAIM_LIMIT_INTERVAL	NSEC_PER_SEC
+
+/**
+ * Granted lock accounting of one JobID in a server namespace. Every lock
+ * enqueued with that JobID holds a reference on it, the entry is removed
+ * from ldlm_namespace::ns_reclaim_jobs when the last such lock is freed.
+ */
+struct ldlm_reclaim_job {
+	struct rhash_head	 lrj_hash;
+	struct ldlm_namespace	*lrj_ns;
+	char			 lrj_jobid[LUSTRE_JOBID_SIZE];
+	/* number of reclaimable locks granted to the job */
+	atomic_t		 lrj_granted;
+	/* number of locks referencing the job */
+	refcount_t		 lrj_refs;
+	struct rcu_head		 lrj_rcu;
+};
+
+static const struct rhashtable_params ldlm_reclaim_job_params = {
+	.key_len	= LUSTRE_JOBID_SIZE,
+	.key_offset	= offsetof(struct ldlm_reclaim_job, lrj_jobid),
+	.head_offset	= offsetof(struct ldlm_reclaim_job, lrj_hash),
+	.automatic_shrinking = true,
+};
+
+/* Which locks a reclaim scan may revoke */
+enum ldlm_reclaim_target {
+	/* any aged lock */
+	LDLM_RECLAIM_ANY,
+	/* locks of the exports or jobs above their fair share or soft limit */
+	LDLM_RECLAIM_LARGEST,
+	/* locks of the exports or jobs above their soft limit only */
+	LDLM_RECLAIM_OVER_LIMIT,
+};
+
+#define LDLM_RECLAIM_BATCH	512
+#define LDLM_RECLAIM_AGE_MIN	(300 * NSEC_PER_SEC)
+#define LDLM_RECLAIM_AGE_MAX	(LDLM_DEFAULT_LRU_MAX_AGE * NSEC_PER_SEC * 3/4)
+/* only revoke locks idle for this long from consumers over their limit */
+#define LDLM_RECLAIM_AGE_LIMIT	(10 * NSEC_PER_SEC)
 
 struct ldlm_reclaim_cb_data {
 	struct list_head	 rcd_rpc_list;
 	int			 rcd_added;
 	int			 rcd_total;
-	int			 rcd_cursor;
-	int			 rcd_start;
-	bool			 rcd_skip;
 	s64			 rcd_age_ns;
-	struct cfs_hash_bd	*rcd_prev_bd;
+	enum ldlm_reclaim_target rcd_target;
+	/* average number of locks granted to an export of the namespace */
+	unsigned int		 rcd_exp_share;
 };
 
 static inline bool ldlm_lock_reclaimable(struct ldlm_lock *lock)
@@ -77,25 +148,56 @@ static inline bool ldlm_lock_reclaimable(struct ldlm_lock *lock)
 	return false;
 }
 
+/**
+ * Check whether \a lock belongs to one of the consumers a targeted reclaim
+ * scan is after, see enum ldlm_reclaim_target.
+ */
+static bool ldlm_reclaim_lock_targeted(struct ldlm_lock *lock,
+				       struct ldlm_reclaim_cb_data *data)
+{
+	struct ldlm_reclaim_job *job = lock->l_reclaim_job;
+	unsigned int granted;
+
+	if (data->rcd_target == LDLM_RECLAIM_ANY)
+		return true;
+
+	/* not charged to any export, nothing to target */
+	if (!lock->l_reclaim_charged)
+		return false;
+
+	if (job && ldlm_job_lock_soft_limit != 0 &&
+	    atomic_read(&job->lrj_granted) > ldlm_job_lock_soft_limit)
+		return true;
+
+	granted = atomic_read(&lock->l_export->exp_granted_locks);
+	if (ldlm_exp_lock_soft_limit != 0 &&
+	    granted > ldlm_exp_lock_soft_limit)
+		return true;
+
+	return data->rcd_target == LDLM_RECLAIM_LARGEST &&
+	       granted > data->rcd_exp_share;
+}
+
+static inline bool ldlm_reclaim_lock_aged(struct ldlm_lock *lock, s64 age_ns)
+{
+	return CFS_FAIL_CHECK(OBD_FAIL_LDLM_WATERMARK_LOW) ||
+	       !ktime_before(ktime_get(),
+			     ktime_add_ns(lock->l_last_used, age_ns));
+}
+
 /**
  * Callback function for revoking locks from certain resource.
  *
- * \param [in] hs	ns_rs_hash
- * \param [in] bd	current bucket of ns_rsh_hash
- * \param [in] hnode	hnode of the resource
+ * \param [in] res	the resource
  * \param [in] arg	opaque data
  *
  * \retval 0		continue the scan
  * \retval 1		stop the iteration
  */
-static int ldlm_reclaim_lock_cb(struct cfs_hash *hs, struct cfs_hash_bd *bd,
-				struct hlist_node *hnode, void *arg)
-
+static int ldlm_reclaim_lock_cb(struct ldlm_resource *res, void *arg)
 {
-	struct ldlm_resource		*res;
 	struct ldlm_reclaim_cb_data	*data;
 	struct ldlm_lock		*lock;
-	struct ldlm_ns_bucket		*nsb;
 	int				 rc = 0;
 
 	data = (struct ldlm_reclaim_cb_data *)arg;
@@ -103,34 +205,15 @@ static int ldlm_reclaim_lock_cb(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 	LASSERTF(data->rcd_added < data->rcd_total, "added:%d >= total:%d\n",
 		 data->rcd_added, data->rcd_total);
 
-	nsb = cfs_hash_bd_extra_get(hs, bd);
-	res = cfs_hash_object(hs, hnode);
-
-	if (data->rcd_prev_bd != bd) {
-		if (data->rcd_prev_bd != NULL)
-			ldlm_res_to_ns(res)->ns_reclaim_start++;
-		data->rcd_prev_bd = bd;
-		data->rcd_cursor = 0;
-		data->rcd_start = nsb->nsb_reclaim_start %
-				  cfs_hash_bd_count_get(bd);
-	}
-
-	if (data->rcd_skip && data->rcd_cursor < data->rcd_start) {
-		data->rcd_cursor++;
-		return 0;
-	}
-
-	nsb->nsb_reclaim_start++;
-
 	lock_res(res);
 	list_for_each_entry(lock, &res->lr_granted, l_res_link) {
 		if (!ldlm_lock_reclaimable(lock))
 			continue;
 
-		if (!CFS_FAIL_CHECK(OBD_FAIL_LDLM_WATERMARK_LOW) &&
-		    ktime_before(ktime_get(),
-				 ktime_add_ns(lock->l_last_used,
-					      data->rcd_age_ns)))
+		if (!ldlm_reclaim_lock_targeted(lock, data))
+			continue;
+
+		if (!ldlm_reclaim_lock_aged(lock, data->rcd_age_ns))
 			continue;
 
 		if (!ldlm_is_ast_sent(lock)) {
@@ -156,16 +239,19 @@ static int ldlm_reclaim_lock_cb(struct cfs_hash *hs, struct cfs_hash_bd *bd,
  * \param[in] ns	namespace to do the lock revoke on
  * \param[in] count	count of lock to be revoked
  * \param[in] age	only revoke locks older than the 'age'
- * \param[in] skip	scan from the first lock on resource if the
- *			'skip' is false, otherwise, continue scan
- *			from the last scanned position
+ * \param[in] skip	scan from the first resource if 'skip' is false,
+ *			otherwise continue from ns_reclaim_iter, where the
+ *			previous scan stopped
+ * \param[in] target	which locks may be revoked
  * \param[out] count	count of lock still to be revoked
  */
 static void ldlm_reclaim_res(struct ldlm_namespace *ns, int *count,
-			     s64 age_ns, bool skip)
+			     s64 age_ns, bool skip,
+			     enum ldlm_reclaim_target target)
 {
 	struct ldlm_reclaim_cb_data	data;
-	int				idx, type, start;
+	int				idx, type;
+	int				nr_exports;
 	int				rc;
 	ENTRY;
 
@@ -188,16 +274,30 @@ static void ldlm_reclaim_res(struct ldlm_namespace *ns, int *count,
 	data.rcd_added = 0;
 	data.rcd_total = *count;
 	data.rcd_age_ns = age_ns;
-	data.rcd_skip = skip;
-	data.rcd_prev_bd = NULL;
-	start = ns->ns_reclaim_start % CFS_HASH_NBKT(ns->ns_rs_hash);
-
-	cfs_hash_for_each_nolock(ns->ns_rs_hash, ldlm_reclaim_lock_cb, &data,
-				 start);
+	data.rcd_target = target;
+	nr_exports = ns->ns_obd ? ns->ns_obd->obd_num_exports : 0;
+	data.rcd_exp_share = atomic_read(&ns->ns_pool.pl_granted) /
+			     max(nr_exports, 1);
+
+	if (skip && target == LDLM_RECLAIM_ANY) {
+		mutex_lock(&ns->ns_reclaim_mutex);
+		rc = ldlm_namespace_res_walk_resume(&ns->ns_reclaim_iter,
+						    ldlm_reclaim_lock_cb,
+						    &data);
+		/* reached the end of the namespace, start over next time */
+		if (rc == 0) {
+			rhashtable_walk_exit(&ns->ns_reclaim_iter);
+			rhashtable_walk_enter(&ns->ns_rs_hash,
+					      &ns->ns_reclaim_iter);
+		}
+		mutex_unlock(&ns->ns_reclaim_mutex);
+	} else {
+		ldlm_namespace_res_walk(ns, ldlm_reclaim_lock_cb, &data);
+	}
 
 	CDEBUG(D_DLMTRACE, "NS(%s): %d locks to be reclaimed, found %d/%d "
-	       "locks.\n", ldlm_ns_name(ns), *count, data.rcd_added,
-	       data.rcd_total);
+	       "locks, target %d.\n", ldlm_ns_name(ns), *count, data.rcd_added,
+	       data.rcd_total, target);
 
 	LASSERTF(*count >= data.rcd_added, "count:%d, added:%d\n", *count,
 		 data.rcd_added);
@@ -210,10 +310,6 @@ static void ldlm_reclaim_res(struct ldlm_namespace *ns, int *count,
 	EXIT;
 }
 
-#define LDLM_RECLAIM_BATCH	512
-#define LDLM_RECLAIM_AGE_MIN	(300 * NSEC_PER_SEC)
-#define LDLM_RECLAIM_AGE_MAX	(LDLM_DEFAULT_LRU_MAX_AGE * NSEC_PER_SEC * 3/4)
-
 static inline s64 ldlm_reclaim_age(void)
 {
 	s64 age_ns = ldlm_last_reclaim_age_ns;
@@ -230,46 +326,66 @@ static inline s64 ldlm_reclaim_age(void)
 }
 
 /**
- * Revoke certain amount of locks from all the server namespaces
- * in a roundrobin manner. Lock age is used to avoid reclaim on
- * the non-aged locks.
+ * Walk all the server namespaces once in a roundrobin manner, revoking
+ * locks until \a count is reached.
+ *
+ * \retval false	there is no server namespace
+ * \retval true	otherwise
  */
-static void ldlm_reclaim_ns(void)
+static bool ldlm_reclaim_ns_walk(int *count, s64 age_ns, bool skip,
+				 enum ldlm_reclaim_target target)
 {
 	struct ldlm_namespace	*ns;
-	int			 count = LDLM_RECLAIM_BATCH;
-	int			 ns_nr, nr_processed;
+	int			 ns_nr, nr_processed = 0;
 	enum ldlm_side		 ns_cli = LDLM_NAMESPACE_SERVER;
-	s64 age_ns;
-	bool			 skip = true;
-	ENTRY;
-
-	if (!atomic_add_unless(&ldlm_nr_reclaimer, 1, 1)) {
-		EXIT;
-		return;
-	}
 
-	age_ns = ldlm_reclaim_age();
-again:
-	nr_processed = 0;
 	ns_nr = ldlm_namespace_nr_read(ns_cli);
-	while (count > 0 && nr_processed < ns_nr) {
+	while (*count > 0 && nr_processed < ns_nr) {
 		mutex_lock(ldlm_namespace_lock(ns_cli));
 
 		if (list_empty(ldlm_namespace_list(ns_cli))) {
 			mutex_unlock(ldlm_namespace_lock(ns_cli));
-			goto out;
+			return false;
 		}
 
 		ns = ldlm_namespace_first_locked(ns_cli);
 		ldlm_namespace_move_to_active_locked(ns, ns_cli);
 		mutex_unlock(ldlm_namespace_lock(ns_cli));
 
-		ldlm_reclaim_res(ns, &count, age_ns, skip);
+		ldlm_reclaim_res(ns, count, age_ns, skip, target);
 		ldlm_namespace_put(ns);
 		nr_processed++;
 	}
 
+	return true;
+}
+
+/**
+ * Revoke certain amount of locks from all the server namespaces
+ * in a roundrobin manner. Lock age is used to avoid reclaim on
+ * the non-aged locks. Locks of the largest consumers are revoked
+ * first.
+ */
+static void ldlm_reclaim_ns(void)
+{
+	int			 count = LDLM_RECLAIM_BATCH;
+	s64 age_ns;
+	bool			 skip = true;
+	ENTRY;
+
+	if (!atomic_add_unless(&ldlm_nr_reclaimer, 1, 1)) {
+		EXIT;
+		return;
+	}
+
+	age_ns = ldlm_reclaim_age();
+	if (!ldlm_reclaim_ns_walk(&count, age_ns, false, LDLM_RECLAIM_LARGEST))
+		goto out;
+again:
+	if (count > 0 &&
+	    !ldlm_reclaim_ns_walk(&count, age_ns, skip, LDLM_RECLAIM_ANY))
+		goto out;
+
 	if (count > 0 && age_ns > LDLM_RECLAIM_AGE_MIN) {
 		age_ns >>= 1;
 		if (age_ns < (LDLM_RECLAIM_AGE_MIN * 2))
@@ -285,12 +401,300 @@ out:
 	EXIT;
 }
 
+struct ldlm_reclaim_exp_data {
+	struct ldlm_lock	**red_locks;
+	int			  red_count;
+};
+
+/* collect the idle granted locks of an export, called under the bucket lock */
+static int ldlm_reclaim_exp_cb(struct cfs_hash *hs, struct cfs_hash_bd *bd,
+			       struct hlist_node *hnode, void *arg)
+{
+	struct ldlm_reclaim_exp_data *data = arg;
+	struct ldlm_lock *lock = cfs_hash_object(hs, hnode);
+
+	/* unlocked checks, done again under the resource lock */
+	if (!lock->l_reclaim_charged || ldlm_is_ast_sent(lock) ||
+	    !ldlm_reclaim_lock_aged(lock, LDLM_RECLAIM_AGE_LIMIT))
+		return 0;
+
+	data->red_locks[data->red_count++] = ldlm_lock_get(lock);
+
+	return data->red_count == LDLM_RECLAIM_BATCH;
+}
+
+/**
+ * Revoke the idle locks of export \a exp, which is over its lock limit.
+ *
+ * The locks are found in the export lock hash rather than by scanning the
+ * whole namespace. They cannot be locked from the hash iteration, as the
+ * resource lock is taken before the hash bucket lock elsewhere, so they
+ * are collected first and checked again under their resource lock.
+ */
+static void ldlm_reclaim_export(struct ldlm_namespace *ns,
+				struct obd_export *exp)
+{
+	struct ldlm_reclaim_exp_data data = { 0 };
+	LIST_HEAD(rpc_list);
+	int added = 0;
+	int rc;
+	int i;
+
+	ENTRY;
+
+	if (!exp->exp_lock_hash || atomic_read(&ns->ns_bref) == 0)
+		RETURN_EXIT;
+
+	OBD_ALLOC_PTR_ARRAY_LARGE(data.red_locks, LDLM_RECLAIM_BATCH);
+	if (!data.red_locks)
+		RETURN_EXIT;
+
+	cfs_hash_for_each(exp->exp_lock_hash, ldlm_reclaim_exp_cb, &data);
+
+	for (i = 0; i < data.red_count; i++) {
+		struct ldlm_lock *lock = data.red_locks[i];
+
+		lock_res_and_lock(lock);
+		if (lock->l_reclaim_charged && !ldlm_is_ast_sent(lock) &&
+		    ldlm_reclaim_lock_aged(lock, LDLM_RECLAIM_AGE_LIMIT)) {
+			ldlm_set_ast_sent(lock);
+			LASSERT(list_empty(&lock->l_rk_ast));
+			list_add(&lock->l_rk_ast, &rpc_list);
+			ldlm_lock_get(lock);
+			added++;
+		}
+		unlock_res_and_lock(lock);
+		ldlm_lock_put(lock);
+	}
+	OBD_FREE_PTR_ARRAY_LARGE(data.red_locks, LDLM_RECLAIM_BATCH);
+
+	CDEBUG(D_DLMTRACE,
+	       "NS(%s): export %s over its limit, %d locks to be reclaimed\n",
+	       ldlm_ns_name(ns), obd_uuid2str(&exp->exp_client_uuid), added);
+
+	rc = ldlm_run_ast_work(ns, &rpc_list, LDLM_WORK_REVOKE_AST);
+	if (rc == -ERESTART)
+		ldlm_reprocess_recovery_done(ns);
+
+	EXIT;
+}
+
+/**
+ * Revoke the idle locks of the exports and jobs of namespace \a ns which
+ * are over their soft limit, see ldlm_reclaim_limit_full().
+ */
+static void ldlm_reclaim_limit_work(struct work_struct *work)
+{
+	struct ldlm_namespace *ns = container_of(work, struct ldlm_namespace,
+						 ns_reclaim_work);
+	struct obd_export *exp;
+	int count = LDLM_RECLAIM_BATCH;
+	bool jobs;
+
+	spin_lock(&ns->ns_reclaim_lock);
+	while ((exp = list_first_entry_or_null(&ns->ns_reclaim_exports,
+					       struct obd_export,
+					       exp_reclaim_list)) != NULL) {
+		list_del_init(&exp->exp_reclaim_list);
+		spin_unlock(&ns->ns_reclaim_lock);
+
+		ldlm_reclaim_export(ns, exp);
+		class_export_put(exp);
+
+		spin_lock(&ns->ns_reclaim_lock);
+	}
+	jobs = ns->ns_reclaim_jobs_over;
+	ns->ns_reclaim_jobs_over = false;
+	spin_unlock(&ns->ns_reclaim_lock);
+
+	/* the locks of a job are spread over the exports */
+	if (!jobs || !atomic_add_unless(&ldlm_nr_reclaimer, 1, 1))
+		return;
+
+	ldlm_reclaim_res(ns, &count, LDLM_RECLAIM_AGE_LIMIT, false,
+			 LDLM_RECLAIM_OVER_LIMIT);
+	atomic_add_unless(&ldlm_nr_reclaimer, -1, 0);
+}
+
+/* schedule the revocation of the idle locks of \a exp, at most once a second */
+static void ldlm_reclaim_queue_export(struct ldlm_namespace *ns,
+				      struct obd_export *exp)
+{
+	ktime_t now = ktime_get();
+	bool queue = false;
+
+	if (ktime_before(now, ktime_add_ns(exp->exp_reclaim_time,
+					   LDLM_RECLAIM_LIMIT_INTERVAL)))
+		return;
+
+	spin_lock(&ns->ns_reclaim_lock);
+	if (list_empty(&exp->exp_reclaim_list)) {
+		exp->exp_reclaim_time = now;
+		list_add_tail(&exp->exp_reclaim_list, &ns->ns_reclaim_exports);
+		class_export_get(exp);
+		queue = true;
+	}
+	spin_unlock(&ns->ns_reclaim_lock);
+
+	if (queue)
+		ldlm_ast_queue_work(&ns->ns_reclaim_work);
+}
+
+/* schedule a scan for the idle locks of the jobs, at most once a second */
+static void ldlm_reclaim_queue_jobs(struct ldlm_namespace *ns)
+{
+	ktime_t now = ktime_get();
+
+	if (ktime_before(now, ktime_add_ns(ldlm_last_limit_reclaim_time,
+					   LDLM_RECLAIM_LIMIT_INTERVAL)))
+		return;
+
+	ldlm_last_limit_reclaim_time = now;
+	spin_lock(&ns->ns_reclaim_lock);
+	ns->ns_reclaim_jobs_over = true;
+	spin_unlock(&ns->ns_reclaim_lock);
+
+	ldlm_ast_queue_work(&ns->ns_reclaim_work);
+}
+
+static struct ldlm_reclaim_job *
+ldlm_reclaim_job_lookup(struct ldlm_namespace *ns, const char *key)
+{
+	return rhashtable_lookup(&ns->ns_reclaim_jobs, key,
+				 ldlm_reclaim_job_params);
+}
+
+/**
+ * Find or create the accounting entry of \a jobid in namespace \a ns and
+ * take a reference on it. May be called under a spinlock.
+ *
+ * An entry is only removed from ns_reclaim_jobs under ns_reclaim_lock once
+ * its last reference is dropped, so an entry found under that lock can
+ * always be referenced.
+ *
+ * \retval NULL	on allocation failure, the lock is not accounted to
+ *			the job then
+ */
+static struct ldlm_reclaim_job *
+ldlm_reclaim_job_get(struct ldlm_namespace *ns, const char *jobid)
+{
+	struct ldlm_reclaim_job *job, *new;
+	char key[LUSTRE_JOBID_SIZE] = "";
+	int rc;
+
+	strscpy(key, jobid, sizeof(key));
+
+	rcu_read_lock();
+	job = ldlm_reclaim_job_lookup(ns, key);
+	if (job && refcount_inc_not_zero(&job->lrj_refs)) {
+		rcu_read_unlock();
+		return job;
+	}
+	rcu_read_unlock();
+
+	OBD_ALLOC_GFP(new, sizeof(*new), GFP_ATOMIC);
+	if (!new)
+		return NULL;
+
+	new->lrj_ns = ns;
+	memcpy(new->lrj_jobid, key, sizeof(key));
+	atomic_set(&new->lrj_granted, 0);
+	refcount_set(&new->lrj_refs, 1);
+
+	spin_lock(&ns->ns_reclaim_lock);
+	job = ldlm_reclaim_job_lookup(ns, key);
+	if (job) {
+		refcount_inc(&job->lrj_refs);
+	} else {
+		rc = rhashtable_insert_fast(&ns->ns_reclaim_jobs,
+					    &new->lrj_hash,
+					    ldlm_reclaim_job_params);
+		if (rc == 0)
+			job = new;
+	}
+	spin_unlock(&ns->ns_reclaim_lock);
+
+	if (job != new)
+		OBD_FREE_PTR(new);
+
+	return job;
+}
+
+static void ldlm_reclaim_job_put(struct ldlm_reclaim_job *job)
+{
+	struct ldlm_namespace *ns = job->lrj_ns;
+
+	if (!refcount_dec_and_lock(&job->lrj_refs, &ns->ns_reclaim_lock))
+		return;
+
+	rhashtable_remove_fast(&ns->ns_reclaim_jobs, &job->lrj_hash,
+			       ldlm_reclaim_job_params);
+	spin_unlock(&ns->ns_reclaim_lock);
+	OBD_FREE_RCU(job, sizeof(*job), lrj_rcu);
+}
+
+/* charge a granted lock to its export and job */
+static void ldlm_reclaim_charge(struct ldlm_lock *lock)
+{
+	if (!lock->l_export || lock->l_reclaim_charged)
+		return;
+
+	lock->l_reclaim_charged = 1;
+	atomic_inc(&lock->l_export->exp_granted_locks);
+	if (lock->l_reclaim_job)
+		atomic_inc(&lock->l_reclaim_job->lrj_granted);
+}
+
+static void ldlm_reclaim_uncharge(struct ldlm_lock *lock)
+{
+	if (!lock->l_reclaim_charged)
+		return;
+
+	lock->l_reclaim_charged = 0;
+	atomic_dec(&lock->l_export->exp_granted_locks);
+	if (lock->l_reclaim_job)
+		atomic_dec(&lock->l_reclaim_job->lrj_granted);
+}
+
+/**
+ * Account server lock \a lock to the job \a jobid of the client process
+ * which enqueued it. Also charges the lock to its export and job if it was
+ * granted before being given to the client, as for the MDT intent locks.
+ *
+ * The lock must not be visible to other threads yet, or its resource must
+ * be locked.
+ */
+void ldlm_reclaim_attach(struct ldlm_lock *lock, const char *jobid)
+{
+	if (!ldlm_lock_reclaimable(lock))
+		return;
+
+	if (jobid && jobid[0] != '\0' && !lock->l_reclaim_job)
+		lock->l_reclaim_job =
+			ldlm_reclaim_job_get(ldlm_lock_to_ns(lock), jobid);
+
+	if (ldlm_is_granted(lock))
+		ldlm_reclaim_charge(lock);
+}
+EXPORT_SYMBOL(ldlm_reclaim_attach);
+
+/* drop the job reference of a lock being freed */
+void ldlm_reclaim_release(struct ldlm_lock *lock)
+{
+	ldlm_reclaim_uncharge(lock);
+	if (lock->l_reclaim_job) {
+		ldlm_reclaim_job_put(lock->l_reclaim_job);
+		lock->l_reclaim_job = NULL;
+	}
+}
+
 void ldlm_reclaim_add(struct ldlm_lock *lock)
 {
 	if (!ldlm_lock_reclaimable(lock))
 		return;
 	percpu_counter_add(&ldlm_granted_total, 1);
 	lock->l_last_used = ktime_get();
+	ldlm_reclaim_charge(lock);
 }
 
 void ldlm_reclaim_del(struct ldlm_lock *lock)
@@ -298,6 +702,122 @@ void ldlm_reclaim_del(struct ldlm_lock *lock)
 	if (!ldlm_lock_reclaimable(lock))
 		return;
 	percpu_counter_sub(&ldlm_granted_total, 1);
+	ldlm_reclaim_uncharge(lock);
+}
+
+/**
+ * Check the granted locks of the export \a exp and of the job \a jobid
+ * enqueueing a new lock in namespace \a ns against their limits: return
+ * true if a hard limit is reached, and schedule the revocation of the idle
+ * locks of the consumers over their soft limit.
+ *
+ * \retval true		hard limit reached.
+ * \retval false	hard limit not reached.
+ */
+bool ldlm_reclaim_limit_full(struct ldlm_namespace *ns, struct obd_export *exp,
+			     const char *jobid)
+{
+	unsigned int exp_granted = atomic_read(&exp->exp_granted_locks);
+	unsigned int job_granted = 0;
+	bool exp_over;
+	bool job_over;
+	bool over_hard;
+
+	if (jobid && jobid[0] != '\0' &&
+	    (ldlm_job_lock_soft_limit != 0 || ldlm_job_lock_hard_limit != 0)) {
+		struct ldlm_reclaim_job *job;
+		char key[LUSTRE_JOBID_SIZE] = "";
+
+		strscpy(key, jobid, sizeof(key));
+		rcu_read_lock();
+		job = ldlm_reclaim_job_lookup(ns, key);
+		if (job)
+			job_granted = atomic_read(&job->lrj_granted);
+		rcu_read_unlock();
+	}
+
+	over_hard = (ldlm_exp_lock_hard_limit != 0 &&
+		     exp_granted >= ldlm_exp_lock_hard_limit) ||
+		    (ldlm_job_lock_hard_limit != 0 &&
+		     job_granted >= ldlm_job_lock_hard_limit);
+	exp_over = ldlm_exp_lock_soft_limit != 0 &&
+		   exp_granted > ldlm_exp_lock_soft_limit;
+	job_over = ldlm_job_lock_soft_limit != 0 &&
+		   job_granted > ldlm_job_lock_soft_limit;
+
+	if (exp_over)
+		ldlm_reclaim_queue_export(ns, exp);
+	if (job_over)
+		ldlm_reclaim_queue_jobs(ns);
+
+	if (over_hard)
+		CDEBUG(D_DLMTRACE,
+		       "NS(%s): export %s (%u locks) or job '%s' (%u locks) reached its hard limit\n",
+		       ldlm_ns_name(ns), obd_uuid2str(&exp->exp_client_uuid),
+		       exp_granted, jobid ?: "", job_granted);
+
+	return over_hard;
+}
+
+/**
+ * Print the granted lock count of job \a jobid on target \a obd in its
+ * job_stats.
+ */
+void ldlm_reclaim_job_seq_show(struct seq_file *p, struct obd_device *obd,
+			       const char *jobid)
+{
+	struct ldlm_namespace *ns = obd->obd_namespace;
+	struct ldlm_reclaim_job *job;
+	char key[LUSTRE_JOBID_SIZE] = "";
+	unsigned int granted = 0;
+
+	if (!ns)
+		return;
+
+	strscpy(key, jobid, sizeof(key));
+	rcu_read_lock();
+	job = ldlm_reclaim_job_lookup(ns, key);
+	if (job)
+		granted = atomic_read(&job->lrj_granted);
+	rcu_read_unlock();
+
+	seq_printf(p, "  %-15s { samples: %11u, unit: locks }\n",
+		   "granted_locks:", granted);
+}
+EXPORT_SYMBOL(ldlm_reclaim_job_seq_show);
+
+int ldlm_reclaim_ns_init(struct ldlm_namespace *ns)
+{
+	int rc;
+
+	rc = rhashtable_init(&ns->ns_reclaim_jobs, &ldlm_reclaim_job_params);
+	if (rc)
+		return rc;
+
+	mutex_init(&ns->ns_reclaim_mutex);
+	rhashtable_walk_enter(&ns->ns_rs_hash, &ns->ns_reclaim_iter);
+	spin_lock_init(&ns->ns_reclaim_lock);
+	INIT_WORK(&ns->ns_reclaim_work, ldlm_reclaim_limit_work);
+	INIT_LIST_HEAD(&ns->ns_reclaim_exports);
+	ns->ns_reclaim_jobs_over = false;
+
+	return 0;
+}
+
+void ldlm_reclaim_ns_fini(struct ldlm_namespace *ns)
+{
+	struct obd_export *exp;
+
+	cancel_work_sync(&ns->ns_reclaim_work);
+	while ((exp = list_first_entry_or_null(&ns->ns_reclaim_exports,
+					       struct obd_export,
+					       exp_reclaim_list)) != NULL) {
+		list_del_init(&exp->exp_reclaim_list);
+		class_export_put(exp);
+	}
+	rhashtable_walk_exit(&ns->ns_reclaim_iter);
+	/* every lock, and thus every job reference, is gone by now */
+	rhashtable_destroy(&ns->ns_reclaim_jobs);
 }
 
 /**
@@ -385,6 +905,7 @@ int ldlm_reclaim_setup(void)
 
 	ldlm_last_reclaim_age_ns = LDLM_RECLAIM_AGE_MAX;
 	ldlm_last_reclaim_time = ktime_get();
+	ldlm_last_limit_reclaim_time = 0;
 
 	return percpu_counter_init(&ldlm_granted_total, 0, GFP_KERNEL);
 }
@@ -409,6 +930,19 @@ void ldlm_reclaim_del(struct ldlm_lock *lock)
 {
 }
 
+void ldlm_reclaim_release(struct ldlm_lock *lock)
+{
+}
+
+int ldlm_reclaim_ns_init(struct ldlm_namespace *ns)
+{
+	return 0;
+}
+
+void ldlm_reclaim_ns_fini(struct ldlm_namespace *ns)
+{
+}
+
 int ldlm_reclaim_setup(void)
 {
 	return 0;
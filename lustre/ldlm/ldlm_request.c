@@ -988,27 +988,55 @@ int ldlm_prep_enqueue_req(struct obd_export *exp, struct ptlrpc_request *req,
 }
 EXPORT_SYMBOL(ldlm_prep_enqueue_req);
 
-struct ptlrpc_request *ldlm_enqueue_pack(struct obd_export *exp, int lvb_len)
+/**
+ * Allocate and pack an LDLM_ENQUEUE request.
+ *
+ * If \a stride is given and the server supports OBD_CONNECT2_LOCK_STRIDE,
+ * the client access pattern is sent along so that the server can shape the
+ * granted extent to it.
+ */
+struct ptlrpc_request *
+ldlm_enqueue_stride_pack(struct obd_export *exp, int lvb_len,
+			 const struct ldlm_extent_stride *stride)
 {
 	struct ptlrpc_request *req;
 	int rc;
 
 	ENTRY;
 
-	req = ptlrpc_request_alloc(class_exp2cliimp(exp), &RQF_LDLM_ENQUEUE);
+	if (!exp_connect_lock_stride(exp))
+		stride = NULL;
+
+	req = ptlrpc_request_alloc(class_exp2cliimp(exp),
+				   stride ? &RQF_LDLM_ENQUEUE_STRIDE :
+					    &RQF_LDLM_ENQUEUE);
 	if (req == NULL)
 		RETURN(ERR_PTR(-ENOMEM));
 
+	if (stride)
+		req_capsule_set_size(&req->rq_pill, &RMF_DLM_STRIDE,
+				     RCL_CLIENT, sizeof(*stride));
+
 	rc = ldlm_prep_enqueue_req(exp, req, NULL, 0);
 	if (rc) {
 		ptlrpc_request_free(req);
 		RETURN(ERR_PTR(rc));
 	}
 
+	if (stride)
+		*(struct ldlm_extent_stride *)req_capsule_client_get(
+			&req->rq_pill, &RMF_DLM_STRIDE) = *stride;
+
 	req_capsule_set_size(&req->rq_pill, &RMF_DLM_LVB, RCL_SERVER, lvb_len);
 	ptlrpc_request_set_replen(req);
 	RETURN(req);
 }
+EXPORT_SYMBOL(ldlm_enqueue_stride_pack);
+
+struct ptlrpc_request *ldlm_enqueue_pack(struct obd_export *exp, int lvb_len)
+{
+	return ldlm_enqueue_stride_pack(exp, lvb_len, NULL);
+}
 EXPORT_SYMBOL(ldlm_enqueue_pack);
 
 static void ldlm_lock_add_to_enqueueing(struct ldlm_lock *lock)
@@ -2226,6 +2254,13 @@ static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
 		}
 		LASSERT(!lock->l_readers && !lock->l_writers);
 
+		if (ns->ns_lock_cache_ops &&
+		    ns->ns_lock_cache_ops->llco_evict_lock) {
+			spin_lock(&ns->ns_lock);
+			ns->ns_lock_cache_ops->llco_evict_lock(ns, lock);
+			spin_unlock(&ns->ns_lock);
+		}
+
 		/*
 		 * If we have chosen to cancel this lock voluntarily, we
 		 * better send cancel notification to server, so that it
@@ -2286,6 +2321,7 @@ int ldlm_cancel_lru_local(struct ldlm_namespace *ns, struct list_head *cancels,
 
 	return ldlm_cli_cancel_list_local(cancels, added, cancel_flags);
 }
+EXPORT_SYMBOL(ldlm_cancel_lru_local);
 
 /**
  * ldlm_cancel_lru() - Cancel at least @min locks from given namespace LRU.
@@ -2546,16 +2582,14 @@ struct ldlm_cli_cancel_arg {
 };
 
 static int
-ldlm_cli_hash_cancel_unused(struct cfs_hash *hs, struct cfs_hash_bd *bd,
-			    struct hlist_node *hnode, void *arg)
+ldlm_cli_hash_cancel_unused(struct ldlm_resource *res, void *arg)
 {
-	struct ldlm_resource           *res = cfs_hash_object(hs, hnode);
 	struct ldlm_cli_cancel_arg     *lc = arg;
 
 	ldlm_cli_cancel_unused_resource(ldlm_res_to_ns(res), &res->lr_name,
 					NULL, LCK_MODE_MIN, lc->lc_flags,
 					lc->lc_opaque);
-	/* must return 0 for hash iteration */
+	/* must return 0 to continue the walk */
 	return 0;
 }
 
@@ -2595,8 +2629,7 @@ int ldlm_cli_cancel_unused(struct ldlm_namespace *ns,
 						       LCK_MODE_MIN, flags,
 						       opaque));
 	} else {
-		cfs_hash_for_each_nolock(ns->ns_rs_hash,
-					 ldlm_cli_hash_cancel_unused, &arg, 0);
+		ldlm_namespace_res_walk(ns, ldlm_cli_hash_cancel_unused, &arg);
 		RETURN(ELDLM_OK);
 	}
 }
@@ -2641,12 +2674,8 @@ static int ldlm_iter_helper(struct ldlm_lock *lock, void *closure)
 	return helper->iter(lock, helper->closure);
 }
 
-static int ldlm_res_iter_helper(struct cfs_hash *hs, struct cfs_hash_bd *bd,
-				struct hlist_node *hnode, void *arg)
-
+static int ldlm_res_iter_helper(struct ldlm_resource *res, void *arg)
 {
-	struct ldlm_resource *res = cfs_hash_object(hs, hnode);
-
 	return ldlm_resource_foreach(res, ldlm_iter_helper, arg) ==
 				     LDLM_ITER_STOP;
 }
@@ -2657,9 +2686,7 @@ void ldlm_namespace_foreach(struct ldlm_namespace *ns,
 {
 	struct iter_helper_data helper = { .iter = iter, .closure = closure };
 
-	cfs_hash_for_each_nolock(ns->ns_rs_hash,
-				 ldlm_res_iter_helper, &helper, 0);
-
+	ldlm_namespace_res_walk(ns, ldlm_res_iter_helper, &helper);
 }
 
 /*
@@ -15,6 +15,7 @@
  */
 
 #define DEBUG_SUBSYSTEM S_LDLM
+#include <linux/jhash.h>
 #include <lustre_dlm.h>
 #include <lustre_fid.h>
 #include <obd_class.h>
@@ -93,15 +94,11 @@ static ssize_t resource_count_show(struct kobject *kobj, struct attribute *attr,
 	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
 						 ns_kobj);
 	u64 res = 0;
-	int pos;
-	struct ldlm_ns_bucket *nsb;
-	struct cfs_hash_bd bd;
+	int i;
 
 	/* result is not strictly consistant */
-	cfs_hash_for_each_bucket(ns->ns_rs_hash, &bd, pos) {
-		nsb = cfs_hash_bd_extra_get(ns->ns_rs_hash, &bd);
-		res += atomic_read(&nsb->nsb_count);
-	}
+	for (i = 0; i < (1 << ns->ns_rs_bkt_bits); i++)
+		res += atomic_read(&ns->ns_rs_buckets[i].nsb_count);
 
 	return sprintf(buf, "%lld\n", res);
 }
@@ -147,6 +144,43 @@ static ssize_t lock_lru_hits_show(struct kobject *kobj, struct attribute *attr,
 }
 LUSTRE_RO_ATTR(lock_lru_hits);
 
+static ssize_t lock_lru_ghost_hits_show(struct kobject *kobj,
+					struct attribute *attr, char *buf)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+	__u64 ghost_hits;
+
+	ghost_hits = lprocfs_stats_collector(ns->ns_stats,
+					     LDLM_NSS_LRU_GHOST_HITS,
+					     LPROCFS_FIELDS_FLAGS_SUM);
+	return scnprintf(buf, PAGE_SIZE, "%lld\n", ghost_hits);
+}
+LUSTRE_RO_ATTR(lock_lru_ghost_hits);
+
+static ssize_t lock_stride_grants_show(struct kobject *kobj,
+				       struct attribute *attr, char *buf)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+	__u64 grants;
+
+	grants = lprocfs_stats_collector(ns->ns_stats, LDLM_NSS_STRIDE_GRANTS,
+					 LPROCFS_FIELDS_FLAGS_SUM);
+	return scnprintf(buf, PAGE_SIZE, "%lld\n", grants);
+}
+LUSTRE_RO_ATTR(lock_stride_grants);
+
+static ssize_t lru_arc_target_show(struct kobject *kobj,
+				   struct attribute *attr, char *buf)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", ns->ns_arc_target);
+}
+LUSTRE_RO_ATTR(lru_arc_target);
+
 static ssize_t lock_unused_count_show(struct kobject *kobj,
 				      struct attribute *attr,
 				      char *buf)
@@ -511,6 +545,12 @@ static ssize_t lru_priv_ratio_limit_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(lru_priv_ratio_limit);
 
+static const char *const ldlm_lock_cache_policy_names[] = {
+	[LDLM_LOCK_CACHE_LRU]	= "LRU",
+	[LDLM_LOCK_CACHE_LFRU]	= "LFRU",
+	[LDLM_LOCK_CACHE_ARC]	= "ARC",
+};
+
 static ssize_t lock_cache_policy_show(struct kobject *kobj,
 				      struct attribute *attr, char *buf)
 {
@@ -518,8 +558,7 @@ static ssize_t lock_cache_policy_show(struct kobject *kobj,
 						 ns_kobj);
 
 	return scnprintf(buf, PAGE_SIZE, "%s\n",
-			 ns->ns_lock_cache_policy == LDLM_LOCK_CACHE_LRU ?
-			 "LRU" : "LFRU");
+			 ldlm_lock_cache_policy_names[ns->ns_lock_cache_policy]);
 }
 
 static ssize_t lock_cache_policy_store(struct kobject *kobj,
@@ -540,6 +579,8 @@ static ssize_t lock_cache_policy_store(struct kobject *kobj,
 		policy = LDLM_LOCK_CACHE_LRU;
 	else if (strncasecmp(policy_name, "LFRU", 4) == 0)
 		policy = LDLM_LOCK_CACHE_LFRU;
+	else if (strncasecmp(policy_name, "ARC", 3) == 0)
+		policy = LDLM_LOCK_CACHE_ARC;
 	else
 		return -EINVAL;
 
@@ -547,6 +588,8 @@ static ssize_t lock_cache_policy_store(struct kobject *kobj,
 		return count;
 
 	spin_lock(&ns->ns_lock);
+	if (ns->ns_lock_cache_policy == LDLM_LOCK_CACHE_ARC)
+		ldlm_arc_ghost_flush(ns);
 	switch (policy) {
 	case LDLM_LOCK_CACHE_LRU:
 		ns->ns_lock_cache_policy = policy;
@@ -559,6 +602,10 @@ static ssize_t lock_cache_policy_store(struct kobject *kobj,
 		ns->ns_lfru_priv_score_threshold = LDLM_LFRU_MIN_PRIV_THRESH;
 		ns->ns_lfru_max_freq = LDLM_LFRU_MIN_PRIV_THRESH;
 		break;
+	case LDLM_LOCK_CACHE_ARC:
+		ns->ns_lock_cache_policy = policy;
+		ns->ns_lock_cache_ops = &ldlm_arc_cache_ops;
+		break;
 	default:
 		spin_unlock(&ns->ns_lock);
 		return -EINVAL;
@@ -716,6 +763,36 @@ static ssize_t max_parallel_ast_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(max_parallel_ast);
 
+static ssize_t ast_fanout_show(struct kobject *kobj, struct attribute *attr,
+			       char *buf)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", ns->ns_ast_fanout);
+}
+
+static ssize_t ast_fanout_store(struct kobject *kobj, struct attribute *attr,
+				const char *buffer, size_t count)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+	unsigned int tmp;
+	int err;
+
+	err = kstrtouint(buffer, 10, &tmp);
+	if (err != 0)
+		return -EINVAL;
+
+	if (tmp > LDLM_AST_FANOUT_MAX)
+		return -ERANGE;
+
+	ns->ns_ast_fanout = tmp;
+
+	return count;
+}
+LUSTRE_RW_ATTR(ast_fanout);
+
 #endif /* CONFIG_LUSTRE_FS_SERVER */
 
 /* These are for namespaces in /sys/fs/lustre/ldlm/namespaces/ */
@@ -724,6 +801,8 @@ static struct attribute *ldlm_ns_attrs[] = {
 	&lustre_attr_lock_count.attr,
 	&lustre_attr_lock_lru_priv_hits.attr,
 	&lustre_attr_lock_lru_hits.attr,
+	&lustre_attr_lock_lru_ghost_hits.attr,
+	&lustre_attr_lock_stride_grants.attr,
 	&lustre_attr_lock_unused_count.attr,
 	&lustre_attr_lock_unused_priv_count.attr,
 	&lustre_attr_ns_recalc_pct.attr,
@@ -736,6 +815,7 @@ static struct attribute *ldlm_ns_attrs[] = {
 	&lustre_attr_lru_priv_score_threshold.attr,
 	&lustre_attr_lru_priv_ratio_limit.attr,
 	&lustre_attr_lock_cache_policy.attr,
+	&lustre_attr_lru_arc_target.attr,
 #ifdef CONFIG_LUSTRE_FS_SERVER
 	&lustre_attr_ctime_age_limit.attr,
 	&lustre_attr_lock_timeouts.attr,
@@ -743,6 +823,7 @@ static struct attribute *ldlm_ns_attrs[] = {
 	&lustre_attr_contention_seconds.attr,
 	&lustre_attr_contended_locks.attr,
 	&lustre_attr_max_parallel_ast.attr,
+	&lustre_attr_ast_fanout.attr,
 #endif
 	NULL,
 };
@@ -797,6 +878,12 @@ static int ldlm_namespace_sysfs_register(struct ldlm_namespace *ns)
 	lprocfs_counter_init(ns->ns_stats, LDLM_NSS_LRU_HITS,
 			     LPROCFS_CNTR_AVGMINMAX | LPROCFS_TYPE_LOCKS,
 			     "lock_lru_hits");
+	lprocfs_counter_init(ns->ns_stats, LDLM_NSS_LRU_GHOST_HITS,
+			     LPROCFS_CNTR_AVGMINMAX | LPROCFS_TYPE_LOCKS,
+			     "lock_lru_ghost_hits");
+	lprocfs_counter_init(ns->ns_stats, LDLM_NSS_STRIDE_GRANTS,
+			     LPROCFS_CNTR_AVGMINMAX | LPROCFS_TYPE_LOCKS,
+			     "lock_stride_grants");
 
 	ns->ns_kobj.kset = ldlm_ns_kset;
 	init_completion(&ns->ns_kobj_unregister);
@@ -828,97 +915,54 @@ static int ldlm_namespace_debugfs_register(struct ldlm_namespace *ns)
 }
 #undef MAX_STRING_SIZE
 
-static unsigned int ldlm_res_hop_hash(struct cfs_hash *hs,
-				      const void *key, const unsigned int bits)
+static u32 ldlm_res_hash(const void *data, u32 len, u32 seed)
 {
-	const struct ldlm_res_id *id = key;
-	unsigned int val = 0;
-	unsigned int i;
+	const struct ldlm_res_id *id = data;
 
-	for (i = 0; i < RES_NAME_SIZE; i++)
-		val += id->name[i];
-
-	return val & ((1UL << bits) - 1);
+	return jhash2((const u32 *)id->name, sizeof(id->name) / sizeof(u32),
+		      seed);
 }
 
-static void *ldlm_res_hop_key(struct hlist_node *hnode)
-{
-	struct ldlm_resource   *res;
-
-	res = hlist_entry(hnode, struct ldlm_resource, lr_hash);
-	return &res->lr_name;
-}
-
-static int ldlm_res_hop_keycmp(const void *key, struct hlist_node *hnode)
-{
-	struct ldlm_resource   *res;
-
-	res = hlist_entry(hnode, struct ldlm_resource, lr_hash);
-	return ldlm_res_eq((const struct ldlm_res_id *)key,
-			   (const struct ldlm_res_id *)&res->lr_name);
-}
-
-static void *ldlm_res_hop_object(struct hlist_node *hnode)
-{
-	return hlist_entry(hnode, struct ldlm_resource, lr_hash);
-}
-
-static void
-ldlm_res_hop_get_locked(struct cfs_hash *hs, struct hlist_node *hnode)
-{
-	struct ldlm_resource *res;
-
-	res = hlist_entry(hnode, struct ldlm_resource, lr_hash);
-	ldlm_resource_getref(res);
-}
+static const struct rhashtable_params ldlm_res_hash_params = {
+	.key_len	= sizeof(struct ldlm_res_id),
+	.key_offset	= offsetof(struct ldlm_resource, lr_name),
+	.head_offset	= offsetof(struct ldlm_resource, lr_hash),
+	.hashfn		= ldlm_res_hash,
+	.automatic_shrinking = true,
+};
 
-static void ldlm_res_hop_put(struct cfs_hash *hs, struct hlist_node *hnode)
+static inline struct ldlm_ns_bucket *
+ldlm_res_bucket(struct ldlm_namespace *ns, const struct ldlm_res_id *name)
 {
-	struct ldlm_resource *res;
-
-	res = hlist_entry(hnode, struct ldlm_resource, lr_hash);
-	ldlm_resource_putref(res);
+	return &ns->ns_rs_buckets[ldlm_res_hash(name, sizeof(*name), 0) &
+				  ((1U << ns->ns_rs_bkt_bits) - 1)];
 }
 
-static struct cfs_hash_ops ldlm_ns_hash_ops = {
-	.hs_hash        = ldlm_res_hop_hash,
-	.hs_key         = ldlm_res_hop_key,
-	.hs_keycmp      = ldlm_res_hop_keycmp,
-	.hs_keycpy      = NULL,
-	.hs_object      = ldlm_res_hop_object,
-	.hs_get         = ldlm_res_hop_get_locked,
-	.hs_put         = ldlm_res_hop_put
-};
-
+/*
+ * The resource hash itself grows and shrinks on demand, this only sizes the
+ * array of per-namespace buckets holding the AT estimates and counters.
+ */
 static struct {
 	/** hash bucket bits */
 	unsigned int		nsd_bkt_bits;
-	/** hash bits */
-	unsigned int		nsd_all_bits;
 } ldlm_ns_hash_defs[] = {
 	[LDLM_NS_TYPE_MDC] = {
 		.nsd_bkt_bits   = 11,
-		.nsd_all_bits   = 16,
 	},
 	[LDLM_NS_TYPE_MDT] = {
 		.nsd_bkt_bits   = 14,
-		.nsd_all_bits   = 21,
 	},
 	[LDLM_NS_TYPE_OSC] = {
 		.nsd_bkt_bits   = 8,
-		.nsd_all_bits   = 12,
 	},
 	[LDLM_NS_TYPE_OST] = {
 		.nsd_bkt_bits   = 11,
-		.nsd_all_bits   = 17,
 	},
 	[LDLM_NS_TYPE_MGC] = {
 		.nsd_bkt_bits   = 3,
-		.nsd_all_bits   = 4,
 	},
 	[LDLM_NS_TYPE_MGT] = {
 		.nsd_bkt_bits   = 3,
-		.nsd_all_bits   = 4,
 	},
 };
 
@@ -934,8 +978,7 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
 	struct ldlm_ns_bucket *nsb;
 	int idx;
 	int rc;
-	struct cfs_hash_bd bd;
-	int pos;
+	int i;
 
 	ENTRY;
 	LASSERT(obd != NULL);
@@ -958,29 +1001,34 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
 	if (!ns)
 		GOTO(out_ref, rc = -ENOMEM);
 
-	ns->ns_rs_hash = cfs_hash_create(name,
-					 ldlm_ns_hash_defs[ns_type].nsd_all_bits,
-					 ldlm_ns_hash_defs[ns_type].nsd_all_bits,
-					 ldlm_ns_hash_defs[ns_type].nsd_bkt_bits,
-					 sizeof(*nsb),
-					 CFS_HASH_MIN_THETA,
-					 CFS_HASH_MAX_THETA,
-					 &ldlm_ns_hash_ops,
-					 CFS_HASH_DEPTH |
-					 CFS_HASH_BIGNAME |
-					 CFS_HASH_SPIN_BKTLOCK |
-					 CFS_HASH_NO_ITEMREF);
-	if (!ns->ns_rs_hash)
+	ns->ns_rs_bkt_bits = ldlm_ns_hash_defs[ns_type].nsd_bkt_bits;
+	OBD_ALLOC_PTR_ARRAY_LARGE(ns->ns_rs_buckets, 1 << ns->ns_rs_bkt_bits);
+	if (!ns->ns_rs_buckets)
 		GOTO(out_ns, rc = -ENOMEM);
 
-	cfs_hash_for_each_bucket(ns->ns_rs_hash, &bd, pos) {
-		nsb = cfs_hash_bd_extra_get(ns->ns_rs_hash, &bd);
+	for (i = 0; i < (1 << ns->ns_rs_bkt_bits); i++) {
+		nsb = &ns->ns_rs_buckets[i];
 		at_init(&nsb->nsb_at_estimate, obd_get_ldlm_enqueue_min(obd), 0);
 		nsb->nsb_namespace = ns;
-		nsb->nsb_reclaim_start = 0;
 		atomic_set(&nsb->nsb_count, 0);
 	}
 
+	rc = rhashtable_init(&ns->ns_rs_hash, &ldlm_res_hash_params);
+	if (rc)
+		GOTO(out_bkt, rc);
+
+	rc = ldlm_arc_init(ns);
+	if (rc)
+		GOTO(out_rs_hash, rc);
+
+	rc = ldlm_reclaim_ns_init(ns);
+	if (rc)
+		GOTO(out_arc, rc);
+
+	rc = ldlm_flock_ns_init(ns);
+	if (rc)
+		GOTO(out_reclaim, rc);
+
 	ns->ns_obd = obd;
 	ns->ns_appetite = apt;
 	ns->ns_client = client;
@@ -1011,7 +1059,7 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
 	ns->ns_contention_time = NS_DEFAULT_CONTENTION_SECONDS;
 	ns->ns_max_nolock_size = NS_DEFAULT_MAX_NOLOCK_BYTES;
 	ns->ns_max_parallel_ast = LDLM_DEFAULT_PARALLEL_AST_LIMIT;
-	ns->ns_reclaim_start = 0;
+	ns->ns_ast_fanout = 0;
 
 	ns->ns_lfru_access_window_cnt = 0;
 	ns->ns_lfru_max_freq = LDLM_LFRU_MIN_PRIV_THRESH;
@@ -1053,7 +1101,15 @@ out_sysfs:
 	ldlm_namespace_cleanup(ns, 0);
 out_hash:
 	kfree(ns->ns_name);
-	cfs_hash_putref(ns->ns_rs_hash);
+	ldlm_flock_ns_fini(ns);
+out_reclaim:
+	ldlm_reclaim_ns_fini(ns);
+out_arc:
+	ldlm_arc_fini(ns);
+out_rs_hash:
+	rhashtable_destroy(&ns->ns_rs_hash);
+out_bkt:
+	OBD_FREE_PTR_ARRAY_LARGE(ns->ns_rs_buckets, 1 << ns->ns_rs_bkt_bits);
 out_ns:
 	OBD_FREE_PTR(ns);
 out_ref:
@@ -1148,10 +1204,74 @@ static void cleanup_resource(struct ldlm_resource *res, struct list_head *q,
 	} while (1);
 }
 
-static int ldlm_resource_clean(struct cfs_hash *hs, struct cfs_hash_bd *bd,
-			       struct hlist_node *hnode, void *arg)
+/**
+ * ldlm_namespace_res_walk() - Call @iter on every resource in a namespace
+ * @ns: namespace to walk
+ * @iter: callback, a non-zero return stops the walk
+ * @arg: opaque data passed to @iter
+ *
+ * The callback is called without any lock held and with a reference taken on
+ * the resource, so it may block and may drop the last lock on the resource.
+ * Resources added or removed during the walk may or may not be visited, and
+ * a resource may be visited twice if the hash table is resized meanwhile.
+ *
+ * Return: the non-zero value returned by @iter, or 0 if all were visited
+ */
+int ldlm_namespace_res_walk(struct ldlm_namespace *ns,
+			    ldlm_res_iterator_t iter, void *arg)
+{
+	struct rhashtable_iter hti;
+	int rc;
+
+	rhashtable_walk_enter(&ns->ns_rs_hash, &hti);
+	rc = ldlm_namespace_res_walk_resume(&hti, iter, arg);
+	rhashtable_walk_exit(&hti);
+
+	return rc;
+}
+EXPORT_SYMBOL(ldlm_namespace_res_walk);
+
+/**
+ * ldlm_namespace_res_walk_resume() - Continue a walk of namespace resources
+ * @hti: iterator entered on ldlm_namespace::ns_rs_hash
+ * @iter: callback, a non-zero return stops the walk
+ * @arg: opaque data passed to @iter
+ *
+ * Call @iter on the resources following the one at which the previous walk
+ * with @hti stopped, see ldlm_namespace_res_walk(). The caller serializes the
+ * users of @hti, and exits and re-enters it to start over once the end of the
+ * table has been reached.
+ *
+ * Return: the non-zero value returned by @iter, or 0 at the end of the table
+ */
+int ldlm_namespace_res_walk_resume(struct rhashtable_iter *hti,
+				   ldlm_res_iterator_t iter, void *arg)
+{
+	struct ldlm_resource *res;
+	int rc = 0;
+
+	rhashtable_walk_start(hti);
+	while ((res = rhashtable_walk_next(hti)) != NULL) {
+		/* -EAGAIN: table was resized, walk restarts from the start */
+		if (IS_ERR(res))
+			continue;
+		if (!refcount_inc_not_zero(&res->lr_refcount))
+			continue;
+
+		rhashtable_walk_stop(hti);
+		rc = iter(res, arg);
+		ldlm_resource_putref(res);
+		rhashtable_walk_start(hti);
+		if (rc)
+			break;
+	}
+	rhashtable_walk_stop(hti);
+
+	return rc;
+}
+
+static int ldlm_resource_clean(struct ldlm_resource *res, void *arg)
 {
-	struct ldlm_resource *res = cfs_hash_object(hs, hnode);
 	__u64 flags = *(__u64 *)arg;
 
 	cleanup_resource(res, &res->lr_granted, flags);
@@ -1160,11 +1280,8 @@ static int ldlm_resource_clean(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 	return 0;
 }
 
-static int ldlm_resource_complain(struct cfs_hash *hs, struct cfs_hash_bd *bd,
-				  struct hlist_node *hnode, void *arg)
+static int ldlm_resource_complain(struct ldlm_resource *res, void *arg)
 {
-	struct ldlm_resource  *res = cfs_hash_object(hs, hnode);
-
 	lock_res(res);
 	CERROR("%s: namespace resource "DLDLMRES" (%p) refcount nonzero "
 	       "(%d) after lock cleanup; forcing cleanup.\n",
@@ -1191,10 +1308,8 @@ int ldlm_namespace_cleanup(struct ldlm_namespace *ns, __u64 flags)
 		return ELDLM_OK;
 	}
 
-	cfs_hash_for_each_nolock(ns->ns_rs_hash, ldlm_resource_clean,
-				 &flags, 0);
-	cfs_hash_for_each_nolock(ns->ns_rs_hash, ldlm_resource_complain,
-				 NULL, 0);
+	ldlm_namespace_res_walk(ns, ldlm_resource_clean, &flags);
+	ldlm_namespace_res_walk(ns, ldlm_resource_complain, NULL);
 	return ELDLM_OK;
 }
 EXPORT_SYMBOL(ldlm_namespace_cleanup);
@@ -1319,7 +1434,11 @@ void ldlm_namespace_free_post(struct ldlm_namespace *ns)
 
 	ldlm_namespace_debugfs_unregister(ns);
 	ldlm_namespace_sysfs_unregister(ns);
-	cfs_hash_putref(ns->ns_rs_hash);
+	ldlm_flock_ns_fini(ns);
+	ldlm_reclaim_ns_fini(ns);
+	ldlm_arc_fini(ns);
+	rhashtable_destroy(&ns->ns_rs_hash);
+	OBD_FREE_PTR_ARRAY_LARGE(ns->ns_rs_buckets, 1 << ns->ns_rs_bkt_bits);
 	kfree(ns->ns_name);
 	/* Namespace \a ns should be not on list at this time, otherwise
 	 * this will cause issues related to using freed \a ns in poold
@@ -1537,32 +1656,27 @@ static void ldlm_resource_free(struct ldlm_resource *res)
 /**
  * Return a reference to resource with given name, creating it if necessary.
  * Args: namespace with ns_lock unlocked
- * Locks: takes and releases NS hash-lock and res->lr_lock
+ * Locks: lookup is done under RCU only, no NS lock is taken
  * Returns: referenced, unlocked ldlm_resource or ERR_PTR
  */
 struct ldlm_resource *
 ldlm_resource_get(struct ldlm_namespace *ns, const struct ldlm_res_id *name,
 		  enum ldlm_type type, int create)
 {
-	struct hlist_node	*hnode;
-	struct ldlm_resource	*res = NULL;
-	struct cfs_hash_bd		bd;
-	__u64			version;
+	struct ldlm_resource	*res;
+	struct ldlm_resource	*old;
 	int			ns_refcount = 0;
 
 	LASSERT(ns != NULL);
-	LASSERT(ns->ns_rs_hash != NULL);
 	LASSERT(name->name[0] != 0);
 
-	cfs_hash_bd_get_and_lock(ns->ns_rs_hash, (void *)name, &bd, 0);
-	hnode = cfs_hash_bd_lookup_locked(ns->ns_rs_hash, &bd, (void *)name);
-	if (hnode != NULL) {
-		cfs_hash_bd_unlock(ns->ns_rs_hash, &bd, 0);
-		GOTO(found, res);
+	rcu_read_lock();
+	res = rhashtable_lookup(&ns->ns_rs_hash, name, ldlm_res_hash_params);
+	if (res && refcount_inc_not_zero(&res->lr_refcount)) {
+		rcu_read_unlock();
+		return res;
 	}
-
-	version = cfs_hash_bd_version_get(&bd);
-	cfs_hash_bd_unlock(ns->ns_rs_hash, &bd, 0);
+	rcu_read_unlock();
 
 	if (create == 0)
 		return ERR_PTR(-ENOENT);
@@ -1575,27 +1689,37 @@ ldlm_resource_get(struct ldlm_namespace *ns, const struct ldlm_res_id *name,
 
 	res->lr_name = *name;
 	res->lr_type = type;
-
-	cfs_hash_bd_lock(ns->ns_rs_hash, &bd, 1);
-	res->lr_ns_bucket = cfs_hash_bd_extra_get(ns->ns_rs_hash, &bd);
-	hnode = (version == cfs_hash_bd_version_get(&bd)) ? NULL :
-		cfs_hash_bd_lookup_locked(ns->ns_rs_hash, &bd, (void *)name);
-
-	if (hnode != NULL) {
+	res->lr_ns_bucket = ldlm_res_bucket(ns, name);
+
+again:
+	rcu_read_lock();
+	old = rhashtable_lookup_get_insert_fast(&ns->ns_rs_hash, &res->lr_hash,
+						ldlm_res_hash_params);
+	if (IS_ERR(old)) {
+		rcu_read_unlock();
+		ldlm_resource_free(res);
+		return old;
+	}
+	if (old != NULL) {
+		if (!refcount_inc_not_zero(&old->lr_refcount)) {
+			/* The resource found is being freed, wait until its
+			 * last putref unhashes it and retry.
+			 */
+			rcu_read_unlock();
+			cond_resched();
+			goto again;
+		}
+		rcu_read_unlock();
 		/* Someone won the race and already added the resource. */
-		cfs_hash_bd_unlock(ns->ns_rs_hash, &bd, 1);
 		ldlm_resource_free(res);
-found:
-		res = hlist_entry(hnode, struct ldlm_resource, lr_hash);
-		return res;
+		return old;
 	}
-	/* We won! Let's add the resource. */
-	cfs_hash_bd_add_locked(ns->ns_rs_hash, &bd, &res->lr_hash);
+	rcu_read_unlock();
+
+	/* We won! The resource is added. */
 	if (atomic_inc_return(&res->lr_ns_bucket->nsb_count) == 1)
 		ns_refcount = ldlm_namespace_get_return(ns);
 
-	cfs_hash_bd_unlock(ns->ns_rs_hash, &bd, 1);
-
 	CFS_FAIL_TIMEOUT(OBD_FAIL_LDLM_CREATE_RESOURCE, 2);
 
 	/* Let's see if we happened to be the very first resource in this
@@ -1623,7 +1747,7 @@ struct ldlm_resource *ldlm_resource_getref(struct ldlm_resource *res)
 	return res;
 }
 
-static void __ldlm_resource_putref_final(struct cfs_hash_bd *bd,
+static void __ldlm_resource_putref_final(struct ldlm_namespace *ns,
 					 struct ldlm_resource *res)
 {
 	struct ldlm_ns_bucket *nsb = res->lr_ns_bucket;
@@ -1643,8 +1767,8 @@ static void __ldlm_resource_putref_final(struct cfs_hash_bd *bd,
 		LBUG();
 	}
 
-	cfs_hash_bd_del_locked(nsb->nsb_namespace->ns_rs_hash,
-			       bd, &res->lr_hash);
+	rhashtable_remove_fast(&ns->ns_rs_hash, &res->lr_hash,
+			       ldlm_res_hash_params);
 	if (atomic_dec_and_test(&nsb->nsb_count))
 		ldlm_namespace_put(nsb->nsb_namespace);
 }
@@ -1654,8 +1778,6 @@ int ldlm_resource_putref(struct ldlm_resource *res)
 {
 	struct ldlm_valblock_ops *ns_lvbo;
 	struct ldlm_namespace *ns;
-	struct cfs_hash_bd bd;
-	int refcount;
 
 	if (refcount_dec_not_one(&res->lr_refcount))
 		return 0;
@@ -1663,22 +1785,23 @@ int ldlm_resource_putref(struct ldlm_resource *res)
 	/* save ops as __ldlm_resource_putref_final() may
 	 * initiate namespace release in a separate thread */
 	ns_lvbo = ns->ns_lvbo;
-	refcount = refcount_read(&res->lr_refcount);
-	LASSERT(refcount < LI_POISON);
+	LASSERT(refcount_read(&res->lr_refcount) < LI_POISON);
 
 	CDEBUG(D_INFO, "putref res: %p count: %d\n",
 	       res, refcount_read(&res->lr_refcount) - 1);
 
-	cfs_hash_bd_get(ns->ns_rs_hash, &res->lr_name, &bd);
-	if (cfs_hash_bd_dec_and_lock(ns->ns_rs_hash, &bd, &res->lr_refcount)) {
-		__ldlm_resource_putref_final(&bd, res);
-		cfs_hash_bd_unlock(ns->ns_rs_hash, &bd, 1);
-		if (ns_lvbo && ns_lvbo->lvbo_free)
-			ns_lvbo->lvbo_free(res);
-		ldlm_resource_free(res);
-		return 1;
-	}
-	return 0;
+	/* lookups only take a reference with refcount_inc_not_zero(), so
+	 * once the count drops to zero the resource cannot be revived and
+	 * is unhashed without any lock.
+	 */
+	if (!refcount_dec_and_test(&res->lr_refcount))
+		return 0;
+
+	__ldlm_resource_putref_final(ns, res);
+	if (ns_lvbo && ns_lvbo->lvbo_free)
+		ns_lvbo->lvbo_free(res);
+	ldlm_resource_free(res);
+	return 1;
 }
 EXPORT_SYMBOL(ldlm_resource_putref);
 
@@ -1793,10 +1916,8 @@ void ldlm_dump_all_namespaces(enum ldlm_side client, int level)
 	mutex_unlock(ldlm_namespace_lock(client));
 }
 
-static int ldlm_res_hash_dump(struct cfs_hash *hs, struct cfs_hash_bd *bd,
-			      struct hlist_node *hnode, void *arg)
+static int ldlm_res_hash_dump(struct ldlm_resource *res, void *arg)
 {
-	struct ldlm_resource *res = cfs_hash_object(hs, hnode);
 	int    level = (int)(unsigned long)arg;
 
 	lock_res(res);
@@ -1819,9 +1940,8 @@ void ldlm_namespace_dump(int level, struct ldlm_namespace *ns)
 	if (ktime_get_seconds() < ns->ns_next_dump)
 		return;
 
-	cfs_hash_for_each_nolock(ns->ns_rs_hash,
-				 ldlm_res_hash_dump,
-				 (void *)(unsigned long)level, 0);
+	ldlm_namespace_res_walk(ns, ldlm_res_hash_dump,
+				(void *)(unsigned long)level);
 	spin_lock(&ns->ns_lock);
 	ns->ns_next_dump = ktime_get_seconds() + 10;
 	spin_unlock(&ns->ns_lock);
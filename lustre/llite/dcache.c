@@ -231,6 +231,8 @@ int ll_revalidate_it_finish(struct ptlrpc_request *request,
 
 	ll_set_lock_data(ll_i2sbi(inode)->ll_md_exp, inode, it,
 			 &bits);
+	if (bits & MDS_INODELOCK_XATTR)
+		ll_xattr_cache_prefetch(inode, &request->rq_pill);
 	if ((bits & MDS_INODELOCK_LOOKUP) &&
 	    !d_lustre_invalid(de) && S_ISDIR(inode->i_mode)) {
 		struct dentry *parent = dget_parent(de);
@@ -39,6 +39,246 @@
 
 #include "llite_internal.h"
 
+/* pages read with CLI_READDIR_PLUS, see ll_readdir_plus_add() */
+struct ll_readdir_plus {
+	struct md_readdir_info	lrp_mrinfo;
+	struct list_head	lrp_pages;
+};
+
+struct ll_readdir_plus_page {
+	struct list_head	lrpp_list;
+	struct page		*lrpp_page;
+};
+
+/* dentries are instantiated from a work item, off the readdir path */
+struct ll_readdir_plus_work {
+	struct work_struct	lrpw_work;
+	struct inode		*lrpw_dir;
+	struct list_head	lrpw_pages;
+	unsigned long		lrpw_expire;
+};
+
+/*
+ * Called by MDC for each page read from the MDT. The page is up to date and
+ * its content won't change anymore, so only take a reference on it for
+ * ll_readdir_plus_work_handle().
+ */
+static void ll_readdir_plus_add(struct md_readdir_info *mrinfo,
+				struct page *page)
+{
+	struct ll_readdir_plus *lrp = container_of(mrinfo,
+						   struct ll_readdir_plus,
+						   lrp_mrinfo);
+	struct ll_readdir_plus_page *lrpp;
+
+	OBD_ALLOC_PTR(lrpp);
+	if (!lrpp)
+		return;
+
+	get_page(page);
+	lrpp->lrpp_page = page;
+	list_add_tail(&lrpp->lrpp_list, &lrp->lrp_pages);
+}
+
+static void ll_readdir_plus_pages_put(struct list_head *pages)
+{
+	struct ll_readdir_plus_page *lrpp, *tmp;
+
+	list_for_each_entry_safe(lrpp, tmp, pages, lrpp_list) {
+		list_del(&lrpp->lrpp_list);
+		put_page(lrpp->lrpp_page);
+		OBD_FREE_PTR(lrpp);
+	}
+}
+
+/*
+ * Instantiate the dentry and inode of one entry carrying LUDA_ATTRS. Names
+ * which are already cached, or being looked up, and inodes which are already
+ * cached are left alone: the attributes don't come with a lock, so they must
+ * not overwrite those of an inode which may be protected by one.
+ */
+static int ll_readdir_plus_entry(struct dentry *parent, struct lu_dirent *ent,
+				 unsigned long expire)
+{
+	DECLARE_WAIT_QUEUE_HEAD_ONSTACK(wq);
+	struct inode *dir = d_inode(parent);
+	struct luda_attrs *lda = lu_dirent_attrs_get(ent);
+	struct mdt_body body = { 0 };
+	struct lustre_md md = { .body = &body };
+	struct dentry *dentry;
+	struct dentry *alias;
+	struct inode *inode;
+	struct qstr qstr;
+
+	if (!lda)
+		return -ENODATA;
+
+	qstr.name = ent->lde_name;
+	qstr.len = le16_to_cpu(ent->lde_namelen);
+	qstr.hash = full_name_hash(parent, qstr.name, qstr.len);
+
+	dentry = d_lookup(parent, &qstr);
+	if (dentry) {
+		dput(dentry);
+		return -EEXIST;
+	}
+
+	dentry = d_alloc_parallel(parent, &qstr, &wq);
+	if (IS_ERR(dentry))
+		return PTR_ERR(dentry);
+
+	if (!d_in_lookup(dentry)) {
+		dput(dentry);
+		return -EEXIST;
+	}
+
+	fid_le_to_cpu(&body.mbo_fid1, &ent->lde_fid);
+	body.mbo_valid = le64_to_cpu(lda->lda_valid) | OBD_MD_FLID;
+	body.mbo_size = le64_to_cpu(lda->lda_size);
+	body.mbo_blocks = le64_to_cpu(lda->lda_blocks);
+	body.mbo_mtime = le64_to_cpu(lda->lda_mtime);
+	body.mbo_atime = le64_to_cpu(lda->lda_atime);
+	body.mbo_ctime = le64_to_cpu(lda->lda_ctime);
+	body.mbo_btime = le64_to_cpu(lda->lda_btime);
+	body.mbo_mode = le32_to_cpu(lda->lda_mode);
+	body.mbo_uid = le32_to_cpu(lda->lda_uid);
+	body.mbo_gid = le32_to_cpu(lda->lda_gid);
+	body.mbo_projid = le32_to_cpu(lda->lda_projid);
+	body.mbo_nlink = le32_to_cpu(lda->lda_nlink);
+	body.mbo_flags = le32_to_cpu(lda->lda_flags);
+	body.mbo_rdev = le32_to_cpu(lda->lda_rdev);
+
+	/* directories need their LMV, which only comes with a lookup */
+	if (!fid_is_sane(&body.mbo_fid1) || S_ISDIR(body.mbo_mode) ||
+	    !(body.mbo_valid & OBD_MD_FLTYPE)) {
+		d_lookup_done(dentry);
+		dput(dentry);
+		return -EINVAL;
+	}
+
+	inode = ll_iget_new(dir->i_sb,
+			    cl_fid_build_ino(&body.mbo_fid1,
+					     ll_need_32bit_api(ll_i2sbi(dir))),
+			    &md);
+	if (IS_ERR(inode)) {
+		d_lookup_done(dentry);
+		dput(dentry);
+		return PTR_ERR(inode);
+	}
+
+	alias = ll_splice_alias(inode, dentry);
+	d_lookup_done(dentry);
+	if (IS_ERR(alias)) {
+		dput(dentry);
+		return PTR_ERR(alias);
+	}
+	if (alias != dentry)
+		dput(dentry);
+
+	d_lustre_readdir_plus_set(alias, expire);
+	dput(alias);
+
+	return 0;
+}
+
+/*
+ * Populate the dcache from the pages kept by ll_readdir_plus_add(). The new
+ * dentries are valid without a LOOKUP lock until lrpw_expire, so stat() of
+ * the listed names does not need an RPC to the MDT, see ll_getattr_dentry().
+ *
+ * The pages are only trusted while the UPDATE lock of @dir they were read
+ * under is held: its cancel drops them from the page cache, so a page which
+ * was truncated or a lock which is gone means the listing is out of date.
+ * Each page is kept locked while its entries are instantiated, so the cancel
+ * cannot truncate it in the meantime.
+ * Like a lookup, this is done with the i_rwsem of @dir held shared.
+ */
+static void ll_readdir_plus_work_handle(struct work_struct *work)
+{
+	struct ll_readdir_plus_work *lrpw;
+	struct ll_readdir_plus_page *lrpp;
+	struct dentry *parent;
+	struct inode *dir;
+	int count = 0;
+
+	lrpw = container_of(work, struct ll_readdir_plus_work, lrpw_work);
+	dir = lrpw->lrpw_dir;
+	parent = d_find_any_alias(dir);
+
+	list_for_each_entry(lrpp, &lrpw->lrpw_pages, lrpp_list) {
+		enum mds_ibits_locks bits = MDS_INODELOCK_UPDATE;
+		struct lu_dirpage *dp;
+		struct lu_dirent *ent;
+
+		if (!parent || time_after(jiffies, lrpw->lrpw_expire))
+			break;
+
+		inode_lock_shared(dir);
+		/* the page lock holds off the truncate by the lock cancel */
+		lock_page(lrpp->lrpp_page);
+		if (!lrpp->lrpp_page->mapping ||
+		    !ll_have_md_lock(ll_i2mdexp(dir), dir, &bits,
+				     LCK_MODE_MIN, 0)) {
+			unlock_page(lrpp->lrpp_page);
+			inode_unlock_shared(dir);
+			break;
+		}
+
+		/* lu_dirpages of a page were merged by mdc_adjust_dirpages() */
+		dp = kmap_local_page(lrpp->lrpp_page);
+		for (ent = lu_dirent_start(dp); ent; ent = lu_dirent_next(ent))
+			if (ll_readdir_plus_entry(parent, ent,
+						  lrpw->lrpw_expire) == 0)
+				count++;
+		kunmap_local(dp);
+		unlock_page(lrpp->lrpp_page);
+		inode_unlock_shared(dir);
+		cond_resched();
+	}
+
+	if (parent)
+		dput(parent);
+
+	CDEBUG(D_READA, "%s: "DFID" instantiated %d entries from readdir\n",
+	       ll_i2sbi(dir)->ll_fsname, PFID(ll_inode2fid(dir)), count);
+
+	ll_readdir_plus_pages_put(&lrpw->lrpw_pages);
+	iput(dir);
+	OBD_FREE_PTR(lrpw);
+}
+
+/*
+ * Hand the pages collected by ll_readdir_plus_add() to a work item. The
+ * attributes are only trusted for readdir_plus_ms from now on, whenever the
+ * work item gets to run.
+ */
+static void ll_readdir_plus_queue(struct inode *dir, struct list_head *pages)
+{
+	struct ll_sb_info *sbi = ll_i2sbi(dir);
+	struct ll_readdir_plus_work *lrpw;
+
+	OBD_ALLOC_PTR(lrpw);
+	if (!lrpw)
+		goto out;
+
+	/* ll_kill_super() flushes the work before inodes are evicted */
+	lrpw->lrpw_dir = igrab(dir);
+	if (!lrpw->lrpw_dir) {
+		OBD_FREE_PTR(lrpw);
+		goto out;
+	}
+
+	INIT_LIST_HEAD(&lrpw->lrpw_pages);
+	list_splice_init(pages, &lrpw->lrpw_pages);
+	lrpw->lrpw_expire = jiffies +
+			    msecs_to_jiffies(sbi->ll_readdir_plus_ms) ?: 1;
+	INIT_WORK(&lrpw->lrpw_work, ll_readdir_plus_work_handle);
+	queue_work(sbi->ll_ra_info.ll_readahead_wq, &lrpw->lrpw_work);
+	return;
+out:
+	ll_readdir_plus_pages_put(pages);
+}
+
 /**
  * ll_get_dir_page() - Get directory page for a given directory inode
  * @dir: pointer to the directory(inode) for which page is being fetched
@@ -133,12 +373,18 @@
 struct page *ll_get_dir_page(struct inode *dir, struct md_op_data *op_data,
 			     __u64 offset, bool hash64, int *partial_readdir_rc)
 {
-	struct md_readdir_info mrinfo = {
-					.mr_blocking_ast = ll_md_blocking_ast };
+	struct ll_readdir_plus lrp = {
+		.lrp_mrinfo = { .mr_blocking_ast = ll_md_blocking_ast },
+		.lrp_pages = LIST_HEAD_INIT(lrp.lrp_pages),
+	};
+	struct md_readdir_info *mrinfo = &lrp.lrp_mrinfo;
 	struct page *page;
 	unsigned long idx = hash_x_index(offset, hash64);
 	int rc;
 
+	/* the MDT returns cached creates only once they are written back */
+	ll_wbc_flush_children(dir);
+
 	/* check page first */
 	page = find_get_page(dir->i_mapping, idx);
 	if (page) {
@@ -148,12 +394,17 @@ struct page *ll_get_dir_page(struct inode *dir, struct md_op_data *op_data,
 		put_page(page);
 	}
 
-	rc = md_read_page(ll_i2mdexp(dir), op_data, &mrinfo, offset, &page);
+	if (op_data->op_cli_flags & CLI_READDIR_PLUS)
+		mrinfo->mr_readdir_plus = ll_readdir_plus_add;
+
+	rc = md_read_page(ll_i2mdexp(dir), op_data, mrinfo, offset, &page);
+	if (!list_empty(&lrp.lrp_pages))
+		ll_readdir_plus_queue(dir, &lrp.lrp_pages);
 	if (rc != 0)
 		return ERR_PTR(rc);
 
-	if (partial_readdir_rc && mrinfo.mr_partial_readdir_rc)
-		*partial_readdir_rc = mrinfo.mr_partial_readdir_rc;
+	if (partial_readdir_rc && mrinfo->mr_partial_readdir_rc)
+		*partial_readdir_rc = mrinfo->mr_partial_readdir_rc;
 
 	return page;
 }
@@ -375,6 +626,11 @@ static int ll_iterate(struct file *filp, struct dir_context *ctx)
 
 	op_data->op_fid3 = pfid;
 
+	/* attributes are only handed to those who could stat the entries */
+	if (ll_readdir_plus_enabled(inode) &&
+	    !inode_permission(&nop_mnt_idmap, inode, MAY_EXEC))
+		op_data->op_cli_flags |= CLI_READDIR_PLUS;
+
 	ctx->pos = pos;
 	rc = ll_dir_read(inode, &pos, op_data, ctx, &partial_readdir_rc);
 	pos = ctx->pos;
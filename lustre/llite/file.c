@@ -62,6 +62,8 @@ ll_put_grouplock(struct inode *inode, struct file *file, unsigned long arg);
 static int ll_lease_close(struct obd_client_handle *och, struct inode *inode,
 			  bool *lease_broken);
 
+static void ll_mirror_write_fini(struct inode *inode, struct file *file);
+
 static struct ll_file_data *ll_file_data_get(void)
 {
 	struct ll_file_data *lfd;
@@ -343,6 +345,9 @@ static int ll_md_close(struct inode *inode, struct file *file)
 	if (unlikely(lfd->lfd_file_flags & LL_FILE_GROUP_LOCKED))
 		ll_put_grouplock(inode, file, lfd->fd_grouplock.lg_gid);
 
+	if (lfd->fd_mirror_write != NULL)
+		ll_mirror_write_fini(inode, file);
+
 	mutex_lock(&lli->lli_och_mutex);
 	if (lfd->fd_lease_och != NULL) {
 		bool lease_broken;
@@ -986,7 +991,7 @@ static int ll_local_open(struct file *file, struct lookup_intent *it,
 	}
 
 	file->private_data = lfd;
-	ll_readahead_init(inode, &lfd->fd_ras);
+	ll_readahead_init(inode, lfd);
 	lfd->fd_open_mode = it->it_open_flags & (MDS_FMODE_READ |
 						 MDS_FMODE_WRITE |
 						 MDS_FMODE_EXEC);
@@ -1262,6 +1267,14 @@ restart:
 	if (!S_ISREG(inode->i_mode))
 		GOTO(out_och_free, rc);
 	cl_lov_delay_create_clear(&file->f_flags);
+
+	/* let statahead know if the files it stats are also read */
+	if (file->f_mode & FMODE_READ) {
+		struct dentry *parent = dget_parent(file_dentry(file));
+
+		ll_statahead_open(parent->d_inode);
+		dput(parent);
+	}
 	GOTO(out_och_free, rc);
 
 out_och_free:
@@ -1640,12 +1653,11 @@ static int ll_lease_close(struct obd_client_handle *och, struct inode *inode,
 }
 
 /* After lease is taken, send the RPC MDS_REINT_RESYNC to the MDT */
-static int ll_lease_file_resync(struct obd_client_handle *och,
-				struct inode *inode, void __user *uarg)
+static int __ll_lease_file_resync(struct obd_client_handle *och,
+				  struct inode *inode, __u16 mirror_id)
 {
 	struct ll_sb_info *sbi = ll_i2sbi(inode);
 	struct md_op_data *op_data;
-	struct ll_ioc_lease_id ioc;
 	__u64 data_version_unused;
 	int rc;
 
@@ -1655,9 +1667,6 @@ static int ll_lease_file_resync(struct obd_client_handle *och,
 	if (IS_ERR(op_data))
 		RETURN(PTR_ERR(op_data));
 
-	if (copy_from_user(&ioc, uarg, sizeof(ioc)))
-		RETURN(-EFAULT);
-
 	/* before starting file resync, it's necessary to clean up page cache
 	 * in client memory, otherwise once the layout version is increased,
 	 * writing back cached data will be denied the OSTs.
@@ -1667,7 +1676,7 @@ static int ll_lease_file_resync(struct obd_client_handle *och,
 		GOTO(out, rc);
 
 	op_data->op_lease_handle = och->och_lease_handle;
-	op_data->op_mirror_id = ioc.lil_mirror_id;
+	op_data->op_mirror_id = mirror_id;
 	rc = md_file_resync(sbi->ll_md_exp, op_data);
 	if (rc)
 		GOTO(out, rc);
@@ -1678,6 +1687,17 @@ out:
 	return rc;
 }
 
+static int ll_lease_file_resync(struct obd_client_handle *och,
+				struct inode *inode, void __user *uarg)
+{
+	struct ll_ioc_lease_id ioc;
+
+	if (copy_from_user(&ioc, uarg, sizeof(ioc)))
+		return -EFAULT;
+
+	return __ll_lease_file_resync(och, inode, ioc.lil_mirror_id);
+}
+
 static int ll_merge_attr_nolock(const struct lu_env *env, struct inode *inode)
 {
 	struct ll_inode_info *lli = ll_i2info(inode);
@@ -1919,6 +1939,10 @@ void ll_io_init(struct cl_io *io, struct file *file, enum cl_io_type iot,
 		io->ci_hybrid_switched = args->via_hybrid_switched;
 
 	ll_io_set_mirror(io, file);
+	if (args && args->via_mirror_id) {
+		io->ci_designated_mirror = args->via_mirror_id;
+		io->ci_layout_version = args->via_layout_version;
+	}
 }
 
 static void ll_heat_add(struct inode *inode, enum cl_io_type iot,
@@ -2487,6 +2511,7 @@ static ssize_t do_file_read_iter(struct kiocb *iocb, struct iov_iter *to)
 	args = ll_env_args(env);
 	args->u.normal.via_iter = to;
 	args->u.normal.via_iocb = iocb;
+	args->via_mirror_id = 0;
 
 	if (ll_hybrid_bio_dio_switch_check(file, iocb, to, CIT_READ,
 					   iov_iter_count(to)) ||
@@ -2590,15 +2615,512 @@ static ssize_t ll_do_tiny_write(struct kiocb *iocb, struct iov_iter *iter)
 	RETURN(result);
 }
 
+static bool ll_mirror_id_in(const struct cl_layout *cl, u16 id)
+{
+	int i;
+
+	for (i = 0; i < cl->cl_mirror_count; i++)
+		if (cl->cl_mirror_ids[i] == id)
+			return true;
+
+	return false;
+}
+
+/**
+ * ll_mirror_write_staged() - Get the layout of a file staged for resync
+ * @env: execution environment
+ * @inode: file being written
+ * @insync: layout of the file before staging, only components of its in-sync
+ *	    mirrors are returned in *@iocp
+ * @cl: layout of the file, cl_mirror_ids are the mirrors still in sync [out]
+ * @iocp: stale component IDs to pass to MDS_CLOSE_RESYNC_DONE [out]
+ * @ioc_size: allocated size of *@iocp [out]
+ *
+ * Return: 0 on success or negative errno
+ */
+static int ll_mirror_write_staged(const struct lu_env *env,
+				  struct inode *inode,
+				  const struct cl_layout *insync,
+				  struct cl_layout *cl,
+				  struct ll_ioc_lease **iocp, size_t *ioc_size)
+{
+	struct cl_object *obj = ll_i2info(inode)->lli_clob;
+	struct lov_comp_md_v1 *lcm;
+	struct ll_ioc_lease *ioc;
+	int count;
+	int rc;
+	int i;
+
+	ENTRY;
+	rc = cl_object_layout_get(env, obj, cl);
+	if (rc < 0)
+		RETURN(rc);
+
+	if (cl->cl_flr_state != LCM_FL_SYNC_PENDING || cl->cl_size == 0)
+		RETURN(-EAGAIN);
+
+	OBD_ALLOC_LARGE(cl->cl_buf.lb_buf, cl->cl_size);
+	if (cl->cl_buf.lb_buf == NULL)
+		RETURN(-ENOMEM);
+	cl->cl_buf.lb_len = cl->cl_size;
+
+	rc = cl_object_layout_get(env, obj, cl);
+	if (rc < 0)
+		GOTO(out, rc);
+
+	lcm = cl->cl_buf.lb_buf;
+	count = le16_to_cpu(lcm->lcm_entry_count);
+	*ioc_size = offsetof(struct ll_ioc_lease, lil_ids[count]);
+	OBD_ALLOC(ioc, *ioc_size);
+	if (ioc == NULL)
+		GOTO(out, rc = -ENOMEM);
+
+	for (i = 0; i < count; i++) {
+		struct lov_comp_md_entry_v1 *lcme = &lcm->lcm_entries[i];
+		u32 id = le32_to_cpu(lcme->lcme_id);
+
+		if ((le32_to_cpu(lcme->lcme_flags) & LCME_FL_STALE) &&
+		    ll_mirror_id_in(insync, mirror_id_of(id)))
+			ioc->lil_ids[ioc->lil_count++] = id;
+	}
+	ioc->lil_mode = LL_LEASE_UNLCK;
+	ioc->lil_flags = LL_LEASE_RESYNC_DONE;
+	*iocp = ioc;
+	rc = 0;
+	EXIT;
+out:
+	OBD_FREE_LARGE(cl->cl_buf.lb_buf, cl->cl_buf.lb_len);
+	cl->cl_buf.lb_buf = NULL;
+	cl->cl_buf.lb_len = 0;
+	return rc;
+}
+
+/* a mirror write session is usable while nobody else opened or wrote the
+ * file, called with lmw_sem held
+ */
+static bool ll_mirror_write_valid(struct inode *inode,
+				  struct ll_mirror_write *lmw)
+{
+	struct ldlm_lock *lock;
+	bool broken = true;
+	__u32 gen;
+
+	if (lmw->lmw_och == NULL || lmw->lmw_failed)
+		return false;
+
+	lock = ldlm_handle2lock(&lmw->lmw_och->och_lease_handle);
+	if (lock != NULL) {
+		lock_res_and_lock(lock);
+		broken = ldlm_is_cancel(lock);
+		unlock_res_and_lock(lock);
+		ldlm_lock_put(lock);
+	}
+	if (broken)
+		return false;
+
+	/* a write which does not designate a mirror (mmap, O_APPEND) sends
+	 * its own write intent, which changes the layout version
+	 */
+	return ll_layout_refresh(inode, &gen) == 0 &&
+	       gen == lmw->lmw_layout_gen;
+}
+
+/**
+ * ll_mirror_write_start() - Stage a file for writes to all of its mirrors
+ * @env: execution environment
+ * @inode: file being written
+ * @file: file descriptor the session belongs to
+ * @lmw: mirror write session, lmw_sem held for write
+ *
+ * Return: 0 on success, lmw->lmw_och is NULL if the file cannot be written
+ * this way, or negative errno
+ */
+static int ll_mirror_write_start(const struct lu_env *env,
+				 struct inode *inode, struct file *file,
+				 struct ll_mirror_write *lmw)
+{
+	struct ll_file_data *lfd = file->private_data;
+	struct cl_layout cl = { .cl_is_composite = false };
+	struct cl_layout staged = { .cl_is_composite = false };
+	struct lu_extent ext = { .e_start = 0, .e_end = LUSTRE_EOF };
+	struct obd_client_handle *och;
+	__u32 gen;
+	int rc;
+	int i;
+
+	ENTRY;
+	rc = ll_layout_refresh(inode, &gen);
+	if (rc)
+		RETURN(rc);
+
+	rc = cl_object_layout_get(env, ll_i2info(inode)->lli_clob, &cl);
+	if (rc < 0)
+		RETURN(rc);
+
+	if (cl.cl_flr_state != LCM_FL_RDONLY || cl.cl_mirror_count < 2)
+		RETURN(0);
+
+	/* fails if the file is open by anyone else */
+	lmw->lmw_had_fd_och = lfd->fd_och != NULL;
+	och = ll_lease_open(inode, file, FMODE_WRITE, 0);
+	if (IS_ERR(och)) {
+		rc = PTR_ERR(och);
+		CDEBUG(D_LAYOUT, DFID": no lease for mirror write: rc = %d\n",
+		       PFID(ll_inode2fid(inode)), rc);
+		/* give back the open handle ll_lease_open() may have taken */
+		if (!lmw->lmw_had_fd_och && lfd->fd_och != NULL)
+			ll_lease_och_release(inode, file);
+		lmw->lmw_no_lease = true;
+		RETURN(rc);
+	}
+
+	/* the whole file, so that later writes need no intent of their own */
+	rc = ll_layout_write_intent(inode, LAYOUT_INTENT_WRITE, &ext);
+	if (rc)
+		GOTO(out_lease, rc);
+
+	rc = __ll_lease_file_resync(och, inode, 0);
+	if (rc)
+		GOTO(out_lease, rc);
+
+	rc = ll_layout_refresh(inode, &gen);
+	if (rc)
+		GOTO(out_lease, rc);
+
+	rc = ll_mirror_write_staged(env, inode, &cl, &staged, &lmw->lmw_ioc,
+				    &lmw->lmw_ioc_size);
+	if (rc)
+		GOTO(out_lease, rc);
+
+	/* the mirror left in sync by the write intent (the primary) first */
+	lmw->lmw_nids = 0;
+	for (i = 0; i < staged.cl_mirror_count; i++)
+		lmw->lmw_ids[lmw->lmw_nids++] = staged.cl_mirror_ids[i];
+	for (i = 0; i < cl.cl_mirror_count; i++)
+		if (!ll_mirror_id_in(&staged, cl.cl_mirror_ids[i]))
+			lmw->lmw_ids[lmw->lmw_nids++] = cl.cl_mirror_ids[i];
+
+	lmw->lmw_och = och;
+	lmw->lmw_layout_gen = gen;
+	lmw->lmw_failed = false;
+	RETURN(0);
+
+out_lease:
+	CDEBUG(D_LAYOUT, DFID": cannot stage mirror write: rc = %d\n",
+	       PFID(ll_inode2fid(inode)), rc);
+	ll_lease_close(och, inode, NULL);
+	if (!lmw->lmw_had_fd_och)
+		ll_lease_och_release(inode, file);
+	RETURN(rc);
+}
+
+/**
+ * ll_mirror_write_end() - End a mirror write session
+ * @inode: file being written
+ * @file: file descriptor the session belongs to
+ * @lmw: mirror write session, lmw_sem held for write
+ *
+ * Clears the stale flags of the mirrors with MDS_CLOSE_RESYNC_DONE if every
+ * write of the session reached all of them, otherwise they stay stale until
+ * "lfs mirror resync".
+ *
+ * Return: 0 on success or negative errno
+ */
+static int ll_mirror_write_end(struct inode *inode, struct file *file,
+			       struct ll_mirror_write *lmw)
+{
+	bool lease_broken = true;
+	__u32 gen;
+	int rc = 0;
+
+	ENTRY;
+	if (lmw->lmw_och == NULL)
+		RETURN(0);
+
+	/* cached writes to the primary must reach the OSTs before the other
+	 * mirrors are declared in sync with it
+	 */
+	if (!lmw->lmw_failed) {
+		rc = cl_sync_file_range(inode, 0, OBD_OBJECT_EOF,
+					CL_FSYNC_LOCAL, 0, IO_PRIO_NORMAL);
+		if (rc >= 0)
+			rc = ll_layout_refresh(inode, &gen);
+		if (rc == 0 && gen != lmw->lmw_layout_gen)
+			rc = -ESTALE;
+		if (rc < 0)
+			lmw->lmw_failed = true;
+	}
+
+	if (!lmw->lmw_failed) {
+		rc = ll_lease_close_intent(lmw->lmw_och, inode, &lease_broken,
+					   MDS_CLOSE_RESYNC_DONE, lmw->lmw_ioc);
+	} else {
+		CDEBUG(D_LAYOUT, DFID": mirror write failed, mirrors stay stale: rc = %d\n",
+		       PFID(ll_inode2fid(inode)), rc);
+		rc = ll_lease_close(lmw->lmw_och, inode, NULL);
+	}
+	if (lease_broken)
+		ll_stats_ops_tally(ll_i2sbi(inode),
+				   LPROC_LL_MIRROR_WRITE_FALLBACK, 1);
+	lmw->lmw_och = NULL;
+
+	if (!lmw->lmw_had_fd_och)
+		ll_lease_och_release(inode, file);
+	OBD_FREE(lmw->lmw_ioc, lmw->lmw_ioc_size);
+	lmw->lmw_ioc = NULL;
+	lmw->lmw_failed = false;
+
+	RETURN(rc);
+}
+
+/* called from ll_md_close(), when no write can use the session any more */
+static void ll_mirror_write_fini(struct inode *inode, struct file *file)
+{
+	struct ll_file_data *lfd = file->private_data;
+	struct ll_mirror_write *lmw = lfd->fd_mirror_write;
+
+	lfd->fd_mirror_write = NULL;
+	ll_mirror_write_end(inode, file, lmw);
+	OBD_FREE_PTR(lmw);
+}
+
+/* one of the other mirrors of a mirror write, see ll_mirror_write_fanout() */
+struct ll_mirror_write_io {
+	struct kiocb		 lmwi_iocb;
+	struct iov_iter		 lmwi_iter;
+	struct vvp_io_args	 lmwi_args;
+	ssize_t			 lmwi_result;
+	atomic_t		*lmwi_pending;
+	struct completion	*lmwi_done;
+};
+
+#ifdef HAVE_KIOCB_COMPLETE_2ARGS
+static void ll_mirror_write_complete(struct kiocb *iocb, long res)
+#else
+static void ll_mirror_write_complete(struct kiocb *iocb, long res, long res2)
+#endif
+{
+	struct ll_mirror_write_io *lmwi;
+
+	lmwi = container_of(iocb, struct ll_mirror_write_io, lmwi_iocb);
+	lmwi->lmwi_result = res;
+	if (atomic_dec_and_test(lmwi->lmwi_pending))
+		complete(lmwi->lmwi_done);
+}
+
+/**
+ * ll_mirror_write_fanout() - Write the same data to each mirror of a session
+ * @env: execution environment
+ * @args: I/O arguments set up for a normal write
+ * @file: file to write to
+ * @iocb: kiocb of the write
+ * @from: data to write
+ * @lmw: mirror write session, lmw_sem held for read
+ *
+ * The primary mirror is written as the caller asked, through the page cache
+ * for a buffered writer. The other mirrors cannot share the page cache with
+ * it, so they are written with direct I/O from the caller's buffer. For an
+ * aligned write they are submitted as AIO before the primary is written, so
+ * that all mirrors are written in parallel. Unaligned AIO is not supported
+ * (see ll_direct_IO()), so they are written one after the other otherwise.
+ *
+ * Return: bytes written to the primary mirror or negative errno
+ */
+static ssize_t ll_mirror_write_fanout(const struct lu_env *env,
+				      struct vvp_io_args *args,
+				      struct file *file, struct kiocb *iocb,
+				      struct iov_iter *from,
+				      struct ll_mirror_write *lmw)
+{
+	struct inode *inode = file_inode(file);
+	struct ll_mirror_write_io *lmwi;
+	size_t count = iov_iter_count(from);
+	loff_t pos = iocb->ki_pos;
+	struct completion done;
+	atomic_t pending;
+	int nsec = lmw->lmw_nids - 1;
+	ssize_t result;
+	bool async;
+	int i;
+
+	ENTRY;
+	async = !(pos & ~PAGE_MASK) && !ll_iov_iter_is_unaligned(from);
+
+	OBD_ALLOC_PTR_ARRAY(lmwi, nsec);
+	if (lmwi == NULL)
+		RETURN(-ENOMEM);
+
+	init_completion(&done);
+	atomic_set(&pending, 1);
+	for (i = 0; i < nsec; i++) {
+		struct ll_mirror_write_io *io = &lmwi[i];
+
+		io->lmwi_iter = *from;
+		init_sync_kiocb(&io->lmwi_iocb, file);
+#ifdef IOCB_DIRECT
+		io->lmwi_iocb.ki_flags |= IOCB_DIRECT;
+#endif
+		io->lmwi_iocb.ki_pos = pos;
+		io->lmwi_args.u.normal.via_iocb = &io->lmwi_iocb;
+		io->lmwi_args.u.normal.via_iter = &io->lmwi_iter;
+		io->lmwi_args.via_mirror_id = lmw->lmw_ids[i + 1];
+		io->lmwi_args.via_layout_version = lmw->lmw_layout_gen;
+		if (!async)
+			continue;
+
+		io->lmwi_iocb.ki_complete = ll_mirror_write_complete;
+		io->lmwi_pending = &pending;
+		io->lmwi_done = &done;
+		atomic_inc(&pending);
+		result = ll_file_io_generic(env, &io->lmwi_args, file,
+					    CIT_WRITE, &io->lmwi_iocb.ki_pos,
+					    count);
+		/* queued AIO returns 0, ll_mirror_write_complete() gets the
+		 * result
+		 */
+		if (result != 0) {
+			io->lmwi_result = result;
+			atomic_dec(&pending);
+		}
+	}
+
+	args->via_mirror_id = lmw->lmw_ids[0];
+	args->via_layout_version = lmw->lmw_layout_gen;
+	result = ll_file_io_generic(env, args, file, CIT_WRITE,
+				    &iocb->ki_pos, count);
+	args->via_mirror_id = 0;
+	if (result != count)
+		lmw->lmw_failed = true;
+
+	for (i = 0; i < nsec && !async; i++)
+		lmwi[i].lmwi_result = ll_file_io_generic(env,
+					&lmwi[i].lmwi_args, file, CIT_WRITE,
+					&lmwi[i].lmwi_iocb.ki_pos, count);
+
+	if (!atomic_dec_and_test(&pending))
+		wait_for_completion(&done);
+
+	for (i = 0; i < nsec; i++) {
+		if (lmwi[i].lmwi_result == count)
+			continue;
+
+		CDEBUG(D_LAYOUT, DFID": write to mirror %u failed: rc = %zd\n",
+		       PFID(ll_inode2fid(inode)), lmw->lmw_ids[i + 1],
+		       lmwi[i].lmwi_result);
+		lmw->lmw_failed = true;
+	}
+	OBD_FREE_PTR_ARRAY(lmwi, nsec);
+
+	RETURN(result);
+}
+
+/**
+ * ll_file_mirror_write() - Write to every in-sync mirror of a file
+ * @env: execution environment
+ * @args: I/O arguments set up for a normal write
+ * @file: file to write to
+ * @iocb: kiocb of the write
+ * @from: data to write
+ *
+ * With llite.*.mirror_write_sync set, a write to a mirrored file in the
+ * LCM_FL_RDONLY state is sent to each of its mirrors instead of making the
+ * other mirrors stale until "lfs mirror resync". The first such write on a
+ * file descriptor stages the file as "lfs mirror resync" does, so that the
+ * mirrors never claim to be in sync while they differ:
+ *
+ * - take a write lease on the file, so that an open by anyone else breaks it
+ * - send a write intent for the whole file, which picks a primary mirror and
+ *   makes the others stale (LCM_FL_WRITE_PENDING)
+ * - send a resync intent (LCM_FL_SYNC_PENDING)
+ *
+ * This and later writes on the descriptor are then written to every mirror
+ * by ll_mirror_write_fanout() without any MDT RPC. When the descriptor is
+ * closed, the lease is released with MDS_CLOSE_RESYNC_DONE, which clears the
+ * stale flags and returns the file to LCM_FL_RDONLY.
+ *
+ * If the client dies, a mirror write fails, the lease is broken by another
+ * opener or the file is written without designating a mirror, the lease is
+ * released without the resync, and the other mirrors stay stale as after a
+ * normal write.
+ *
+ * Return: bytes written or negative errno, or 0 if the write was not done
+ * and must be done the normal way
+ */
+static ssize_t ll_file_mirror_write(const struct lu_env *env,
+				    struct vvp_io_args *args,
+				    struct file *file, struct kiocb *iocb,
+				    struct iov_iter *from)
+{
+	struct inode *inode = file_inode(file);
+	struct ll_inode_info *lli = ll_i2info(inode);
+	struct ll_file_data *lfd = file->private_data;
+	struct ll_mirror_write *lmw;
+	ssize_t result = 0;
+	bool failed;
+	int rc = 0;
+
+	ENTRY;
+	mutex_lock(&lli->lli_och_mutex);
+	lmw = lfd->fd_mirror_write;
+	if (lmw == NULL) {
+		OBD_ALLOC_PTR(lmw);
+		if (lmw != NULL) {
+			init_rwsem(&lmw->lmw_sem);
+			lfd->fd_mirror_write = lmw;
+		}
+	}
+	mutex_unlock(&lli->lli_och_mutex);
+	if (lmw == NULL || lmw->lmw_no_lease)
+		GOTO(out_stats, result = 0);
+
+	down_read(&lmw->lmw_sem);
+	if (!ll_mirror_write_valid(inode, lmw)) {
+		up_read(&lmw->lmw_sem);
+		down_write(&lmw->lmw_sem);
+		if (!ll_mirror_write_valid(inode, lmw)) {
+			ll_mirror_write_end(inode, file, lmw);
+			rc = ll_mirror_write_start(env, inode, file, lmw);
+		}
+		downgrade_write(&lmw->lmw_sem);
+	}
+	if (lmw->lmw_och == NULL) {
+		up_read(&lmw->lmw_sem);
+		/* not a mirrored file in sync, or a normal write ended the
+		 * session
+		 */
+		if (rc == 0)
+			RETURN(0);
+		GOTO(out_stats, result = 0);
+	}
+
+	result = ll_mirror_write_fanout(env, args, file, iocb, from, lmw);
+	failed = lmw->lmw_failed;
+	up_read(&lmw->lmw_sem);
+
+	/* a failed write to the primary is redone the normal way */
+	if (result < 0)
+		result = 0;
+	if (result > 0 && !failed) {
+		ll_stats_ops_tally(ll_i2sbi(inode), LPROC_LL_MIRROR_WRITE, 1);
+		RETURN(result);
+	}
+out_stats:
+	ll_stats_ops_tally(ll_i2sbi(inode), LPROC_LL_MIRROR_WRITE_FALLBACK, 1);
+
+	RETURN(result);
+}
+
 /* Write to a file (through the page cache).*/
 static ssize_t do_file_write_iter(struct kiocb *iocb, struct iov_iter *from)
 {
 	struct file *file = iocb->ki_filp;
+	struct ll_file_data *lfd = file->private_data;
 	struct vvp_io_args *args;
 	struct lu_env *env;
 	int flags = iocb_ki_flags_get(file, iocb);
 	ktime_t kstart = ktime_get();
 	bool hybrid_switched = false;
+	bool mirror_write = false;
 	ssize_t rc_tiny = 0;
 	ssize_t rc_normal;
 	__u16 refcheck;
@@ -2638,13 +3160,20 @@ static ssize_t do_file_write_iter(struct kiocb *iocb, struct iov_iter *from)
 #endif
 	}
 
+#ifdef IOCB_DIRECT
+	/* FLR: appends would land at a different offset in each mirror */
+	if (ll_i2sbi(file_inode(file))->ll_mirror_write_sync &&
+	    !(flags & ki_flag(APPEND)) && !lfd->fd_designated_mirror)
+		mirror_write = true;
+#endif
+
 	/* NB: we can't do direct IO for tiny writes because they use the page
 	 * cache, we can't do sync writes because tiny writes can't flush
 	 * pages, and we can't do append writes because we can't guarantee the
 	 * required DLM locks are held to protect file size.
 	 */
 	if (ll_sbi_has_tiny_write(ll_i2sbi(file_inode(file))) &&
-	    !(flags &
+	    !mirror_write && !(flags &
 	      (ki_flag(DIRECT) | ki_flag(DSYNC) | ki_flag(SYNC) |
 	       ki_flag(APPEND))))
 		rc_tiny = ll_do_tiny_write(iocb, from);
@@ -2663,9 +3192,15 @@ static ssize_t do_file_write_iter(struct kiocb *iocb, struct iov_iter *from)
 	args->u.normal.via_iter = from;
 	args->u.normal.via_iocb = iocb;
 	args->via_hybrid_switched = hybrid_switched;
+	args->via_mirror_id = 0;
 
-	rc_normal = ll_file_io_generic(env, args, file, CIT_WRITE,
-				       &iocb->ki_pos, iov_iter_count(from));
+	rc_normal = 0;
+	if (mirror_write)
+		rc_normal = ll_file_mirror_write(env, args, file, iocb, from);
+	if (rc_normal == 0)
+		rc_normal = ll_file_io_generic(env, args, file, CIT_WRITE,
+					       &iocb->ki_pos,
+					       iov_iter_count(from));
 
 	/* On success, combine bytes written. */
 	if (rc_tiny >= 0 && rc_normal > 0)
@@ -5303,6 +5838,12 @@ int ll_fsync(struct file *file, loff_t start, loff_t end, int datasync)
 	       "VFS Op:inode="DFID"(%p), start %lld, end %lld, datasync %d\n",
 	       PFID(ll_inode2fid(inode)), inode, start, end, datasync);
 
+	/* write back cached creates first, a failure is recorded in the
+	 * mapping of the parent directory and reported below
+	 */
+	if (S_ISDIR(inode->i_mode) || ll_wbc_pending(inode))
+		ll_wbc_flush(ll_i2sbi(inode));
+
 	/* fsync's caller has already called _fdata{sync,write}, we want
 	 * that IO to finish before calling the osc and mdc sync methods
 	 */
@@ -6120,6 +6661,10 @@ static int ll_inode_revalidate(struct dentry *dentry, enum ldlm_intent_flags op)
 	CDEBUG(D_VFSTRACE, "VFS Op:inode="DFID"(%p),name="DNAME"\n",
 	       PFID(ll_inode2fid(inode)), inode, encode_fn_dentry(dentry));
 
+	/* only this client knows the inode, its attributes are current */
+	if (ll_wbc_pending(inode))
+		RETURN(0);
+
 	/* Call getattr by fid */
 	if ((exp_connect_flags2(exp) & OBD_CONNECT2_GETATTR_PFID) &&
 		!d_lustre_invalid(dentry)) {
@@ -6241,10 +6786,25 @@ int ll_getattr_dentry(struct dentry *de, struct kstat *stat, u32 request_mask,
 	if (flags & AT_STATX_DONT_SYNC)
 		GOTO(fill_attr, rc = 0);
 
+	/* Attributes came with the readdir page and nothing revalidated them
+	 * since. They are trusted for llite.*.readdir_plus_ms, so changes by
+	 * other clients may not be seen for that long. Once the inode has an
+	 * UPDATE lock, revalidating is local and always done instead.
+	 */
+	if (d_lustre_readdir_plus(de)) {
+		enum mds_ibits_locks bits = MDS_INODELOCK_UPDATE;
+
+		if (!ll_have_md_lock(ll_i2mdexp(inode), inode, &bits,
+				     LCK_MODE_MIN, 0))
+			GOTO(check_size, rc = 0);
+	}
+
 	rc = ll_inode_revalidate(de, IT_GETATTR);
 	if (rc < 0)
 		RETURN(rc);
 
+check_size:
+
 	/* foreign file/dir are always of zero length, so don't
 	 * need to validate size.
 	 */
@@ -52,6 +52,8 @@
 struct ll_dentry_data {
 	unsigned int			lld_sa_generation;
 	unsigned int			lld_invalid:1;
+	/* jiffies until which a dentry from readdir is valid without lock */
+	unsigned long			lld_rdplus_expire;
 	struct rcu_head			lld_rcu_head;
 };
 
@@ -63,8 +65,10 @@ static inline void set_lld_invalid(struct dentry *de, int flag)
 
 	rcu_read_lock();
 	lld = ll_d2d(de);
-	if (lld)
+	if (lld) {
 		lld->lld_invalid = flag;
+		lld->lld_rdplus_expire = 0;
+	}
 	rcu_read_unlock();
 }
 
@@ -229,6 +233,10 @@ struct ll_inode_info {
 			struct lmv_stripe_object	*lli_lsm_obj;
 			/* directory default LMV */
 			struct lmv_stripe_object	*lli_def_lsm_obj;
+			/* creates cached in this directory not yet written
+			 * back to the MDT, see llite/wbc.c
+			 */
+			atomic_t			lli_wbc_children;
 		};
 
 		/* for non-directory */
@@ -326,6 +334,7 @@ struct ll_inode_info {
 	struct rw_semaphore		lli_xattrs_list_rwsem;
 	struct mutex			lli_xattrs_enq_lock;
 	struct list_head		lli_xattrs; /* ll_xattr_entry->xe_list*/
+	struct hlist_head		*lli_xattrs_hash; /* ->xe_hash */
 	struct list_head		lli_lccs; /* list of ll_cl_context */
 	seqlock_t			lli_page_inv_lock;
 };
@@ -509,6 +518,22 @@ enum ll_file_internal_flags {
 	/* 6 is not used for now */
 	/* Xattr cache is filled */
 	LLIF_XATTR_CACHE_FILLED	= 7,
+	/* inode was created in the metadata writeback cache and does not
+	 * exist on the MDT yet
+	 */
+	LLIF_WBC_PENDING	= 8,
+	/* creates in this directory may be cached while the client holds
+	 * an EX lock on it, or the directory itself is pending
+	 */
+	LLIF_WBC_DIR		= 9,
+	/* Xattr cache holds xattrs piggybacked by the MDT on getattr */
+	LLIF_XATTR_CACHE_PREFETCH	= 10,
+	/* prefetched xattrs were not used yet, see getxattr_saved stat */
+	LLIF_XATTR_CACHE_PREFETCH_NEW	= 11,
+	/* creates cached under the revoked EX lock are being written back
+	 * before the lock is released, see ll_wbc_revoke()
+	 */
+	LLIF_WBC_REVOKE		= 12,
 	/* New flags added to this enum potentially need to be handled in
 	 * ll_inode2ext_flags/ll_set_inode_flags
 	 */
@@ -528,6 +553,8 @@ int ll_xattr_cache_insert(struct inode *inode,
 			  char *buffer,
 			  size_t size);
 
+int ll_xattr_cache_prefetch(struct inode *inode, struct req_capsule *pill);
+
 static inline bool obd_connect_has_secctx(struct obd_connect_data *data)
 {
 #ifdef CONFIG_SECURITY
@@ -677,6 +704,9 @@ static inline struct pcc_inode *ll_i2pcci(struct inode *inode)
 /* Min range pages */
 #define RA_MIN_MMAP_RANGE_PAGES			16UL
 
+/* max number of concurrent read streams tracked per open file */
+#define LL_RA_STREAMS_MAX			4
+
 enum ra_stat {
 	RA_STAT_HIT = 0,
 	RA_STAT_MISS,
@@ -696,7 +726,12 @@ enum ra_stat {
 	RA_STAT_MMAP_RANGE_READ,
 	RA_STAT_READAHEAD_PAGES,
 	RA_STAT_FORCEREAD_PAGES,
-	_NR_RA_STAT,
+	RA_STAT_PREFETCH_PAGES,
+	RA_STAT_STREAM_NEW,
+	/* per-stream hits and misses, LL_RA_STREAMS_MAX entries each */
+	RA_STAT_STREAM_HIT,
+	RA_STAT_STREAM_MISS = RA_STAT_STREAM_HIT + LL_RA_STREAMS_MAX,
+	_NR_RA_STAT = RA_STAT_STREAM_MISS + LL_RA_STREAMS_MAX,
 };
 
 struct ll_ra_info {
@@ -715,6 +750,8 @@ struct ll_ra_info {
 	atomic_t ra_async_inflight;
 	/* Threshold to control when to trigger async readahead */
 	unsigned long ra_async_pages_per_file_threshold;
+	/* number of read streams tracked per open file, see ll_ras_select() */
+	unsigned int ra_streams;
 };
 
 /* ra_io_arg will be filled in the beginning of ll_readahead with
@@ -814,6 +851,7 @@ enum ll_sbi_flags {
 	LL_SBI_LAYOUT_LOCK,		/* layout lock support */
 	LL_SBI_NOROOTSQUASH,		/* do not apply root squash */
 	LL_SBI_PARALLEL_DIO,		/* parallel (async) O_DIRECT RPCs */
+	LL_SBI_STRIDE_LOCK,		/* send IO stride with extent locks */
 	LL_SBI_TINY_WRITE,		/* tiny write support */
 	LL_SBI_UNALIGNED_DIO,		/* unaligned DIO */
 	LL_SBI_XATTR_CACHE,		/* support for xattr cache */
@@ -837,6 +875,9 @@ struct lustre_client_ocd {
 	struct obd_export	*lco_dt_exp;
 };
 
+/* creates written back at once, the MDC queues what it cannot send */
+#define LL_WBC_FLUSH_RPCS		(8)
+
 struct ll_sb_info {
 	/* this protects pglist and ra_info.  It isn't safe to
 	 * grab from interrupt contexts
@@ -863,7 +904,9 @@ struct ll_sb_info {
 				 ll_enable_statahead_fname:1,
 				 ll_inode_cache_enabled:1,
 				 ll_intent_mkdir_enabled:1,
+				 ll_mirror_write_sync:1,
 				 ll_sync_on_close:1,
+				 ll_wbc_enabled:1,
 				 ll_xattr_cache_enabled:1,
 				 ll_xattr_cache_set:1; /* already set to 0/1 */
 
@@ -916,6 +959,8 @@ struct ll_sb_info {
 	atomic_t		  ll_sa_list_total;
 	/* statahead thread count started for regularized file name pattern. */
 	atomic_t		  ll_sa_fname_total;
+	/* statahead thread count run per stripe of a striped directory */
+	atomic_t		  ll_sa_striped_total;
 	/*
 	 * stop the statahead thread if it is not doing a stat() in such time
 	 * period as it probably does not care too much about performance or
@@ -924,6 +969,8 @@ struct ll_sb_info {
 	unsigned long		  ll_sa_timeout;
 	unsigned int		  ll_sa_fname_predict_hit;
 	unsigned int		  ll_sa_fname_match_hit;
+	/* bytes of file data prefetched by AGL during directory sweeps */
+	unsigned long		  ll_sa_data_max;
 	/* save s_dev before assign for clustred nfs */
 	dev_t			  ll_sdev_orig;
 	/* root squash */
@@ -954,6 +1001,31 @@ struct ll_sb_info {
 	/* Time in ms after last file close we no longer count prior opens*/
 	u32			  ll_oc_max_ms;
 
+	/* Time in ms attributes from readdir pages are trusted, 0 disables */
+	u32			  ll_readdir_plus_ms;
+
+	/* metadata writeback cache, creates not yet sent to the MDT */
+	spinlock_t		  ll_wbc_lock;
+	struct list_head	  ll_wbc_list;	/* in creation order */
+	unsigned int		  ll_wbc_count;	/* entries on ll_wbc_list */
+	unsigned int		  ll_wbc_max;	/* max cached creates */
+	unsigned int		  ll_wbc_delay_ms; /* flush delay */
+	struct delayed_work	  ll_wbc_work;
+	struct mutex		  ll_wbc_mutex;	/* serializes flushes */
+	/* holder of ll_wbc_mutex, then the threads helping it */
+	struct task_struct	 *ll_wbc_flushers[LL_WBC_FLUSH_RPCS];
+	atomic_t		  ll_wbc_revoking; /* ll_wbc_revoke() works */
+	/* creates of one owner known to fit, see ll_wbc_reserve() */
+	struct mutex		  ll_wbc_budget_mutex;
+	time64_t		  ll_wbc_budget_time;
+	__u64			  ll_wbc_budget;
+	__u32			  ll_wbc_budget_uid;
+	__u32			  ll_wbc_budget_gid;
+	__u32			  ll_wbc_budget_projid;
+	atomic_t		  ll_wbc_cached;
+	atomic_t		  ll_wbc_flushed;
+	atomic_t		  ll_wbc_errors;
+
 	/* I/O size thresholds for switching from buffered I/O to direct I/O */
 	u32			  ll_hybrid_io_write_threshold_bytes;
 	u32			  ll_hybrid_io_read_threshold_bytes;
@@ -994,9 +1066,22 @@ struct ll_sb_info {
 #define SBI_DEFAULT_OPENCACHE_THRESHOLD_MS	(100) /* 0.1 second */
 #define SBI_DEFAULT_OPENCACHE_THRESHOLD_MAX_MS	(60000) /* 1 minute */
 
+#define SBI_DEFAULT_WBC_MAX		(1024)
+#define SBI_DEFAULT_WBC_DELAY_MS	(5000) /* 5 seconds */
+
 /* per file-descriptor read-ahead data. */
+/*
+ * Read-ahead state of one read stream. Each open file tracks up to
+ * LL_RA_STREAMS_MAX streams, so that readers interleaving several sequential
+ * or strided streams through one file descriptor do not keep resetting a
+ * single window, see ll_ras_select().
+ */
 struct ll_readahead_state {
 	spinlock_t	ras_lock;
+	/* index of this stream in ll_file_data::fd_ras */
+	unsigned int	ras_stream;
+	/* ll_file_data::fd_ras_tick of the last access, 0 if never used */
+	unsigned long	ras_stream_tick;
 	/* End byte that read(2) try to read.  */
 	loff_t		ras_last_read_end_bytes;
 	/*
@@ -1086,6 +1171,8 @@ struct ll_readahead_state {
 struct ll_readahead_work {
 	/** File to readahead */
 	struct file			*lrw_file;
+	/** Read stream of lrw_file that triggered the readahead */
+	struct ll_readahead_state	*lrw_ras;
 	pgoff_t				 lrw_start_idx;
 	pgoff_t				 lrw_end_idx;
 	pid_t				 lrw_user_pid;
@@ -1095,9 +1182,47 @@ struct ll_readahead_work {
 	struct job_info			 lrw_jobinfo;
 };
 
+/*
+ * Strided IO detection for extent lock requests, see vvp_io_lock_stride().
+ * Updated without locking, concurrent IO on the same file descriptor can only
+ * make the hint less accurate.
+ */
+struct ll_lock_stride {
+	loff_t				lls_last_pos;
+	size_t				lls_last_bytes;
+	/* distance between the starts of consecutive IOs */
+	__u64				lls_length;
+	/* number of consecutive IOs matching lls_length */
+	unsigned int			lls_hits;
+};
+
 extern struct kmem_cache *ll_file_data_slab;
 extern unsigned int llite_enable_flr_ec;
 struct lustre_handle;
+/* FLR: writes to every mirror of a file through one file descriptor, see
+ * ll_file_mirror_write()
+ */
+struct ll_mirror_write {
+	/* held shared by writes, exclusive to start or end the session */
+	struct rw_semaphore		 lmw_sem;
+	/* write lease of the session, NULL if there is none */
+	struct obd_client_handle	*lmw_och;
+	/* stale components to clear with MDS_CLOSE_RESYNC_DONE */
+	struct ll_ioc_lease		*lmw_ioc;
+	size_t				 lmw_ioc_size;
+	/* layout version the file was staged with */
+	__u32				 lmw_layout_gen;
+	/* mirrors to write, the primary first */
+	__u16				 lmw_ids[LUSTRE_MIRROR_COUNT_MAX];
+	int				 lmw_nids;
+	/* the fd had its own open handle before the lease was taken */
+	bool				 lmw_had_fd_och;
+	/* a mirror write failed, end the session without the resync */
+	bool				 lmw_failed;
+	/* the file is open by someone else, do not try again on this fd */
+	bool				 lmw_no_lease;
+};
+
 struct ll_file_data {
 	struct file			*fd_file;
 	__u64				lfd_pos;
@@ -1106,7 +1231,14 @@ struct ll_file_data {
 	 */
 	struct obd_client_handle	*fd_lease_och;
 	struct obd_client_handle	*fd_och;
-	struct ll_readahead_state	fd_ras;
+	struct ll_readahead_state	fd_ras[LL_RA_STREAMS_MAX];
+	/* stream used by the last read, see ll_ras_select() */
+	unsigned int			fd_ras_cur;
+	/* incremented for every access, to find the least recently used
+	 * stream
+	 */
+	unsigned long			fd_ras_tick;
+	struct ll_lock_stride		fd_lock_stride;
 	/* Indicate whether need to report failure when close.
 	 * true: failure is known, not report again.
 	 * false: unknown failure, should report.
@@ -1128,6 +1260,8 @@ struct ll_file_data {
 	 * layout version for verification to OST objects
 	 */
 	__u32				fd_layout_version;
+	/* mirror_write_sync session, allocated by the first write */
+	struct ll_mirror_write		*fd_mirror_write;
 	struct ll_grouplock		fd_grouplock;
 	struct pcc_file			fd_pcc_file;
 	/* mdtest unique/shared dir stat mode: per process statahead struct. */
@@ -1179,6 +1313,11 @@ static inline bool ll_sbi_has_fast_read(struct ll_sb_info *sbi)
 	return test_bit(LL_SBI_FAST_READ, sbi->ll_flags);
 }
 
+static inline bool ll_sbi_has_stride_lock(struct ll_sb_info *sbi)
+{
+	return test_bit(LL_SBI_STRIDE_LOCK, sbi->ll_flags);
+}
+
 static inline bool ll_sbi_has_tiny_write(struct ll_sb_info *sbi)
 {
 	return test_bit(LL_SBI_TINY_WRITE, sbi->ll_flags);
@@ -1204,6 +1343,16 @@ static inline bool ll_sbi_has_unaligned_dio(struct ll_sb_info *sbi)
 	return test_bit(LL_SBI_UNALIGNED_DIO, sbi->ll_flags);
 }
 
+/* upper limit of llite.*.readdir_plus_ms */
+#define LL_READDIR_PLUS_MAX_MS	60000
+
+static inline bool ll_readdir_plus_enabled(struct inode *dir)
+{
+	return ll_i2sbi(dir)->ll_readdir_plus_ms &&
+	       exp_connect_readdir_plus(ll_i2mdexp(dir)) &&
+	       !IS_ENCRYPTED(dir);
+}
+
 void ll_ras_enter(struct file *f, loff_t pos, size_t bytes);
 
 /* llite/lcommon_misc.c */
@@ -1232,6 +1381,9 @@ enum {
 	LPROC_LL_MMAP,
 	LPROC_LL_FAULT,
 	LPROC_LL_MKWRITE,
+	LPROC_LL_FAULT_FAST,
+	LPROC_LL_FAULT_SLOW,
+	LPROC_LL_MAP_PAGES,
 	LPROC_LL_LLSEEK,
 	LPROC_LL_FSYNC,
 	LPROC_LL_READDIR,
@@ -1251,9 +1403,11 @@ enum {
 	LPROC_LL_SETXATTR,
 	LPROC_LL_GETXATTR,
 	LPROC_LL_GETXATTR_HITS,
+	LPROC_LL_GETXATTR_SAVED,
 	LPROC_LL_LISTXATTR,
 	LPROC_LL_REMOVEXATTR,
 	LPROC_LL_INODE_PERM,
+	LPROC_LL_PATH_WALK,
 	LPROC_LL_FALLOCATE,
 	LPROC_LL_INODE_OCOUNT,
 	LPROC_LL_INODE_OPCLTM,
@@ -1265,6 +1419,8 @@ enum {
 	LPROC_LL_HYBRID_NOSWITCH,
 	LPROC_LL_HYBRID_WRITESIZE_SWITCH,
 	LPROC_LL_HYBRID_READSIZE_SWITCH,
+	LPROC_LL_MIRROR_WRITE,
+	LPROC_LL_MIRROR_WRITE_FALLBACK,
 	LPROC_LL_FILE_OPCODES
 };
 
@@ -1307,11 +1463,15 @@ enum mds_open_flags ll_kernel_to_mds_open_flags(unsigned int kernel_open_flags);
 
 struct inode *ll_iget(struct super_block *sb, ino_t hash,
 		      struct lustre_md *lic);
+struct inode *ll_iget_new(struct super_block *sb, ino_t hash,
+			  struct lustre_md *md);
 int ll_test_inode_by_fid(struct inode *inode, void *opaque);
 int ll_md_blocking_ast(struct ldlm_lock *lock, struct ldlm_lock_desc *ldesc,
 		       void *data, int flag);
+int ll_md_blocking_release(struct ldlm_lock *lock);
 struct dentry *ll_splice_alias(struct inode *inode, struct dentry *de);
 int ll_rmdir_entry(struct inode *dir, char *name, int namelen);
+int ll_path_walk(struct file *file, struct lu_path_walk __user *uarg);
 void ll_update_times(struct ptlrpc_request *request, struct inode *inode);
 int ll_intent_lock(struct obd_export *exp, struct md_op_data *op_data,
 		   struct lookup_intent *it, struct ptlrpc_request **reqp,
@@ -1326,7 +1486,8 @@ int ll_read_folio(struct file *file, struct folio *folio);
 #endif
 int ll_io_read_page(const struct lu_env *env, struct cl_io *io,
 			   struct cl_page *page, struct file *file);
-void ll_readahead_init(struct inode *inode, struct ll_readahead_state *ras);
+void ll_readahead_init(struct inode *inode, struct ll_file_data *lfd);
+int ll_prefetch_data(struct inode *inode, loff_t bytes);
 int vvp_io_write_commit(const struct lu_env *env, struct cl_io *io,
 			enum cl_io_priority prio);
 
@@ -1550,6 +1711,24 @@ int ll_dir_get_parent_fid(struct inode *dir, struct lu_fid *parent_fid);
 /* llite/symlink.c */
 extern const struct inode_operations ll_fast_symlink_inode_operations;
 
+/* llite/wbc.c */
+void ll_wbc_init(struct ll_sb_info *sbi);
+void ll_wbc_fini(struct ll_sb_info *sbi);
+int ll_wbc_new_node(struct inode *dir, struct dentry *dchild, umode_t mode,
+		    __u64 rdev);
+void ll_wbc_mkdir_done(struct inode *dir, struct inode *inode,
+		       struct lookup_intent *it);
+int ll_wbc_flush(struct ll_sb_info *sbi);
+void ll_wbc_flush_inodes(struct inode *i1, struct inode *i2);
+void ll_wbc_flush_children(struct inode *dir);
+bool ll_wbc_revoke(struct ldlm_lock *lock);
+void ll_wbc_open_prep(struct inode *dir, struct md_op_data *op_data);
+
+static inline bool ll_wbc_pending(struct inode *inode)
+{
+	return test_bit(LLIF_WBC_PENDING, &ll_i2info(inode)->lli_flags);
+}
+
 /* IO arguments for various VFS I/O interfaces. */
 struct vvp_io_args {
 	/** normal/sendfile/splice */
@@ -1561,6 +1740,9 @@ struct vvp_io_args {
 	} u;
 	/* did we switch this IO from BIO to DIO using hybrid IO? */
 	unsigned int	via_hybrid_switched:1;
+	/* FLR: write only this mirror, see ll_file_mirror_write() */
+	u16		via_mirror_id;
+	u32		via_layout_version;
 };
 
 static inline unsigned int iocb_ki_flags_get(const struct file *file,
@@ -1767,9 +1949,29 @@ void ll_ra_stats_inc(struct inode *inode, enum ra_stat which);
 #define LL_SA_CACHE_SIZE        (1 << LL_SA_CACHE_BIT)
 #define LL_SA_CACHE_MASK        (LL_SA_CACHE_SIZE - 1)
 
+/* default file data prefetched per entry when files are read in order */
+#define LL_SA_DATA_MAX_DEF	(1024 * 1024)
+/* regular files opened under a statahead before data is prefetched */
+#define LL_SA_DATA_OPENS_MIN	4
+
 #define LSA_FN_PREDICT_HIT_DEF	2
 #define LSA_FN_MATCH_HIT_DEF	4
 
+/*
+ * statahead state of one stripe of a striped directory, so that the MDTs
+ * of the stripes are kept busy independently of each other. The counters
+ * and sas_queued are protected by lli_sa_lock.
+ */
+struct ll_sa_stripe {
+	struct lu_batch		*sas_bh;	/* batch for the stripe MDT */
+	unsigned int		 sas_max;	/* max getattrs in flight */
+	unsigned int		 sas_inflight;	/* getattrs sent, not replied */
+	unsigned int		 sas_pending;	/* getattrs queued in sas_bh */
+	struct list_head	 sas_queued;	/* sa_entry of those getattrs */
+	__u64			 sas_sent;	/* getattrs sent count */
+	__u64			 sas_lat_us;	/* average getattr latency */
+};
+
 /* statahead controller, per process struct, for dir only */
 struct ll_statahead_info {
 	pid_t			sai_pid;
@@ -1804,9 +2006,17 @@ struct ll_statahead_info {
 	struct list_head	sai_entries;    /* completed entries */
 	struct list_head	sai_agls;	/* AGLs to be sent */
 	atomic_t		sai_cache_count; /* entry count in cache */
+	/* regular files opened for read in the dir during the statahead */
+	atomic_t		sai_data_opens;
 	struct lu_batch		*sai_bh;
 	__u32			sai_max_batch_count;
 	__u64			sai_index_end;
+	/* per stripe state of a striped directory, or NULL */
+	struct ll_sa_stripe	*sai_stripes;
+	struct lmv_stripe_object *sai_lsm_obj;
+	unsigned int		sai_stripe_count;
+	/* sum of the stripe windows, upper limit of sai_max */
+	unsigned int		sai_stripes_max;
 
 	union {
 		/* for ADVISE statahead pattern */
@@ -1845,6 +2055,7 @@ int ll_start_statahead(struct inode *dir, struct dentry *dentry, bool agl);
 void ll_authorize_statahead(struct inode *dir, void *key);
 void ll_deauthorize_statahead(struct inode *dir, void *key);
 void ll_statahead_enter(struct inode *dir, struct dentry *dentry);
+void ll_statahead_open(struct inode *dir);
 
 /* glimpse.c */
 blkcnt_t dirty_cnt(struct inode *inode);
@@ -1999,7 +2210,25 @@ static inline int d_lustre_invalid(const struct dentry *dentry)
 	rcu_read_lock();
 	lld = ll_d2d(dentry);
 	if (lld)
-		rc = lld->lld_invalid;
+		rc = lld->lld_invalid ||
+		     (lld->lld_rdplus_expire &&
+		      time_after(jiffies, lld->lld_rdplus_expire));
+	rcu_read_unlock();
+
+	return rc;
+}
+
+/* dentry is only valid because it was listed by readdir recently */
+static inline bool d_lustre_readdir_plus(const struct dentry *dentry)
+{
+	struct ll_dentry_data *lld;
+	bool rc = false;
+
+	rcu_read_lock();
+	lld = ll_d2d(dentry);
+	if (lld)
+		rc = !lld->lld_invalid && lld->lld_rdplus_expire &&
+		     !time_after(jiffies, lld->lld_rdplus_expire);
 	rcu_read_unlock();
 
 	return rc;
@@ -2035,6 +2264,21 @@ static inline void d_lustre_revalidate(struct dentry *dentry)
 	spin_unlock(&dentry->d_lock);
 }
 
+/* make @dentry valid without a LOOKUP lock until @expire (jiffies) */
+static inline void d_lustre_readdir_plus_set(struct dentry *dentry,
+					     unsigned long expire)
+{
+	struct ll_dentry_data *lld;
+
+	spin_lock(&dentry->d_lock);
+	lld = ll_d2d(dentry);
+	if (lld && lld->lld_invalid) {
+		lld->lld_invalid = 0;
+		lld->lld_rdplus_expire = expire;
+	}
+	spin_unlock(&dentry->d_lock);
+}
+
 static inline dev_t ll_compat_encode_dev(dev_t dev)
 {
 	/* The compat_sys_*stat*() syscalls will fail unless the
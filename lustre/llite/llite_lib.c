@@ -161,6 +161,7 @@ static struct ll_sb_info *ll_init_sbi(struct lustre_sb_info *lsi)
 	sbi->ll_ra_info.ra_async_pages_per_file_threshold =
 				sbi->ll_ra_info.ra_max_pages_per_file;
 	sbi->ll_ra_info.ra_range_pages = SBI_DEFAULT_RA_RANGE_PAGES;
+	sbi->ll_ra_info.ra_streams = LL_RA_STREAMS_MAX;
 	sbi->ll_ra_info.ra_max_read_ahead_whole_pages = -1;
 	atomic_set(&sbi->ll_ra_info.ra_async_inflight, 0);
 
@@ -186,6 +187,7 @@ static struct ll_sb_info *ll_init_sbi(struct lustre_sb_info *lsi)
 	sbi->ll_sa_timeout = LL_SA_TIMEOUT_DEF;
 	sbi->ll_sa_fname_predict_hit = LSA_FN_PREDICT_HIT_DEF;
 	sbi->ll_sa_fname_match_hit = LSA_FN_MATCH_HIT_DEF;
+	sbi->ll_sa_data_max = LL_SA_DATA_MAX_DEF;
 	atomic_set(&sbi->ll_sa_total, 0);
 	atomic_set(&sbi->ll_sa_wrong, 0);
 	atomic_set(&sbi->ll_sa_running, 0);
@@ -195,6 +197,7 @@ static struct ll_sb_info *ll_init_sbi(struct lustre_sb_info *lsi)
 	atomic_set(&sbi->ll_sa_miss_total, 0);
 	atomic_set(&sbi->ll_sa_list_total, 0);
 	atomic_set(&sbi->ll_sa_fname_total, 0);
+	atomic_set(&sbi->ll_sa_striped_total, 0);
 	set_bit(LL_SBI_AGL_ENABLED, sbi->ll_flags);
 	set_bit(LL_SBI_FAST_READ, sbi->ll_flags);
 	set_bit(LL_SBI_TINY_WRITE, sbi->ll_flags);
@@ -202,6 +205,7 @@ static struct ll_sb_info *ll_init_sbi(struct lustre_sb_info *lsi)
 	set_bit(LL_SBI_UNALIGNED_DIO, sbi->ll_flags);
 	set_bit(LL_SBI_STATFS_PROJECT, sbi->ll_flags);
 	set_bit(LL_SBI_HYBRID_IO, sbi->ll_flags);
+	set_bit(LL_SBI_STRIDE_LOCK, sbi->ll_flags);
 	ll_sbi_set_encrypt(sbi, true);
 	ll_sbi_set_name_encrypt(sbi, true);
 
@@ -230,6 +234,9 @@ static struct ll_sb_info *ll_init_sbi(struct lustre_sb_info *lsi)
 	/* erasure coding is disabled by default */
 	sbi->ll_enable_erasure_coding = 0;
 
+	/* metadata writeback cache is disabled by default */
+	ll_wbc_init(sbi);
+
 	INIT_LIST_HEAD(&sbi->ll_all_quota_list);
 
 	rc = rhashtable_init(&sbi->ll_proj_sfs_htable, &proj_sfs_cache_params);
@@ -403,7 +410,11 @@ static int client_common_fill_super(struct super_block *sb, char *md, char *dt)
 				   OBD_CONNECT2_UNALIGNED_DIO |
 				   OBD_CONNECT2_PCCRO |
 				   OBD_CONNECT2_MIRROR_ID_FIX |
-				   OBD_CONNECT2_READDIR_OPEN;
+				   OBD_CONNECT2_READDIR_OPEN |
+				   OBD_CONNECT2_BATCH_BL_AST |
+				   OBD_CONNECT2_READDIR_PLUS |
+				   OBD_CONNECT2_PATH_WALK |
+				   OBD_CONNECT2_XATTR_PREFETCH;
 
 	if (llite_enable_flr_ec)
 		data->ocd_connect_flags2 |= OBD_CONNECT2_FLR_EC;
@@ -644,7 +655,9 @@ retry_connect:
 	data->ocd_connect_flags2 = OBD_CONNECT2_LOCKAHEAD |
 				   OBD_CONNECT2_INC_XID | OBD_CONNECT2_LSEEK |
 				   OBD_CONNECT2_REP_MBITS |
-				   OBD_CONNECT2_UNALIGNED_DIO;
+				   OBD_CONNECT2_UNALIGNED_DIO |
+				   OBD_CONNECT2_BATCH_BL_AST |
+				   OBD_CONNECT2_LOCK_STRIDE;
 
 	if (!CFS_FAIL_CHECK(OBD_FAIL_OSC_CONNECT_GRANT_PARAM))
 		data->ocd_connect_flags |= OBD_CONNECT_GRANT_PARAM;
@@ -1011,6 +1024,12 @@ void ll_kill_super(struct super_block *sb)
 	if (sbi) {
 		sb->s_dev = sbi->ll_sdev_orig;
 
+		/* cached creates pin their dentries */
+		ll_wbc_fini(sbi);
+
+		/* readdir-plus work pins its directory */
+		flush_workqueue(sbi->ll_ra_info.ll_readahead_wq);
+
 		/* wait running statahead threads to quit */
 		while (atomic_read(&sbi->ll_sa_running) > 0 ||
 		       atomic_read(&sbi->ll_sa_refcnt) > 0)
@@ -1066,6 +1085,7 @@ static const match_table_t ll_sbi_flags_name = {
 	{LL_SBI_LAYOUT_LOCK,		"layout"},
 	{LL_SBI_NOROOTSQUASH,		"norootsquash"},
 	{LL_SBI_PARALLEL_DIO,		"parallel_dio"},
+	{LL_SBI_STRIDE_LOCK,		"stride_lock"},
 	{LL_SBI_TINY_WRITE,		"tiny_write"},
 	{LL_SBI_UNALIGNED_DIO,		"unaligned_dio"},
 	{LL_SBI_XATTR_CACHE,		"xattr_cache"},
@@ -1302,6 +1322,7 @@ void ll_lli_init(struct ll_inode_info *lli)
 		lli->lli_stat_pid = 0;
 		lli->lli_sa_enabled = 0;
 		init_rwsem(&lli->lli_lsm_sem);
+		atomic_set(&lli->lli_wbc_children, 0);
 	} else {
 		struct job_info *ji = &lli->lli_jobinfo;
 
@@ -3453,6 +3474,8 @@ int ll_iocontrol(struct inode *inode, struct file *file,
 #endif
 	case LL_IOC_GETPARENT:
 		RETURN(ll_getparent(file, uarg));
+	case LL_IOC_PATH_WALK:
+		RETURN(ll_path_walk(file, uarg));
 	case LL_IOC_PATH2FID:
 		if (copy_to_user(uarg, ll_inode2fid(inode),
 				 sizeof(struct lu_fid)))
@@ -3869,6 +3892,9 @@ struct md_op_data *ll_prep_md_op_data(struct md_op_data *op_data,
 			return ERR_PTR(-EINVAL);
 	}
 
+	/* the MDT has to know the inodes before they are named in an RPC */
+	ll_wbc_flush_inodes(i1, i2);
+
 	if (op_data == NULL) {
 		OBD_ALLOC_PTR(op_data);
 		if (op_data == NULL)
@@ -3916,6 +3942,9 @@ struct md_op_data *ll_prep_md_op_data(struct md_op_data *op_data,
 	if (ll_need_32bit_api(ll_i2sbi(i1)))
 		op_data->op_cli_flags |= CLI_API32;
 
+	if (ll_i2sbi(i1)->ll_xattr_cache_enabled)
+		op_data->op_cli_flags |= CLI_XATTR_PREFETCH;
+
 	if ((i2 && is_root_inode(i2)) ||
 	    opc == LUSTRE_OPC_LOOKUP || opc == LUSTRE_OPC_CREATE) {
 		/* In case of lookup, ll_setup_filename() has already been
@@ -316,8 +316,11 @@ static vm_fault_t __ll_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
 		 * - Otherwise, it should try normal fault under DLM lock.
 		 */
 		if (!(fault_ret & VM_FAULT_RETRY) &&
-		    !(fault_ret & VM_FAULT_ERROR))
+		    !(fault_ret & VM_FAULT_ERROR)) {
+			ll_stats_ops_tally(ll_i2sbi(inode),
+					   LPROC_LL_FAULT_FAST, 1);
 			GOTO(out, result = 0);
+		}
 
 		fault_ret = 0;
 	}
@@ -351,6 +354,9 @@ static vm_fault_t __ll_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
 			put_page(vmpage);
 			vmf->page = NULL;
 		}
+		if (result == 0)
+			ll_stats_ops_tally(ll_i2sbi(inode),
+					   LPROC_LL_FAULT_SLOW, 1);
 	}
 	cl_io_fini(env, io);
 
@@ -447,6 +453,62 @@ restart:
 	return result;
 }
 
+/**
+ * ll_map_pages() - Map cached pages around a faulting address
+ * @vmf: structure which describe type and address where hit fault
+ * @start_pgoff: first page index of the fault-around window
+ * @end_pgoff: last page index of the fault-around window
+ *
+ * Called by the VM before ->fault() to map pages of the fault-around window
+ * that are already in the page cache, without taking the page locks for
+ * longer than needed to install the PTEs. This relies on the same invariant
+ * as the fast read path: an uptodate page in the page cache of a Lustre file
+ * is covered by a DLM lock, and it is unmapped and discarded (clearing its
+ * uptodate bit under the page lock, see vvp_page_delete()) before the lock
+ * goes away. filemap_map_pages() skips locked and !uptodate pages and
+ * rechecks page->mapping under the page lock, so it can only map pages that
+ * are still protected. Anything it skips is left to ll_fault().
+ *
+ * Fault-around is disabled together with fast_read, and for PCC mappings,
+ * whose pages live in the page cache of the PCC copy.
+ *
+ * Return:
+ * * VM_FAULT_NOPAGE if the page at the faulting address was mapped
+ * * 0 otherwise, ->fault() will then be called for it
+ */
+#ifdef HAVE_MAP_PAGES_VM_FAULT_T
+static vm_fault_t ll_map_pages(struct vm_fault *vmf, pgoff_t start_pgoff,
+			       pgoff_t end_pgoff)
+#else
+static void ll_map_pages(struct vm_fault *vmf, pgoff_t start_pgoff,
+			 pgoff_t end_pgoff)
+#endif
+{
+	struct vm_area_struct *vma = vmf->vma;
+	struct inode *inode = file_inode(vma->vm_file);
+	vm_fault_t ret = 0;
+
+	if (vma->vm_private_data != NULL ||
+	    !ll_sbi_has_fast_read(ll_i2sbi(inode)))
+		goto out;
+
+#ifdef HAVE_MAP_PAGES_VM_FAULT_T
+	ret = filemap_map_pages(vmf, start_pgoff, end_pgoff);
+#else
+	filemap_map_pages(vmf, start_pgoff, end_pgoff);
+#endif
+	ll_stats_ops_tally(ll_i2sbi(inode), LPROC_LL_MAP_PAGES, 1);
+
+	CDEBUG(D_MMAP, "%s map pages "DFID" [%lu, %lu]: %d\n", current->comm,
+	       PFID(ll_inode2fid(inode)), start_pgoff, end_pgoff, ret);
+out:
+#ifdef HAVE_MAP_PAGES_VM_FAULT_T
+	return ret;
+#else
+	return;
+#endif
+}
+
 static vm_fault_t ll_page_mkwrite(struct vm_fault *vmf)
 {
 	struct vm_area_struct *vma = vmf->vma;
@@ -567,6 +629,7 @@ static void ll_vm_close(struct vm_area_struct *vma)
 
 static const struct vm_operations_struct ll_file_vm_ops = {
 	.fault			= ll_fault,
+	.map_pages		= ll_map_pages,
 	.page_mkwrite		= ll_page_mkwrite,
 	.open			= ll_vm_open,
 	.close			= ll_vm_close,
@@ -1207,6 +1207,37 @@ static ssize_t statahead_timeout_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(statahead_timeout);
 
+static ssize_t statahead_data_kb_show(struct kobject *kobj,
+				      struct attribute *attr, char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return scnprintf(buf, PAGE_SIZE, "%lu\n", sbi->ll_sa_data_max >> 10);
+}
+
+static ssize_t statahead_data_kb_store(struct kobject *kobj,
+				       struct attribute *attr,
+				       const char *buffer, size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	u64 val;
+	int rc;
+
+	rc = sysfs_memparse(buffer, count, &val, "KiB");
+	if (rc < 0)
+		return rc;
+
+	/* 0 disables the data prefetch of directory sweeps */
+	if ((val >> PAGE_SHIFT) > sbi->ll_ra_info.ra_max_pages_per_file)
+		return -ERANGE;
+
+	sbi->ll_sa_data_max = val;
+	return count;
+}
+LUSTRE_RW_ATTR(statahead_data_kb);
+
 static ssize_t
 statahead_fname_predict_hit_show(struct kobject *kobj, struct attribute *attr,
 				 char *buf)
@@ -1308,6 +1339,7 @@ static int ll_statahead_stats_seq_show(struct seq_file *m, void *v)
 		      "agl total: %u\n"
 		      "list_total: %u\n"
 		      "fname_total: %u\n"
+		      "striped_total: %u\n"
 		      "hit_total: %u\n"
 		      "miss_total: %u\n",
 		   atomic_read(&sbi->ll_sa_total),
@@ -1315,6 +1347,7 @@ static int ll_statahead_stats_seq_show(struct seq_file *m, void *v)
 		   atomic_read(&sbi->ll_agl_total),
 		   atomic_read(&sbi->ll_sa_list_total),
 		   atomic_read(&sbi->ll_sa_fname_total),
+		   atomic_read(&sbi->ll_sa_striped_total),
 		   atomic_read(&sbi->ll_sa_hit_total),
 		   atomic_read(&sbi->ll_sa_miss_total));
 	return 0;
@@ -1333,6 +1366,7 @@ static ssize_t ll_statahead_stats_seq_write(struct file *file,
 	atomic_set(&sbi->ll_agl_total, 0);
 	atomic_set(&sbi->ll_sa_list_total, 0);
 	atomic_set(&sbi->ll_sa_fname_total, 0);
+	atomic_set(&sbi->ll_sa_striped_total, 0);
 	atomic_set(&sbi->ll_sa_hit_total, 0);
 	atomic_set(&sbi->ll_sa_miss_total, 0);
 
@@ -1340,6 +1374,38 @@ static ssize_t ll_statahead_stats_seq_write(struct file *file,
 }
 LDEBUGFS_SEQ_FOPS(ll_statahead_stats);
 
+static int ll_metadata_writeback_stats_seq_show(struct seq_file *m, void *v)
+{
+	struct super_block *sb = m->private;
+	struct ll_sb_info *sbi = ll_s2sbi(sb);
+
+	seq_printf(m, "cached: %u\n"
+		      "flushed: %u\n"
+		      "errors: %u\n"
+		      "pending: %u\n",
+		   atomic_read(&sbi->ll_wbc_cached),
+		   atomic_read(&sbi->ll_wbc_flushed),
+		   atomic_read(&sbi->ll_wbc_errors),
+		   READ_ONCE(sbi->ll_wbc_count));
+	return 0;
+}
+
+static ssize_t ll_metadata_writeback_stats_seq_write(struct file *file,
+						     const char __user *buffer,
+						     size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct super_block *sb = m->private;
+	struct ll_sb_info *sbi = ll_s2sbi(sb);
+
+	atomic_set(&sbi->ll_wbc_cached, 0);
+	atomic_set(&sbi->ll_wbc_flushed, 0);
+	atomic_set(&sbi->ll_wbc_errors, 0);
+
+	return count;
+}
+LDEBUGFS_SEQ_FOPS(ll_metadata_writeback_stats);
+
 static ssize_t lazystatfs_show(struct kobject *kobj,
 			       struct attribute *attr,
 			       char *buf)
@@ -1587,6 +1653,98 @@ static ssize_t intent_mkdir_store(struct kobject *kobj, struct attribute *attr,
 }
 LUSTRE_RW_ATTR(intent_mkdir);
 
+static ssize_t metadata_writeback_show(struct kobject *kobj,
+				       struct attribute *attr, char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", sbi->ll_wbc_enabled);
+}
+
+static ssize_t metadata_writeback_store(struct kobject *kobj,
+					struct attribute *attr,
+					const char *buffer, size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	bool val;
+	int rc;
+
+	rc = kstrtobool(buffer, &val);
+	if (rc)
+		return rc;
+
+	sbi->ll_wbc_enabled = val;
+	/* write back what is cached when disabled */
+	if (!val) {
+		rc = ll_wbc_flush(sbi);
+		if (rc)
+			return rc;
+	}
+
+	return count;
+}
+LUSTRE_RW_ATTR(metadata_writeback);
+
+static ssize_t metadata_writeback_max_show(struct kobject *kobj,
+					   struct attribute *attr, char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", sbi->ll_wbc_max);
+}
+
+static ssize_t metadata_writeback_max_store(struct kobject *kobj,
+					    struct attribute *attr,
+					    const char *buffer, size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 10, &val);
+	if (rc)
+		return rc;
+
+	sbi->ll_wbc_max = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(metadata_writeback_max);
+
+static ssize_t metadata_writeback_delay_ms_show(struct kobject *kobj,
+						struct attribute *attr,
+						char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", sbi->ll_wbc_delay_ms);
+}
+
+static ssize_t metadata_writeback_delay_ms_store(struct kobject *kobj,
+						 struct attribute *attr,
+						 const char *buffer,
+						 size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 10, &val);
+	if (rc)
+		return rc;
+
+	sbi->ll_wbc_delay_ms = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(metadata_writeback_delay_ms);
+
 static ssize_t tiny_write_show(struct kobject *kobj,
 			       struct attribute *attr,
 			       char *buf)
@@ -1654,6 +1812,36 @@ static ssize_t enable_erasure_coding_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(enable_erasure_coding);
 
+static ssize_t mirror_write_sync_show(struct kobject *kobj,
+				      struct attribute *attr,
+				      char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", sbi->ll_mirror_write_sync);
+}
+
+static ssize_t mirror_write_sync_store(struct kobject *kobj,
+				       struct attribute *attr,
+				       const char *buffer,
+				       size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	bool val;
+	int rc;
+
+	rc = kstrtobool(buffer, &val);
+	if (rc)
+		return rc;
+
+	sbi->ll_mirror_write_sync = !!val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(mirror_write_sync);
+
 static ssize_t unaligned_dio_show(struct kobject *kobj,
 				  struct attribute *attr,
 				  char *buf)
@@ -1921,6 +2109,37 @@ out:
 }
 LUSTRE_RW_ATTR(read_ahead_range_kb);
 
+static ssize_t read_ahead_streams_show(struct kobject *kobj,
+				       struct attribute *attr, char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", sbi->ll_ra_info.ra_streams);
+}
+
+static ssize_t read_ahead_streams_store(struct kobject *kobj,
+					struct attribute *attr,
+					const char *buffer, size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 0, &val);
+	if (rc)
+		return rc;
+
+	if (val < 1 || val > LL_RA_STREAMS_MAX)
+		return -ERANGE;
+
+	sbi->ll_ra_info.ra_streams = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(read_ahead_streams);
+
 static ssize_t fast_read_show(struct kobject *kobj,
 			      struct attribute *attr,
 			      char *buf)
@@ -1957,6 +2176,42 @@ static ssize_t fast_read_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(fast_read);
 
+static ssize_t stride_lock_show(struct kobject *kobj,
+				struct attribute *attr,
+				char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n",
+			 test_bit(LL_SBI_STRIDE_LOCK, sbi->ll_flags));
+}
+
+static ssize_t stride_lock_store(struct kobject *kobj,
+				 struct attribute *attr,
+				 const char *buffer,
+				 size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	bool val;
+	int rc;
+
+	rc = kstrtobool(buffer, &val);
+	if (rc)
+		return rc;
+
+	spin_lock(&sbi->ll_lock);
+	if (val)
+		set_bit(LL_SBI_STRIDE_LOCK, sbi->ll_flags);
+	else
+		clear_bit(LL_SBI_STRIDE_LOCK, sbi->ll_flags);
+	spin_unlock(&sbi->ll_lock);
+
+	return count;
+}
+LUSTRE_RW_ATTR(stride_lock);
+
 static ssize_t file_heat_show(struct kobject *kobj,
 			      struct attribute *attr,
 			      char *buf)
@@ -2159,6 +2414,44 @@ static ssize_t opencache_max_ms_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(opencache_max_ms);
 
+/*
+ * Time in ms the attributes returned in readdir pages are trusted by stat()
+ * of the listed names, 0 (default) disables readdir-plus. Within that time
+ * changes made by other clients are not seen, see llite.readdir_plus_ms(4).
+ */
+static ssize_t readdir_plus_ms_show(struct kobject *kobj,
+				    struct attribute *attr,
+				    char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return snprintf(buf, PAGE_SIZE, "%u\n", sbi->ll_readdir_plus_ms);
+}
+
+static ssize_t readdir_plus_ms_store(struct kobject *kobj,
+				     struct attribute *attr,
+				     const char *buffer,
+				     size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 10, &val);
+	if (rc)
+		return rc;
+
+	if (val > LL_READDIR_PLUS_MAX_MS)
+		return -ERANGE;
+
+	sbi->ll_readdir_plus_ms = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(readdir_plus_ms);
+
 static ssize_t inode_cache_show(struct kobject *kobj,
 				struct attribute *attr,
 				char *buf)
@@ -2559,6 +2852,8 @@ struct ldebugfs_vars lprocfs_llite_obd_vars[] = {
 	  .fops	=	&ll_enable_mlock_pages_fops		},
 	{ .name	=	"statahead_stats",
 	  .fops	=	&ll_statahead_stats_fops		},
+	{ .name	=	"metadata_writeback_stats",
+	  .fops	=	&ll_metadata_writeback_stats_fops	},
 	{ .name	=	"unstable_stats",
 	  .fops	=	&ll_unstable_stats_fops			},
 	{ .name =	"sbi_flags",
@@ -2605,12 +2900,14 @@ static struct attribute *llite_attrs[] = {
 	&lustre_attr_opencache_threshold_count.attr,
 	&lustre_attr_opencache_threshold_ms.attr,
 	&lustre_attr_opencache_max_ms.attr,
+	&lustre_attr_readdir_plus_ms.attr,
 	&lustre_attr_parallel_dio.attr,
 	&lustre_attr_pcc_async_threshold.attr,
 	&lustre_attr_pcc_mode.attr,
 	&lustre_attr_pcc_async_affinity.attr,
 	&lustre_attr_read_ahead_async_file_threshold_mb.attr,
 	&lustre_attr_read_ahead_range_kb.attr,
+	&lustre_attr_read_ahead_streams.attr,
 	&lustre_attr_stat_blocksize.attr,
 	&lustre_attr_stats_track_pid.attr,
 	&lustre_attr_stats_track_ppid.attr,
@@ -2621,6 +2918,7 @@ static struct attribute *llite_attrs[] = {
 	&lustre_attr_statahead_max.attr,
 	&lustre_attr_statahead_min.attr,
 	&lustre_attr_statahead_timeout.attr,
+	&lustre_attr_statahead_data_kb.attr,
 	&lustre_attr_statahead_fname_predict_hit.attr,
 	&lustre_attr_statahead_fname_match_hit.attr,
 	&lustre_attr_statahead_agl.attr,
@@ -2631,9 +2929,14 @@ static struct attribute *llite_attrs[] = {
 	&lustre_attr_default_easize.attr,
 	&lustre_attr_xattr_cache.attr,
 	&lustre_attr_intent_mkdir.attr,
+	&lustre_attr_metadata_writeback.attr,
+	&lustre_attr_metadata_writeback_max.attr,
+	&lustre_attr_metadata_writeback_delay_ms.attr,
 	&lustre_attr_fast_read.attr,
+	&lustre_attr_stride_lock.attr,
 	&lustre_attr_tiny_write.attr,
 	&lustre_attr_enable_erasure_coding.attr,
+	&lustre_attr_mirror_write_sync.attr,
 	&lustre_attr_unaligned_dio.attr,
 	&lustre_attr_enable_setstripe_gid.attr,
 	&lustre_attr_file_heat.attr,
@@ -2681,6 +2984,10 @@ static const struct llite_file_opcode {
 	{ LPROC_LL_MMAP,	LPROCFS_TYPE_LATENCY,	"mmap" },
 	{ LPROC_LL_FAULT,	LPROCFS_TYPE_LATENCY,	"page_fault" },
 	{ LPROC_LL_MKWRITE,	LPROCFS_TYPE_LATENCY,	"page_mkwrite" },
+	/* faults served from the page cache vs. under a cl_io/DLM lock */
+	{ LPROC_LL_FAULT_FAST,	LPROCFS_TYPE_REQS,	"page_fault_fast" },
+	{ LPROC_LL_FAULT_SLOW,	LPROCFS_TYPE_REQS,	"page_fault_slow" },
+	{ LPROC_LL_MAP_PAGES,	LPROCFS_TYPE_REQS,	"page_fault_around" },
 	{ LPROC_LL_LLSEEK,	LPROCFS_TYPE_LATENCY,	"seek" },
 	{ LPROC_LL_FSYNC,	LPROCFS_TYPE_LATENCY,	"fsync" },
 	{ LPROC_LL_READDIR,	LPROCFS_TYPE_LATENCY,	"readdir" },
@@ -2707,9 +3014,14 @@ static const struct llite_file_opcode {
 	{ LPROC_LL_SETXATTR,	LPROCFS_TYPE_LATENCY,	"setxattr" },
 	{ LPROC_LL_GETXATTR,	LPROCFS_TYPE_LATENCY,	"getxattr" },
 	{ LPROC_LL_GETXATTR_HITS, LPROCFS_TYPE_REQS,	"getxattr_hits" },
+	/* getxattr RPCs avoided thanks to xattrs prefetched with getattr */
+	{ LPROC_LL_GETXATTR_SAVED, LPROCFS_TYPE_REQS,	"getxattr_saved" },
 	{ LPROC_LL_LISTXATTR,	LPROCFS_TYPE_LATENCY,	"listxattr" },
 	{ LPROC_LL_REMOVEXATTR,	LPROCFS_TYPE_LATENCY,	"removexattr" },
 	{ LPROC_LL_INODE_PERM,	LPROCFS_TYPE_LATENCY,	"inode_permission" },
+	/* one sample per RPC, summing the path components it looked up */
+	{ LPROC_LL_PATH_WALK,	LPROCFS_TYPE_REQS | LPROCFS_CNTR_AVGMINMAX,
+				"path_walk" },
 	/* PCC I/O statistics */
 	{ LPROC_LL_PCC_ATTACH,  LPROCFS_TYPE_REQS,	"pcc_attach" },
 	{ LPROC_LL_PCC_DETACH,  LPROCFS_TYPE_REQS,	"pcc_detach" },
@@ -2723,6 +3035,9 @@ static const struct llite_file_opcode {
 		"hybrid_writesize_switch" },
 	{ LPROC_LL_HYBRID_READSIZE_SWITCH, LPROCFS_TYPE_REQS,
 		"hybrid_readsize_switch" },
+	{ LPROC_LL_MIRROR_WRITE, LPROCFS_TYPE_REQS, "mirror_write" },
+	{ LPROC_LL_MIRROR_WRITE_FALLBACK, LPROCFS_TYPE_REQS,
+		"mirror_write_fallback" },
 };
 
 void ll_stats_ops_tally(struct ll_sb_info *sbi, int op, long count)
@@ -2763,7 +3078,17 @@ static const char *const ra_stat_string[] = {
 	[RA_STAT_FAILED_FAST_READ]	= "failed_to_fast_read",
 	[RA_STAT_MMAP_RANGE_READ]	= "mmap_range_read",
 	[RA_STAT_READAHEAD_PAGES]	= "readahead_pages",
-	[RA_STAT_FORCEREAD_PAGES]	= "forceread_pages"
+	[RA_STAT_FORCEREAD_PAGES]	= "forceread_pages",
+	[RA_STAT_PREFETCH_PAGES]	= "dir_prefetch_pages",
+	[RA_STAT_STREAM_NEW]		= "readahead_streams_started",
+	[RA_STAT_STREAM_HIT + 0]	= "stream0_hits",
+	[RA_STAT_STREAM_HIT + 1]	= "stream1_hits",
+	[RA_STAT_STREAM_HIT + 2]	= "stream2_hits",
+	[RA_STAT_STREAM_HIT + 3]	= "stream3_hits",
+	[RA_STAT_STREAM_MISS + 0]	= "stream0_misses",
+	[RA_STAT_STREAM_MISS + 1]	= "stream1_misses",
+	[RA_STAT_STREAM_MISS + 2]	= "stream2_misses",
+	[RA_STAT_STREAM_MISS + 3]	= "stream3_misses",
 };
 
 int ll_debugfs_register_super(struct super_block *sb, const char *name)
@@ -2821,6 +3146,7 @@ int ll_debugfs_register_super(struct super_block *sb, const char *name)
 				     llite_opcode_table[id].lfo_config,
 				     llite_opcode_table[id].lfo_opname);
 
+	BUILD_BUG_ON(ARRAY_SIZE(ra_stat_string) != _NR_RA_STAT);
 	sbi->ll_ra_stats = lprocfs_stats_alloc(ARRAY_SIZE(ra_stat_string),
 					       LPROCFS_STATS_FLAG_NONE);
 	if (sbi->ll_ra_stats == NULL)
@@ -2828,7 +3154,8 @@ int ll_debugfs_register_super(struct super_block *sb, const char *name)
 
 	for (id = 0; id < ARRAY_SIZE(ra_stat_string); id++) {
 		if (id == RA_STAT_READAHEAD_PAGES ||
-		    id == RA_STAT_FORCEREAD_PAGES)
+		    id == RA_STAT_FORCEREAD_PAGES ||
+		    id == RA_STAT_PREFETCH_PAGES)
 			lprocfs_counter_init(sbi->ll_ra_stats, id,
 					     LPROCFS_TYPE_PAGES |
 					     LPROCFS_CNTR_AVGMINMAX,
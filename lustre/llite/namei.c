@@ -93,19 +93,8 @@ out:
 }
 
 
-/**
- * ll_iget() - Get an inode by inode number(@hash), which is already
- * instantiated by the intent lookup).
- * @sb: Pointer to struct super_block
- * @hash: inode number (to be retrived)
- * @md: Inode metadata info.
- *
- * Return:
- * * Valid inode struct on Success
- * * ERRNO converted by ERR_PTR on Failure
- */
-struct inode *ll_iget(struct super_block *sb, ino_t hash,
-		      struct lustre_md *md)
+static struct inode *__ll_iget(struct super_block *sb, ino_t hash,
+			       struct lustre_md *md, bool update)
 {
 	struct inode	*inode;
 	int		rc = 0;
@@ -141,6 +130,9 @@ struct inode *ll_iget(struct super_block *sb, ino_t hash,
 	} else if (is_bad_inode(inode)) {
 		iput(inode);
 		inode = ERR_PTR(-ESTALE);
+	} else if (!update) {
+		iput(inode);
+		inode = ERR_PTR(-EEXIST);
 	} else if (!(inode->i_state & (I_FREEING | I_CLEAR))) {
 		rc = ll_update_inode(inode, md);
 		CDEBUG(D_VFSTRACE, "got inode: "DFID"(%p): rc = %d\n",
@@ -156,6 +148,42 @@ struct inode *ll_iget(struct super_block *sb, ino_t hash,
 	RETURN(inode);
 }
 
+/**
+ * ll_iget() - Get an inode by inode number(@hash), which is already
+ * instantiated by the intent lookup).
+ * @sb: Pointer to struct super_block
+ * @hash: inode number (to be retrived)
+ * @md: Inode metadata info.
+ *
+ * Return:
+ * * Valid inode struct on Success
+ * * ERRNO converted by ERR_PTR on Failure
+ */
+struct inode *ll_iget(struct super_block *sb, ino_t hash,
+		      struct lustre_md *md)
+{
+	return __ll_iget(sb, hash, md, true);
+}
+
+/**
+ * ll_iget_new() - Get an inode by inode number(@hash) only if it is not cached
+ * @sb: Pointer to struct super_block
+ * @hash: inode number (to be retrived)
+ * @md: Inode metadata info, which does not come with a lock.
+ *
+ * A cached inode may be protected by a lock, its attributes are left alone.
+ *
+ * Return:
+ * * Valid new inode struct on Success
+ * * -EEXIST if the inode is already cached
+ * * ERRNO converted by ERR_PTR on Failure
+ */
+struct inode *ll_iget_new(struct super_block *sb, ino_t hash,
+			  struct lustre_md *md)
+{
+	return __ll_iget(sb, hash, md, false);
+}
+
 /* mark negative sub file dentries invalid and prune unused dentries */
 static void ll_prune_negative_children(struct inode *dir)
 {
@@ -251,6 +279,12 @@ static void ll_lock_cancel_bits(struct ldlm_lock *lock,
 		RETURN_EXIT;
 	}
 
+	/* creates cached under this lock must reach the MDT before it is
+	 * released, this is normally done after the blocking AST already
+	 */
+	if (lock->l_granted_mode == LCK_EX && bits & MDS_INODELOCK_UPDATE)
+		ll_wbc_flush_children(inode);
+
 	if (bits & MDS_INODELOCK_XATTR) {
 		ll_xattr_cache_empty(inode);
 		bits &= ~MDS_INODELOCK_XATTR;
@@ -463,42 +497,63 @@ static int ll_md_need_convert(struct ldlm_lock *lock)
 	return !!(bits);
 }
 
+/**
+ * ll_md_blocking_release() - give back a lock the MDT asked for
+ * @lock: lock whose blocking AST was received
+ *
+ * The bits no longer needed are dropped by a lock convert, or the whole lock
+ * is cancelled.
+ *
+ * Return: 0 on success, negative errno on failure
+ */
+int ll_md_blocking_release(struct ldlm_lock *lock)
+{
+	enum ldlm_cancel_flags cancel_flags = LCF_ASYNC;
+	struct lustre_handle lockh;
+	int rc;
+
+	/* if lock convert is not needed then still have to
+	 * pass lock via ldlm_cli_convert() to keep all states
+	 * correct, set cancel_bits to full lock bits to cause
+	 * full cancel to happen.
+	 */
+	if (!ll_md_need_convert(lock)) {
+		lock_res_and_lock(lock);
+		lock->l_policy_data.l_inodebits.cancel_bits =
+				lock->l_policy_data.l_inodebits.bits;
+		unlock_res_and_lock(lock);
+	}
+	rc = ldlm_cli_convert(lock, cancel_flags);
+	if (!rc)
+		return 0;
+	/* continue with cancel otherwise */
+	ldlm_lock2handle(lock, &lockh);
+	rc = ldlm_cli_cancel(&lockh, cancel_flags);
+	if (rc < 0)
+		CDEBUG(D_INODE, "ldlm_cli_cancel: rc = %d\n", rc);
+
+	return rc;
+}
+
 int ll_md_blocking_ast(struct ldlm_lock *lock, struct ldlm_lock_desc *ld,
 		       void *data, int flag)
 {
-	struct lustre_handle lockh;
 	int rc;
 
 	ENTRY;
 
 	switch (flag) {
 	case LDLM_CB_BLOCKING:
-	{
-		enum ldlm_cancel_flags cancel_flags = LCF_ASYNC;
-
-		/* if lock convert is not needed then still have to
-		 * pass lock via ldlm_cli_convert() to keep all states
-		 * correct, set cancel_bits to full lock bits to cause
-		 * full cancel to happen.
+		/* creates cached under an EX lock are written back before it
+		 * is released, away from the blocking thread
 		 */
-		if (!ll_md_need_convert(lock)) {
-			lock_res_and_lock(lock);
-			lock->l_policy_data.l_inodebits.cancel_bits =
-					lock->l_policy_data.l_inodebits.bits;
-			unlock_res_and_lock(lock);
-		}
-		rc = ldlm_cli_convert(lock, cancel_flags);
-		if (!rc)
+		if (ll_wbc_revoke(lock))
 			RETURN(0);
-		/* continue with cancel otherwise */
-		ldlm_lock2handle(lock, &lockh);
-		rc = ldlm_cli_cancel(&lockh, cancel_flags);
-		if (rc < 0) {
-			CDEBUG(D_INODE, "ldlm_cli_cancel: rc = %d\n", rc);
+
+		rc = ll_md_blocking_release(lock);
+		if (rc < 0)
 			RETURN(rc);
-		}
 		break;
-	}
 	case LDLM_CB_CANCELING:
 	{
 		enum mds_ibits_locks to_cancel =
@@ -711,6 +766,9 @@ static int ll_lookup_it_finish(struct ptlrpc_request *request,
 		}
 
 		ll_set_lock_data(ll_i2sbi(parent)->ll_md_exp, inode, it, &bits);
+		/* xattrs piggybacked under the XATTR lock save a getxattr */
+		if (bits & MDS_INODELOCK_XATTR)
+			ll_xattr_cache_prefetch(inode, pill);
 		/* OPEN can return data if lock has DoM+LAYOUT bits set */
 		if (it->it_op & IT_OPEN) {
 			if (bits & MDS_INODELOCK_DOM &&
@@ -1105,6 +1163,9 @@ static struct dentry *ll_lookup_it(struct inode *parent, struct dentry *dentry,
 	}
 	if (fid_is_obf(ll_inode2fid(parent)))
 		obf_mod_fixup(op_data, it);
+	/* a create keeps the lock under which creates are cached in @parent */
+	if (it->it_op & IT_OPEN && it->it_op & IT_CREAT)
+		ll_wbc_open_prep(parent, op_data);
 
 	if (!sbi->ll_dir_open_read && it->it_op & IT_OPEN &&
 	    it->it_open_flags & O_DIRECTORY)
@@ -1335,6 +1396,14 @@ static struct dentry *ll_lookup_nd(struct inode *parent, struct dentry *dentry,
 			      parent, MAY_WRITE | MAY_EXEC) == 0))
 		goto out;
 
+	/* the MDT does not know a directory cached in the metadata writeback
+	 * cache, all its entries are cached and pinned in the dcache
+	 */
+	if (ll_wbc_pending(parent) && !(flags & LOOKUP_OPEN)) {
+		d_add(dentry, NULL);
+		goto out;
+	}
+
 	if (flags & (LOOKUP_PARENT|LOOKUP_OPEN|LOOKUP_CREATE))
 		itp = NULL;
 	else
@@ -1348,6 +1417,376 @@ out:
 	return de;
 }
 
+/*
+ * LL_IOC_PATH_WALK looks up the components of a path below a directory with
+ * batched getattr sub requests in a single RPC: each one but the first has no
+ * parent FID, and the MDT looks its name up in the object found by the
+ * previous one, see mdt_batch_walk_prep(). The MDT stops at remote or striped
+ * directories and at lock contention, the rest is left to the normal lookup.
+ */
+
+/* path components looked up by one LL_IOC_PATH_WALK RPC */
+#define LL_PATH_WALK_MAX	16
+
+struct ll_path_walk_item {
+	struct md_op_item	*pwi_item;
+	struct ptlrpc_request	*pwi_req;
+	struct qstr		 pwi_name;
+	int			 pwi_rc;
+};
+
+/* return the next component of @path, skipping empty and "." ones */
+static char *ll_path_walk_name(char **path)
+{
+	char *name;
+
+	while ((name = strsep(path, "/")) != NULL)
+		if (name[0] != '\0' && strcmp(name, ".") != 0)
+			break;
+
+	return name;
+}
+
+/* descend into @name if it is valid in the dcache, return 1 if so */
+static int ll_path_walk_cached(struct dentry **parentp, const char *name)
+{
+	struct qstr qstr = QSTR_INIT(name, strlen(name));
+	struct dentry *child;
+
+	qstr.hash = full_name_hash(*parentp, qstr.name, qstr.len);
+	child = d_lookup(*parentp, &qstr);
+	if (!child)
+		return 0;
+
+	if (d_really_is_negative(child) || d_lustre_invalid(child)) {
+		dput(child);
+		return 0;
+	}
+
+	dput(*parentp);
+	*parentp = child;
+
+	return 1;
+}
+
+/* called by the batch interpreter, ll_path_walk_finish() uses the reply */
+static int ll_path_walk_interpret(struct md_op_item *item, int rc)
+{
+	struct ll_path_walk_item *pwi = item->mop_cbdata;
+
+	if (rc == 0 && it_disposition(&item->mop_it, DISP_LOOKUP_NEG))
+		rc = -ENOENT;
+
+	if (rc == 0) {
+		pwi->pwi_req = item->mop_pill->rc_req;
+		ptlrpc_request_addref(pwi->pwi_req);
+	}
+	pwi->pwi_rc = rc;
+
+	return rc;
+}
+
+static struct md_op_item *ll_path_walk_prep(struct inode *dir,
+					    struct ll_path_walk_item *pwi,
+					    bool first)
+{
+	struct ldlm_enqueue_info *einfo;
+	struct md_op_data *op_data;
+	struct md_op_item *item;
+
+	OBD_ALLOC_PTR(item);
+	if (!item)
+		return ERR_PTR(-ENOMEM);
+
+	op_data = ll_prep_md_op_data(&item->mop_data, dir, NULL,
+				     pwi->pwi_name.name, pwi->pwi_name.len, 0,
+				     LUSTRE_OPC_ANY, NULL);
+	if (IS_ERR(op_data)) {
+		OBD_FREE_PTR(item);
+		return ERR_CAST(op_data);
+	}
+
+	/* the parent is only known to the MDT, see mdt_batch_walk_prep() */
+	if (!first) {
+		ll_unlock_md_op_lsm(op_data);
+		fid_zero(&op_data->op_fid1);
+		op_data->op_flags |= MF_PATH_WALK;
+	}
+
+	item->mop_opc = MD_OP_GETATTR;
+	item->mop_it.it_op = IT_GETATTR;
+	item->mop_cb = ll_path_walk_interpret;
+	item->mop_cbdata = pwi;
+
+	einfo = &item->mop_einfo;
+	einfo->ei_type = LDLM_IBITS;
+	einfo->ei_mode = it_to_lock_mode(&item->mop_it);
+	einfo->ei_cb_bl = ll_md_blocking_ast;
+	einfo->ei_cb_cp = ldlm_completion_ast;
+	einfo->ei_cb_gl = NULL;
+	einfo->ei_cbdata = NULL;
+	einfo->ei_req_slot = 1;
+
+	return item;
+}
+
+static void ll_path_walk_fini(struct ll_path_walk_item *pwi)
+{
+	struct md_op_item *item = pwi->pwi_item;
+
+	if (pwi->pwi_req) {
+		ptlrpc_req_put(pwi->pwi_req);
+		pwi->pwi_req = NULL;
+	}
+
+	if (!item)
+		return;
+
+	ll_intent_release(&item->mop_it);
+	ll_unlock_md_op_lsm(&item->mop_data);
+	if (item->mop_subpill_allocated)
+		OBD_FREE_PTR(item->mop_pill);
+	OBD_FREE_PTR(item);
+	pwi->pwi_item = NULL;
+}
+
+/* instantiate the dentry of one looked up component below @parent */
+static struct dentry *ll_path_walk_finish(struct dentry *parent,
+					  struct ll_path_walk_item *pwi)
+{
+	DECLARE_WAIT_QUEUE_HEAD_ONSTACK(wq);
+	enum mds_ibits_locks bits = MDS_INODELOCK_NONE;
+	struct md_op_item *item = pwi->pwi_item;
+	struct lookup_intent *it = &item->mop_it;
+	struct inode *dir = d_inode(parent);
+	struct inode *inode = NULL;
+	struct dentry *dentry;
+	struct dentry *alias;
+	int rc;
+
+	if (pwi->pwi_rc)
+		return ERR_PTR(pwi->pwi_rc);
+
+	rc = ll_prep_inode(&inode, item->mop_pill, dir->i_sb, it);
+	if (rc)
+		return ERR_PTR(rc);
+
+	ll_set_lock_data(ll_i2sbi(dir)->ll_md_exp, inode, it, &bits);
+
+	pwi->pwi_name.hash = full_name_hash(parent, pwi->pwi_name.name,
+					    pwi->pwi_name.len);
+	/* instantiate as a lookup would, with the parent's i_rwsem shared */
+	inode_lock_shared(dir);
+	dentry = d_alloc_parallel(parent, &pwi->pwi_name, &wq);
+	if (IS_ERR(dentry)) {
+		inode_unlock_shared(dir);
+		iput(inode);
+		return dentry;
+	}
+
+	if (!d_in_lookup(dentry)) {
+		inode_unlock_shared(dir);
+		/* raced with another lookup, keep its dentry if it agrees */
+		if (d_inode(dentry) != inode) {
+			dput(dentry);
+			dentry = ERR_PTR(-ESTALE);
+		} else if (bits & MDS_INODELOCK_LOOKUP) {
+			d_lustre_revalidate(dentry);
+		}
+		iput(inode);
+		return dentry;
+	}
+
+	alias = ll_splice_alias(inode, dentry);
+	d_lookup_done(dentry);
+	inode_unlock_shared(dir);
+	if (IS_ERR(alias)) {
+		dput(dentry);
+		return alias;
+	}
+	if (alias != dentry) {
+		dput(dentry);
+		dentry = alias;
+	}
+
+	if (bits & MDS_INODELOCK_LOOKUP)
+		d_lustre_revalidate(dentry);
+	if (S_ISDIR(d_inode(dentry)->i_mode))
+		ll_update_dir_depth_dmv(dir, dentry);
+
+	return dentry;
+}
+
+/*
+ * Send the components in @pwis to the MDT in one batched RPC, and
+ * instantiate them below @parentp as far as they were found.
+ *
+ * Return the number of components instantiated.
+ */
+static int ll_path_walk_rpc(struct dentry **parentp,
+			    struct ll_path_walk_item *pwis, int nr)
+{
+	struct inode *dir = d_inode(*parentp);
+	struct ll_sb_info *sbi = ll_i2sbi(dir);
+	struct lu_batch *bh;
+	int count = 0;
+	int rc = 0;
+	int i;
+
+	bh = md_batch_create(sbi->ll_md_exp, BATCH_FL_RDONLY | BATCH_FL_SYNC,
+			     0);
+	if (IS_ERR(bh))
+		return PTR_ERR(bh);
+
+	for (i = 0; i < nr; i++) {
+		struct md_op_item *item;
+
+		/* not interpreted if the batch could not be sent */
+		pwis[i].pwi_rc = -ECANCELED;
+		item = ll_path_walk_prep(dir, &pwis[i], i == 0);
+		if (IS_ERR(item))
+			break;
+
+		pwis[i].pwi_item = item;
+		rc = md_batch_add(sbi->ll_md_exp, bh, item);
+		if (rc) {
+			ll_path_walk_fini(&pwis[i]);
+			break;
+		}
+	}
+	nr = i;
+
+	md_batch_stop(sbi->ll_md_exp, bh);
+
+	for (i = 0; i < nr; i++) {
+		struct dentry *child;
+
+		if (rc == 0) {
+			child = ll_path_walk_finish(*parentp, &pwis[i]);
+			if (IS_ERR(child)) {
+				rc = PTR_ERR(child);
+				CDEBUG(D_DENTRY, "%s: walk stopped at "DNAME": rc = %d\n",
+				       sbi->ll_fsname,
+				       encode_fn_qstr(pwis[i].pwi_name), rc);
+			} else {
+				dput(*parentp);
+				*parentp = child;
+				count++;
+			}
+		}
+		ll_path_walk_fini(&pwis[i]);
+	}
+
+	ll_stats_ops_tally(sbi, LPROC_LL_PATH_WALK, count);
+
+	return count;
+}
+
+/**
+ * ll_path_walk() - look up a relative path below a directory in one RPC
+ * @file: directory the path is relative to
+ * @uarg: struct lu_path_walk with the path, returns the number of
+ *	  components looked up on the MDT
+ *
+ * Components already valid in the dcache are skipped, and the dentries of
+ * the others are instantiated with their LOOKUP lock, so a following open()
+ * of the path does not need one lookup RPC per component. The walk quietly
+ * ends at the first component which can't be resolved this way.
+ *
+ * Return:
+ * * %0 on success
+ * * %-errno on failure
+ */
+int ll_path_walk(struct file *file, struct lu_path_walk __user *uarg)
+{
+	struct inode *dir = file_inode(file);
+	struct ll_sb_info *sbi = ll_i2sbi(dir);
+	struct ll_path_walk_item *pwis = NULL;
+	struct lu_path_walk *lpw = NULL;
+	struct dentry *parent = NULL;
+	__u32 path_size;
+	char *path;
+	char *name;
+	int count = 0;
+	int rc = 0;
+
+	ENTRY;
+
+	if (!S_ISDIR(dir->i_mode))
+		RETURN(-ENOTDIR);
+
+	if (!exp_connect_batch_rpc(sbi->ll_md_exp) ||
+	    !exp_connect_path_walk(sbi->ll_md_exp))
+		RETURN(-EOPNOTSUPP);
+
+	if (get_user(path_size, &uarg->lpw_path_size))
+		RETURN(-EFAULT);
+
+	if (path_size < 2 || path_size > PATH_MAX)
+		RETURN(-EINVAL);
+
+	OBD_ALLOC(lpw, sizeof(*lpw) + path_size);
+	if (!lpw)
+		RETURN(-ENOMEM);
+
+	if (copy_from_user(lpw, uarg, sizeof(*lpw) + path_size))
+		GOTO(out, rc = -EFAULT);
+	lpw->lpw_path[path_size - 1] = '\0';
+
+	OBD_ALLOC_PTR_ARRAY(pwis, LL_PATH_WALK_MAX);
+	if (!pwis)
+		GOTO(out, rc = -ENOMEM);
+
+	parent = dget(file_dentry(file));
+	path = lpw->lpw_path;
+	name = ll_path_walk_name(&path);
+	while (name) {
+		struct inode *pdir = d_inode(parent);
+		int nr = 0;
+		int found;
+
+		if (!d_can_lookup(parent) || d_mountpoint(parent) ||
+		    IS_ENCRYPTED(pdir) || strcmp(name, "..") == 0 ||
+		    inode_permission(&nop_mnt_idmap, pdir, MAY_EXEC))
+			break;
+
+		if (ll_path_walk_cached(&parent, name)) {
+			name = ll_path_walk_name(&path);
+			continue;
+		}
+
+		while (name && nr < LL_PATH_WALK_MAX &&
+		       strcmp(name, "..") != 0) {
+			memset(&pwis[nr], 0, sizeof(pwis[nr]));
+			pwis[nr].pwi_name = (struct qstr)QSTR_INIT(name,
+								   strlen(name));
+			nr++;
+			name = ll_path_walk_name(&path);
+		}
+
+		found = ll_path_walk_rpc(&parent, pwis, nr);
+		if (found < 0)
+			GOTO(out, rc = found);
+
+		count += found;
+		if (found < nr)
+			break;
+	}
+
+	if (put_user(count, &uarg->lpw_count))
+		rc = -EFAULT;
+
+	CDEBUG(D_DENTRY, "%s: looked up %d components below "DFID"\n",
+	       sbi->ll_fsname, count, PFID(ll_inode2fid(dir)));
+out:
+	dput(parent);
+	if (pwis)
+		OBD_FREE_PTR_ARRAY(pwis, LL_PATH_WALK_MAX);
+	OBD_FREE(lpw, sizeof(*lpw) + path_size);
+
+	RETURN(rc);
+}
+
 #ifdef FMODE_CREATED /* added in Linux v4.18-rc1-20-g73a09dd */
 # define ll_is_opened(o, f)		((f)->f_mode & FMODE_OPENED)
 # define ll_finish_open(f, d, o)	finish_open((f), (d), NULL)
@@ -2076,6 +2515,9 @@ static int ll_mknod(struct mnt_idmap *map, struct inode *dir,
 	case S_IFBLK:
 	case S_IFIFO:
 	case S_IFSOCK:
+		err = ll_wbc_new_node(dir, dchild, mode, old_encode_dev(rdev));
+		if (err != -EAGAIN)
+			break;
 		err = ll_new_node(dir, dchild, NULL, mode, old_encode_dev(rdev),
 				  LUSTRE_OPC_MKNOD);
 		break;
@@ -2228,6 +2670,10 @@ static inline int do_mkdir(struct inode *dir, struct dentry *dchild,
 		GOTO(out_tally, rc);
 	}
 
+	rc = ll_wbc_new_node(dir, dchild, mode, 0);
+	if (rc != -EAGAIN)
+		GOTO(out_tally, rc);
+
 	mkdir_it.it_create_mode = mode;
 	rc = ll_new_node_prepare(dir, dchild, mode, LUSTRE_OPC_MKDIR, &encrypt,
 				 NULL, &op_data, &lum, &data, &datalen, NULL);
@@ -2236,6 +2682,10 @@ static inline int do_mkdir(struct inode *dir, struct dentry *dchild,
 
 	op_data->op_data = data;
 	op_data->op_data_size = datalen;
+	/* ask for an EX lock to cache creates in the new directory */
+	if (sbi->ll_wbc_enabled && !encrypt && !lum &&
+	    !test_bit(LL_SBI_FILE_SECCTX, sbi->ll_flags))
+		op_data->op_bias |= MDS_WBC_LOCK;
 	rc = md_intent_lock(sbi->ll_md_exp, op_data, &mkdir_it,
 			    &request, &ll_md_blocking_ast, 0);
 	if (rc)
@@ -2256,6 +2706,8 @@ static inline int do_mkdir(struct inode *dir, struct dentry *dchild,
 		ll_set_lock_data(sbi->ll_md_exp, inode, &mkdir_it, &bits);
 		if (bits & MDS_INODELOCK_LOOKUP)
 			d_lustre_revalidate(dchild);
+		if (op_data->op_bias & MDS_WBC_LOCK)
+			ll_wbc_mkdir_done(dir, inode, &mkdir_it);
 	}
 
 out_fini:
@@ -610,7 +610,7 @@ static void ll_readahead_handle_work(struct work_struct *wq)
 	work = container_of(wq, struct ll_readahead_work,
 			    lrw_readahead_work);
 	lfd = work->lrw_file->private_data;
-	ras = &lfd->fd_ras;
+	ras = work->lrw_ras;
 	file = work->lrw_file;
 	inode = file_inode(file);
 	sbi = ll_i2sbi(inode);
@@ -728,6 +728,124 @@ out_free_work:
 	ll_readahead_work_free(work);
 }
 
+/**
+ * ll_prefetch_data() - Read the head of a file into the page cache before
+ * it is opened.
+ *
+ * @inode: regular file to prefetch
+ * @bytes: maximum number of bytes to prefetch from the start of the file
+ *
+ * Used by the AGL thread of statahead when a process is reading the files
+ * of a directory one after another. Instead of only glimpsing the size, a
+ * PR extent lock is taken on the head of the file and its pages are sent
+ * as read-ahead pages, so that the later open+read is served from the
+ * page cache. The lock is only requested if it does not conflict with
+ * other clients, and no page is waited for.
+ *
+ * Return:
+ * * %>=0 number of pages sent for read, the size is known in any case
+ * * %negative errno if nothing was done, the caller should glimpse instead
+ */
+int ll_prefetch_data(struct inode *inode, loff_t bytes)
+{
+	struct ll_sb_info *sbi = ll_i2sbi(inode);
+	struct cl_object *clob = ll_i2info(inode)->lli_clob;
+	struct cl_lock_descr *descr;
+	struct cl_2queue *queue;
+	struct ra_io_arg *ria;
+	struct cl_lock *lock;
+	struct lu_env *env;
+	struct cl_io *io;
+	pgoff_t end_idx;
+	pgoff_t index;
+	__u16 refcheck;
+	__u64 kms;
+	int count = 0;
+	int rc;
+
+	ENTRY;
+
+	if (!clob || bytes <= 0 || !ll_readahead_enabled(sbi) ||
+	    IS_ENCRYPTED(inode))
+		RETURN(-EOPNOTSUPP);
+
+	env = cl_env_get(&refcheck);
+	if (IS_ERR(env))
+		RETURN(PTR_ERR(env));
+
+	io = vvp_env_new_io(env);
+	io->ci_obj = clob;
+	rc = cl_io_rw_init(env, io, CIT_READ, 0, bytes);
+	if (rc)
+		GOTO(out_io_fini, rc = rc > 0 ? -ENODATA : rc);
+
+	lock = vvp_env_new_lock(env);
+	descr = &lock->cll_descr;
+	descr->cld_obj = clob;
+	descr->cld_start = 0;
+	descr->cld_end = (bytes - 1) >> PAGE_SHIFT;
+	descr->cld_mode = CLM_READ;
+	descr->cld_enq_flags = CEF_MUST | CEF_NONBLOCK;
+
+	rc = cl_lock_request(env, io, lock);
+	if (rc < 0)
+		GOTO(out_io_fini, rc);
+
+	rc = ll_readahead_file_kms(env, io, &kms);
+	if (rc != 0 || kms == 0)
+		GOTO(out_lock, rc);
+
+	end_idx = (min_t(__u64, kms, bytes) - 1) >> PAGE_SHIFT;
+
+	ria = &ll_env_info(env)->lti_ria;
+	memset(ria, 0, sizeof(*ria));
+	ria->ria_end_idx = end_idx;
+	ria->ria_reserved = ll_ra_count_get(sbi, ria, end_idx + 1, 0);
+	if (ria->ria_reserved == 0) {
+		ll_ra_stats_inc_sbi(sbi, RA_STAT_MAX_IN_FLIGHT);
+		GOTO(out_lock, rc = 0);
+	}
+
+	queue = &io->ci_queue;
+	cl_2queue_init(queue);
+
+	for (index = 0; index <= end_idx && ria->ria_reserved > 0; index++) {
+		rc = ll_read_ahead_page(env, io, &queue->c2_qin, index,
+					MAYNEED);
+		if (rc == 0) {
+			count++;
+			ria->ria_reserved--;
+		} else if (rc < 0 && rc != -EBUSY) {
+			break;
+		}
+	}
+	if (ria->ria_reserved != 0)
+		ll_ra_count_put(sbi, ria->ria_reserved);
+
+	rc = 0;
+	if (queue->c2_qin.pl_nr > 0) {
+		rc = cl_io_submit_rw(env, io, CRT_READ, queue);
+		if (rc == 0) {
+			task_io_account_read(PAGE_SIZE * count);
+			ll_ra_stats_add(inode, RA_STAT_PREFETCH_PAGES, count);
+		}
+	}
+
+	cl_page_list_discard(env, io, &queue->c2_qin);
+	cl_page_list_disown(env, &queue->c2_qin);
+	cl_2queue_fini(env, queue);
+
+	CDEBUG(D_READA, DFID": prefetched %d pages of %llu bytes: rc = %d\n",
+	       PFID(ll_inode2fid(inode)), count, kms, rc);
+out_lock:
+	cl_lock_release(env, lock);
+out_io_fini:
+	cl_io_fini(env, io);
+	cl_env_put(env, &refcheck);
+
+	RETURN(rc < 0 ? rc : count);
+}
+
 static int ll_readahead(const struct lu_env *env, struct cl_io *io,
 			struct cl_page_list *queue, struct ra_io_arg *ria,
 			struct ll_readahead_state *ras, bool hit,
@@ -957,17 +1075,40 @@ static void ras_stride_reset(struct ll_readahead_state *ras)
 	RAS_CDEBUG(ras);
 }
 
-void ll_readahead_init(struct inode *inode, struct ll_readahead_state *ras)
+/*
+ * Start a new read stream at @pos, as if the file had just been opened and
+ * read from there. Called with the ras_lock held or from places where it
+ * doesn't matter.
+ */
+static void ras_stream_reset(struct ll_readahead_state *ras, loff_t pos)
 {
-	spin_lock_init(&ras->ras_lock);
-	ras->ras_rpc_pages = PTLRPC_MAX_BRW_PAGES;
-	ras_reset(ras, 0);
-	ras->ras_last_read_end_bytes = 0;
+	ras_reset(ras, pos >> PAGE_SHIFT);
+	ras_stride_reset(ras);
+	ras->ras_last_read_end_bytes = pos > 0 ? pos - 1 : 0;
 	ras->ras_requests = 0;
 	ras->ras_range_min_start_idx = 0;
 	ras->ras_range_max_end_idx = 0;
 	ras->ras_range_requests = 0;
 	ras->ras_last_range_pages = 0;
+	ras->ras_async_last_readpage_idx = 0;
+	ras->ras_whole_file_read = false;
+}
+
+void ll_readahead_init(struct inode *inode, struct ll_file_data *lfd)
+{
+	int i;
+
+	for (i = 0; i < LL_RA_STREAMS_MAX; i++) {
+		struct ll_readahead_state *ras = &lfd->fd_ras[i];
+
+		spin_lock_init(&ras->ras_lock);
+		ras->ras_stream = i;
+		ras->ras_stream_tick = 0;
+		ras->ras_rpc_pages = PTLRPC_MAX_BRW_PAGES;
+		ras_stream_reset(ras, 0);
+	}
+	lfd->fd_ras_cur = 0;
+	lfd->fd_ras_tick = 0;
 }
 
 /*
@@ -1245,6 +1386,119 @@ static void ras_detect_read_pattern(struct ll_readahead_state *ras,
 	RAS_CDEBUG(ras);
 }
 
+/* Whether an access at @pos continues the read stream @ras */
+static bool ras_stream_match(struct ll_sb_info *sbi,
+			     struct ll_readahead_state *ras,
+			     loff_t pos, size_t bytes, bool mmap)
+{
+	if (!ras->ras_stream_tick)
+		return false;
+
+	if (is_loose_seq_read(ras, pos) ||
+	    read_in_stride_window(ras, pos, bytes) ||
+	    (mmap && is_loose_mmap_read(sbi, ras, pos)))
+		return true;
+
+	/* a read of pages this stream has already read ahead */
+	return ras->ras_window_pages &&
+	       pos_in_window(pos >> PAGE_SHIFT, ras->ras_window_start_idx, 0,
+			     ras->ras_window_pages - 1);
+}
+
+/**
+ * ll_ras_select() - find the read stream an access belongs to
+ *
+ * @lfd: open file being read
+ * @sbi: superblock info of the file
+ * @pos: position where read is starting
+ * @bytes: length to be read
+ * @mmap: access from a page fault
+ *
+ * Readers such as HDF5 or NetCDF interleave several sequential or strided
+ * streams through one file descriptor. With a single read-ahead state, each
+ * switch between them looks like a seek and resets the window. Instead,
+ * up to ll_ra_info::ra_streams independent states are kept per open file.
+ *
+ * An access that continues one of the streams (see ras_stream_match()) is
+ * handed to it. Otherwise, a short forward jump from the last used stream
+ * stays with that stream, so that stride detection, which needs to see the
+ * jumps, and the read pattern reset on seek work as before. Any other
+ * access starts a new stream, recycling the least recently used one.
+ *
+ * The selection is done without locking, concurrent reads on one file
+ * descriptor can only make it less accurate.
+ *
+ * Returns the read-ahead state to use for the access, which also becomes
+ * the current stream of the file for the following page reads.
+ */
+static struct ll_readahead_state *ll_ras_select(struct ll_file_data *lfd,
+						struct ll_sb_info *sbi,
+						loff_t pos, size_t bytes,
+						bool mmap)
+{
+	unsigned int streams = min_t(unsigned int,
+				     READ_ONCE(sbi->ll_ra_info.ra_streams),
+				     LL_RA_STREAMS_MAX);
+	unsigned int cur_idx = READ_ONCE(lfd->fd_ras_cur);
+	struct ll_readahead_state *cur;
+	struct ll_readahead_state *lru = NULL;
+	loff_t jump_max;
+	int i;
+
+	if (streams <= 1 || cur_idx >= streams)
+		cur_idx = 0;
+	cur = &lfd->fd_ras[cur_idx];
+
+	if (streams <= 1 || !cur->ras_stream_tick ||
+	    ras_stream_match(sbi, cur, pos, bytes, mmap))
+		goto out;
+
+	for (i = 0; i < streams; i++) {
+		struct ll_readahead_state *ras = &lfd->fd_ras[i];
+
+		if (ras == cur)
+			continue;
+
+		if (ras_stream_match(sbi, ras, pos, bytes, mmap)) {
+			cur = ras;
+			goto out;
+		}
+
+		/* prefer an unused stream, then the least recently used */
+		if (!lru ||
+		    (lru->ras_stream_tick &&
+		     ras->ras_stream_tick < lru->ras_stream_tick))
+			lru = ras;
+	}
+
+	jump_max = (loff_t)sbi->ll_ra_info.ra_max_pages_per_file << PAGE_SHIFT;
+	if (!lru || (pos > cur->ras_last_read_end_bytes &&
+		     pos - cur->ras_last_read_end_bytes <= jump_max))
+		goto out;
+
+	spin_lock(&lru->ras_lock);
+	ras_stream_reset(lru, pos);
+	spin_unlock(&lru->ras_lock);
+	ll_ra_stats_inc_sbi(sbi, RA_STAT_STREAM_NEW);
+	CDEBUG(D_READA, "new read stream %u at %llu, last stream %u at %llu\n",
+	       lru->ras_stream, pos, cur->ras_stream,
+	       cur->ras_last_read_end_bytes);
+	cur = lru;
+out:
+	cur->ras_stream_tick = ++lfd->fd_ras_tick;
+	if (lfd->fd_ras_cur != cur->ras_stream)
+		WRITE_ONCE(lfd->fd_ras_cur, cur->ras_stream);
+
+	return cur;
+}
+
+/* Read stream of the current read(2) on @lfd, see ll_ras_select() */
+static inline struct ll_readahead_state *
+ll_ras_current(struct ll_file_data *lfd)
+{
+	return &lfd->fd_ras[READ_ONCE(lfd->fd_ras_cur)];
+}
+
 /**
  * ll_ras_enter() - used to detect read pattern according to pos and count
  *
@@ -1258,9 +1512,10 @@ static void ras_detect_read_pattern(struct ll_readahead_state *ras,
 void ll_ras_enter(struct file *f, loff_t pos, size_t bytes)
 {
 	struct ll_file_data *lfd = f->private_data;
-	struct ll_readahead_state *ras = &lfd->fd_ras;
 	struct inode *inode = file_inode(f);
 	struct ll_sb_info *sbi = ll_i2sbi(inode);
+	struct ll_readahead_state *ras = ll_ras_select(lfd, sbi, pos, bytes,
+						       false);
 
 	if (!spin_trylock(&ras->ras_lock))
 		return;
@@ -1345,6 +1600,8 @@ static void ras_update(struct ll_sb_info *sbi, struct inode *inode,
 		CDEBUG(D_READA|D_IOTRACE, DFID " pages at %lu miss.\n",
 		       PFID(ll_inode2fid(inode)), index);
 	ll_ra_stats_inc_sbi(sbi, hit ? RA_STAT_HIT : RA_STAT_MISS);
+	ll_ra_stats_inc_sbi(sbi, (hit ? RA_STAT_STREAM_HIT :
+				  RA_STAT_STREAM_MISS) + ras->ras_stream);
 
 	/*
 	 * The readahead window has been expanded to cover whole
@@ -1622,7 +1879,12 @@ int ll_io_read_page(const struct lu_env *env, struct cl_io *io,
 
 	if (file) {
 		lfd = file->private_data;
-		ras = &lfd->fd_ras;
+		if (mmap)
+			ras = ll_ras_select(lfd, sbi,
+				(loff_t)cl_page_index(page) << PAGE_SHIFT,
+				PAGE_SIZE, true);
+		else
+			ras = ll_ras_current(lfd);
 
 		if (file->f_mode & FMODE_RANDOM)
 			io->ci_rand_read = 1;
@@ -1740,6 +2002,7 @@ int ll_io_read_page(const struct lu_env *env, struct cl_io *io,
  * kickoff_async_readahead() - start asynchronous readahead
  *
  * @file: readahead for this open file
+ * @ras: read stream of @file to read ahead for
  * @pages: size of read ahead (in pages)
  *
  * Returns:
@@ -1748,13 +2011,13 @@ int ll_io_read_page(const struct lu_env *env, struct cl_io *io,
  * * %2 async readahead triggered and fast read could be used too.
  * * %-ENOMEM on error.
  */
-static int kickoff_async_readahead(struct file *file, unsigned long pages)
+static int kickoff_async_readahead(struct file *file,
+				   struct ll_readahead_state *ras,
+				   unsigned long pages)
 {
 	struct ll_readahead_work *lrw;
 	struct inode *inode = file_inode(file);
 	struct ll_sb_info *sbi = ll_i2sbi(inode);
-	struct ll_file_data *lfd = file->private_data;
-	struct ll_readahead_state *ras = &lfd->fd_ras;
 	struct ll_ra_info *ra = &sbi->ll_ra_info;
 	unsigned long throttle;
 	pgoff_t start_idx = ras_align(ras, ras->ras_next_readahead_idx);
@@ -1792,6 +2055,7 @@ static int kickoff_async_readahead(struct file *file, unsigned long pages)
 	if (lrw) {
 		atomic_inc(&sbi->ll_ra_info.ra_async_inflight);
 		lrw->lrw_file = get_file(file);
+		lrw->lrw_ras = ras;
 		lrw->lrw_start_idx = start_idx;
 		lrw->lrw_end_idx = end_idx;
 		lrw->lrw_user_pid = current->pid;
@@ -1837,7 +2101,7 @@ static bool ll_use_fast_io(struct file *file,
 	if (ras->ras_whole_file_read ||
 	    ras->ras_window_start_idx + ras->ras_window_pages <
 	    ras->ras_next_readahead_idx + skip_pages ||
-	    kickoff_async_readahead(file, fast_read_pages) > 0) {
+	    kickoff_async_readahead(file, ras, fast_read_pages) > 0) {
 		return true;
 	}
 
@@ -1920,7 +2184,7 @@ int ll_readpage(struct file *file, struct page *vmpage)
 	if (io == NULL) { /* fast read */
 		struct inode *inode = file_inode(file);
 		struct ll_file_data *lfd = file->private_data;
-		struct ll_readahead_state *ras = &lfd->fd_ras;
+		struct ll_readahead_state *ras;
 		struct lu_env  *local_env = NULL;
 
 		CDEBUG(D_VFSTRACE, "fast read pgno: %ld\n",
@@ -1943,8 +2207,14 @@ int ll_readpage(struct file *file, struct page *vmpage)
 		if (page->cp_defer_uptodate) {
 			enum ras_update_flags flags = LL_RAS_HIT;
 
-			if (lcc && lcc->lcc_type == LCC_MMAP)
+			if (lcc && lcc->lcc_type == LCC_MMAP) {
 				flags |= LL_RAS_MMAP;
+				ras = ll_ras_select(lfd, sbi,
+						    page_offset(vmpage),
+						    PAGE_SIZE, true);
+			} else {
+				ras = ll_ras_current(lfd);
+			}
 
 			/* For fast read, it updates read ahead state only
 			 * if the page is hit in cache because non cache page
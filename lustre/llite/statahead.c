@@ -61,6 +61,12 @@ struct sa_entry {
 	struct qstr			 se_qstr;
 	/* entry fid */
 	struct lu_fid			 se_fid;
+	/* stripe index in a striped directory, or -1 */
+	int				 se_stripe;
+	/* link into sas_queued until the stripe batch is sent */
+	struct list_head		 se_stripe_list;
+	/* time the stripe batch of the getattr was sent */
+	ktime_t				 se_sent;
 };
 
 static unsigned int sai_generation;
@@ -142,13 +148,244 @@ static inline bool sa_has_batch_handle(struct ll_statahead_info *sai)
 	return sai->sai_bh != NULL;
 }
 
+/*
+ * The getattrs queued in the batch of @sas are about to be sent: they are in
+ * flight from now on, and their latency is measured from now.
+ */
+static void sa_stripe_sending(struct ll_statahead_info *sai,
+			      struct ll_sa_stripe *sas)
+{
+	struct ll_inode_info *lli = ll_i2info(sai->sai_dentry->d_inode);
+	struct sa_entry *entry, *tmp;
+	ktime_t now = ktime_get();
+
+	spin_lock(&lli->lli_sa_lock);
+	list_for_each_entry_safe(entry, tmp, &sas->sas_queued, se_stripe_list) {
+		entry->se_sent = now;
+		list_del_init(&entry->se_stripe_list);
+	}
+	sas->sas_inflight += sas->sas_pending;
+	sas->sas_pending = 0;
+	spin_unlock(&lli->lli_sa_lock);
+}
+
+static void sa_stripe_flush(struct ll_statahead_info *sai,
+			    struct ll_sa_stripe *sas)
+{
+	sa_stripe_sending(sai, sas);
+	(void) md_batch_flush(ll_i2mdexp(sai->sai_dentry->d_inode),
+			      sas->sas_bh, false);
+}
+
 static inline void ll_statahead_flush_nowait(struct ll_statahead_info *sai)
 {
+	struct obd_export *exp = ll_i2mdexp(sai->sai_dentry->d_inode);
+	int i;
+
 	if (sa_has_batch_handle(sai)) {
 		sai->sai_index_end = sai->sai_index - 1;
-		(void) md_batch_flush(ll_i2mdexp(sai->sai_dentry->d_inode),
-				      sai->sai_bh, false);
+		(void) md_batch_flush(exp, sai->sai_bh, false);
+	}
+
+	for (i = 0; i < sai->sai_stripe_count; i++) {
+		struct ll_sa_stripe *sas = &sai->sai_stripes[i];
+
+		if (sas->sas_bh && sas->sas_pending)
+			sa_stripe_flush(sai, sas);
+	}
+}
+
+/* statahead window of a striped directory is the sum of stripe windows */
+static inline unsigned int sa_window_max(struct ll_statahead_info *sai)
+{
+	if (sai->sai_stripes)
+		return sai->sai_stripes_max;
+
+	return ll_i2sbi(sai->sai_dentry->d_inode)->ll_sa_max;
+}
+
+/*
+ * Size the window of every stripe from the getattr latency of its MDT. The
+ * scanner stats the entries of all stripes at about the same rate, so the
+ * getattrs a stripe needs in flight are proportional to its latency: the
+ * slowest stripe gets statahead_max, a stripe not replied yet statahead_min.
+ */
+static void sa_stripes_resize(struct ll_statahead_info *sai)
+{
+	struct inode *dir = sai->sai_dentry->d_inode;
+	struct ll_inode_info *lli = ll_i2info(dir);
+	struct ll_sb_info *sbi = ll_i2sbi(dir);
+	unsigned int total = 0;
+	__u64 lat_max = 0;
+	int i;
+
+	spin_lock(&lli->lli_sa_lock);
+	for (i = 0; i < sai->sai_stripe_count; i++)
+		lat_max = max(lat_max, sai->sai_stripes[i].sas_lat_us);
+
+	for (i = 0; i < sai->sai_stripe_count; i++) {
+		struct ll_sa_stripe *sas = &sai->sai_stripes[i];
+		unsigned int max = sbi->ll_sa_min;
+
+		if (sas->sas_lat_us)
+			max = max_t(unsigned int, max,
+				    div64_u64((__u64)sbi->ll_sa_max *
+					      sas->sas_lat_us, lat_max));
+		sas->sas_max = max;
+		total += max;
+	}
+	sai->sai_stripes_max = total;
+	spin_unlock(&lli->lli_sa_lock);
+}
+
+/* the window of @sas is full, a getattr can only be added after a reply */
+static inline bool sa_stripe_full(struct ll_sa_stripe *sas)
+{
+	return sas->sas_inflight &&
+	       sas->sas_inflight + sas->sas_pending >= max(sas->sas_max, 1U);
+}
+
+/*
+ * Account the reply of @entry to its stripe and its latency, average of 8,
+ * and let the statahead thread go on if it waits for room in the stripe.
+ */
+static void sa_stripe_replied(struct ll_statahead_info *sai,
+			      struct sa_entry *entry)
+{
+	struct ll_inode_info *lli = ll_i2info(sai->sai_dentry->d_inode);
+	struct ll_sa_stripe *sas = &sai->sai_stripes[entry->se_stripe];
+	bool full;
+	__u64 lat;
+
+	spin_lock(&lli->lli_sa_lock);
+	full = sa_stripe_full(sas);
+	if (!list_empty(&entry->se_stripe_list)) {
+		/* sent by md_batch_add() on a full batch, time unknown */
+		list_del_init(&entry->se_stripe_list);
+		sas->sas_pending--;
+	} else {
+		sas->sas_inflight--;
+		lat = max_t(s64, ktime_us_delta(ktime_get(), entry->se_sent),
+			    1);
+		if (sas->sas_lat_us)
+			sas->sas_lat_us = (sas->sas_lat_us * 7 + lat) >> 3;
+		else
+			sas->sas_lat_us = lat;
+	}
+	if (full && !sa_stripe_full(sas) && sai->sai_task)
+		wake_up_process(sai->sai_task);
+	spin_unlock(&lli->lli_sa_lock);
+}
+
+/*
+ * Wait until the stripe window has room, or the statahead thread is asked to
+ * stop. Like the window of the whole directory, give up after ll_sa_timeout.
+ */
+static void sa_stripe_wait(struct ll_statahead_info *sai,
+			   struct ll_sa_stripe *sas)
+{
+	struct ll_inode_info *lli = ll_i2info(sai->sai_dentry->d_inode);
+	struct ll_sb_info *sbi = ll_i2sbi(sai->sai_dentry->d_inode);
+	bool full;
+
+	while (({set_current_state(TASK_IDLE);
+		 /* matches smp_store_release() in ll_deauthorize_statahead() */
+		 smp_load_acquire(&sai->sai_task); })) {
+		spin_lock(&lli->lli_sa_lock);
+		full = sa_stripe_full(sas);
+		spin_unlock(&lli->lli_sa_lock);
+		if (!full)
+			break;
+
+		if (!schedule_timeout(cfs_time_seconds(sbi->ll_sa_timeout)))
+			break;
 	}
+	__set_current_state(TASK_RUNNING);
+}
+
+/*
+ * Statahead in a striped directory uses one batch per stripe, so that the
+ * MDT of a stripe is sent its getattrs as soon as enough are queued for it
+ * instead of when the window of the whole directory is full, and the window
+ * grows with the number of stripes rather than being shared by all MDTs.
+ */
+static void sa_stripes_init(struct ll_statahead_info *sai)
+{
+	struct inode *dir = sai->sai_dentry->d_inode;
+	struct ll_inode_info *lli = ll_i2info(dir);
+	struct lmv_stripe_object *lsm_obj = NULL;
+	unsigned int count;
+
+	down_read(&lli->lli_lsm_sem);
+	if (ll_dir_striped_locked(dir) &&
+	    !lmv_dir_layout_changing(lli->lli_lsm_obj) &&
+	    !lmv_dir_bad_hash(lli->lli_lsm_obj))
+		lsm_obj = lmv_stripe_object_get(lli->lli_lsm_obj);
+	up_read(&lli->lli_lsm_sem);
+
+	if (!lsm_obj)
+		return;
+
+	count = lsm_obj->lso_lsm.lsm_md_stripe_count;
+	if (count > 1)
+		OBD_ALLOC_PTR_ARRAY(sai->sai_stripes, count);
+	if (!sai->sai_stripes) {
+		lmv_stripe_object_put(&lsm_obj);
+		return;
+	}
+
+	sai->sai_lsm_obj = lsm_obj;
+	sai->sai_stripe_count = count;
+	while (count-- > 0)
+		INIT_LIST_HEAD(&sai->sai_stripes[count].sas_queued);
+	sa_stripes_resize(sai);
+	atomic_inc(&ll_i2sbi(dir)->ll_sa_striped_total);
+}
+
+/* stop the stripe batches, sending what is still queued */
+static void sa_stripes_stop(struct ll_statahead_info *sai)
+{
+	struct obd_export *exp = ll_i2mdexp(sai->sai_dentry->d_inode);
+	int rc;
+	int i;
+
+	for (i = 0; i < sai->sai_stripe_count; i++) {
+		struct ll_sa_stripe *sas = &sai->sai_stripes[i];
+
+		if (!sas->sas_bh)
+			continue;
+
+		sa_stripe_sending(sai, sas);
+		rc = md_batch_stop(exp, sas->sas_bh);
+		if (rc)
+			CDEBUG(D_READA, "%s: stop batch of stripe %d: rc = %d\n",
+			       ll_i2sbi(sai->sai_dentry->d_inode)->ll_fsname,
+			       i, rc);
+		sas->sas_bh = NULL;
+	}
+}
+
+/* free the stripe state, once all getattrs are replied */
+static void sa_stripes_fini(struct ll_statahead_info *sai)
+{
+	int i;
+
+	if (!sai->sai_stripes)
+		return;
+
+	for (i = 0; i < sai->sai_stripe_count; i++) {
+		struct ll_sa_stripe *sas = &sai->sai_stripes[i];
+
+		LASSERT(!sas->sas_bh);
+		LASSERT(list_empty(&sas->sas_queued));
+		CDEBUG(D_READA, "stripe %d: sent %llu latency %lluus max %u\n",
+		       i, sas->sas_sent, sas->sas_lat_us, sas->sas_max);
+	}
+
+	OBD_FREE_PTR_ARRAY(sai->sai_stripes, sai->sai_stripe_count);
+	sai->sai_stripes = NULL;
+	sai->sai_stripe_count = 0;
+	lmv_stripe_object_put(&sai->sai_lsm_obj);
 }
 
 static inline int agl_list_empty(struct ll_statahead_info *sai)
@@ -209,6 +446,8 @@ sa_alloc(struct dentry *parent, struct ll_statahead_info *sai, __u64 index,
 
 	entry->se_index = index;
 	entry->se_sai = sai;
+	entry->se_stripe = -1;
+	INIT_LIST_HEAD(&entry->se_stripe_list);
 
 	entry->se_state = SA_ENTRY_INIT;
 	entry->se_size = entry_size;
@@ -334,10 +573,11 @@ static void sa_put(struct inode *dir, struct ll_statahead_info *sai,
 
 		sai->sai_hit++;
 		sai->sai_consecutive_miss = 0;
-		if (sai->sai_max < sbi->ll_sa_max) {
-			sai->sai_max = min(2 * sai->sai_max, sbi->ll_sa_max);
+		if (sai->sai_max < sa_window_max(sai)) {
+			sai->sai_max = min(2 * sai->sai_max,
+					   sa_window_max(sai));
 			wakeup = true;
-		} else if (sai->sai_max_batch_count > 0) {
+		} else if (sai->sai_max_batch_count > 0 && !sai->sai_stripes) {
 			if (sai->sai_max >= sai->sai_max_batch_count &&
 			   (sai->sai_index_end - entry->se_index) %
 			   sai->sai_max_batch_count == 0) {
@@ -620,6 +860,7 @@ static struct ll_statahead_info *ll_sai_alloc(struct dentry *dentry)
 
 	atomic_set(&sai->sai_cache_count, 0);
 	atomic_set(&sai->sai_inuse_count, 0);
+	atomic_set(&sai->sai_data_opens, 0);
 	spin_lock(&sai_generation_lock);
 	lli->lli_sa_generation = ++sai_generation;
 	if (unlikely(sai_generation == 0))
@@ -671,6 +912,19 @@ static void ll_sai_put(struct ll_statahead_info *sai)
 	}
 }
 
+/*
+ * Whether the process running statahead also reads most of the files it
+ * stats, so that their data is worth being prefetched by AGL.
+ */
+static inline bool sai_data_sweep(struct ll_statahead_info *sai)
+{
+	unsigned int opens = atomic_read(&sai->sai_data_opens);
+	struct inode *dir = sai->sai_dentry->d_inode;
+
+	return ll_i2sbi(dir)->ll_sa_data_max > 0 &&
+	       opens >= LL_SA_DATA_OPENS_MIN && opens * 2 >= sai->sai_hit;
+}
+
 /* Do NOT forget to drop inode refcount when into sai_agls. */
 static void ll_agl_trigger(struct inode *inode, struct ll_statahead_info *sai)
 {
@@ -738,7 +992,16 @@ static void ll_agl_trigger(struct inode *inode, struct ll_statahead_info *sai)
 	       "Handling (init) async glimpse: inode = " DFID", idx = %llu\n",
 	       PFID(&lli->lli_fid), index);
 
-	cl_agl(inode);
+	/*
+	 * The files of the directory are being read in order, e.g. by tar or
+	 * a data loader, read the head of this one under a PR lock, which
+	 * also gives its size. Otherwise, or if the lock conflicts, glimpse.
+	 */
+	rc = -EOPNOTSUPP;
+	if (sai_data_sweep(sai))
+		rc = ll_prefetch_data(inode, ll_i2sbi(inode)->ll_sa_data_max);
+	if (rc < 0)
+		cl_agl(inode);
 	lli->lli_agl_index = 0;
 	lli->lli_glimpse_time = ktime_get();
 	up_write(&lli->lli_glimpse_sem);
@@ -768,6 +1031,9 @@ static void ll_statahead_interpret_fini(struct ll_inode_info *lli,
 	sa_fini_data(item);
 	if (req)
 		ptlrpc_req_put(req);
+	/* @entry may be freed by the scanner as soon as it is ready */
+	if (entry->se_stripe >= 0)
+		sa_stripe_replied(sai, entry);
 	sa_make_ready(sai, entry, rc);
 
 	spin_lock(&lli->lli_sa_lock);
@@ -779,6 +1045,7 @@ static void ll_statahead_interpret_work(struct work_struct *work)
 {
 	struct md_op_item *item = container_of(work, struct md_op_item,
 					       mop_work);
+	enum mds_ibits_locks bits = MDS_INODELOCK_NONE;
 	struct req_capsule *pill = item->mop_pill;
 	struct inode *dir = item->mop_dir;
 	struct ll_inode_info *lli = ll_i2info(dir);
@@ -855,7 +1122,9 @@ static void ll_statahead_interpret_work(struct work_struct *work)
 	CDEBUG(D_READA, "%s: setting "DNAME""DFID" l_data to inode %p\n",
 	       ll_i2sbi(dir)->ll_fsname, encode_fn_qstr(entry->se_qstr),
 	       PFID(ll_inode2fid(child)), child);
-	ll_set_lock_data(ll_i2sbi(dir)->ll_md_exp, child, it, NULL);
+	ll_set_lock_data(ll_i2sbi(dir)->ll_md_exp, child, it, &bits);
+	if (bits & MDS_INODELOCK_XATTR)
+		ll_xattr_cache_prefetch(child, pill);
 
 	entry->se_inode = child;
 
@@ -956,12 +1225,103 @@ out:
 	RETURN(rc);
 }
 
+/* stripe of the @item name in a striped directory, or -1 */
+static int sa_stripe_index(struct ll_statahead_info *sai,
+			   struct md_op_item *item)
+{
+	const struct md_op_data *op_data = &item->mop_data;
+	const struct lmv_stripe_md *lsm;
+	int index;
+
+	if (!sai->sai_stripes || !op_data->op_name || !op_data->op_namelen)
+		return -1;
+
+	lsm = &sai->sai_lsm_obj->lso_lsm;
+	index = __lmv_name_to_stripe_index(lsm->lsm_md_hash_type,
+					   lsm->lsm_md_stripe_count,
+					   lsm->lsm_md_migrate_hash,
+					   lsm->lsm_md_migrate_offset,
+					   op_data->op_name,
+					   op_data->op_namelen, true);
+	if (index < 0 || index >= sai->sai_stripe_count)
+		return -1;
+
+	return index;
+}
+
+/*
+ * add @item to the batch of its stripe, which is sent once half of the
+ * stripe window is queued, so the stripe MDT always has getattrs to do.
+ * No more than the stripe window is in flight to the MDT of the stripe.
+ */
+static int sa_stripe_getattr(struct ll_statahead_info *sai, struct inode *dir,
+			     struct md_op_item *item)
+{
+	struct ll_inode_info *lli = ll_i2info(sai->sai_dentry->d_inode);
+	struct sa_entry *entry = item->mop_cbdata;
+	struct ll_sa_stripe *sas = &sai->sai_stripes[entry->se_stripe];
+	unsigned int batch;
+	bool flush;
+	bool full;
+	int rc;
+
+	if (!sas->sas_bh) {
+		struct lu_batch *bh;
+
+		bh = md_batch_create(ll_i2mdexp(dir), BATCH_FL_RDONLY,
+				     sai->sai_max_batch_count);
+		if (IS_ERR(bh))
+			return PTR_ERR(bh);
+		sas->sas_bh = bh;
+	}
+
+	spin_lock(&lli->lli_sa_lock);
+	full = sa_stripe_full(sas);
+	spin_unlock(&lli->lli_sa_lock);
+	if (full) {
+		if (sas->sas_pending)
+			sa_stripe_flush(sai, sas);
+		sa_stripe_wait(sai, sas);
+	}
+
+	/* queued before the add, the reply may come from a full batch */
+	spin_lock(&lli->lli_sa_lock);
+	list_add_tail(&entry->se_stripe_list, &sas->sas_queued);
+	sas->sas_pending++;
+	spin_unlock(&lli->lli_sa_lock);
+
+	rc = md_batch_add(ll_i2mdexp(dir), sas->sas_bh, item);
+	if (rc < 0) {
+		spin_lock(&lli->lli_sa_lock);
+		list_del_init(&entry->se_stripe_list);
+		sas->sas_pending--;
+		spin_unlock(&lli->lli_sa_lock);
+		return rc;
+	}
+
+	sas->sas_sent++;
+	batch = clamp(sas->sas_max / 2, 1U, sai->sai_max_batch_count);
+	spin_lock(&lli->lli_sa_lock);
+	flush = sas->sas_pending >= batch;
+	spin_unlock(&lli->lli_sa_lock);
+	if (flush) {
+		sa_stripe_flush(sai, sas);
+		sa_stripes_resize(sai);
+	}
+
+	return 0;
+}
+
 static inline int sa_getattr(struct ll_statahead_info *sai, struct inode *dir,
 			     struct md_op_item *item)
 {
+	struct sa_entry *entry = item->mop_cbdata;
 	int rc;
 
-	if (sa_has_batch_handle(sai))
+	entry->se_stripe = sa_stripe_index(sai, item);
+	if (entry->se_stripe >= 0)
+		rc = sa_stripe_getattr(sai, dir, item);
+	else if (sa_has_batch_handle(sai))
 		rc = md_batch_add(ll_i2mdexp(dir), sai->sai_bh, item);
 	else
 		rc = md_intent_getattr_async(ll_i2mdexp(dir), item);
@@ -1556,6 +1916,8 @@ static int ll_statahead_thread(void *arg)
 				     sai->sai_max_batch_count);
 		if (IS_ERR(bh))
 			GOTO(out_stop_agl, rc = PTR_ERR(bh));
+
+		sa_stripes_init(sai);
 	}
 
 	sai->sai_bh = bh;
@@ -1606,6 +1968,7 @@ static int ll_statahead_thread(void *arg)
 	if (bh) {
 		rc = md_batch_stop(ll_i2mdexp(dir), sai->sai_bh);
 		sai->sai_bh = NULL;
+		sa_stripes_stop(sai);
 	}
 
 out_stop_agl:
@@ -1619,6 +1982,8 @@ out_stop_agl:
 		/* in case we're not woken up, timeout wait */
 		msleep(125);
 
+	sa_stripes_fini(sai);
+
 	CDEBUG(D_READA, "%s: statahead thread stopped: sai %p, parent %pd hit %llu miss %llu\n",
 	       sbi->ll_fsname, sai, parent, sai->sai_hit, sai->sai_miss);
 
@@ -2752,6 +3117,28 @@ out:
 	RETURN(rc);
 }
 
+/**
+ * ll_statahead_open() - Account a regular file opened for read in @dir.
+ *
+ * @dir: parent directory of the opened file
+ *
+ * If a statahead is running on @dir, the open is counted so that the AGL
+ * thread can tell a plain "ls -l" from a sweep reading every file, and
+ * prefetch the data of the next entries in the latter case.
+ */
+void ll_statahead_open(struct inode *dir)
+{
+	struct ll_inode_info *lli = ll_i2info(dir);
+
+	if (!lli->lli_sai)
+		return;
+
+	spin_lock(&lli->lli_sa_lock);
+	if (lli->lli_sai)
+		atomic_inc(&lli->lli_sai->sai_data_opens);
+	spin_unlock(&lli->lli_sa_lock);
+}
+
 /*
  * This function is called in each stat() system call to do statahead check.
  * When the files' naming of stat() call sequence under a directory follows
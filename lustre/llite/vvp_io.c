@@ -530,6 +530,50 @@ static void vvp_io_update_iov(const struct lu_env *env,
 	iov_iter_truncate(vio->vui_iter, size);
 }
 
+/* consecutive IOs with the same size and distance before reporting a stride */
+#define VVP_LOCK_STRIDE_HITS	2
+
+/**
+ * Track the IO pattern on the file descriptor and, once a stable stride is
+ * seen, attach it to the lock descriptor so that the server can grant an
+ * extent which does not reach into the chunks accessed by other clients.
+ */
+static void vvp_io_lock_stride(struct vvp_io *vio, struct cl_io *io,
+			       struct cl_lock_descr *descr)
+{
+	struct inode *inode = vvp_object_inode(io->ci_obj);
+	loff_t pos = io->u.ci_rw.crw_pos;
+	size_t bytes = io->u.ci_rw.crw_bytes;
+	struct ll_lock_stride *lls;
+
+	if (!vio->vui_fd || !ll_sbi_has_stride_lock(ll_i2sbi(inode)))
+		return;
+
+	if (io->ci_type == CIT_WRITE && io->u.ci_wr.wr_append)
+		return;
+
+	lls = &vio->vui_fd->fd_lock_stride;
+	if (bytes == lls->lls_last_bytes && pos > lls->lls_last_pos &&
+	    pos - lls->lls_last_pos == lls->lls_length) {
+		lls->lls_hits++;
+	} else {
+		lls->lls_length = pos > lls->lls_last_pos ?
+				  pos - lls->lls_last_pos : 0;
+		lls->lls_hits = 0;
+	}
+	lls->lls_last_pos = pos;
+	lls->lls_last_bytes = bytes;
+
+	if (lls->lls_hits < VVP_LOCK_STRIDE_HITS || lls->lls_length <= bytes)
+		return;
+
+	descr->cld_stride.cls_offset = pos;
+	descr->cld_stride.cls_length = lls->lls_length;
+	descr->cld_stride.cls_bytes = bytes;
+	CDEBUG(D_VFSTRACE, "stride %zu/%llu at %lld\n",
+	       bytes, lls->lls_length, pos);
+}
+
 static int vvp_io_rw_lock(const struct lu_env *env, struct cl_io *io,
 			  enum cl_lock_mode mode, loff_t start, loff_t end)
 {
@@ -564,6 +608,8 @@ static int vvp_io_rw_lock(const struct lu_env *env, struct cl_io *io,
 	result = vvp_mmap_locks(env, vio, io);
 	if (result == 0)
 		result = vvp_io_one_lock(env, io, ast_flags, mode, start, end);
+	if (result == 0)
+		vvp_io_lock_stride(vio, io, &vio->vui_link.cill_descr);
 
 	RETURN(result);
 }
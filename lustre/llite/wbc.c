@@ -0,0 +1,991 @@
+// SPDX-License-Identifier: GPL-2.0
+
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ *
+ * Metadata writeback cache for create-heavy workloads.
+ *
+ * When intent mkdir is granted an EX lock on the new directory, nobody else
+ * can look into that directory until the lock is revoked, so the client may
+ * create entries in it without asking the MDT.  mkdir(2) and mknod(2) in such
+ * a directory allocate the FID locally, instantiate the inode from a locally
+ * built mdt_body and queue the create on ll_sb_info::ll_wbc_list.  A cached
+ * directory may itself hold cached entries, so whole subtrees ("mkdir -p",
+ * untar of a directory tree) are built without a single RPC.
+ *
+ * The queue is written back in creation order, which sends a parent before
+ * its children:
+ *  - after ll_sb_info::ll_wbc_delay_ms by a delayed work,
+ *  - before any RPC that names a cached inode, only that inode and its cached
+ *    parents, see ll_prep_md_op_data(),
+ *  - before readdir of a directory holding cached entries,
+ *  - on fsync() of a directory, and at umount,
+ *  - when the EX lock is revoked, so another client never sees the directory
+ *    without the cached entries.
+ *
+ * Readdir and a revoked lock only send the entries of that one directory,
+ * see ll_wbc_flush_children().  On a blocking AST this is done by a work
+ * item which releases the lock afterwards, see ll_wbc_revoke(), and every
+ * create flagged MDS_WBC_FLUSH prolongs the lock on the MDT like I/O under
+ * an extent lock does, so a long queue does not get the client evicted.
+ *
+ * open(O_CREAT) is not cached, but does not take the EX lock back from a
+ * directory holding cached creates, see ll_wbc_open_prep().
+ *
+ * Creates are only cached while the quotas of their owner and the free
+ * inodes of the MDTs leave room for them, see ll_wbc_reserve(), so EDQUOT
+ * and ENOSPC are returned by the create itself.
+ *
+ * Each write back is a plain create with the pre-allocated FID flagged
+ * MDS_WBC_FLUSH, for which the MDT skips the parent lock if this client
+ * still holds the EX lock on the parent.  Directories are written back with
+ * intent mkdir asking for MDS_WBC_LOCK again, so their subtrees stay cached.
+ * The batch RPC only packs getattr sub-requests, so there is one create RPC
+ * per entry, but entries whose parents are on the MDT already are sent
+ * LL_WBC_FLUSH_RPCS at a time, see ll_wbc_flush_list().
+ */
+
+#define DEBUG_SUBSYSTEM S_LLITE
+
+#include <linux/fs.h>
+#include <linux/sched.h>
+#include <linux/mm.h>
+#include <linux/iversion.h>
+#include <linux/workqueue.h>
+#include <obd_support.h>
+#include <lustre_dlm.h>
+#include "llite_internal.h"
+
+/* creates written back at the same time */
+struct ll_wbc_wave {
+	struct ll_sb_info	*lww_sbi;
+	atomic_t		 lww_slot;	/* in ll_wbc_flushers[] */
+	atomic_t		 lww_pending;
+	struct completion	 lww_done;
+	int			 lww_rc;	/* first error */
+};
+
+struct ll_wbc_entry {
+	struct list_head	 lwe_list;	/* on ll_sb_info::ll_wbc_list */
+	/* sends the create next to others, see ll_wbc_flush_list() */
+	struct work_struct	 lwe_work;
+	struct ll_wbc_wave	*lwe_wave;
+	struct inode		*lwe_dir;
+	struct inode		*lwe_inode;
+	/* pins the dentry, a cached entry cannot be looked up again */
+	struct dentry		*lwe_dentry;
+	umode_t			 lwe_mode;
+	__u64			 lwe_rdev;
+	__u32			 lwe_fsuid;
+	__u32			 lwe_fsgid;
+	__u32			 lwe_suppgid;
+	kernel_cap_t		 lwe_cap;
+	s64			 lwe_time;
+	int			 lwe_namelen;
+	char			 lwe_name[];
+};
+
+#define LWE_SIZE(namelen) offsetof(struct ll_wbc_entry, lwe_name[(namelen) + 1])
+
+/* allocate the FID of a cached create on the MDT of its parent */
+static int ll_wbc_fid_alloc(struct inode *dir, struct lu_fid *fid)
+{
+	struct ll_sb_info *sbi = ll_i2sbi(dir);
+	struct md_op_data *op_data;
+	int rc;
+
+	OBD_ALLOC_PTR(op_data);
+	if (!op_data)
+		return -ENOMEM;
+
+	op_data->op_flags |= MF_GET_MDT_IDX;
+	op_data->op_fid1 = *ll_inode2fid(dir);
+	rc = md_getattr(sbi->ll_md_exp, op_data, NULL);
+	if (!rc)
+		rc = md_fid_alloc(NULL, sbi->ll_md_exp, fid, op_data);
+	OBD_FREE_PTR(op_data);
+
+	return rc;
+}
+
+/* build the attributes the MDT would give the new inode */
+static void ll_wbc_fill_body(struct inode *dir, struct mdt_body *body,
+			     const struct lu_fid *fid, umode_t mode,
+			     __u64 rdev, s64 now)
+{
+	struct ll_inode_info *dlli = ll_i2info(dir);
+
+	body->mbo_valid = OBD_MD_FLID | OBD_MD_FLTYPE | OBD_MD_FLMODE |
+			  OBD_MD_FLUID | OBD_MD_FLGID | OBD_MD_FLNLINK |
+			  OBD_MD_FLATIME | OBD_MD_FLMTIME | OBD_MD_FLCTIME |
+			  OBD_MD_FLSIZE | OBD_MD_FLBLOCKS | OBD_MD_FLRDEV |
+			  OBD_MD_FLPROJID | OBD_MD_FLFLAGS;
+	body->mbo_fid1 = *fid;
+	body->mbo_uid = from_kuid(&init_user_ns, current_fsuid());
+	if (dir->i_mode & S_ISGID) {
+		body->mbo_gid = from_kgid(&init_user_ns, dir->i_gid);
+		if (S_ISDIR(mode))
+			mode |= S_ISGID;
+	} else {
+		body->mbo_gid = from_kgid(&init_user_ns, current_fsgid());
+	}
+	body->mbo_mode = mode;
+	body->mbo_nlink = S_ISDIR(mode) ? 2 : 1;
+	body->mbo_atime = now;
+	body->mbo_mtime = now;
+	body->mbo_ctime = now;
+	body->mbo_rdev = rdev;
+	if (test_bit(LLIF_PROJECT_INHERIT, &dlli->lli_flags)) {
+		body->mbo_projid = dlli->lli_projid;
+		if (S_ISDIR(mode))
+			body->mbo_flags |= LUSTRE_PROJINHERIT_FL;
+	}
+}
+
+/* lower @headroom to the inodes left in the quota of @id */
+static int ll_wbc_quota_headroom(struct ll_sb_info *sbi, int type, __u32 id,
+				 __u64 *headroom)
+{
+	struct obd_quotactl *oqctl;
+	__u64 limit;
+	int rc;
+
+	OBD_ALLOC_PTR(oqctl);
+	if (!oqctl)
+		return -ENOMEM;
+
+	oqctl->qc_cmd = Q_GETQUOTA;
+	oqctl->qc_type = type;
+	oqctl->qc_id = id;
+	rc = obd_quotactl(sbi->ll_md_exp, oqctl);
+	/* no limit for @id, or quota is not enforced */
+	if (rc == -ESRCH || rc == -EOPNOTSUPP)
+		GOTO(out, rc = 0);
+	if (rc)
+		GOTO(out, rc);
+
+	/* the soft limit fails creates once the grace time is over */
+	limit = oqctl->qc_dqblk.dqb_isoftlimit ?:
+		oqctl->qc_dqblk.dqb_ihardlimit;
+	if (!limit)
+		GOTO(out, rc = 0);
+
+	/* the usage is kept by the MDTs, not by the quota master */
+	if (!(oqctl->qc_dqblk.dqb_valid & QIF_INODES)) {
+		oqctl->qc_cmd = Q_GETOQUOTA;
+		oqctl->qc_dqblk.dqb_curinodes = 0;
+		rc = obd_quotactl(sbi->ll_md_exp, oqctl);
+		if (rc && rc != -EREMOTEIO)
+			GOTO(out, rc);
+		rc = 0;
+	}
+
+	if (oqctl->qc_dqblk.dqb_curinodes >= limit)
+		*headroom = 0;
+	else
+		*headroom = min(*headroom,
+				limit - oqctl->qc_dqblk.dqb_curinodes);
+out:
+	OBD_FREE_PTR(oqctl);
+
+	return rc;
+}
+
+/*
+ * A create is only cached once it is known to fit in the inode quotas of its
+ * owner and in the free inodes of the MDTs, an error from the write back
+ * could only be reported by a later fsync().  The headroom is looked up at
+ * most once a second, for one owner at a time, and half of it is shared by
+ * the cached creates of that owner: other clients may create at the same
+ * time.  A create that does not fit is sent right away and gets the
+ * EDQUOT or ENOSPC error itself.
+ */
+static bool ll_wbc_reserve(struct ll_sb_info *sbi, __u32 uid, __u32 gid,
+			   __u32 projid)
+{
+	time64_t now = ktime_get_seconds();
+	struct obd_statfs osfs;
+	__u64 headroom = 0;
+	bool looked_up;
+	bool fit;
+	int rc;
+
+	spin_lock(&sbi->ll_wbc_lock);
+	looked_up = sbi->ll_wbc_budget_uid == uid &&
+		    sbi->ll_wbc_budget_gid == gid &&
+		    sbi->ll_wbc_budget_projid == projid &&
+		    sbi->ll_wbc_budget_time >= now - 1;
+	fit = looked_up && sbi->ll_wbc_budget > 0;
+	if (fit)
+		sbi->ll_wbc_budget--;
+	spin_unlock(&sbi->ll_wbc_lock);
+	if (fit || looked_up)
+		return fit;
+
+	mutex_lock(&sbi->ll_wbc_budget_mutex);
+	rc = obd_statfs(NULL, sbi->ll_md_exp, &osfs,
+			now - OBD_STATFS_CACHE_SECONDS, OBD_STATFS_NODELAY);
+	if (!rc && !(osfs.os_state & (OS_STATFS_READONLY | OS_STATFS_NOCREATE |
+				       OS_STATFS_ENOSPC | OS_STATFS_ENOINO)))
+		headroom = osfs.os_ffree;
+	if (headroom)
+		rc = ll_wbc_quota_headroom(sbi, USRQUOTA, uid, &headroom);
+	if (headroom && !rc)
+		rc = ll_wbc_quota_headroom(sbi, GRPQUOTA, gid, &headroom);
+	if (headroom && !rc && projid)
+		rc = ll_wbc_quota_headroom(sbi, PRJQUOTA, projid, &headroom);
+	if (rc)
+		headroom = 0;
+
+	spin_lock(&sbi->ll_wbc_lock);
+	/* the creates still queued are not counted by the MDT yet */
+	headroom = headroom > sbi->ll_wbc_count ?
+		   (headroom - sbi->ll_wbc_count) / 2 : 0;
+	fit = headroom > 0;
+	sbi->ll_wbc_budget = fit ? headroom - 1 : 0;
+	sbi->ll_wbc_budget_uid = uid;
+	sbi->ll_wbc_budget_gid = gid;
+	sbi->ll_wbc_budget_projid = projid;
+	sbi->ll_wbc_budget_time = now;
+	spin_unlock(&sbi->ll_wbc_lock);
+	mutex_unlock(&sbi->ll_wbc_budget_mutex);
+
+	CDEBUG(D_INODE, "%s: %llu creates of %u:%u:%u can be cached: rc = %d\n",
+	       sbi->ll_fsname, headroom, uid, gid, projid, rc);
+
+	return fit;
+}
+
+/**
+ * ll_wbc_new_node() - create an inode in the metadata writeback cache
+ * @dir: parent directory, locked by the VFS
+ * @dchild: negative dentry of the new entry
+ * @mode: file type and permissions, umask already applied by the caller
+ *        unless the MDT applies it
+ * @rdev: encoded device number for mknod
+ *
+ * Return:
+ * * %0 on success, @dchild is instantiated
+ * * %-EAGAIN if the create cannot be cached, the caller should send it
+ * * negative errno on failure
+ */
+int ll_wbc_new_node(struct inode *dir, struct dentry *dchild, umode_t mode,
+		    __u64 rdev)
+{
+	struct ll_sb_info *sbi = ll_i2sbi(dir);
+	struct ll_inode_info *dlli = ll_i2info(dir);
+	struct lustre_handle lockh = { 0 };
+	enum ldlm_mode lock_mode = 0;
+	struct lustre_md md = { NULL };
+	struct ll_wbc_entry *lwe;
+	struct inode *inode;
+	struct lu_fid fid;
+	bool first;
+	s64 now;
+	int rc;
+
+	ENTRY;
+
+	if (!sbi->ll_wbc_enabled || !test_bit(LLIF_WBC_DIR, &dlli->lli_flags))
+		RETURN(-EAGAIN);
+
+	if (test_bit(LL_SBI_FILE_SECCTX, sbi->ll_flags) || IS_ENCRYPTED(dir))
+		RETURN(-EAGAIN);
+
+	if (READ_ONCE(sbi->ll_wbc_count) >= sbi->ll_wbc_max) {
+		mod_delayed_work(system_wq, &sbi->ll_wbc_work, 0);
+		RETURN(-EAGAIN);
+	}
+
+	/* the owner ll_wbc_fill_body() gives the new inode */
+	if (!ll_wbc_reserve(sbi, from_kuid(&init_user_ns, current_fsuid()),
+			    from_kgid(&init_user_ns, dir->i_mode & S_ISGID ?
+					    dir->i_gid : current_fsgid()),
+			    test_bit(LLIF_PROJECT_INHERIT, &dlli->lli_flags) ?
+					    dlli->lli_projid : 0))
+		RETURN(-EAGAIN);
+
+	if (!ll_wbc_pending(dir)) {
+		union ldlm_policy_data policy = {
+			.l_inodebits = { MDS_INODELOCK_UPDATE } };
+
+		/* the reference keeps the lock from being cancelled until
+		 * the create is queued
+		 */
+		lock_mode = md_lock_match(sbi->ll_md_exp, LDLM_FL_BLOCK_GRANTED,
+					  ll_inode2fid(dir), LDLM_IBITS,
+					  &policy, LCK_EX, 0, &lockh);
+		if (!lock_mode)
+			RETURN(-EAGAIN);
+	}
+
+	/* LLIF_WBC_DIR is only set without a default ACL on @dir, so the MDT
+	 * would apply the umask itself.
+	 */
+	if (IS_POSIXACL(dir) && exp_connect_umask(ll_i2mdexp(dir)))
+		mode &= ~current_umask();
+
+	rc = ll_wbc_fid_alloc(dir, &fid);
+	if (rc)
+		GOTO(out_lock, rc);
+
+	OBD_ALLOC(lwe, LWE_SIZE(dchild->d_name.len));
+	if (!lwe)
+		GOTO(out_lock, rc = -ENOMEM);
+
+	OBD_ALLOC_PTR(md.body);
+	if (!md.body)
+		GOTO(out_free, rc = -ENOMEM);
+
+	now = ktime_get_real_seconds();
+	ll_wbc_fill_body(dir, md.body, &fid, mode, rdev, now);
+	inode = ll_iget(dir->i_sb,
+			cl_fid_build_ino(&fid, ll_need_32bit_api(sbi)), &md);
+	OBD_FREE_PTR(md.body);
+	if (IS_ERR(inode))
+		GOTO(out_free, rc = PTR_ERR(inode));
+
+	set_bit(LLIF_WBC_PENDING, &ll_i2info(inode)->lli_flags);
+	/* only intent mkdir gets the EX lock the entries need once the
+	 * directory is on the MDT, another client could create the same
+	 * names in between otherwise
+	 */
+	if (S_ISDIR(mode) && sbi->ll_intent_mkdir_enabled)
+		set_bit(LLIF_WBC_DIR, &ll_i2info(inode)->lli_flags);
+
+	INIT_LIST_HEAD(&lwe->lwe_list);
+	lwe->lwe_dir = igrab(dir);
+	lwe->lwe_inode = igrab(inode);
+	lwe->lwe_dentry = dget(dchild);
+	lwe->lwe_mode = mode;
+	lwe->lwe_rdev = rdev;
+	lwe->lwe_fsuid = from_kuid(&init_user_ns, current_fsuid());
+	lwe->lwe_fsgid = from_kgid(&init_user_ns, current_fsgid());
+	lwe->lwe_suppgid = ll_i2suppgid(dir);
+	lwe->lwe_cap = current_cap();
+	lwe->lwe_time = now;
+	lwe->lwe_namelen = dchild->d_name.len;
+	memcpy(lwe->lwe_name, dchild->d_name.name, dchild->d_name.len);
+
+	/* the entry is only known to this client, it is valid until the
+	 * create is written back
+	 */
+	d_lustre_revalidate(dchild);
+
+	atomic_inc(&dlli->lli_wbc_children);
+	spin_lock(&sbi->ll_wbc_lock);
+	/* a cached parent must still be queued, so @lwe is sent after it */
+	if (!lock_mode && !ll_wbc_pending(dir)) {
+		spin_unlock(&sbi->ll_wbc_lock);
+		atomic_dec(&dlli->lli_wbc_children);
+		d_lustre_invalidate(dchild);
+		clear_nlink(inode);
+		iput(inode);
+		GOTO(out_free, rc = -EAGAIN);
+	}
+	list_add_tail(&lwe->lwe_list, &sbi->ll_wbc_list);
+	first = sbi->ll_wbc_count++ == 0;
+	spin_unlock(&sbi->ll_wbc_lock);
+
+	atomic_inc(&sbi->ll_wbc_cached);
+	if (first)
+		schedule_delayed_work(&sbi->ll_wbc_work,
+				      msecs_to_jiffies(sbi->ll_wbc_delay_ms));
+
+	if (S_ISDIR(mode))
+		inc_nlink(dir);
+	inode_set_mtime(dir, now, 0);
+	inode_set_ctime(dir, now, 0);
+	/* readdir pages cached under the EX lock miss the new entry */
+	truncate_inode_pages(dir->i_mapping, 0);
+	inode_inc_iversion(dir);
+
+	d_instantiate(dchild, inode);
+
+	rc = ll_inode_init_security(dchild, inode, dir);
+
+	CDEBUG(D_INODE, "%s: cached create of "DNAME" "DFID" in "DFID"\n",
+	       sbi->ll_fsname, encode_fn_dentry(dchild), PFID(&fid),
+	       PFID(ll_inode2fid(dir)));
+	GOTO(out_lock, rc);
+
+out_free:
+	if (lwe->lwe_inode)
+		iput(lwe->lwe_inode);
+	if (lwe->lwe_dentry)
+		dput(lwe->lwe_dentry);
+	if (lwe->lwe_dir)
+		iput(lwe->lwe_dir);
+	OBD_FREE(lwe, LWE_SIZE(dchild->d_name.len));
+out_lock:
+	if (lock_mode)
+		ldlm_lock_decref(&lockh, lock_mode);
+
+	RETURN(rc);
+}
+
+/**
+ * ll_wbc_mkdir_done() - enable the writeback cache on a new directory
+ * @dir: parent directory
+ * @inode: the new directory
+ * @it: intent of the mkdir, holding the lock granted on @inode
+ *
+ * The MDT grants an EX lock to intent mkdir flagged MDS_WBC_LOCK if the new
+ * directory is not striped.  Creates are only cached where the MDT would not
+ * have to add anything the client does not know about, so directories with
+ * a default layout or a default ACL are left alone.
+ */
+void ll_wbc_mkdir_done(struct inode *dir, struct inode *inode,
+		       struct lookup_intent *it)
+{
+	struct ll_inode_info *lli = ll_i2info(inode);
+	bool enable;
+
+	if (it->it_lock_mode != LCK_EX || !S_ISDIR(inode->i_mode))
+		goto out_clear;
+
+	down_read(&lli->lli_lsm_sem);
+	enable = !lli->lli_lsm_obj && !lli->lli_def_lsm_obj;
+	up_read(&lli->lli_lsm_sem);
+	if (!enable)
+		goto out_clear;
+
+#ifdef CONFIG_LUSTRE_FS_POSIX_ACL
+	if (IS_POSIXACL(inode)) {
+		struct posix_acl *acl;
+
+		acl = ll_get_inode_acl(inode, ACL_TYPE_DEFAULT, false);
+		if (IS_ERR(acl))
+			goto out_clear;
+		if (acl) {
+			posix_acl_release(acl);
+			goto out_clear;
+		}
+	}
+#endif
+	set_bit(LLIF_WBC_DIR, &lli->lli_flags);
+	return;
+
+out_clear:
+	clear_bit(LLIF_WBC_DIR, &lli->lli_flags);
+}
+
+/* called back from a lock cancel in the middle of a flush */
+static bool ll_wbc_in_flush(struct ll_sb_info *sbi)
+{
+	int i;
+
+	for (i = 0; i < LL_WBC_FLUSH_RPCS; i++)
+		if (READ_ONCE(sbi->ll_wbc_flushers[i]) == current)
+			return true;
+
+	return false;
+}
+
+/* send one cached create to the MDT */
+static int ll_wbc_flush_one(struct ll_sb_info *sbi, struct ll_wbc_entry *lwe)
+{
+	struct lookup_intent it = { .it_op = IT_CREAT,
+				    .it_create_mode = lwe->lwe_mode };
+	struct inode *dir = lwe->lwe_dir;
+	struct inode *inode = lwe->lwe_inode;
+	struct ptlrpc_request *req = NULL;
+	struct md_op_data *op_data;
+	bool isdir = S_ISDIR(lwe->lwe_mode);
+	int rc;
+
+	ENTRY;
+
+	op_data = ll_prep_md_op_data(NULL, dir, NULL, lwe->lwe_name,
+				     lwe->lwe_namelen, lwe->lwe_mode,
+				     isdir ? LUSTRE_OPC_MKDIR :
+					     LUSTRE_OPC_MKNOD, NULL);
+	if (IS_ERR(op_data))
+		GOTO(out, rc = PTR_ERR(op_data));
+
+	op_data->op_fid2 = *ll_inode2fid(inode);
+	op_data->op_bias |= MDS_WBC_FLUSH;
+	op_data->op_mod_time = lwe->lwe_time;
+	op_data->op_fsuid = lwe->lwe_fsuid;
+	op_data->op_fsgid = lwe->lwe_fsgid;
+	op_data->op_cap = lwe->lwe_cap;
+	op_data->op_suppgids[0] = lwe->lwe_suppgid;
+
+	if (isdir && sbi->ll_intent_mkdir_enabled) {
+		op_data->op_bias |= MDS_WBC_LOCK;
+		rc = md_intent_lock(sbi->ll_md_exp, op_data, &it, &req,
+				    &ll_md_blocking_ast, 0);
+	} else {
+		rc = md_create(sbi->ll_md_exp, op_data, NULL, 0, lwe->lwe_mode,
+			       lwe->lwe_fsuid, lwe->lwe_fsgid, lwe->lwe_cap,
+			       lwe->lwe_rdev, &req);
+	}
+	ll_finish_md_op_data(op_data);
+	if (rc)
+		GOTO(out, rc);
+
+	rc = ll_prep_inode(&inode, &req->rq_pill, inode->i_sb, NULL);
+	if (rc)
+		GOTO(out, rc);
+
+	if (it.it_lock_mode) {
+		enum mds_ibits_locks bits = MDS_INODELOCK_NONE;
+
+		ll_set_lock_data(sbi->ll_md_exp, inode, &it, &bits);
+		if (!(bits & MDS_INODELOCK_LOOKUP))
+			d_lustre_invalidate(lwe->lwe_dentry);
+	} else {
+		/* like any create without a lock on the child */
+		d_lustre_invalidate(lwe->lwe_dentry);
+	}
+	EXIT;
+out:
+	spin_lock(&sbi->ll_wbc_lock);
+	clear_bit(LLIF_WBC_PENDING, &ll_i2info(inode)->lli_flags);
+	spin_unlock(&sbi->ll_wbc_lock);
+	/* the MDT only grants EX to an unstriped directory, and the parent had
+	 * no default layout or ACL to inherit
+	 */
+	if (isdir && (rc || it.it_lock_mode != LCK_EX))
+		clear_bit(LLIF_WBC_DIR, &ll_i2info(inode)->lli_flags);
+	ll_intent_release(&it);
+	ptlrpc_req_put(req);
+
+	if (rc) {
+		CERROR("%s: cannot write back create of %.*s "DFID" in "DFID": rc = %d\n",
+		       sbi->ll_fsname, lwe->lwe_namelen, lwe->lwe_name,
+		       PFID(ll_inode2fid(inode)), PFID(ll_inode2fid(dir)), rc);
+		atomic_inc(&sbi->ll_wbc_errors);
+		/* reported by the next fsync() of the parent, quota and
+		 * space were checked by ll_wbc_reserve() already
+		 */
+		mapping_set_error(dir->i_mapping, rc);
+		clear_nlink(inode);
+		d_lustre_invalidate(lwe->lwe_dentry);
+		ll_prune_aliases(inode);
+	} else {
+		atomic_inc(&sbi->ll_wbc_flushed);
+	}
+
+	atomic_dec(&ll_i2info(dir)->lli_wbc_children);
+	dput(lwe->lwe_dentry);
+	iput(inode);
+	iput(dir);
+	OBD_FREE(lwe, LWE_SIZE(lwe->lwe_namelen));
+
+	return rc;
+}
+
+static void ll_wbc_wave_done(struct ll_wbc_wave *wave, int rc)
+{
+	if (rc)
+		cmpxchg(&wave->lww_rc, 0, rc);
+	if (atomic_dec_and_test(&wave->lww_pending))
+		complete(&wave->lww_done);
+}
+
+static void ll_wbc_flush_work(struct work_struct *work)
+{
+	struct ll_wbc_entry *lwe = container_of(work, struct ll_wbc_entry,
+						lwe_work);
+	struct ll_wbc_wave *wave = lwe->lwe_wave;
+	struct ll_sb_info *sbi = wave->lww_sbi;
+	int slot = atomic_inc_return(&wave->lww_slot);
+	int rc;
+
+	WRITE_ONCE(sbi->ll_wbc_flushers[slot], current);
+	rc = ll_wbc_flush_one(sbi, lwe);
+	WRITE_ONCE(sbi->ll_wbc_flushers[slot], NULL);
+	ll_wbc_wave_done(wave, rc);
+}
+
+/*
+ * Send the creates on @list, in waves of entries whose parents are on the
+ * MDT already.  Those do not depend on each other, so up to
+ * LL_WBC_FLUSH_RPCS of them are sent at the same time, one by the caller and
+ * the others by work items.  The first entry on @list always goes: it was
+ * created after its parent, which was sent before.
+ *
+ * Called with ll_wbc_mutex held.  Returns the first error hit.
+ */
+static int ll_wbc_flush_list(struct ll_sb_info *sbi, struct list_head *list)
+{
+	struct ll_wbc_wave wave = { .lww_sbi = sbi };
+	struct ll_wbc_entry *first;
+	struct ll_wbc_entry *lwe;
+	struct ll_wbc_entry *tmp;
+	LIST_HEAD(batch);
+	int count;
+	int rc = 0;
+
+	while ((first = list_first_entry_or_null(list, struct ll_wbc_entry,
+						 lwe_list)) != NULL) {
+		list_del_init(&first->lwe_list);
+		count = 1;
+		list_for_each_entry_safe(lwe, tmp, list, lwe_list) {
+			if (count == LL_WBC_FLUSH_RPCS)
+				break;
+			if (ll_wbc_pending(lwe->lwe_dir))
+				continue;
+			list_move_tail(&lwe->lwe_list, &batch);
+			count++;
+		}
+
+		atomic_set(&wave.lww_slot, 0);
+		atomic_set(&wave.lww_pending, count);
+		init_completion(&wave.lww_done);
+		wave.lww_rc = 0;
+		list_for_each_entry_safe(lwe, tmp, &batch, lwe_list) {
+			list_del_init(&lwe->lwe_list);
+			lwe->lwe_wave = &wave;
+			INIT_WORK(&lwe->lwe_work, ll_wbc_flush_work);
+			queue_work(system_unbound_wq, &lwe->lwe_work);
+		}
+		ll_wbc_wave_done(&wave, ll_wbc_flush_one(sbi, first));
+		wait_for_completion(&wave.lww_done);
+		if (wave.lww_rc && !rc)
+			rc = wave.lww_rc;
+	}
+
+	return rc;
+}
+
+/* move the whole queue to @list */
+static bool ll_wbc_take_all(struct ll_sb_info *sbi, struct list_head *list)
+{
+	spin_lock(&sbi->ll_wbc_lock);
+	list_splice_tail_init(&sbi->ll_wbc_list, list);
+	sbi->ll_wbc_count = 0;
+	spin_unlock(&sbi->ll_wbc_lock);
+
+	return !list_empty(list);
+}
+
+/**
+ * ll_wbc_flush() - write back all cached creates
+ * @sbi: superblock info
+ *
+ * Creates cached while the flush runs are written back as well.  Returns
+ * once everything queued before the call is on the MDT.
+ *
+ * Return: 0 or the first error hit
+ */
+int ll_wbc_flush(struct ll_sb_info *sbi)
+{
+	LIST_HEAD(list);
+	int rc = 0;
+	int rc2;
+
+	if (ll_wbc_in_flush(sbi))
+		return 0;
+
+	if (!READ_ONCE(sbi->ll_wbc_count) && !mutex_is_locked(&sbi->ll_wbc_mutex))
+		return 0;
+
+	mutex_lock(&sbi->ll_wbc_mutex);
+	WRITE_ONCE(sbi->ll_wbc_flushers[0], current);
+	while (ll_wbc_take_all(sbi, &list)) {
+		rc2 = ll_wbc_flush_list(sbi, &list);
+		if (rc2 && !rc)
+			rc = rc2;
+	}
+	WRITE_ONCE(sbi->ll_wbc_flushers[0], NULL);
+	mutex_unlock(&sbi->ll_wbc_mutex);
+
+	return rc;
+}
+
+/*
+ * Move to @list the queued creates of @dir, if not NULL, and those of any
+ * directory that was written back without getting an EX lock of its own:
+ * nothing covers them anymore, see ll_wbc_new_node().  Creation order is
+ * kept, entries of a directory still queued are left for a later pass.
+ */
+static bool ll_wbc_take_children(struct ll_sb_info *sbi, struct inode *dir,
+				 struct list_head *list)
+{
+	struct ll_wbc_entry *lwe;
+	struct ll_wbc_entry *tmp;
+	struct inode *parent;
+
+	spin_lock(&sbi->ll_wbc_lock);
+	list_for_each_entry_safe(lwe, tmp, &sbi->ll_wbc_list, lwe_list) {
+		parent = lwe->lwe_dir;
+		if (parent != dir &&
+		    (ll_wbc_pending(parent) ||
+		     test_bit(LLIF_WBC_DIR, &ll_i2info(parent)->lli_flags)))
+			continue;
+		list_move_tail(&lwe->lwe_list, list);
+		sbi->ll_wbc_count--;
+	}
+	spin_unlock(&sbi->ll_wbc_lock);
+
+	return !list_empty(list);
+}
+
+/* move the queued creates of @inode and of its queued parents to @list */
+static void ll_wbc_take_chain(struct ll_sb_info *sbi, struct inode *inode,
+			      struct list_head *list)
+{
+	struct ll_wbc_entry *lwe;
+	LIST_HEAD(chain);
+	bool found;
+
+	spin_lock(&sbi->ll_wbc_lock);
+	while (ll_wbc_pending(inode)) {
+		found = false;
+		list_for_each_entry(lwe, &sbi->ll_wbc_list, lwe_list) {
+			if (lwe->lwe_inode == inode) {
+				found = true;
+				break;
+			}
+		}
+		/* taken already for the other inode of the RPC */
+		if (!found)
+			break;
+		/* the parent goes first */
+		list_move(&lwe->lwe_list, &chain);
+		sbi->ll_wbc_count--;
+		inode = lwe->lwe_dir;
+	}
+	spin_unlock(&sbi->ll_wbc_lock);
+
+	list_splice_tail(&chain, list);
+}
+
+/**
+ * ll_wbc_flush_inodes() - make sure inodes exist on the MDT
+ * @i1: inode an RPC is about to be sent for
+ * @i2: second inode of the RPC, may be NULL
+ *
+ * Called before an RPC naming @i1 or @i2 is packed.  Only @i1, @i2 and their
+ * cached parents are written back, and the entries of a parent left without
+ * a lock by its write back.  The rest of the queue stays cached.
+ */
+void ll_wbc_flush_inodes(struct inode *i1, struct inode *i2)
+{
+	struct ll_sb_info *sbi = ll_i2sbi(i1);
+	LIST_HEAD(list);
+
+	if (likely(!READ_ONCE(sbi->ll_wbc_count) &&
+		   !mutex_is_locked(&sbi->ll_wbc_mutex)))
+		return;
+
+	if (!ll_wbc_pending(i1) && !(i2 && ll_wbc_pending(i2)))
+		return;
+
+	if (ll_wbc_in_flush(sbi))
+		return;
+
+	mutex_lock(&sbi->ll_wbc_mutex);
+	WRITE_ONCE(sbi->ll_wbc_flushers[0], current);
+	ll_wbc_take_chain(sbi, i1, &list);
+	if (i2)
+		ll_wbc_take_chain(sbi, i2, &list);
+	ll_wbc_flush_list(sbi, &list);
+	while (ll_wbc_take_children(sbi, NULL, &list))
+		ll_wbc_flush_list(sbi, &list);
+	WRITE_ONCE(sbi->ll_wbc_flushers[0], NULL);
+	mutex_unlock(&sbi->ll_wbc_mutex);
+}
+
+/**
+ * ll_wbc_flush_children() - write back creates cached in a directory
+ * @dir: directory about to be read, or whose EX lock is being revoked
+ *
+ * Only the entries of @dir are sent, the rest of the queue is left to the
+ * delayed work.  A subdirectory written back without getting an EX lock of
+ * its own is no longer covered by any lock, so its entries are sent too.
+ * A directory that exists on the MDT is never sent by this, so the parents
+ * of everything sent are already there.
+ *
+ * The queue is scanned again after each pass until nothing is left to send:
+ * an entry may be cached in a subdirectory until the moment it is written
+ * back, after the previous scan.
+ */
+void ll_wbc_flush_children(struct inode *dir)
+{
+	struct ll_sb_info *sbi = ll_i2sbi(dir);
+	LIST_HEAD(list);
+
+	if (!S_ISDIR(dir->i_mode) ||
+	    !atomic_read(&ll_i2info(dir)->lli_wbc_children))
+		return;
+
+	if (ll_wbc_in_flush(sbi))
+		return;
+
+	/* @dir is itself cached, its entries have to wait for it */
+	if (ll_wbc_pending(dir))
+		ll_wbc_flush_inodes(dir, NULL);
+
+	mutex_lock(&sbi->ll_wbc_mutex);
+	WRITE_ONCE(sbi->ll_wbc_flushers[0], current);
+	while (ll_wbc_take_children(sbi, dir, &list))
+		ll_wbc_flush_list(sbi, &list);
+	WRITE_ONCE(sbi->ll_wbc_flushers[0], NULL);
+	mutex_unlock(&sbi->ll_wbc_mutex);
+}
+
+struct ll_wbc_revoke {
+	struct work_struct	 lwr_work;
+	struct ldlm_lock	*lwr_lock;
+	struct inode		*lwr_dir;
+};
+
+static void ll_wbc_revoke_work(struct work_struct *work)
+{
+	struct ll_wbc_revoke *lwr = container_of(work, struct ll_wbc_revoke,
+						 lwr_work);
+	struct ldlm_lock *lock = lwr->lwr_lock;
+	struct inode *dir = lwr->lwr_dir;
+	struct ll_sb_info *sbi = ll_i2sbi(dir);
+	bool busy;
+
+	ll_wbc_flush_children(dir);
+	clear_bit(LLIF_WBC_REVOKE, &ll_i2info(dir)->lli_flags);
+	/* a blocking AST run after the check below sees the bit cleared */
+	smp_mb__after_atomic();
+
+	/* a reference taken meanwhile runs the blocking AST again once it is
+	 * dropped, which releases the lock then
+	 */
+	lock_res_and_lock(lock);
+	busy = lock->l_readers || lock->l_writers;
+	unlock_res_and_lock(lock);
+	if (!busy)
+		ll_md_blocking_release(lock);
+
+	ldlm_lock_put(lock);
+	iput(dir);
+	OBD_FREE_PTR(lwr);
+	if (atomic_dec_and_test(&sbi->ll_wbc_revoking))
+		wake_up_var(&sbi->ll_wbc_revoking);
+}
+
+/**
+ * ll_wbc_revoke() - write back the creates cached under a revoked lock
+ * @lock: lock whose blocking AST was received
+ *
+ * If @lock is the EX lock of a directory holding cached creates, they are
+ * sent by a work item which then releases @lock like the blocking AST would
+ * have, so a long queue does not hold up the ldlm blocking thread.
+ *
+ * Return: true if @lock is released by the work item
+ */
+bool ll_wbc_revoke(struct ldlm_lock *lock)
+{
+	struct ll_wbc_revoke *lwr;
+	struct ll_sb_info *sbi;
+	struct inode *dir;
+
+	if (lock->l_granted_mode != LCK_EX ||
+	    !(lock->l_policy_data.l_inodebits.bits & MDS_INODELOCK_UPDATE))
+		return false;
+
+	dir = ll_inode_from_resource_lock(lock);
+	if (!dir)
+		return false;
+
+	if (!S_ISDIR(dir->i_mode) ||
+	    !atomic_read(&ll_i2info(dir)->lli_wbc_children)) {
+		iput(dir);
+		return false;
+	}
+
+	/* the work item already queued releases the lock */
+	if (test_and_set_bit(LLIF_WBC_REVOKE, &ll_i2info(dir)->lli_flags)) {
+		iput(dir);
+		return true;
+	}
+
+	OBD_ALLOC_PTR(lwr);
+	if (!lwr) {
+		clear_bit(LLIF_WBC_REVOKE, &ll_i2info(dir)->lli_flags);
+		ll_wbc_flush_children(dir);
+		iput(dir);
+		return false;
+	}
+
+	sbi = ll_i2sbi(dir);
+	INIT_WORK(&lwr->lwr_work, ll_wbc_revoke_work);
+	lwr->lwr_lock = ldlm_lock_get(lock);
+	lwr->lwr_dir = dir;
+	atomic_inc(&sbi->ll_wbc_revoking);
+	queue_work(system_long_wq, &lwr->lwr_work);
+
+	return true;
+}
+
+/**
+ * ll_wbc_open_prep() - keep the EX lock of a directory across open(O_CREAT)
+ * @dir: parent directory
+ * @op_data: intent open being prepared
+ *
+ * An open is not cached: the MDT has to give the open handle and the layout
+ * of a new file.  While this client holds the EX lock on @dir, the open is
+ * flagged MDS_WBC_FLUSH so the MDT does not take the parent lock, and mdc
+ * does not cancel that lock by ELC: the creates cached in @dir stay cached.
+ * The FID of the file is allocated here, lmv leaves it alone then.
+ */
+void ll_wbc_open_prep(struct inode *dir, struct md_op_data *op_data)
+{
+	struct ll_sb_info *sbi = ll_i2sbi(dir);
+	union ldlm_policy_data policy = {
+		.l_inodebits = { MDS_INODELOCK_UPDATE } };
+	struct lustre_handle lockh;
+
+	if (!sbi->ll_wbc_enabled ||
+	    !test_bit(LLIF_WBC_DIR, &ll_i2info(dir)->lli_flags) ||
+	    ll_wbc_pending(dir) || !fid_is_zero(&op_data->op_fid2))
+		return;
+
+	if (!md_lock_match(sbi->ll_md_exp,
+			   LDLM_FL_BLOCK_GRANTED | LDLM_FL_TEST_LOCK,
+			   ll_inode2fid(dir), LDLM_IBITS, &policy, LCK_EX, 0,
+			   &lockh))
+		return;
+
+	if (ll_wbc_fid_alloc(dir, &op_data->op_fid2)) {
+		fid_zero(&op_data->op_fid2);
+		return;
+	}
+	op_data->op_bias |= MDS_WBC_FLUSH;
+}
+
+static void ll_wbc_work(struct work_struct *work)
+{
+	struct ll_sb_info *sbi = container_of(work, struct ll_sb_info,
+					      ll_wbc_work.work);
+
+	ll_wbc_flush(sbi);
+}
+
+void ll_wbc_init(struct ll_sb_info *sbi)
+{
+	spin_lock_init(&sbi->ll_wbc_lock);
+	INIT_LIST_HEAD(&sbi->ll_wbc_list);
+	sbi->ll_wbc_count = 0;
+	sbi->ll_wbc_max = SBI_DEFAULT_WBC_MAX;
+	sbi->ll_wbc_delay_ms = SBI_DEFAULT_WBC_DELAY_MS;
+	INIT_DELAYED_WORK(&sbi->ll_wbc_work, ll_wbc_work);
+	mutex_init(&sbi->ll_wbc_mutex);
+	memset(sbi->ll_wbc_flushers, 0, sizeof(sbi->ll_wbc_flushers));
+	atomic_set(&sbi->ll_wbc_revoking, 0);
+	mutex_init(&sbi->ll_wbc_budget_mutex);
+	sbi->ll_wbc_budget_time = 0;
+	sbi->ll_wbc_budget = 0;
+	atomic_set(&sbi->ll_wbc_cached, 0);
+	atomic_set(&sbi->ll_wbc_flushed, 0);
+	atomic_set(&sbi->ll_wbc_errors, 0);
+}
+
+/* write back everything before the MDC export goes away */
+void ll_wbc_fini(struct ll_sb_info *sbi)
+{
+	sbi->ll_wbc_enabled = 0;
+	cancel_delayed_work_sync(&sbi->ll_wbc_work);
+	wait_var_event(&sbi->ll_wbc_revoking,
+		       !atomic_read(&sbi->ll_wbc_revoking));
+	ll_wbc_flush(sbi);
+}
@@ -13,15 +13,20 @@
 #include <linux/fs.h>
 #include <linux/sched.h>
 #include <linux/mm.h>
+#include <linux/hash.h>
 #include <obd_support.h>
 #include <lustre_dlm.h>
 #include "llite_internal.h"
 
-/* If we ever have hundreds of extended attributes, we might want to consider
- * using a hash or a tree structure instead of list for faster lookups.
+/* Lookups go through a small per-inode hash, security modules and ACL checks
+ * ask for several names on every access. The list keeps listxattr() order.
  */
+#define LL_XATTR_HASH_BITS	3
+#define LL_XATTR_HASH_SIZE	(1 << LL_XATTR_HASH_BITS)
+
 struct ll_xattr_entry {
 	struct list_head xe_list; /* protected by lli_xattrs_list_rwsem */
+	struct hlist_node xe_hash; /* in lli_xattrs_hash, same lock */
 	char *xe_name;            /* xattr name, \0-terminated */
 	char *xe_value;           /* xattr value */
 	unsigned int xe_namelen;  /* strlen(xe_name) + 1 */
@@ -50,41 +55,60 @@ void ll_xattr_fini(void)
 	lu_kmem_fini(xattr_caches);
 }
 
+static inline struct hlist_head *ll_xattr_bucket(struct ll_inode_info *lli,
+						 const char *xattr_name)
+{
+	u32 hash = full_name_hash(NULL, xattr_name, strlen(xattr_name));
+
+	return &lli->lli_xattrs_hash[hash_32(hash, LL_XATTR_HASH_BITS)];
+}
+
 /**
  * ll_xattr_cache_init() - Initializes xattr cache for an inode.
  *
- * This initializes the xattr list and marks cache presence.
+ * This initializes the xattr list and hash and marks cache presence.
  *
  * @lli:  lustre ll_inode_info struct (list of xattrs)
  *
  * Returns:
- * * %void
+ * * %0       success
+ * * %-ENOMEM if the hash table could not be allocated
  */
-static void ll_xattr_cache_init(struct ll_inode_info *lli)
+static int ll_xattr_cache_init(struct ll_inode_info *lli)
 {
+	int i;
+
 	ENTRY;
 
 	LASSERT(lli != NULL);
 
+	OBD_ALLOC_PTR_ARRAY(lli->lli_xattrs_hash, LL_XATTR_HASH_SIZE);
+	if (lli->lli_xattrs_hash == NULL)
+		RETURN(-ENOMEM);
+
+	for (i = 0; i < LL_XATTR_HASH_SIZE; i++)
+		INIT_HLIST_HEAD(&lli->lli_xattrs_hash[i]);
 	INIT_LIST_HEAD(&lli->lli_xattrs);
 	set_bit(LLIF_XATTR_CACHE, &lli->lli_flags);
+
+	RETURN(0);
 }
 
 /**
  *  ll_xattr_cache_find() - This looks for a specific extended attribute.
  *
- *  @cache: Find in this list @xattr_name
+ *  @lli: Find in the xattr cache of this inode @xattr_name
  *  @xattr_name: xattr name to find
  *  @xattr: Return matched xattr attribute on success
  *
- *  Find in @cache and return @xattr_name attribute in @xattr,
+ *  Find in the cache of @lli and return @xattr_name attribute in @xattr,
  *  for the NULL @xattr_name return the first cached @xattr.
  *
  *  Returns:
  *  * %0        success
  *  * %-ENODATA if not found
  */
-static int ll_xattr_cache_find(struct list_head *cache,
+static int ll_xattr_cache_find(struct ll_inode_info *lli,
 			       const char *xattr_name,
 			       struct ll_xattr_entry **xattr)
 {
@@ -92,10 +116,21 @@ static int ll_xattr_cache_find(struct list_head *cache,
 
 	ENTRY;
 
-	list_for_each_entry(entry, cache, xe_list) {
-		/* xattr_name == NULL means look for any entry */
-		if (xattr_name == NULL ||
-		    strcmp(xattr_name, entry->xe_name) == 0) {
+	/* xattr_name == NULL means look for any entry */
+	if (xattr_name == NULL) {
+		entry = list_first_entry_or_null(&lli->lli_xattrs,
+						 struct ll_xattr_entry,
+						 xe_list);
+		if (entry == NULL)
+			RETURN(-ENODATA);
+
+		*xattr = entry;
+		RETURN(0);
+	}
+
+	hlist_for_each_entry(entry, ll_xattr_bucket(lli, xattr_name),
+			     xe_hash) {
+		if (strcmp(xattr_name, entry->xe_name) == 0) {
 			*xattr = entry;
 			CDEBUG(D_CACHE, "find: [%s]=%.*s\n",
 			       entry->xe_name, entry->xe_vallen,
@@ -110,9 +145,9 @@ static int ll_xattr_cache_find(struct list_head *cache,
 /**
  * ll_xattr_cache_add() - This adds an xattr.
  *
- * @cache: list of xattr for an inode (struct ll_xattr_entry)
- * @xattr_name: name of xattr to be added to the cache list
- * @xattr_val: value of xattr to be added to the cache list
+ * @lli: inode whose xattr cache gets the new entry
+ * @xattr_name: name of xattr to be added to the cache
+ * @xattr_val: value of xattr to be added to the cache
  * @xattr_val_len: length of xattr value
  *
  * Add @xattr_name attr with @xattr_val value and @xattr_val_len length,
@@ -122,7 +157,7 @@ static int ll_xattr_cache_find(struct list_head *cache,
  * * %-ENOMEM if no memory could be allocated for the cached attr
  * * %-EPROTO if duplicate xattr is being added
  */
-static int ll_xattr_cache_add(struct list_head *cache,
+static int ll_xattr_cache_add(struct ll_inode_info *lli,
 			      const char *xattr_name,
 			      const char *xattr_val,
 			      unsigned int xattr_val_len)
@@ -131,7 +166,7 @@ static int ll_xattr_cache_add(struct list_head *cache,
 
 	ENTRY;
 
-	if (ll_xattr_cache_find(cache, xattr_name, &xattr) == 0) {
+	if (ll_xattr_cache_find(lli, xattr_name, &xattr) == 0) {
 		if (!strcmp(xattr_name, LL_XATTR_NAME_ENCRYPTION_CONTEXT) ||
 		    !strcmp(xattr_name, LL_XATTR_NAME_ENCRYPTION_CONTEXT_OLD))
 			/* it means enc ctx was already in cache,
@@ -167,7 +202,8 @@ static int ll_xattr_cache_add(struct list_head *cache,
 	memcpy(xattr->xe_name, xattr_name, xattr->xe_namelen);
 	memcpy(xattr->xe_value, xattr_val, xattr_val_len);
 	xattr->xe_vallen = xattr_val_len;
-	list_add(&xattr->xe_list, cache);
+	list_add(&xattr->xe_list, &lli->lli_xattrs);
+	hlist_add_head(&xattr->xe_hash, ll_xattr_bucket(lli, xattr_name));
 
 	CDEBUG(D_CACHE, "set: [%s]=%.*s\n", xattr_name,
 		xattr_val_len, xattr_val);
@@ -181,19 +217,28 @@ err_name:
 	RETURN(-ENOMEM);
 }
 
+static void ll_xattr_cache_free(struct ll_xattr_entry *xattr)
+{
+	list_del(&xattr->xe_list);
+	hlist_del(&xattr->xe_hash);
+	OBD_FREE(xattr->xe_name, xattr->xe_namelen);
+	OBD_FREE(xattr->xe_value, xattr->xe_vallen);
+	OBD_SLAB_FREE_PTR(xattr, xattr_kmem);
+}
+
 /**
  * ll_xattr_cache_del() - This removes an extended attribute from cache.
  *
- * @cache: list of xattr for an inode (struct ll_xattr_entry)
- * @xattr_name: name of xattr to be deleted to the cache list
+ * @lli: inode whose xattr cache holds @xattr_name
+ * @xattr_name: name of xattr to be deleted from the cache
  *
- * Remove @xattr_name attribute from @cache.
+ * Remove @xattr_name attribute from the cache of @lli.
  *
  * Returns:
  * * %0        success
  * * %-ENODATA if @xattr_name is not cached
  */
-static int ll_xattr_cache_del(struct list_head *cache,
+static int ll_xattr_cache_del(struct ll_inode_info *lli,
 			      const char *xattr_name)
 {
 	struct ll_xattr_entry *xattr;
@@ -202,12 +247,8 @@ static int ll_xattr_cache_del(struct list_head *cache,
 
 	CDEBUG(D_CACHE, "del xattr: %s\n", xattr_name);
 
-	if (ll_xattr_cache_find(cache, xattr_name, &xattr) == 0) {
-		list_del(&xattr->xe_list);
-		OBD_FREE(xattr->xe_name, xattr->xe_namelen);
-		OBD_FREE(xattr->xe_value, xattr->xe_vallen);
-		OBD_SLAB_FREE_PTR(xattr, xattr_kmem);
-
+	if (ll_xattr_cache_find(lli, xattr_name, &xattr) == 0) {
+		ll_xattr_cache_free(xattr);
 		RETURN(0);
 	}
 
@@ -217,18 +258,18 @@ static int ll_xattr_cache_del(struct list_head *cache,
 /**
  * ll_xattr_cache_list() - This iterates cached extended attributes.
  *
- * @cache: list of xattr for an inode (struct ll_xattr_entry)
+ * @lli: inode whose cached xattrs are listed
  * @xld_buffer: buffer(space) to store xattrs
  * @xld_size: size of @xld_buffer
  *
- * Walk over cached attributes in @cache and fill in @xld_buffer or only
+ * Walk over cached attributes of @lli and fill in @xld_buffer or only
  * calculate buffer size if @xld_buffer is NULL.
  *
  * Returns:
  * * >= 0     buffer list size
  * * %-ENODATA if the list cannot fit @xld_size buffer
  */
-static int ll_xattr_cache_list(struct list_head *cache,
+static int ll_xattr_cache_list(struct ll_inode_info *lli,
 			       char *xld_buffer,
 			       int xld_size)
 {
@@ -237,7 +278,7 @@ static int ll_xattr_cache_list(struct list_head *cache,
 
 	ENTRY;
 
-	list_for_each_entry_safe(xattr, tmp, cache, xe_list) {
+	list_for_each_entry_safe(xattr, tmp, &lli->lli_xattrs, xe_list) {
 		CDEBUG(D_CACHE, "list: buffer=%p[%d] name=%s\n",
 			xld_buffer, xld_tail, xattr->xe_name);
 
@@ -285,6 +326,29 @@ static int ll_xattr_cache_filled(struct ll_inode_info *lli)
 	return test_bit(LLIF_XATTR_CACHE_FILLED, &lli->lli_flags);
 }
 
+/**
+ * ll_xattr_cache_prefetched() - Check if @name was piggybacked by the MDT.
+ *
+ * @lli:  lustre ll_inode_info struct (list of xattrs)
+ * @name: xattr name looked up
+ * @valid: OBD_MD_FLXATTR for a single xattr, OBD_MD_FLXATTRLS for a list
+ *
+ * The MDT returns either all or none of the xattrs matching
+ * exp_xattr_prefetch_name(), so a prefetched cache can answer a lookup of
+ * such a name, including a miss, but not a listxattr().
+ *
+ * Returns:
+ * * %true  the cache holds the authoritative answer for @name
+ * * %false a refill is needed
+ */
+static bool ll_xattr_cache_prefetched(struct ll_inode_info *lli,
+				      const char *name, __u64 valid)
+{
+	return valid & OBD_MD_FLXATTR &&
+	       test_bit(LLIF_XATTR_CACHE_PREFETCH, &lli->lli_flags) &&
+	       exp_xattr_prefetch_name(name);
+}
+
 /**
  * ll_xattr_cache_destroy_locked() - This finalizes the xattr cache.
  *
@@ -302,9 +366,13 @@ static int ll_xattr_cache_destroy_locked(struct ll_inode_info *lli)
 	if (!ll_xattr_cache_valid(lli))
 		RETURN(0);
 
-	while (ll_xattr_cache_del(&lli->lli_xattrs, NULL) == 0)
+	while (ll_xattr_cache_del(lli, NULL) == 0)
 		; /* empty loop */
 
+	OBD_FREE_PTR_ARRAY(lli->lli_xattrs_hash, LL_XATTR_HASH_SIZE);
+	lli->lli_xattrs_hash = NULL;
+
+	clear_bit(LLIF_XATTR_CACHE_PREFETCH, &lli->lli_flags);
 	clear_bit(LLIF_XATTR_CACHE_FILLED, &lli->lli_flags);
 	clear_bit(LLIF_XATTR_CACHE, &lli->lli_flags);
 
@@ -325,38 +393,43 @@ int ll_xattr_cache_destroy(struct inode *inode)
 	RETURN(rc);
 }
 
-/*
- * ll_xattr_cache_empty - empty xattr cache for @ino
- *
- * Similar to ll_xattr_cache_destroy(), but preserves encryption context.
- * So only LLIF_XATTR_CACHE_FILLED flag is cleared, but not LLIF_XATTR_CACHE.
- */
-int ll_xattr_cache_empty(struct inode *inode)
+/* drop everything but the encryption context, lli_xattrs_list_rwsem held */
+static void ll_xattr_cache_purge_locked(struct inode *inode)
 {
 	struct ll_inode_info *lli = ll_i2info(inode);
 	struct ll_xattr_entry *entry, *n;
 
-	ENTRY;
-
-	down_write(&lli->lli_xattrs_list_rwsem);
-	if (!ll_xattr_cache_valid(lli) ||
-	    !ll_xattr_cache_filled(lli))
-		GOTO(out_empty, 0);
-
 	list_for_each_entry_safe(entry, n, &lli->lli_xattrs, xe_list) {
 		if (strcmp(entry->xe_name, xattr_for_enc(inode)) == 0)
 			continue;
 
 		CDEBUG(D_CACHE, "delete: %s\n", entry->xe_name);
-		list_del(&entry->xe_list);
-		OBD_FREE(entry->xe_name, entry->xe_namelen);
-		OBD_FREE(entry->xe_value, entry->xe_vallen);
-		OBD_SLAB_FREE_PTR(entry, xattr_kmem);
+		ll_xattr_cache_free(entry);
 	}
+	clear_bit(LLIF_XATTR_CACHE_PREFETCH, &lli->lli_flags);
 	clear_bit(LLIF_XATTR_CACHE_FILLED, &lli->lli_flags);
+}
 
-out_empty:
+/*
+ * ll_xattr_cache_empty - empty xattr cache for @ino
+ *
+ * Similar to ll_xattr_cache_destroy(), but preserves encryption context.
+ * So only LLIF_XATTR_CACHE_FILLED and LLIF_XATTR_CACHE_PREFETCH flags are
+ * cleared, but not LLIF_XATTR_CACHE.
+ */
+int ll_xattr_cache_empty(struct inode *inode)
+{
+	struct ll_inode_info *lli = ll_i2info(inode);
+
+	ENTRY;
+
+	down_write(&lli->lli_xattrs_list_rwsem);
+	if (ll_xattr_cache_valid(lli) &&
+	    (ll_xattr_cache_filled(lli) ||
+	     test_bit(LLIF_XATTR_CACHE_PREFETCH, &lli->lli_flags)))
+		ll_xattr_cache_purge_locked(inode);
 	up_write(&lli->lli_xattrs_list_rwsem);
+
 	RETURN(0);
 }
 
@@ -507,8 +580,14 @@ static int ll_xattr_cache_refill(struct inode *inode)
 
 	CDEBUG(D_CACHE, "caching: xdata=%p xtail=%p\n", xdata, xtail);
 
-	if (!ll_xattr_cache_valid(lli))
-		ll_xattr_cache_init(lli);
+	if (!ll_xattr_cache_valid(lli)) {
+		rc = ll_xattr_cache_init(lli);
+		if (rc < 0)
+			GOTO(err_cancel, rc);
+	} else {
+		/* prefetched entries are replaced by the full set */
+		ll_xattr_cache_purge_locked(inode);
+	}
 
 	for (i = 0; i < body->mbo_max_mdsize; i++) {
 		CDEBUG(D_CACHE, "caching [%s]=%.*s\n", xdata, *xsizes, xval);
@@ -535,8 +614,7 @@ static int ll_xattr_cache_refill(struct inode *inode)
 			CDEBUG(D_CACHE, "not caching trusted.som\n");
 			rc = 0;
 		} else {
-			rc = ll_xattr_cache_add(&lli->lli_xattrs, xdata, xval,
-						*xsizes);
+			rc = ll_xattr_cache_add(lli, xdata, xval, *xsizes);
 		}
 		if (rc < 0) {
 			ll_xattr_cache_destroy_locked(lli);
@@ -613,7 +691,8 @@ int ll_xattr_cache_get(struct inode *inode,
 	 */
 	if ((valid & OBD_MD_FLXATTRLS ||
 	     strcmp(name, xattr_for_enc(inode)) != 0) &&
-	    !ll_xattr_cache_filled(lli)) {
+	    !ll_xattr_cache_filled(lli) &&
+	    !ll_xattr_cache_prefetched(lli, name, valid)) {
 		up_read(&lli->lli_xattrs_list_rwsem);
 		rc = ll_xattr_cache_refill(inode);
 		if (rc)
@@ -624,6 +703,13 @@ int ll_xattr_cache_get(struct inode *inode,
 		downgrade_write(&lli->lli_xattrs_list_rwsem);
 	} else {
 		ll_stats_ops_tally(ll_i2sbi(inode), LPROC_LL_GETXATTR_HITS, 1);
+		/* first use of prefetched xattrs saved a getxattr RPC */
+		if (!ll_xattr_cache_filled(lli) &&
+		    test_bit(LLIF_XATTR_CACHE_PREFETCH, &lli->lli_flags) &&
+		    test_and_clear_bit(LLIF_XATTR_CACHE_PREFETCH_NEW,
+				       &lli->lli_flags))
+			ll_stats_ops_tally(ll_i2sbi(inode),
+					   LPROC_LL_GETXATTR_SAVED, 1);
 	}
 
 	if (!ll_xattr_cache_valid(lli))
@@ -632,7 +718,7 @@ int ll_xattr_cache_get(struct inode *inode,
 	if (valid & OBD_MD_FLXATTR) {
 		struct ll_xattr_entry *xattr;
 
-		rc = ll_xattr_cache_find(&lli->lli_xattrs, name, &xattr);
+		rc = ll_xattr_cache_find(lli, name, &xattr);
 		if (rc == 0) {
 			rc = xattr->xe_vallen;
 			/* zero size means we are only requested size in rc */
@@ -660,8 +746,7 @@ int ll_xattr_cache_get(struct inode *inode,
 			}
 		}
 	} else if (valid & OBD_MD_FLXATTRLS) {
-		rc = ll_xattr_cache_list(&lli->lli_xattrs,
-					 size ? buffer : NULL, size);
+		rc = ll_xattr_cache_list(lli, size ? buffer : NULL, size);
 	}
 
 	GOTO(out, rc);
@@ -699,8 +784,111 @@ int ll_xattr_cache_insert(struct inode *inode,
 
 	down_write(&lli->lli_xattrs_list_rwsem);
 	if (!ll_xattr_cache_valid(lli))
-		ll_xattr_cache_init(lli);
-	rc = ll_xattr_cache_add(&lli->lli_xattrs, name, buffer, size);
+		rc = ll_xattr_cache_init(lli);
+	else
+		rc = 0;
+	if (rc == 0)
+		rc = ll_xattr_cache_add(lli, name, buffer, size);
 	up_write(&lli->lli_xattrs_list_rwsem);
 	RETURN(rc);
 }
+
+/**
+ * ll_xattr_cache_prefetch() - Cache xattrs piggybacked on a getattr reply.
+ *
+ * @inode: inode the getattr/lookup intent was done for
+ * @pill: reply capsule holding EADATA/EAVALS/EAVALS_LENS
+ *
+ * With OBD_CONNECT2_XATTR_PREFETCH the MDT packs all security, default ACL
+ * and trusted xattrs of the file into the intent reply, together with an
+ * XATTR ibit lock, in the same format as a getxattr(OBD_MD_FLXATTRALL)
+ * reply. Cache them so the first getxattr() of any such name does not need
+ * an RPC. User xattrs are not sent, so the cache is not marked as filled and
+ * listxattr() still fetches the full set. Must be called while the intent
+ * still holds its lock reference, so a cancel empties the cache afterwards.
+ *
+ * Returns:
+ * * %0       success or nothing was prefetched
+ * * %-EPROTO network protocol error
+ * * %-ENOMEM not enough memory for the cache
+ */
+int ll_xattr_cache_prefetch(struct inode *inode, struct req_capsule *pill)
+{
+	struct ll_inode_info *lli = ll_i2info(inode);
+	const char *xdata = NULL, *xval = NULL, *xtail = NULL, *xvtail = NULL;
+	struct mdt_body *body;
+	__u32 *xsizes = NULL;
+	int namelen, vallen, count, i;
+	int rc = 0;
+
+	ENTRY;
+
+	body = req_capsule_server_get(pill, &RMF_MDT_BODY);
+	if (body == NULL || !(body->mbo_valid & OBD_MD_FLXATTR) ||
+	    !req_capsule_has_field(pill, &RMF_EAVALS_LENS, RCL_SERVER))
+		RETURN(0);
+
+	namelen = req_capsule_get_size(pill, &RMF_EADATA, RCL_SERVER);
+	vallen = req_capsule_get_size(pill, &RMF_EAVALS, RCL_SERVER);
+	count = req_capsule_get_size(pill, &RMF_EAVALS_LENS, RCL_SERVER) /
+		sizeof(__u32);
+	if (count > 0) {
+		xdata = req_capsule_server_sized_get(pill, &RMF_EADATA,
+						     namelen);
+		xsizes = req_capsule_server_sized_get(pill, &RMF_EAVALS_LENS,
+						      count * sizeof(__u32));
+		if (vallen > 0)
+			xval = req_capsule_server_sized_get(pill, &RMF_EAVALS,
+							    vallen);
+		if (xdata == NULL || xsizes == NULL ||
+		    (vallen > 0 && xval == NULL))
+			RETURN(-EPROTO);
+
+		xtail = xdata + namelen;
+		xvtail = xval + vallen;
+	}
+
+	down_write(&lli->lli_xattrs_list_rwsem);
+	/* a full set fetched under the same lock is already there */
+	if (ll_xattr_cache_filled(lli))
+		GOTO(out_unlock, rc = 0);
+
+	if (!ll_xattr_cache_valid(lli))
+		rc = ll_xattr_cache_init(lli);
+	else
+		ll_xattr_cache_purge_locked(inode);
+	if (rc < 0)
+		GOTO(out_unlock, rc);
+
+	for (i = 0; i < count; i++) {
+		if (memchr(xdata, 0, xtail - xdata) == NULL ||
+		    xval + xsizes[i] > xvtail) {
+			rc = -EPROTO;
+			CERROR("%s: broken prefetched xattrs of "DFID": rc = %d\n",
+			       ll_i2sbi(inode)->ll_fsname,
+			       PFID(ll_inode2fid(inode)), rc);
+		} else if (!strcmp(xdata, XATTR_NAME_ACL_ACCESS) ||
+			   ll_xattr_is_seclabel(xdata) ||
+			   !strcmp(xdata, XATTR_NAME_SOM)) {
+			/* same filtering as in ll_xattr_cache_refill() */
+			CDEBUG(D_CACHE, "not caching %s\n", xdata);
+		} else {
+			CDEBUG(D_CACHE, "prefetched [%s]=%.*s\n", xdata,
+			       xsizes[i], xval);
+			rc = ll_xattr_cache_add(lli, xdata, xval, xsizes[i]);
+		}
+		if (rc < 0) {
+			ll_xattr_cache_purge_locked(inode);
+			GOTO(out_unlock, rc);
+		}
+		xdata += strlen(xdata) + 1;
+		xval += xsizes[i];
+	}
+
+	set_bit(LLIF_XATTR_CACHE_PREFETCH_NEW, &lli->lli_flags);
+	set_bit(LLIF_XATTR_CACHE_PREFETCH, &lli->lli_flags);
+out_unlock:
+	up_write(&lli->lli_xattrs_list_rwsem);
+
+	RETURN(rc);
+}
@@ -344,6 +344,15 @@ retry:
 		if (IS_ERR(tgt))
 			RETURN(PTR_ERR(tgt));
 
+		op_data->op_mds = tgt->ltd_index;
+	} else if (op_data->op_bias & MDS_WBC_FLUSH) {
+		/* create under the EX lock llite holds on the parent, FID
+		 * allocated on the parent MDT
+		 */
+		tgt = lmv_fid2tgt(lmv, &op_data->op_fid2);
+		if (IS_ERR(tgt))
+			RETURN(PTR_ERR(tgt));
+
 		op_data->op_mds = tgt->ltd_index;
 	} else {
 		LASSERT(fid_is_sane(&op_data->op_fid1));
@@ -357,7 +366,8 @@ retry:
 
 	/* If it is ready to open the file by FID, do not need
 	 * allocate FID at all, otherwise it will confuse MDT */
-	if ((it->it_op & IT_CREAT) && !(it->it_open_flags & MDS_OPEN_BY_FID)) {
+	if ((it->it_op & IT_CREAT) && !(it->it_open_flags & MDS_OPEN_BY_FID) &&
+	    !(op_data->op_bias & MDS_WBC_FLUSH)) {
 		/*
 		 * For lookup(IT_CREATE) cases allocate new fid and setup FLD
 		 * for it.
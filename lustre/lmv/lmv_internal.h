@@ -32,6 +32,8 @@ struct lmv_batch {
 	struct lu_batch			 lbh_super;
 	struct ptlrpc_request_set	*lbh_rqset;
 	struct list_head		 lbh_sub_batch_list;
+	/* target of the last item added, for MF_PATH_WALK items */
+	struct lmv_tgt_desc		*lbh_last_tgt;
 };
 
 int lmv_intent_lock(struct obd_export *exp, struct md_op_data *op_data,
@@ -597,6 +597,10 @@ static int lmv_disconnect(struct obd_export *exp)
 
 	ENTRY;
 
+	/* readahead holds references on the MDC exports */
+	if (lmv->lmv_readdir_wq)
+		flush_workqueue(lmv->lmv_readdir_wq);
+
 	lmv_foreach_connected_tgt(lmv, tgt)
 		lmv_disconnect_mdc(obd, tgt);
 
@@ -1288,6 +1292,16 @@ static struct lu_device *lmv_device_alloc(const struct lu_env *env,
 		CWARN("%s: error initialize target table: rc = %d\n",
 		      obd->obd_name, rc);
 
+	lmv->lmv_readdir_wq = alloc_workqueue("%s-readdir", WQ_UNBOUND, 0,
+					      obd->obd_name);
+	if (lmv->lmv_readdir_wq)
+		lmv->lmv_readdir_readahead = true;
+	else
+		CWARN("%s: cannot start readdir readahead\n", obd->obd_name);
+	atomic_set(&lmv->lmv_ra_rpcs, 0);
+	atomic_set(&lmv->lmv_ra_pages, 0);
+	atomic_set(&lmv->lmv_ra_misses, 0);
+
 	OBD_ALLOC_PTR(pat);
 	if (!pat)
 		GOTO(out_free, rc = -ENOMEM);
@@ -1324,6 +1338,11 @@ static struct lu_device *lmv_device_free(const struct lu_env *env,
 
 	ENTRY;
 
+	if (lmv->lmv_readdir_wq) {
+		destroy_workqueue(lmv->lmv_readdir_wq);
+		lmv->lmv_readdir_wq = NULL;
+	}
+
 	spin_lock(&lmv->lmv_lock);
 	list_for_each_entry_safe(pat, ptmp,
 		&lmv->lmv_qos_exclude_list, qep_list) {
@@ -2234,6 +2253,20 @@ static int lmv_create(struct obd_export *exp, struct md_op_data *op_data,
 	if (lmv_dir_bad_hash(op_data->op_lso1))
 		RETURN(-EBADF);
 
+	if (op_data->op_bias & MDS_WBC_FLUSH) {
+		/* create cached by llite, FID allocated on the MDT of the
+		 * parent already. Keep the EX lock on the parent, the MDT
+		 * relies on it to skip the parent lock.
+		 */
+		tgt = lmv_fid2tgt(lmv, &op_data->op_fid2);
+		if (IS_ERR(tgt))
+			RETURN(PTR_ERR(tgt));
+
+		op_data->op_mds = tgt->ltd_index;
+		RETURN(md_create(tgt->ltd_exp, op_data, data, datalen, mode,
+				 uid, gid, cap_effective, rdev, request));
+	}
+
 	if (lmv_dir_layout_changing(op_data->op_lso1)) {
 		/*
 		 * if parent is migrating, create() needs to lookup existing
@@ -2996,6 +3029,7 @@ static struct lu_dirent *stripe_dirent_load(struct lmv_dir_ctxt *ctxt,
 	struct lmv_tgt_desc *tgt;
 	struct lu_dirent *ent = stripe->sd_ent;
 	__u64 hash = ctxt->ldc_hash;
+	int pages_read;
 	int rc = 0;
 
 	ENTRY;
@@ -3039,8 +3073,12 @@ static struct lu_dirent *stripe_dirent_load(struct lmv_dir_ctxt *ctxt,
 		op_data->op_data = oinfo->lmo_root;
 
 		stripe->sd_dp = NULL;
+		pages_read = ctxt->ldc_mrinfo->mr_pages_read;
 		rc = md_read_page(tgt->ltd_exp, op_data, ctxt->ldc_mrinfo, hash,
 				  &stripe->sd_page);
+		/* the page was neither cached nor read ahead */
+		if (ctxt->ldc_mrinfo->mr_pages_read != pages_read)
+			atomic_inc(&ctxt->ldc_lmv->lmv_ra_misses);
 
 		op_data->op_fid1 = fid;
 		op_data->op_fid2 = fid;
@@ -3146,6 +3184,170 @@ static struct lu_dirent *lmv_dirent_next(struct lmv_dir_ctxt *ctxt)
 	return ent;
 }
 
+/* dir pages of one stripe to read ahead in the background */
+struct lmv_readahead_work {
+	struct work_struct	 lrw_work;
+	struct lmv_obd		*lrw_lmv;
+	struct obd_export	*lrw_exp;	/* MDC export of the stripe */
+	struct lmv_stripe_object *lrw_lso;
+	struct lmv_oinfo	*lrw_oinfo;
+	struct md_op_data	 lrw_op_data;
+	struct md_readdir_info	 lrw_mrinfo;
+	__u64			 lrw_hash;
+};
+
+/*
+ * Find the first page from lrw_hash on that is not cached yet, and read it
+ * with all the pages following it that fit in one RPC. Reading the cached
+ * pages first is cheap, since their lock is cached as well.
+ */
+static void lmv_readahead_work(struct work_struct *work)
+{
+	struct lmv_readahead_work *lrw = container_of(work,
+						      struct lmv_readahead_work,
+						      lrw_work);
+	struct lmv_oinfo *oinfo = lrw->lrw_oinfo;
+	__u64 hash = lrw->lrw_hash;
+	int rc = 0;
+
+	while (hash != MDS_DIR_END_OFF) {
+		struct lu_dirpage *dp;
+		struct page *page;
+		__u64 end;
+
+		lrw->lrw_mrinfo.mr_pages_read = 0;
+		rc = md_read_page(lrw->lrw_exp, &lrw->lrw_op_data,
+				  &lrw->lrw_mrinfo, hash, &page);
+		if (rc)
+			break;
+
+		dp = kmap_local_page(page);
+		end = le64_to_cpu(dp->ldp_hash_end);
+		kunmap_local(dp);
+		put_page(page);
+
+		if (lrw->lrw_mrinfo.mr_pages_read) {
+			atomic_inc(&lrw->lrw_lmv->lmv_ra_rpcs);
+			atomic_add(lrw->lrw_mrinfo.mr_pages_read,
+				   &lrw->lrw_lmv->lmv_ra_pages);
+			break;
+		}
+
+		if (end <= hash)
+			hash = MDS_DIR_END_OFF;
+		else
+			hash = end;
+	}
+
+	CDEBUG(D_INODE, "stripe "DFID" read ahead from %#llx to %#llx: rc = %d\n",
+	       PFID(&oinfo->lmo_fid), lrw->lrw_hash, hash, rc);
+
+	/* don't retry until the directory is read again from the start */
+	WRITE_ONCE(oinfo->lmo_ra_hash, rc ? MDS_DIR_END_OFF : hash);
+	set_bit(LMO_RA_VALID, &oinfo->lmo_ra_flags);
+	clear_bit_unlock(LMO_RA_BUSY, &oinfo->lmo_ra_flags);
+
+	lmv_stripe_object_put(&lrw->lrw_lso);
+	class_export_put(lrw->lrw_exp);
+	OBD_FREE_PTR(lrw);
+}
+
+static int lmv_readahead_queue(struct obd_export *exp,
+			       struct md_op_data *op_data,
+			       struct md_readdir_info *mrinfo, int index,
+			       __u64 hash)
+{
+	struct lmv_obd *lmv = &exp->exp_obd->u.lmv;
+	struct lmv_oinfo *oinfo = &op_data->op_lso1->lso_lsm.lsm_md_oinfo[index];
+	struct lmv_readahead_work *lrw;
+	struct md_op_data *ra_data;
+	struct lmv_tgt_desc *tgt;
+
+	tgt = lmv_tgt(lmv, oinfo->lmo_mds);
+	if (!tgt || !tgt->ltd_exp || !tgt->ltd_active)
+		return -ENODEV;
+
+	OBD_ALLOC_PTR(lrw);
+	if (!lrw)
+		return -ENOMEM;
+
+	lrw->lrw_lmv = lmv;
+	lrw->lrw_exp = class_export_get(tgt->ltd_exp);
+	lrw->lrw_lso = lmv_stripe_object_get(op_data->op_lso1);
+	lrw->lrw_oinfo = oinfo;
+	lrw->lrw_hash = hash;
+	/* pages read ahead don't go through mr_readdir_plus */
+	lrw->lrw_mrinfo.mr_blocking_ast = mrinfo->mr_blocking_ast;
+
+	ra_data = &lrw->lrw_op_data;
+	*ra_data = *op_data;
+	ra_data->op_fid1 = oinfo->lmo_fid;
+	ra_data->op_fid2 = oinfo->lmo_fid;
+	ra_data->op_data = oinfo->lmo_root;
+	ra_data->op_name = NULL;
+	ra_data->op_namelen = 0;
+	ra_data->op_lso1 = NULL;
+	ra_data->op_lso2 = NULL;
+	ra_data->op_default_lso1 = NULL;
+	ra_data->op_file_secctx_name = NULL;
+	ra_data->op_file_secctx = NULL;
+	ra_data->op_file_encctx = NULL;
+
+	INIT_WORK(&lrw->lrw_work, lmv_readahead_work);
+	queue_work(lmv->lmv_readdir_wq, &lrw->lrw_work);
+
+	return 0;
+}
+
+/**
+ * lmv_stripes_readahead() - Read the dir pages of all stripes ahead
+ * @exp: obd export refer to LMV
+ * @op_data: hold those MD parameters of read_entry
+ * @mrinfo: readdir info of the caller
+ * @hash: hash the merge of the stripes has reached
+ *
+ * The merge of the stripes in hash order reads the next pages of a stripe
+ * only when it runs out of entries of that stripe, and waits for the MDT
+ * of the stripe each time. Once the merge has reached the pages read ahead
+ * last time for a stripe, read the next RPC worth of pages of the stripe
+ * in the background, so that all stripe MDTs are read in parallel and the
+ * merge finds the pages in the cache.
+ */
+static void lmv_stripes_readahead(struct obd_export *exp,
+				  struct md_op_data *op_data,
+				  struct md_readdir_info *mrinfo, __u64 hash)
+{
+	struct lmv_obd *lmv = &exp->exp_obd->u.lmv;
+	struct lmv_stripe_md *lsm = &op_data->op_lso1->lso_lsm;
+	int i;
+
+	/* attributes of readdir-plus are handed over as pages are read */
+	if (!lmv->lmv_readdir_readahead ||
+	    op_data->op_cli_flags & CLI_READDIR_PLUS ||
+	    hash == MDS_DIR_END_OFF)
+		return;
+
+	for (i = 0; i < lsm->lsm_md_stripe_count; i++) {
+		struct lmv_oinfo *oinfo = &lsm->lsm_md_oinfo[i];
+
+		if (!oinfo->lmo_root)
+			continue;
+
+		/* a new listing, forget about the previous one */
+		if (hash == 0)
+			clear_bit(LMO_RA_VALID, &oinfo->lmo_ra_flags);
+		else if (test_bit(LMO_RA_VALID, &oinfo->lmo_ra_flags) &&
+			 hash < READ_ONCE(oinfo->lmo_ra_hash))
+			continue;
+
+		if (test_and_set_bit_lock(LMO_RA_BUSY, &oinfo->lmo_ra_flags))
+			continue;
+
+		if (lmv_readahead_queue(exp, op_data, mrinfo, i, hash))
+			clear_bit_unlock(LMO_RA_BUSY, &oinfo->lmo_ra_flags);
+	}
+}
+
 /**
  * lmv_striped_read_page() - Build dir entry page for striped directory
  * @exp: obd export refer to LMV
@@ -3216,6 +3418,8 @@ static int lmv_striped_read_page(struct obd_export *exp,
 	ctxt->ldc_hash = offset;
 	ctxt->ldc_count = stripe_count;
 
+	lmv_stripes_readahead(exp, op_data, mrinfo, offset);
+
 	while (1) {
 		next = lmv_dirent_next(ctxt);
 
@@ -4481,16 +4685,28 @@ static int lmv_batch_add(struct obd_export *exp, struct lu_batch *bh,
 
 	ENTRY;
 
-	tgt = lmv_batch_locate_tgt(lmv, item);
-	if (IS_ERR(tgt))
-		RETURN(PTR_ERR(tgt));
-
 	lbh = container_of(bh, struct lmv_batch, lbh_super);
+	/*
+	 * A path walk item has no parent FID yet, the MDT looks its name up in
+	 * the object found by the previous item, so both go in the same RPC.
+	 */
+	if (item->mop_data.op_flags & MF_PATH_WALK) {
+		tgt = lbh->lbh_last_tgt;
+		if (tgt == NULL)
+			RETURN(-EINVAL);
+	} else {
+		tgt = lmv_batch_locate_tgt(lmv, item);
+		if (IS_ERR(tgt))
+			RETURN(PTR_ERR(tgt));
+	}
+
 	child_bh = lmv_batch_get_sub(lbh, tgt);
 	if (IS_ERR(child_bh))
 		RETURN(PTR_ERR(child_bh));
 
 	rc = md_batch_add(tgt->ltd_exp, child_bh, item);
+	if (rc == 0)
+		lbh->lbh_last_tgt = tgt;
 	RETURN(rc);
 }
 
@@ -214,6 +214,39 @@ static ssize_t qos_threshold_rr_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(qos_threshold_rr);
 
+static ssize_t readdir_readahead_show(struct kobject *kobj,
+				      struct attribute *attr, char *buf)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n",
+			 obd->u.lmv.lmv_readdir_readahead);
+}
+
+static ssize_t readdir_readahead_store(struct kobject *kobj,
+				       struct attribute *attr,
+				       const char *buffer, size_t count)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct lmv_obd *lmv = &obd->u.lmv;
+	bool val;
+	int rc;
+
+	rc = kstrtobool(buffer, &val);
+	if (rc)
+		return rc;
+
+	if (val && !lmv->lmv_readdir_wq)
+		return -ENODEV;
+
+	lmv->lmv_readdir_readahead = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(readdir_readahead);
+
 static int qos_exclude_seq_show_internal(struct seq_file *m, void *v,
 						bool is_prefix)
 {
@@ -395,11 +428,44 @@ static ssize_t qos_exclude_prefixes_seq_write(struct file *file,
 }
 LDEBUGFS_SEQ_FOPS(qos_exclude_prefixes);
 
+static int readdir_readahead_stats_seq_show(struct seq_file *m, void *v)
+{
+	struct obd_device *obd = m->private;
+	struct lmv_obd *lmv = &obd->u.lmv;
+
+	seq_printf(m, "readahead_rpcs: %u\n"
+		   "readahead_pages: %u\n"
+		   "miss_rpcs: %u\n",
+		   atomic_read(&lmv->lmv_ra_rpcs),
+		   atomic_read(&lmv->lmv_ra_pages),
+		   atomic_read(&lmv->lmv_ra_misses));
+
+	return 0;
+}
+
+static ssize_t readdir_readahead_stats_seq_write(struct file *file,
+						 const char __user *buffer,
+						 size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct obd_device *obd = m->private;
+	struct lmv_obd *lmv = &obd->u.lmv;
+
+	atomic_set(&lmv->lmv_ra_rpcs, 0);
+	atomic_set(&lmv->lmv_ra_pages, 0);
+	atomic_set(&lmv->lmv_ra_misses, 0);
+
+	return count;
+}
+LDEBUGFS_SEQ_FOPS(readdir_readahead_stats);
+
 static struct ldebugfs_vars ldebugfs_lmv_obd_vars[] = {
 	{ .name =	"qos_exclude_patterns",
 	  .fops =	&qos_exclude_patterns_fops },
 	{ .name =	"qos_exclude_prefixes",
 	  .fops =	&qos_exclude_prefixes_fops },
+	{ .name =	"readdir_readahead_stats",
+	  .fops =	&readdir_readahead_stats_fops },
 	{ NULL }
 };
 
@@ -492,6 +558,7 @@ static struct attribute *lmv_attrs[] = {
 	&lustre_attr_qos_prio_free.attr,
 	&lustre_attr_qos_rr_index.attr,
 	&lustre_attr_qos_threshold_rr.attr,
+	&lustre_attr_readdir_readahead.attr,
 	NULL,
 };
 
@@ -205,6 +205,9 @@ struct lov_layout_entry {
 	};
 };
 
+/* preference of a mirror with the "prefer" flag, outweighs any OST hint */
+#define LOV_PREF_RD_WEIGHT	1000
+
 struct lov_mirror_entry {
 	unsigned short	lre_mirror_id;
 	unsigned short	lre_stale:1,	/* set if any components is stale */
@@ -286,6 +289,12 @@ struct lov_object {
 			 * is inaccessible.
 			 */
 			int             lo_preferred_mirror;
+			/* For FLR: mirror currently fastest to read from,
+			 * as measured by the OSCs, see lov_io_mirror_select()
+			 */
+			int		lo_fastest_mirror;
+			/* For FLR: reads started, to probe other mirrors */
+			unsigned int	lo_mirror_reads;
 			/* For FLR: Number of (valid) mirrors. */
 			unsigned int lo_mirror_count;
 			struct lov_mirror_entry *lo_mirrors;
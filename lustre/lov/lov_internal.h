@@ -339,6 +339,10 @@ extern struct lu_device_type lov_device_type;
 
 #define LOV_MDC_TGT_MAX 256
 
+/* FLR mirror selection for reads */
+#define LOV_MIRROR_HYSTERESIS_DEF	20	/* percent */
+#define LOV_MIRROR_PROBE_INTERVAL	64	/* reads between probes */
+
 /* high level pool methods */
 int lov_pool_new(struct obd_device *obd, char *poolname);
 int lov_pool_del(struct obd_device *obd, char *poolname);
@@ -312,6 +312,152 @@ static int lov_io_mirror_write_intent(struct lov_io *lio,
 	RETURN(0);
 }
 
+/**
+ * lov_mirror_read_cost() - Estimated cost of reading a mirror
+ * @lov: LOV device
+ * @obj: mirrored object
+ * @lre: mirror to estimate
+ * @ext: extent about to be read
+ *
+ * The cost is that of the OST holding the stripe which backs the start
+ * of @ext, as measured by its OSC from recent reads.
+ *
+ * Return: cost in usec, or 0 if it is not known
+ */
+static unsigned int lov_mirror_read_cost(struct lov_obd *lov,
+					 struct lov_object *obj,
+					 struct lov_mirror_entry *lre,
+					 struct lu_extent *ext)
+{
+	struct lov_layout_entry *lle;
+
+	lov_foreach_mirror_layout_entry(obj, lle, lre) {
+		struct lov_stripe_md_entry *lsme = lle->lle_lsme;
+		struct lov_oinfo *loi;
+		struct lov_tgt_desc *tgt;
+		int stripe;
+
+		if (!lle->lle_valid ||
+		    !lu_extent_is_overlapped(ext, lle->lle_extent))
+			continue;
+
+		/* no measurement for Data-on-MDT */
+		if (lsme_is_dom(lsme))
+			return 0;
+
+		stripe = lov_stripe_number(obj->lo_lsm,
+					   lov_layout_entry_index(obj, lle),
+					   ext->e_start);
+		loi = lsme->lsme_oinfo[stripe];
+		if (lov_oinfo_is_dummy(loi))
+			return 0;
+
+		tgt = lov_tgt(lov, loi->loi_ost_idx);
+		if (!tgt || !tgt->ltd_active || !tgt->ltd_exp)
+			return 0;
+
+		return READ_ONCE(tgt->ltd_exp->exp_obd->u.cli.cl_read_cost_us);
+	}
+
+	return 0;
+}
+
+/**
+ * lov_io_mirror_select() - Pick the mirror to read from first
+ * @lio: LOV IO
+ * @obj: mirrored object
+ *
+ * Start from the mirror that is currently the fastest, which only
+ * changes once another one is faster by lov_mirror_hysteresis percent
+ * so that reads do not flip between mirrors of similar speed. Mirrors
+ * without the "prefer" flag are not considered if the preferred mirror
+ * has it. Every LOV_MIRROR_PROBE_INTERVAL reads start from another of
+ * the mirrors that may be considered instead, so that the speed of each
+ * is kept up to date.
+ *
+ * Return: index of the mirror to try first
+ */
+static int lov_io_mirror_select(struct lov_io *lio, struct lov_object *obj)
+{
+	struct lov_obd *lov = lu2lov_dev(obj->lo_cl.co_lu.lo_dev)->ld_lov;
+	struct lov_layout_composite *comp = &obj->u.composite;
+	struct lu_extent ext = { .e_start = lio->lis_pos,
+				 .e_end	  = lio->lis_pos + 1 };
+	struct lov_mirror_entry *lre;
+	unsigned int hysteresis = READ_ONCE(lov->lov_mirror_hysteresis);
+	unsigned int best_cost = 0;
+	unsigned int cur_cost = 0;
+	unsigned int reads;
+	unsigned int probe = 0;
+	bool pref_rd;
+	int best = -1;
+	int cur;
+	int i;
+
+	if (!READ_ONCE(lov->lov_mirror_read_select) ||
+	    comp->lo_mirror_count < 2)
+		return comp->lo_preferred_mirror;
+
+	cur = READ_ONCE(comp->lo_fastest_mirror);
+	if (cur < 0 || cur >= comp->lo_mirror_count)
+		cur = comp->lo_preferred_mirror;
+
+	/* racy, only used to probe other mirrors now and then */
+	reads = ++comp->lo_mirror_reads;
+	if (reads % LOV_MIRROR_PROBE_INTERVAL == 0)
+		probe = reads / LOV_MIRROR_PROBE_INTERVAL;
+
+	lre = lov_mirror_entry(obj, comp->lo_preferred_mirror);
+	pref_rd = lre->lre_preference >= LOV_PREF_RD_WEIGHT;
+
+	for (i = 0; i < comp->lo_mirror_count; i++) {
+		/* when probing, rotate the mirror examined first */
+		int m = probe ? (cur + probe + i) % comp->lo_mirror_count : i;
+		unsigned int cost;
+
+		lre = lov_mirror_entry(obj, m);
+		if (!lre->lre_valid || lre->lre_stale || lre->lre_foreign ||
+		    lre->lre_parity)
+			continue;
+
+		if (pref_rd && lre->lre_preference < LOV_PREF_RD_WEIGHT)
+			continue;
+
+		if (probe) {
+			/* the first allowed mirror other than the current */
+			if (m == cur)
+				continue;
+			return m;
+		}
+
+		cost = lov_mirror_read_cost(lov, obj, lre, &ext);
+		if (cost == 0)
+			continue;
+
+		if (m == cur)
+			cur_cost = cost;
+		if (best < 0 || cost < best_cost) {
+			best = m;
+			best_cost = cost;
+		}
+	}
+
+	if (probe || best < 0 || best == cur)
+		return cur;
+
+	if (cur_cost &&
+	    (u64)best_cost * (100 + hysteresis) >= (u64)cur_cost * 100)
+		return cur;
+
+	CDEBUG(D_LAYOUT, DFID": read mirror %d (%uus) instead of %d (%uus)\n",
+	       PFID(lu_object_fid(lov2lu(obj))), best, best_cost, cur,
+	       cur_cost);
+	WRITE_ONCE(comp->lo_fastest_mirror, best);
+	atomic_inc(&lov->lov_mirror_switches);
+
+	return best;
+}
+
 static int lov_io_mirror_init(struct lov_io *lio, struct lov_object *obj,
 			      struct cl_io *io)
 {
@@ -404,7 +550,11 @@ static int lov_io_mirror_init(struct lov_io *lio, struct lov_object *obj,
 	    /* reset the mirror index if layout has changed */
 	    lio->lis_mirror_layout_gen != obj->lo_lsm->lsm_layout_gen) {
 		lio->lis_mirror_layout_gen = obj->lo_lsm->lsm_layout_gen;
-		index = lio->lis_mirror_index = comp->lo_preferred_mirror;
+		if (io->ci_type == CIT_READ || io->ci_type == CIT_FAULT)
+			index = lov_io_mirror_select(lio, obj);
+		else
+			index = comp->lo_preferred_mirror;
+		lio->lis_mirror_index = index;
 	} else {
 		index = lio->lis_mirror_index;
 		LASSERT(index >= 0);
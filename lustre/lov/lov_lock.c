@@ -81,6 +81,45 @@ static int lov_sublock_init(const struct lu_env *env,
 	RETURN(result);
 }
 
+/**
+ * Translate the file access stride of a top-lock into the offsets of the
+ * sub-object \a stripe of component \a index.
+ *
+ * A stride maps onto a single object only if every chunk lands on the same
+ * stripe, i.e. the stride length is a multiple of the stripe width and the
+ * chunks do not cross a stripe boundary; otherwise no hint is given.
+ */
+static void lov_lock_sub_stride(struct lov_stripe_md *lsm, int index,
+				int stripe, const struct cl_lock_stride *fst,
+				struct cl_lock_stride *ost)
+{
+	struct lov_stripe_md_entry *lse = lsm->lsm_entries[index];
+	u64 swidth = stripe_width(lsm, index);
+	u64 skew;
+	loff_t obd_off;
+
+	if (fst->cls_length == 0 || !lsm_entry_inited(lsm, index))
+		return;
+
+	if (lse->lsme_stripe_count > 1) {
+		div64_u64_rem(fst->cls_length, swidth, &skew);
+		if (skew != 0)
+			return;
+
+		div64_u64_rem(fst->cls_offset, lse->lsme_stripe_size, &skew);
+		if (skew + fst->cls_bytes > lse->lsme_stripe_size)
+			return;
+	}
+
+	if (lov_stripe_offset(lsm, index, fst->cls_offset, stripe,
+			      &obd_off) != 0)
+		return;
+
+	ost->cls_offset = obd_off;
+	ost->cls_length = div64_u64(fst->cls_length, lse->lsme_stripe_count);
+	ost->cls_bytes = fst->cls_bytes;
+}
+
 /**
  * Creates sub-locks for a given lov_lock for the first time.
  *
@@ -175,6 +214,9 @@ init_sublock:
 			descr->cld_mode  = lock->cll_descr.cld_mode;
 			descr->cld_gid   = lock->cll_descr.cld_gid;
 			descr->cld_enq_flags = lock->cll_descr.cld_enq_flags;
+			lov_lock_sub_stride(lov->lo_lsm, index, i,
+					    &lock->cll_descr.cld_stride,
+					    &descr->cld_stride);
 
 			lls->sub_index = lov_comp_index(index, i);
 
@@ -726,6 +726,9 @@ int lov_setup(struct obd_device *obd, struct lustre_cfg *lcfg)
 
 	INIT_LIST_HEAD(&lov->lov_pool_list);
 	lov->lov_pool_count = 0;
+	lov->lov_mirror_read_select = false;
+	lov->lov_mirror_hysteresis = LOV_MIRROR_HYSTERESIS_DEF;
+	atomic_set(&lov->lov_mirror_switches, 0);
 	rc = lov_pool_hash_init(&lov->lov_pools_hash_body);
 	if (rc < 0) {
 		lu_tgt_descs_fini(ltd);
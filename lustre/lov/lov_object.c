@@ -721,7 +721,7 @@ static int lov_init_composite(const struct lu_env *env, struct lov_device *dev,
 		lre->lre_mirror_id = mirror_id;
 		lre->lre_start = lre->lre_end = i;
 		lre->lre_preference = lle->lle_lsme->lsme_flags &
-					LCME_FL_PREF_RD ? 1000 : 0;
+					LCME_FL_PREF_RD ? LOV_PREF_RD_WEIGHT : 0;
 		lre->lre_valid = lle->lle_valid;
 		lre->lre_stale = !lle->lle_valid;
 		lre->lre_foreign = lsme_is_foreign(lle->lle_lsme);
@@ -813,6 +813,7 @@ static int lov_init_composite(const struct lu_env *env, struct lov_device *dev,
 	}
 
 	LASSERT(comp->lo_preferred_mirror >= 0);
+	comp->lo_fastest_mirror = comp->lo_preferred_mirror;
 
 	EXIT;
 out:
@@ -2244,6 +2245,60 @@ static int lov_object_getstripe(const struct lu_env *env, struct cl_object *obj,
 	RETURN(rc);
 }
 
+static bool lov_mirror_id_find(const u16 *ids, int count, u16 id)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+		if (ids[i] == id)
+			return true;
+
+	return false;
+}
+
+/* fill in the FLR state and the in-sync data mirrors of @lsm */
+static void lov_layout_get_mirrors(struct lov_stripe_md *lsm,
+				   struct cl_layout *cl)
+{
+	u16 skip[LUSTRE_MIRROR_COUNT_MAX];
+	int nskip = 0;
+	int i;
+
+	cl->cl_mirror_count = 0;
+	cl->cl_flr_state = lsm_is_composite(lsm->lsm_magic) ?
+			   lsm->lsm_flags & LCM_FL_FLR_MASK : LCM_FL_NONE;
+	if (cl->cl_flr_state == LCM_FL_NONE)
+		return;
+
+	/* a mirror is out if any of its components is */
+	for (i = 0; i < lsm->lsm_entry_count; i++) {
+		struct lov_stripe_md_entry *lsme = lsm->lsm_entries[i];
+		u16 id = mirror_id_of(lsme->lsme_id);
+
+		if (!(lsme->lsme_flags & (LCME_FL_STALE | LCME_FL_PARITY)) &&
+		    !lsme_is_foreign(lsme))
+			continue;
+
+		if (nskip < ARRAY_SIZE(skip) &&
+		    !lov_mirror_id_find(skip, nskip, id))
+			skip[nskip++] = id;
+	}
+
+	for (i = 0; i < lsm->lsm_entry_count; i++) {
+		u16 id = mirror_id_of(lsm->lsm_entries[i]->lsme_id);
+
+		if (cl->cl_mirror_count == ARRAY_SIZE(cl->cl_mirror_ids))
+			break;
+
+		if (lov_mirror_id_find(skip, nskip, id) ||
+		    lov_mirror_id_find(cl->cl_mirror_ids, cl->cl_mirror_count,
+				       id))
+			continue;
+
+		cl->cl_mirror_ids[cl->cl_mirror_count++] = id;
+	}
+}
+
 static int lov_object_layout_get(const struct lu_env *env,
 				 struct cl_object *obj,
 				 struct cl_layout *cl)
@@ -2266,6 +2321,7 @@ static int lov_object_layout_get(const struct lu_env *env,
 	cl->cl_is_rdonly = lsm->lsm_is_rdonly;
 	cl->cl_is_released = lsm->lsm_is_released;
 	cl->cl_is_composite = lsm_is_composite(lsm->lsm_magic);
+	lov_layout_get_mirrors(lsm, cl);
 
 	rc = lov_lsm_pack(lsm, buf->lb_buf, buf->lb_len);
 	lov_lsm_put(lsm);
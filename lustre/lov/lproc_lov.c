@@ -178,6 +178,76 @@ static ssize_t desc_uuid_show(struct kobject *kobj, struct attribute *attr,
 }
 LUSTRE_RO_ATTR(desc_uuid);
 
+static ssize_t mirror_read_select_show(struct kobject *kobj,
+				       struct attribute *attr, char *buf)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+
+	return sprintf(buf, "%u\n", obd->u.lov.lov_mirror_read_select);
+}
+
+static ssize_t mirror_read_select_store(struct kobject *kobj,
+					struct attribute *attr,
+					const char *buffer, size_t count)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	bool val;
+	int rc;
+
+	rc = kstrtobool(buffer, &val);
+	if (rc)
+		return rc;
+
+	WRITE_ONCE(obd->u.lov.lov_mirror_read_select, val);
+
+	return count;
+}
+LUSTRE_RW_ATTR(mirror_read_select);
+
+static ssize_t mirror_read_hysteresis_show(struct kobject *kobj,
+					   struct attribute *attr, char *buf)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+
+	return sprintf(buf, "%u\n", obd->u.lov.lov_mirror_hysteresis);
+}
+
+static ssize_t mirror_read_hysteresis_store(struct kobject *kobj,
+					    struct attribute *attr,
+					    const char *buffer, size_t count)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 0, &val);
+	if (rc)
+		return rc;
+
+	if (val > 1000)
+		return -ERANGE;
+
+	WRITE_ONCE(obd->u.lov.lov_mirror_hysteresis, val);
+
+	return count;
+}
+LUSTRE_RW_ATTR(mirror_read_hysteresis);
+
+static ssize_t mirror_read_switches_show(struct kobject *kobj,
+					 struct attribute *attr, char *buf)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+
+	return sprintf(buf, "%u\n",
+		       atomic_read(&obd->u.lov.lov_mirror_switches));
+}
+LUSTRE_RO_ATTR(mirror_read_switches);
+
 static void *lov_tgt_seq_start(struct seq_file *p, loff_t *pos)
 {
 	struct obd_device *obd = p->private;
@@ -258,6 +328,54 @@ static const struct file_operations lov_debugfs_target_fops = {
 	.release	= seq_release,
 };
 
+static int lov_tgt_read_seq_show(struct seq_file *p, void *v)
+{
+	struct lov_tgt_desc *tgt = v;
+	struct client_obd *cli;
+
+	if (!tgt->ltd_exp)
+		return 0;
+
+	cli = &tgt->ltd_exp->exp_obd->u.cli;
+	seq_printf(p, "%d: %s samples: %u latency_p50_us: %u latency_p99_us: %u read_bw_kbs: %llu cost_us: %u\n",
+		   tgt->ltd_index, obd_uuid2str(&tgt->ltd_uuid),
+		   atomic_read(&cli->cl_read_lat_samples),
+		   lprocfs_oh_pct_log2(&cli->cl_read_lat_recent, 50),
+		   lprocfs_oh_pct_log2(&cli->cl_read_lat_recent, 99),
+		   READ_ONCE(cli->cl_read_bw) >> 10,
+		   READ_ONCE(cli->cl_read_cost_us));
+	return 0;
+}
+
+static const struct seq_operations lov_tgt_read_sops = {
+	.start = lov_tgt_seq_start,
+	.stop = lov_tgt_seq_stop,
+	.next = lov_tgt_seq_next,
+	.show = lov_tgt_read_seq_show,
+};
+
+static int lov_target_read_seq_open(struct inode *inode, struct file *file)
+{
+	struct seq_file *seq;
+	int rc;
+
+	rc = seq_open(file, &lov_tgt_read_sops);
+	if (rc)
+		return rc;
+
+	seq = file->private_data;
+	seq->private = inode->i_private;
+	return 0;
+}
+
+static const struct file_operations lov_debugfs_target_read_fops = {
+	.owner		= THIS_MODULE,
+	.open		= lov_target_read_seq_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= seq_release,
+};
+
 static struct attribute *lov_attrs[] = {
 	&lustre_attr_activeobd.attr,
 	&lustre_attr_numobd.attr,
@@ -266,6 +384,9 @@ static struct attribute *lov_attrs[] = {
 	&lustre_attr_stripeoffset.attr,
 	&lustre_attr_stripetype.attr,
 	&lustre_attr_stripecount.attr,
+	&lustre_attr_mirror_read_select.attr,
+	&lustre_attr_mirror_read_hysteresis.attr,
+	&lustre_attr_mirror_read_switches.attr,
 	NULL,
 };
 
@@ -283,6 +404,8 @@ int lov_tunables_init(struct obd_device *obd)
 
 	debugfs_create_file("target_obd", 0444, obd->obd_debugfs_entry,
 			    obd, &lov_debugfs_target_fops);
+	debugfs_create_file("target_read_stats", 0444, obd->obd_debugfs_entry,
+			    obd, &lov_debugfs_target_read_fops);
 #ifdef CONFIG_PROC_FS
 	lov->lov_pool_proc_entry = lprocfs_register("pools",
 						    obd->obd_proc_entry,
@@ -175,7 +175,7 @@ void mdc_file_sepol_pack(struct req_capsule *pill, struct sptlrpc_sepol *p)
 }
 
 void mdc_readdir_pack(struct req_capsule *pill, __u64 pgoff, size_t size,
-		      const struct lu_fid *fid)
+		      const struct lu_fid *fid, __u32 attrs)
 {
 	struct mdt_body *b = req_capsule_client_get(pill, &RMF_MDT_BODY);
 
@@ -184,7 +184,7 @@ void mdc_readdir_pack(struct req_capsule *pill, __u64 pgoff, size_t size,
 	b->mbo_size = pgoff;			/* !! */
 	b->mbo_nlink = size;			/* !! */
 	__mdc_pack_body(b, -1);
-	b->mbo_mode = LUDA_FID | LUDA_TYPE;
+	b->mbo_mode = LUDA_FID | LUDA_TYPE | attrs;
 }
 
 /* packing of MDS records */
@@ -232,7 +232,9 @@ void mdc_create_pack(struct req_capsule *pill, struct md_op_data *op_data,
 	}
 	set_mrc_cr_flags(rec, flags);
 	rec->cr_bias     = op_data->op_bias;
-	rec->cr_umask    = current_umask();
+	/* the umask was applied when the create was cached */
+	rec->cr_umask    = op_data->op_bias & MDS_WBC_FLUSH ? 0 :
+			   current_umask();
 
 	mdc_pack_name(pill, &RMF_NAME, op_data->op_name, op_data->op_namelen);
 	if (data) {
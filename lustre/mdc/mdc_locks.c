@@ -283,14 +283,17 @@ mdc_intent_open_pack(struct obd_export *exp, struct lookup_intent *it,
 						   MDS_INODELOCK_OPEN);
 	}
 
-	/* If CREATE, cancel parent's UPDATE lock. */
+	/* If CREATE, cancel parent's UPDATE lock, unless the MDT is to rely
+	 * on the EX lock this client holds on the parent.
+	 */
 	if (it->it_op & IT_CREAT)
 		mode = LCK_EX;
 	else
 		mode = LCK_CR;
-	count += mdc_resource_cancel_unused(exp, &op_data->op_fid1,
-					    &cancels, mode,
-					    MDS_INODELOCK_UPDATE);
+	if (!(op_data->op_bias & MDS_WBC_FLUSH))
+		count += mdc_resource_cancel_unused(exp, &op_data->op_fid1,
+						    &cancels, mode,
+						    MDS_INODELOCK_UPDATE);
 
 	req = ptlrpc_request_alloc(class_exp2cliimp(exp),
 				   &RQF_LDLM_INTENT_OPEN);
@@ -449,8 +452,11 @@ mdc_intent_create_pack(struct obd_export *exp, struct lookup_intent *it,
 
 	ENTRY;
 
-	if (fid_is_sane(&op_data->op_fid1))
-		/* cancel parent's UPDATE lock. */
+	/* cancel parent's UPDATE lock, unless this writes back a mkdir cached
+	 * under the EX lock on the parent
+	 */
+	if (fid_is_sane(&op_data->op_fid1) &&
+	    !(op_data->op_bias & MDS_WBC_FLUSH))
 		count = mdc_resource_cancel_unused(exp, &op_data->op_fid1,
 						   &cancels, LCK_EX,
 						   MDS_INODELOCK_UPDATE);
@@ -615,6 +621,7 @@ mdc_intent_getattr_pack(struct obd_export *exp, struct lookup_intent *it,
 		    OBD_MD_DEFAULT_MEA;
 	struct ldlm_intent *lit;
 	__u32 easize;
+	__u32 xattr_size = 0;
 	bool have_secctx = false;
 	int rc;
 
@@ -654,9 +661,25 @@ mdc_intent_getattr_pack(struct obd_export *exp, struct lookup_intent *it,
 	else
 		easize = obd->u.cli.cl_max_mds_easize;
 
+	/* xattrs are only worth asking for if the xattr cache is used */
+	if (exp_connect_xattr_prefetch(exp) &&
+	    op_data->op_cli_flags & CLI_XATTR_PREFETCH &&
+	    it->it_op & (IT_LOOKUP | IT_GETATTR)) {
+		xattr_size = READ_ONCE(obd->u.cli.cl_xattr_prefetch_size);
+		valid |= OBD_MD_FLXATTR;
+	}
+
 	/* pack the intended request */
 	mdc_getattr_pack(&req->rq_pill, valid, it->it_open_flags, op_data,
 			 easize);
+	if (xattr_size) {
+		struct mdt_body *body;
+
+		/* tell the MDT the room reserved below */
+		body = req_capsule_client_get(&req->rq_pill, &RMF_MDT_BODY);
+		body->mbo_aclsize = xattr_size;
+		body->mbo_max_mdsize = xattr_size / 4;
+	}
 
 	req_capsule_set_size(&req->rq_pill, &RMF_MDT_MD, RCL_SERVER, easize);
 	req_capsule_set_size(&req->rq_pill, &RMF_ACL, RCL_SERVER, acl_bufsize);
@@ -688,6 +711,22 @@ mdc_intent_getattr_pack(struct obd_export *exp, struct lookup_intent *it,
 		req_capsule_set_size(&req->rq_pill, &RMF_FILE_ENCCTX,
 				     RCL_SERVER, 0);
 
+	/* room for security/trusted xattrs piggybacked by the MDT */
+	if (xattr_size) {
+		req_capsule_set_size(&req->rq_pill, &RMF_EADATA, RCL_SERVER,
+				     xattr_size / 4);
+		req_capsule_set_size(&req->rq_pill, &RMF_EAVALS, RCL_SERVER,
+				     xattr_size);
+		req_capsule_set_size(&req->rq_pill, &RMF_EAVALS_LENS,
+				     RCL_SERVER, XATTR_PREFETCH_COUNT_MAX *
+						 sizeof(__u32));
+	} else {
+		req_capsule_set_size(&req->rq_pill, &RMF_EADATA, RCL_SERVER, 0);
+		req_capsule_set_size(&req->rq_pill, &RMF_EAVALS, RCL_SERVER, 0);
+		req_capsule_set_size(&req->rq_pill, &RMF_EAVALS_LENS,
+				     RCL_SERVER, 0);
+	}
+
 	ptlrpc_request_set_replen(req);
 	RETURN(req);
 }
@@ -859,6 +898,18 @@ int mdc_finish_enqueue(struct obd_export *exp,
 					     LPROC_MD_CREATE);
 		}
 
+		/* the xattrs of the file did not fit, ask for more room */
+		if (it->it_op & (IT_LOOKUP | IT_GETATTR) &&
+		    (body->mbo_valid & OBD_MD_FLXATTRALL) == OBD_MD_FLXATTRLS) {
+			struct client_obd *cli = &exp->exp_obd->u.cli;
+			__u32 size = READ_ONCE(cli->cl_xattr_prefetch_size);
+
+			if (size < XATTR_PREFETCH_VALS_MAX)
+				WRITE_ONCE(cli->cl_xattr_prefetch_size,
+					   min_t(__u32, size * 2,
+						 XATTR_PREFETCH_VALS_MAX));
+		}
+
 		if (body->mbo_valid & (OBD_MD_FLDIREA | OBD_MD_FLEASIZE)) {
 			void *eadata;
 
@@ -1441,8 +1492,8 @@ int mdc_revalidate_lock(struct obd_export *exp, struct lookup_intent *it,
 
 		mode = mdc_lock_match(exp, LDLM_FL_BLOCK_GRANTED, fid,
 				      LDLM_IBITS, &policy,
-				      LCK_CR | LCK_CW | LCK_PR | LCK_PW, 0,
-				      &lockh);
+				      LCK_CR | LCK_CW | LCK_PR | LCK_PW |
+				      LCK_EX, 0, &lockh);
 	}
 
 	if (mode) {
@@ -1025,7 +1025,8 @@ out:
 
 static int mdc_getpage(struct obd_export *exp, const struct lu_fid *fid,
 		       u64 offset, struct page **pages, int npages,
-		       __u32 projid, struct ptlrpc_request **request)
+		       __u32 projid, __u32 attrs,
+		       struct ptlrpc_request **request)
 {
 	struct ptlrpc_request   *req;
 	struct ptlrpc_bulk_desc *desc;
@@ -1064,7 +1065,7 @@ restart_bulk:
 		desc->bd_frag_ops->add_kiov_frag(desc, pages[i], 0,
 						 PAGE_SIZE);
 
-	mdc_readdir_pack(&req->rq_pill, offset, PAGE_SIZE * npages, fid);
+	mdc_readdir_pack(&req->rq_pill, offset, PAGE_SIZE * npages, fid, attrs);
 
 	ptlrpc_request_set_replen(req);
 	rc = ptlrpc_queue_wait(req);
@@ -1357,6 +1358,7 @@ struct readpage_param {
 	__u64			rp_off;
 	int			rp_hash64;
 	struct obd_export	*rp_exp;
+	struct md_readdir_info	*rp_mrinfo;
 };
 
 /**
@@ -1409,7 +1411,9 @@ static int ll_mdc_read_page_remote(void *data, struct page *page0)
 	}
 
 	rc = mdc_getpage(rp->rp_exp, fid, rp->rp_off, page_pool, npages,
-			 op_data->op_projid, &req);
+			 op_data->op_projid,
+			 op_data->op_cli_flags & CLI_READDIR_PLUS ?
+			 LUDA_ATTRS : 0, &req);
 	if (rc < 0) {
 		/* page0 is special, which was added into page cache early */
 		cfs_delete_from_page_cache(page0);
@@ -1421,8 +1425,17 @@ static int ll_mdc_read_page_remote(void *data, struct page *page0)
 	lu_pgs = req->rq_bulk->bd_nob_transferred >> LU_PAGE_SHIFT;
 	LASSERT(!(req->rq_bulk->bd_nob_transferred & ~LU_PAGE_MASK));
 	ptlrpc_req_put(req);
+	rp->rp_mrinfo->mr_pages_read += rd_pgs;
 
 	mdc_dirpage_add(NULL, inode, page_pool, rd_pgs, lu_pgs, rp->rp_hash64);
+
+	/* hand the pages just read with LUDA_ATTRS to the caller */
+	if (op_data->op_cli_flags & CLI_READDIR_PLUS &&
+	    rp->rp_mrinfo->mr_readdir_plus) {
+		for (i = 0; i < rd_pgs; i++)
+			rp->rp_mrinfo->mr_readdir_plus(rp->rp_mrinfo,
+						       page_pool[i]);
+	}
 exit:
 	/* release extra pages */
 	for (i = 1; i < npages; i++) {
@@ -1532,6 +1545,7 @@ static int mdc_read_page(struct obd_export *exp, struct md_op_data *op_data,
 
 	rp_param.rp_exp = exp;
 	rp_param.rp_mod = op_data;
+	rp_param.rp_mrinfo = mrinfo;
 	page = ll_read_cache_page(mapping,
 				  hash_x_index(rp_param.rp_off,
 					       rp_param.rp_hash64),
@@ -2909,9 +2923,9 @@ static int mdc_import_event(struct obd_device *obd, struct obd_import *imp,
 			 */
 			osc_io_unplug(env, cli, NULL);
 
-			cfs_hash_for_each_nolock(ns->ns_rs_hash,
-						 osc_ldlm_resource_invalidate,
-						 env, 0);
+			ldlm_namespace_res_walk(ns,
+						osc_ldlm_resource_invalidate,
+						env);
 			cl_env_put(env, &refcheck);
 			ldlm_namespace_cleanup(ns, LDLM_FL_LOCAL_ONLY);
 		} else {
@@ -3050,6 +3064,7 @@ int mdc_setup(struct obd_device *obd, struct lustre_cfg *cfg)
 		GOTO(err_osc_cleanup, rc);
 
 	obd->u.cli.cl_dom_min_inline_repsize = MDC_DOM_DEF_INLINE_REPSIZE;
+	obd->u.cli.cl_xattr_prefetch_size = XATTR_PREFETCH_VALS_DEFAULT;
 	obd->u.cli.cl_lsom_update = true;
 
 	ns_register_cancel(obd->obd_namespace, mdc_cancel_weight);
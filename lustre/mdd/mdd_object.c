@@ -4075,6 +4075,140 @@ static int mdd_readpage_sanity_check(const struct lu_env *env,
 	return 0;
 }
 
+/**
+ * mdd_dir_page_attrs() - Append LUDA_ATTRS to a directory entry
+ * @env: execution environment
+ * @mdd: MDD device
+ * @ent: entry just packed by the OSD, with LUDA_FID in little-endian
+ * @bytes: space left in the lu_page for @ent
+ *
+ * Attributes are only packed for existing local non-directory targets without
+ * a POSIX ACL, which the client may trust without fetching anything else.
+ * Size and blocks are only returned when strict or lazy SOM is stored on the
+ * MDT, as pack_attr2body() does. IDs are not mapped here, that is done by the
+ * MDT for the nodemap of the requesting client.
+ *
+ * Return: new record length of @ent
+ */
+static size_t mdd_dir_page_attrs(const struct lu_env *env,
+				 struct mdd_device *mdd, struct lu_dirent *ent,
+				 size_t bytes)
+{
+	struct lu_attr *la = MDD_ENV_VAR(env, cattr);
+	struct lustre_som_attrs som;
+	struct mdd_object *child;
+	struct luda_attrs *lda;
+	struct lu_fid fid;
+	__u32 attrs = le32_to_cpu(ent->lde_attrs);
+	size_t recsize = le16_to_cpu(ent->lde_reclen);
+	size_t newsize;
+	__u64 valid = 0;
+	int rc;
+
+	if (!(attrs & LUDA_FID) || S_ISDIR(lu_dirent_type_get(ent)))
+		return recsize;
+
+	newsize = lu_dirent_calc_size(le16_to_cpu(ent->lde_namelen),
+				      (attrs & LUDA_TYPE) | LUDA_ATTRS);
+	if (newsize > bytes)
+		return recsize;
+
+	fid_le_to_cpu(&fid, &ent->lde_fid);
+	if (!fid_is_norm(&fid) && !fid_is_igif(&fid))
+		return recsize;
+
+	child = mdd_object_find(env, mdd, &fid);
+	if (IS_ERR_OR_NULL(child))
+		return recsize;
+
+	if (mdd_object_remote(child) || !mdd_object_exists(child))
+		GOTO(out, rc = 0);
+
+	rc = mdd_la_get(env, child, la);
+	if (rc || S_ISDIR(la->la_mode) || mdd_is_dead_obj(child))
+		GOTO(out, rc);
+
+	rc = mdo_xattr_get(env, child, &LU_BUF_NULL, XATTR_NAME_ACL_ACCESS);
+	if (rc != -ENODATA && rc != -EOPNOTSUPP)
+		GOTO(out, rc);
+
+	lda = (void *)ent + lu_dirent_calc_size(le16_to_cpu(ent->lde_namelen),
+						attrs & LUDA_TYPE);
+	memset(lda, 0, sizeof(*lda));
+
+	if (la->la_valid & LA_ATIME) {
+		lda->lda_atime = cpu_to_le64(la->la_atime);
+		valid |= OBD_MD_FLATIME;
+	}
+	if (la->la_valid & LA_MTIME) {
+		lda->lda_mtime = cpu_to_le64(la->la_mtime);
+		valid |= OBD_MD_FLMTIME;
+	}
+	if (la->la_valid & LA_CTIME) {
+		lda->lda_ctime = cpu_to_le64(la->la_ctime);
+		valid |= OBD_MD_FLCTIME;
+	}
+	if (la->la_valid & LA_BTIME) {
+		lda->lda_btime = cpu_to_le64(la->la_btime);
+		valid |= OBD_MD_FLBTIME;
+	}
+	if (la->la_valid & LA_FLAGS) {
+		lda->lda_flags = cpu_to_le32(la->la_flags);
+		valid |= OBD_MD_FLFLAGS;
+	}
+	if (la->la_valid & LA_NLINK) {
+		lda->lda_nlink = cpu_to_le32(la->la_nlink);
+		valid |= OBD_MD_FLNLINK;
+	}
+	if (la->la_valid & LA_UID) {
+		lda->lda_uid = cpu_to_le32(la->la_uid);
+		valid |= OBD_MD_FLUID;
+	}
+	if (la->la_valid & LA_GID) {
+		lda->lda_gid = cpu_to_le32(la->la_gid);
+		valid |= OBD_MD_FLGID;
+	}
+	if (la->la_valid & LA_PROJID) {
+		lda->lda_projid = cpu_to_le32(la->la_projid);
+		valid |= OBD_MD_FLPROJID;
+	}
+	lda->lda_mode = cpu_to_le32(la->la_mode);
+	valid |= OBD_MD_FLMODE | OBD_MD_FLTYPE;
+
+	if (!S_ISREG(la->la_mode)) {
+		lda->lda_size = cpu_to_le64(la->la_size);
+		lda->lda_blocks = cpu_to_le64(la->la_blocks);
+		lda->lda_rdev = cpu_to_le32(la->la_rdev);
+		valid |= OBD_MD_FLSIZE | OBD_MD_FLBLOCKS | OBD_MD_FLRDEV;
+	} else {
+		rc = mdo_xattr_get(env, child,
+				   mdd_buf_get(env, &som, sizeof(som)),
+				   XATTR_NAME_SOM);
+		if (rc == sizeof(som)) {
+			lustre_som_swab(&som);
+			lda->lda_size = cpu_to_le64(som.lsa_size);
+			lda->lda_blocks = cpu_to_le64(som.lsa_blocks);
+			if (som.lsa_valid & SOM_FL_STRICT)
+				valid |= OBD_MD_FLSIZE | OBD_MD_FLBLOCKS;
+			else if (som.lsa_valid & SOM_FL_LAZY)
+				valid |= OBD_MD_FLLAZYSIZE |
+					 OBD_MD_FLLAZYBLOCKS;
+		}
+	}
+	lda->lda_valid = cpu_to_le64(valid);
+
+	ent->lde_attrs = cpu_to_le32(attrs | LUDA_ATTRS);
+	ent->lde_reclen = cpu_to_le16(newsize);
+	recsize = newsize;
+	rc = 0;
+out:
+	mdd_object_put(env, child);
+	if (rc < 0)
+		CDEBUG(D_INODE, "%s: no attrs for "DFID": rc = %d\n",
+		       mdd2obd_dev(mdd)->obd_name, PFID(&fid), rc);
+	return recsize;
+}
+
 static int mdd_dir_page_build(const struct lu_env *env, struct dt_object *obj,
 			      union lu_page *lp, size_t bytes,
 			      const struct dt_it_ops *iops,
@@ -4118,7 +4252,9 @@ static int mdd_dir_page_build(const struct lu_env *env, struct dt_object *obj,
 
 		if (bytes >= recsize &&
 		    !CFS_FAIL_CHECK(OBD_FAIL_MDS_DIR_PAGE_WALK)) {
-			result = iops->rec(env, it, (struct dt_rec *)ent, attr);
+			/* the OSD does not know about inode attributes */
+			result = iops->rec(env, it, (struct dt_rec *)ent,
+					   attr & ~LUDA_ATTRS);
 			if (result == -ESTALE)
 				GOTO(next, result);
 			if (result != 0)
@@ -4128,6 +4264,9 @@ static int mdd_dir_page_build(const struct lu_env *env, struct dt_object *obj,
 			 * recheck record length had room to store FID
 			 */
 			recsize = le16_to_cpu(ent->lde_reclen);
+			if (attr & LUDA_ATTRS)
+				recsize = mdd_dir_page_attrs(env, arg, ent,
+							     bytes);
 
 			if (le32_to_cpu(ent->lde_attrs) & LUDA_FID) {
 				fid_le_to_cpu(&fid, &ent->lde_fid);
@@ -4218,7 +4357,7 @@ int mdd_readpage(const struct lu_env *env, struct md_object *obj,
 	}
 
 	rc = dt_index_walk(env, mdd_object_child(mdd_obj), rdpg,
-			   mdd_dir_page_build, NULL);
+			   mdd_dir_page_build, mdo2mdd(obj));
 	if (rc >= 0) {
 		struct lu_dirpage *dp;
 
@@ -51,6 +51,76 @@ static int mdt_batch_pack_repmsg(struct mdt_thread_info *info)
 	return 0;
 }
 
+/*
+ * A BUT_GETATTR sub request with a zero parent FID continues a path walk:
+ * its name is looked up in the object found by the previous sub request, so
+ * that a multi-component path is resolved by one batched RPC. @walk_fid is
+ * that object, or zero if the walk can't continue there.
+ *
+ * Return 1 if the walk stops here, 0 if the sub request can be executed.
+ */
+static int mdt_batch_walk_prep(struct mdt_thread_info *info, __u32 opc,
+			       const struct lu_fid *walk_fid)
+{
+	struct req_capsule *pill = info->mti_pill;
+	struct ldlm_request *dlm_req;
+	struct mdt_body *body;
+
+	if (opc != BUT_GETATTR)
+		return 0;
+
+	body = req_capsule_client_get(pill, &RMF_MDT_BODY);
+	if (body == NULL)
+		return -EFAULT;
+
+	if (!fid_is_zero(&body->mbo_fid1))
+		return 0;
+
+	if (!exp_connect_path_walk(info->mti_exp) || fid_is_zero(walk_fid))
+		return 1;
+
+	dlm_req = req_capsule_client_get(pill, &RMF_DLM_REQ);
+	if (dlm_req == NULL)
+		return -EFAULT;
+
+	body->mbo_fid1 = *walk_fid;
+	fid_build_reg_res_name(walk_fid, &dlm_req->lock_desc.l_resource.lr_name);
+	info->mti_path_walk = 1;
+
+	return 0;
+}
+
+/*
+ * Remember the object found by a BUT_GETATTR sub request for the next path
+ * walk component. The walk can only continue in a local, plain directory:
+ * remote entries and striped directories are left to the client.
+ */
+static void mdt_batch_walk_next(struct mdt_thread_info *info, __u32 opc,
+				struct lu_fid *walk_fid)
+{
+	struct req_capsule *pill = info->mti_pill;
+	struct ldlm_reply *rep;
+	struct mdt_body *body;
+
+	fid_zero(walk_fid);
+	if (opc != BUT_GETATTR)
+		return;
+
+	rep = req_capsule_server_get(pill, &RMF_DLM_REP);
+	if (rep == NULL || rep->lock_policy_res2 != 0 ||
+	    !(rep->lock_policy_res1 & DISP_LOOKUP_POS) ||
+	    rep->lock_policy_res1 & DISP_LOOKUP_NEG)
+		return;
+
+	body = req_capsule_server_get(pill, &RMF_MDT_BODY);
+	if (body == NULL || !(body->mbo_valid & OBD_MD_FLTYPE) ||
+	    !S_ISDIR(body->mbo_mode) ||
+	    body->mbo_valid & (OBD_MD_MDS | OBD_MD_MEA))
+		return;
+
+	*walk_fid = body->mbo_fid1;
+}
+
 typedef int (*mdt_batch_reconstructor)(struct tgt_session_info *tsi);
 
 static mdt_batch_reconstructor reconstructors[BUT_LAST_OPC];
@@ -128,6 +198,7 @@ int mdt_batch(struct tgt_session_info *tsi)
 	struct ptlrpc_bulk_desc *desc = NULL;
 	struct tg_reply_data *trd = NULL;
 	struct lustre_msg *repmsg = NULL;
+	struct lu_fid walk_fid;
 	bool need_reconstruct;
 	__u32 handled_update_count = 0;
 	__u32 update_buf_count;
@@ -235,6 +306,7 @@ int mdt_batch(struct tgt_session_info *tsi)
 		GOTO(out, rc = -ENOMEM);
 
 	need_reconstruct = tgt_check_resent(req, trd);
+	fid_zero(&walk_fid);
 	/* Walk through sub requests in the batch request to execute them. */
 	for (i = 0; i < update_buf_count; i++) {
 		struct batch_update_request *bur;
@@ -281,6 +353,14 @@ int mdt_batch(struct tgt_session_info *tsi)
 			if (rc)
 				GOTO(out, rc);
 
+			rc = mdt_batch_walk_prep(info, reqmsg->lm_opc,
+						 &walk_fid);
+			if (rc < 0)
+				GOTO(out, rc);
+			/* remaining sub requests are cancelled on the client */
+			if (rc > 0)
+				GOTO(walk_stop, rc = 0);
+
 			/* Need to reconstruct the reply for committed sub
 			 * requests in a batched RPC.
 			 * It only calls reconstruct for modification sub
@@ -313,6 +393,7 @@ next:
 				GOTO(out, rc);
 
 			repmsg->lm_result = rc;
+			mdt_batch_walk_next(info, reqmsg->lm_opc, &walk_fid);
 			mdt_thread_info_reset(info);
 
 			replen = lustre_packed_msg_size(repmsg);
@@ -321,6 +402,7 @@ next:
 		}
 	}
 
+walk_stop:
 	CDEBUG(D_INFO, "reply size %u packed replen %u\n",
 	       buh->buh_reply_size, packed_replen);
 	if (buh->buh_reply_size > packed_replen)
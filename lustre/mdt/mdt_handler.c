@@ -2094,6 +2094,28 @@ out_match:
  *            (1)normal request should release the child lock;
  *            (2)intent request will grant the lock to client.
  */
+/*
+ * The parent of a path walk sub request was granted to the client by the
+ * previous sub request of the same batched RPC, and that lock can't be
+ * cancelled before the reply is sent. A blocking enqueue could queue behind a
+ * conflicting lock waiting for that cancel, so only try the parent lock and
+ * end the walk with -EBUSY if it is contended, like batched statahead does.
+ */
+static int mdt_path_walk_parent_lock(struct mdt_thread_info *info,
+				     struct mdt_object *parent,
+				     struct mdt_lock_handle *lhp)
+{
+	enum mds_ibits_locks ibits = MDS_INODELOCK_NONE;
+	int rc;
+
+	rc = mdt_object_lock_try(info, parent, lhp, &ibits,
+				 MDS_INODELOCK_UPDATE, LCK_PR);
+	if (rc == 0 && !(ibits & MDS_INODELOCK_UPDATE))
+		rc = -EBUSY;
+
+	return rc;
+}
+
 static int mdt_getattr_name_lock(struct mdt_thread_info *info,
 				 struct mdt_lock_handle *lhc,
 				 enum mds_ibits_locks child_bits,
@@ -2305,7 +2327,12 @@ static int mdt_getattr_name_lock(struct mdt_thread_info *info,
 		/* step 1: lock parent only if parent is a directory */
 		if (S_ISDIR(lu_object_attr(&parent->mot_obj))) {
 			lhp = &info->mti_lh[MDT_LH_PARENT];
-			rc = mdt_parent_lock(info, parent, lhp, lname, LCK_PR);
+			if (info->mti_path_walk)
+				rc = mdt_path_walk_parent_lock(info, parent,
+							       lhp);
+			else
+				rc = mdt_parent_lock(info, parent, lhp, lname,
+						     LCK_PR);
 			if (unlikely(rc != 0))
 				RETURN(rc);
 		}
@@ -2427,6 +2454,14 @@ static int mdt_getattr_name_lock(struct mdt_thread_info *info,
 				try_bits |= MDS_INODELOCK_DOM;
 		}
 
+		/* xattrs can be piggybacked only under an XATTR lock */
+		if (!mdt_object_remote(child) && ldlm_rep != NULL &&
+		    req_capsule_has_field(info->mti_pill, &RMF_EAVALS_LENS,
+					  RCL_SERVER) &&
+		    req_capsule_get_size(info->mti_pill, &RMF_EAVALS_LENS,
+					 RCL_SERVER) != 0)
+			try_bits |= MDS_INODELOCK_XATTR;
+
 		/*
 		 * To avoid possible deadlock between batched statahead RPC
 		 * and rename()/migrate() operation, it should use trylock to
@@ -2504,6 +2539,9 @@ static int mdt_getattr_name_lock(struct mdt_thread_info *info,
 		GOTO(out_child, rc);
 	}
 
+	if (child_bits & MDS_INODELOCK_XATTR)
+		mdt_pack_xattrs_in_reply(info, child);
+
 	lock = ldlm_handle2lock(&lhc->mlh_reg_lh);
 	if (lock) {
 		/* Debugging code. */
@@ -2952,6 +2990,75 @@ static int mdt_set_info(struct tgt_session_info *tsi)
 	RETURN(rc);
 }
 
+/**
+ * mdt_readpage_attrs() - Prepare LUDA_ATTRS of readdir pages for the client
+ * @exp: export of the client
+ * @rdpg: pages filled by mo_readpage()
+ * @nob: number of bytes filled
+ *
+ * MDD packs raw attributes, map the IDs for the nodemap of the client and
+ * demote strict SOM to lazy SOM if that is disabled, as mdt_pack_attr2body()
+ * does for getattr replies.
+ */
+static void mdt_readpage_attrs(struct obd_export *exp, struct lu_rdpg *rdpg,
+			       int nob)
+{
+	struct mdt_device *mdt = mdt_exp2dev(exp);
+	struct lu_nodemap *nodemap;
+	int i;
+
+	nodemap = nodemap_get_from_exp(exp);
+	if (IS_ERR(nodemap))
+		nodemap = NULL;
+
+	for (i = 0; i < nob >> LU_PAGE_SHIFT; i++) {
+		struct lu_dirpage *dp;
+		struct lu_dirent *ent;
+		void *addr;
+
+		addr = rdpg_page_get(rdpg, i / LU_PAGE_COUNT);
+		dp = addr + (i % LU_PAGE_COUNT) * LU_PAGE_SIZE;
+		for (ent = lu_dirent_start(dp); ent; ent = lu_dirent_next(ent)) {
+			struct luda_attrs *lda = lu_dirent_attrs_get(ent);
+			__u64 valid;
+
+			if (!lda)
+				continue;
+
+			valid = le64_to_cpu(lda->lda_valid);
+			if (!nodemap) {
+				valid &= ~(OBD_MD_FLUID | OBD_MD_FLGID |
+					   OBD_MD_FLPROJID);
+			} else {
+				lda->lda_uid = cpu_to_le32(nodemap_map_id(
+					nodemap, NODEMAP_UID,
+					NODEMAP_FS_TO_CLIENT,
+					le32_to_cpu(lda->lda_uid)));
+				lda->lda_gid = cpu_to_le32(nodemap_map_id(
+					nodemap, NODEMAP_GID,
+					NODEMAP_FS_TO_CLIENT,
+					le32_to_cpu(lda->lda_gid)));
+				lda->lda_projid = cpu_to_le32(nodemap_map_id(
+					nodemap, NODEMAP_PROJID,
+					NODEMAP_FS_TO_CLIENT,
+					le32_to_cpu(lda->lda_projid)));
+			}
+			if (S_ISREG(le32_to_cpu(lda->lda_mode)) &&
+			    valid & OBD_MD_FLSIZE &&
+			    !mdt->mdt_enable_strict_som) {
+				valid &= ~(OBD_MD_FLSIZE | OBD_MD_FLBLOCKS);
+				valid |= OBD_MD_FLLAZYSIZE |
+					 OBD_MD_FLLAZYBLOCKS;
+			}
+			lda->lda_valid = cpu_to_le64(valid);
+		}
+		rdpg_page_put(rdpg, i / LU_PAGE_COUNT, addr);
+	}
+
+	if (nodemap)
+		nodemap_putref(nodemap);
+}
+
 static int mdt_readpage(struct tgt_session_info *tsi)
 {
 	struct mdt_thread_info	*info = mdt_th_info(tsi->tsi_env);
@@ -2986,6 +3093,9 @@ static int mdt_readpage(struct tgt_session_info *tsi)
 	rdpg->rp_attrs = reqbody->mbo_mode;
 	if (exp_connect_flags(tsi->tsi_exp) & OBD_CONNECT_64BITHASH)
 		rdpg->rp_attrs |= LUDA_64BITHASH;
+	if (!exp_connect_readdir_plus(tsi->tsi_exp) ||
+	    !mdt_exp2dev(tsi->tsi_exp)->mdt_enable_readdir_plus)
+		rdpg->rp_attrs &= ~LUDA_ATTRS;
 	rdpg->rp_count  = min_t(unsigned int, reqbody->mbo_nlink,
 				exp_max_brw_size(tsi->tsi_exp));
 	rdpg->rp_npages = (rdpg->rp_count + PAGE_SIZE - 1) >>
@@ -3005,6 +3115,9 @@ static int mdt_readpage(struct tgt_session_info *tsi)
 	if (rc < 0)
 		GOTO(free_rdpg, rc);
 
+	if (rdpg->rp_attrs & LUDA_ATTRS)
+		mdt_readpage_attrs(tsi->tsi_exp, rdpg, rc);
+
 	/* send pages to client */
 	rc = tgt_sendpage(tsi, rdpg, rc);
 
@@ -3049,6 +3162,33 @@ static inline bool mdt_is_readonly_open(struct mdt_thread_info *info, __u32 op)
 	     !(info->mti_spec.sp_cr_flags & (MDS_FMODE_WRITE | MDS_OPEN_CREAT));
 }
 
+static void mdt_preset_xattrs_size(struct mdt_thread_info *info)
+{
+	struct req_capsule *pill = info->mti_pill;
+	struct mdt_body *body = info->mti_body;
+	__u32 names = 0;
+	__u32 vals = 0;
+
+	if (!req_capsule_has_field(pill, &RMF_EAVALS_LENS, RCL_SERVER))
+		return;
+
+	/* the client asks for xattrs piggybacked on getattr and passes the
+	 * room it reserved for them, see mdc_intent_getattr_pack()
+	 */
+	if (exp_connect_xattr_prefetch(info->mti_exp) && body &&
+	    body->mbo_valid & OBD_MD_FLXATTR) {
+		names = min_t(__u32, body->mbo_max_mdsize,
+			      XATTR_PREFETCH_NAMES_MAX);
+		vals = min_t(__u32, body->mbo_aclsize, XATTR_PREFETCH_VALS_MAX);
+	}
+
+	req_capsule_set_size(pill, &RMF_EADATA, RCL_SERVER, names);
+	req_capsule_set_size(pill, &RMF_EAVALS, RCL_SERVER, vals);
+	req_capsule_set_size(pill, &RMF_EAVALS_LENS, RCL_SERVER,
+			     names && vals ? XATTR_PREFETCH_COUNT_MAX *
+					     sizeof(__u32) : 0);
+}
+
 static void mdt_preset_secctx_size(struct mdt_thread_info *info)
 {
 	struct req_capsule *pill = info->mti_pill;
@@ -4698,6 +4838,7 @@ static int mdt_unpack_req_pack_rep(struct mdt_thread_info *info,
 
 		mdt_preset_secctx_size(info);
 		mdt_preset_encctx_size(info);
+		mdt_preset_xattrs_size(info);
 
 		rc = req_capsule_server_pack(pill);
 		if (rc)
@@ -4719,6 +4860,7 @@ void mdt_thread_info_reset(struct mdt_thread_info *info)
 	info->mti_big_acl_used = 0;
 	info->mti_som_strict = 0;
 	info->mti_intent_lock = 0;
+	info->mti_path_walk = 0;
 
 	info->mti_spec.no_create = 0;
 	info->mti_spec.sp_rm_entry = 0;
@@ -4905,6 +5047,7 @@ int mdt_intent_lock_replace(struct mdt_thread_info *info,
 		new_lock->l_glimpse_ast = ldlm_server_glimpse_ast;
 	new_lock->l_remote_handle = lock->l_remote_handle;
 	new_lock->l_flags &= ~LDLM_FL_LOCAL;
+	ldlm_reclaim_attach(new_lock, lustre_msg_get_jobid(req->rq_reqmsg));
 
 	unlock_res_and_lock(new_lock);
 
@@ -6588,6 +6731,7 @@ static int mdt_init0(const struct lu_env *env, struct mdt_device *m,
 	m->mdt_enable_remote_dir_gid = 0;
 	m->mdt_enable_remote_rename = 1;
 	m->mdt_enable_rename_trylock = 1;
+	m->mdt_enable_readdir_plus = 1;
 	m->mdt_enable_striped_dir = 1;
 	m->mdt_enable_dmv_implicit_inherit = 1;
 	m->mdt_dir_restripe_nsonly = 1;
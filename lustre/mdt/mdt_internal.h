@@ -281,6 +281,8 @@ struct mdt_device {
 				   mdt_enable_remote_dir:1,
 				   mdt_enable_remote_rename:1,
 				   mdt_enable_rename_trylock:1,
+				   /* pack LUDA_ATTRS in readdir pages */
+				   mdt_enable_readdir_plus:1,
 				   mdt_enable_striped_dir:1,
 				   mdt_readonly:1,
 				   mdt_skip_lfsck:1,
@@ -442,6 +444,8 @@ struct mdt_reint_record {
 enum mdt_reint_flag {
 	MRF_OPEN_TRUNC = BIT(0),
 	MRF_OPEN_RESEND = BIT(1),
+	MRF_CREATE_WBC_LOCK = BIT(2),
+	MRF_CREATE_WBC_FLUSH = BIT(3),
 };
 
 /*
@@ -502,7 +506,9 @@ struct mdt_thread_info {
 				   mti_som_strict:1,
 	/* Batch processing environment */
 				   mti_batch_env:1,
-				   mti_intent_lock:1;
+				   mti_intent_lock:1,
+	/* parent was found by the previous sub request of a path walk */
+				   mti_path_walk:1;
 
 	/* opdata for mdt_reint_open(), has the same as
 	 * ldlm_reply:lock_policy_res1.  mdt_update_last_rcvd() stores this
@@ -915,6 +921,8 @@ int mdt_close_unpack(struct mdt_thread_info *info);
 int mdt_reint_unpack(struct mdt_thread_info *info, __u32 op);
 void mdt_fix_lov_magic(struct mdt_thread_info *info, void *eadata);
 int mdt_reint_rec(struct mdt_thread_info *info, struct mdt_lock_handle *lh);
+bool mdt_wbc_parent_locked(struct mdt_thread_info *info,
+			   struct mdt_object *obj);
 #ifdef CONFIG_LUSTRE_FS_POSIX_ACL
 int mdt_pack_acl2body(struct mdt_thread_info *info, struct mdt_body *repbody,
 		      struct mdt_object *o, struct lu_nodemap *nodemap);
@@ -924,6 +932,8 @@ void mdt_pack_attr2body(struct mdt_thread_info *info, struct mdt_body *b,
 int mdt_pack_size2body(struct mdt_thread_info *info,
 			const struct lu_fid *fid,  struct lustre_handle *lh);
 int mdt_getxattr(struct mdt_thread_info *info);
+int mdt_pack_xattrs_in_reply(struct mdt_thread_info *info,
+			     struct mdt_object *child);
 int mdt_reint_setxattr(struct mdt_thread_info *info,
 		       struct mdt_lock_handle *lh);
 
@@ -1012,6 +1012,15 @@ int mdt_fix_reply(struct mdt_thread_info *info)
 	    !(body->mbo_valid & OBD_MD_DEFAULT_MEA))
 		req_capsule_shrink(pill, &RMF_DEFAULT_MDT_MD, 0, RCL_SERVER);
 
+	/* Shrink optional prefetched xattr buffers if they are not used */
+	if (req_capsule_has_field(pill, &RMF_EAVALS_LENS, RCL_SERVER) &&
+	    req_capsule_get_size(pill, &RMF_EAVALS_LENS, RCL_SERVER) != 0 &&
+	    !(body->mbo_valid & OBD_MD_FLXATTR)) {
+		req_capsule_shrink(pill, &RMF_EAVALS, 0, RCL_SERVER);
+		req_capsule_shrink(pill, &RMF_EAVALS_LENS, 0, RCL_SERVER);
+		req_capsule_shrink(pill, &RMF_EADATA, 0, RCL_SERVER);
+	}
+
 	/*
 	 * Some more field should be shrinked if needed.
 	 * This should be done by those who added fields to reply message.
@@ -1544,6 +1553,10 @@ static int mdt_create_unpack(struct mdt_thread_info *info)
 		LA_CTIME | LA_MTIME | LA_ATIME;
 	memset(&sp->u, 0, sizeof(sp->u));
 	sp->sp_cr_flags = get_mrc_cr_flags(rec);
+	if (rec->cr_bias & MDS_WBC_LOCK)
+		rr->rr_flags |= MRF_CREATE_WBC_LOCK;
+	if (rec->cr_bias & MDS_WBC_FLUSH)
+		rr->rr_flags |= MRF_CREATE_WBC_FLUSH;
 
 	rc = mdt_name_unpack(pill, &RMF_NAME, &rr->rr_name, 0);
 	if (rc < 0)
@@ -1934,6 +1947,8 @@ static int mdt_open_unpack(struct mdt_thread_info *info)
 		RETURN(-EPROTO);
 
 	info->mti_cross_ref = !!(rec->cr_bias & MDS_CROSS_REF);
+	if (rec->cr_bias & MDS_WBC_FLUSH)
+		rr->rr_flags |= MRF_CREATE_WBC_FLUSH;
 
 	mdt_name_unpack(pill, &RMF_NAME, &rr->rr_name, MNF_FIX_ANON);
 
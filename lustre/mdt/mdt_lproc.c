@@ -767,6 +767,7 @@ MDT_BOOL_RW_ATTR(enable_strict_som);
 MDT_BOOL_RW_ATTR(enable_dmv_implicit_inherit);
 MDT_BOOL_RW_ATTR(enable_dmv_xattr);
 MDT_BOOL_RW_ATTR(enable_rename_trylock);
+MDT_BOOL_RW_ATTR(enable_readdir_plus);
 
 /**
  * enable_resource_id_check_show() - Show if resource ID checking is enabled
@@ -1408,6 +1409,7 @@ static struct attribute *mdt_attrs[] = {
 	&lustre_attr_enable_parallel_rename_file.attr,
 	&lustre_attr_enable_parallel_rename_crossdir.attr,
 	&lustre_attr_enable_pin_gid.attr,
+	&lustre_attr_enable_readdir_plus.attr,
 	&lustre_attr_enable_remote_dir.attr,
 	&lustre_attr_enable_remote_dir_gid.attr,
 	&lustre_attr_enable_remote_rename.attr,
@@ -1660,6 +1662,9 @@ int mdt_tunables_init(struct mdt_device *mdt, const char *name)
 			       LPROCFS_CNTR_HISTOGRAM);
 	rc = lprocfs_job_stats_init(obd, ARRAY_SIZE(mdt_stats),
 				    mdt_stats_counter_init);
+	if (!rc)
+		obd2obt(obd)->obt_jobstats.ojs_show_fn =
+			ldlm_reclaim_job_seq_show;
 
 	lproc_mdt_attach_rename_seqstat(mdt);
 
@@ -1568,10 +1568,16 @@ int mdt_reint_open(struct mdt_thread_info *info, struct mdt_lock_handle *lhc)
 again_pw:
 	if (lock_mode != LCK_NL) {
 		lh = &info->mti_lh[MDT_LH_PARENT];
-		result = mdt_parent_lock(info, parent, lh, &rr->rr_name,
-					 lock_mode);
-		if (result != 0)
-			GOTO(out_parent, result);
+		if (rr->rr_flags & MRF_CREATE_WBC_FLUSH &&
+		    mdt_wbc_parent_locked(info, parent)) {
+			/* the parent is already locked by the client for us */
+			mdt_lock_reg_init(lh, LCK_MINMODE);
+		} else {
+			result = mdt_parent_lock(info, parent, lh,
+						 &rr->rr_name, lock_mode);
+			if (result != 0)
+				GOTO(out_parent, result);
+		}
 
 		result = mdo_lookup(info->mti_env, mdt_object_child(parent),
 				    &rr->rr_name, child_fid, &info->mti_spec);
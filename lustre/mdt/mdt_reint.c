@@ -503,6 +503,54 @@ unlock_parent:
 	return rc;
 }
 
+/*
+ * Check if the client sending the request holds an EX lock on the UPDATE bit
+ * of @obj, under which it cached creates in @obj. The client releases the
+ * lock only once these creates are done, so they can't lock @obj themselves,
+ * while the lock keeps any other client out of @obj.
+ */
+bool mdt_wbc_parent_locked(struct mdt_thread_info *info,
+			   struct mdt_object *obj)
+{
+	struct ldlm_res_id *res_id = &info->mti_res_id;
+	struct ldlm_resource *res;
+	struct ldlm_lock *lock;
+	bool locked = false;
+
+	if (mdt_object_remote(obj))
+		return false;
+
+	fid_build_reg_res_name(mdt_object_fid(obj), res_id);
+	res = ldlm_resource_get(info->mti_mdt->mdt_namespace, res_id,
+				LDLM_IBITS, 0);
+	if (IS_ERR(res))
+		return false;
+
+	lock_res(res);
+	list_for_each_entry(lock, &res->lr_granted, l_res_link) {
+		if (lock->l_export == info->mti_exp &&
+		    lock->l_granted_mode == LCK_EX &&
+		    lock->l_policy_data.l_inodebits.bits &
+		    MDS_INODELOCK_UPDATE) {
+			struct ldlm_prolong_args args = {
+				.lpa_export = info->mti_exp,
+				.lpa_req = mdt_info_req(info),
+			};
+
+			/* the client writes back its cached creates before
+			 * cancelling a revoked lock, don't evict it meanwhile
+			 */
+			ldlm_lock_prolong_one(lock, &args);
+			locked = true;
+			break;
+		}
+	}
+	unlock_res(res);
+	ldlm_resource_putref(res);
+
+	return locked;
+}
+
 /*
  * mdt_create() - File creation operation
  * @info: struct mdt_thread_info
@@ -687,9 +735,15 @@ static int mdt_create(struct mdt_thread_info *info, struct mdt_lock_handle *lhc)
 	CFS_RACE(OBD_FAIL_MDS_CREATE_RACE);
 
 	lh = &info->mti_lh[MDT_LH_PARENT];
-	rc = mdt_parent_lock(info, parent, lh, &rr->rr_name, LCK_PW);
-	if (rc)
-		GOTO(put_parent, rc);
+	if (rr->rr_flags & MRF_CREATE_WBC_FLUSH &&
+	    mdt_wbc_parent_locked(info, parent)) {
+		/* the parent is already locked by the client for us */
+		mdt_lock_reg_init(lh, LCK_MINMODE);
+	} else {
+		rc = mdt_parent_lock(info, parent, lh, &rr->rr_name, LCK_PW);
+		if (rc)
+			GOTO(put_parent, rc);
+	}
 
 	if (!mdt_object_remote(parent)) {
 		rc = mdt_version_get_check_save(info, parent, 0);
@@ -832,10 +886,17 @@ static int mdt_create(struct mdt_thread_info *info, struct mdt_lock_handle *lhc)
 		 * a directory.
 		 * Due to the above reason, it grants a lock with LCK_PR mode to
 		 * the client.
+		 *
+		 * A client caching the creates in a plain directory it makes
+		 * gets LCK_EX instead, which keeps other clients out of the
+		 * directory until the client has created its entries.
 		 */
 		rc = mdt_object_lock(info, child, lhc, MDS_INODELOCK_LOOKUP |
 				     MDS_INODELOCK_UPDATE | MDS_INODELOCK_PERM,
-				     LCK_PR);
+				     (rr->rr_flags & MRF_CREATE_WBC_LOCK &&
+				      S_ISDIR(ma->ma_attr.la_mode) &&
+				      !(ma->ma_valid & MA_LMV)) ?
+				     LCK_EX : LCK_PR);
 	}
 
 	EXIT;
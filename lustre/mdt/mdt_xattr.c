@@ -217,6 +217,122 @@ out_shrink:
 	return rc;
 }
 
+/**
+ * mdt_pack_xattrs_in_reply() - piggyback xattrs in a getattr intent reply
+ * @info: thread info of the getattr/lookup intent
+ * @child: object whose xattrs are packed, XATTR ibit lock is held on it
+ *
+ * Pack security, default ACL and trusted xattrs of @child into the
+ * EADATA/EAVALS/EAVALS_LENS buffers reserved by the client, in the same
+ * format as mdt_getxattr_all(). The reply is marked with OBD_MD_FLXATTR only
+ * if every such xattr fits, so the client can answer a miss with -ENODATA
+ * without asking the MDT again. If they do not fit, the reply is marked with
+ * OBD_MD_FLXATTRLS alone and the client reserves more room next time.
+ * Anything going wrong only drops the xattrs from the reply, it never fails
+ * the getattr.
+ *
+ * Return: always 0
+ */
+int mdt_pack_xattrs_in_reply(struct mdt_thread_info *info,
+			     struct mdt_object *child)
+{
+	const struct lu_env *env = info->mti_env;
+	struct req_capsule *pill = info->mti_pill;
+	struct md_object *next = mdt_object_child(child);
+	struct lu_buf *buf = &info->mti_buf;
+	struct lu_buf list = { NULL, 0 };
+	struct mdt_body *repbody;
+	char *names, *vals, *name, *tail;
+	__u32 *sizes;
+	int names_max, vals_max, count_max;
+	int namelen = 0, vallen = 0, count = 0;
+	int rc;
+
+	ENTRY;
+
+	names_max = req_capsule_get_size(pill, &RMF_EADATA, RCL_SERVER);
+	vals_max = req_capsule_get_size(pill, &RMF_EAVALS, RCL_SERVER);
+	count_max = req_capsule_get_size(pill, &RMF_EAVALS_LENS, RCL_SERVER) /
+		    sizeof(__u32);
+	if (names_max == 0 || count_max == 0)
+		GOTO(out_shrink, rc = -ENOSPC);
+
+	rc = mo_xattr_list(env, next, &LU_BUF_NULL);
+	if (rc < 0)
+		GOTO(out_shrink, rc);
+
+	lu_buf_alloc(&list, rc + 1);
+	if (list.lb_buf == NULL)
+		GOTO(out_shrink, rc = -ENOMEM);
+
+	rc = mo_xattr_list(env, next, &list);
+	if (rc < 0)
+		GOTO(out_free, rc);
+
+	names = req_capsule_server_get(pill, &RMF_EADATA);
+	vals = req_capsule_server_get(pill, &RMF_EAVALS);
+	sizes = req_capsule_server_get(pill, &RMF_EAVALS_LENS);
+
+	tail = (char *)list.lb_buf + rc;
+	for (name = list.lb_buf; name < tail; name += strlen(name) + 1) {
+		int len = strnlen(name, tail - name) + 1;
+
+		if (!exp_xattr_prefetch_name(name))
+			continue;
+
+		/* all or nothing, the client treats the set as complete */
+		if (count == count_max || namelen + len > names_max ||
+		    vallen == vals_max)
+			GOTO(out_free, rc = -E2BIG);
+
+		buf->lb_buf = vals + vallen;
+		buf->lb_len = vals_max - vallen;
+		rc = mo_xattr_get(env, next, buf, name);
+		if (rc == -ENODATA)
+			continue;
+		if (rc == -ERANGE)
+			GOTO(out_free, rc = -E2BIG);
+		if (rc < 0)
+			GOTO(out_free, rc);
+
+		rc = mdt_nodemap_map_acl(info, buf->lb_buf, rc, name,
+					 NODEMAP_FS_TO_CLIENT);
+		if (rc < 0)
+			GOTO(out_free, rc);
+
+		memcpy(names + namelen, name, len);
+		namelen += len;
+		vallen += rc;
+		sizes[count++] = rc;
+	}
+
+	repbody = req_capsule_server_get(pill, &RMF_MDT_BODY);
+	repbody->mbo_valid |= OBD_MD_FLXATTR;
+	rc = 0;
+out_free:
+	lu_buf_free(&list);
+out_shrink:
+	if (rc < 0) {
+		CDEBUG(D_INODE, "%s: no xattr prefetch for "DFID": rc = %d\n",
+		       mdt_obd_name(info->mti_mdt),
+		       PFID(mdt_object_fid(child)), rc);
+		if (rc == -E2BIG) {
+			repbody = req_capsule_server_get(pill, &RMF_MDT_BODY);
+			repbody->mbo_valid |= OBD_MD_FLXATTRLS;
+		}
+		namelen = 0;
+		vallen = 0;
+		count = 0;
+	}
+
+	req_capsule_shrink(pill, &RMF_EAVALS, vallen, RCL_SERVER);
+	req_capsule_shrink(pill, &RMF_EAVALS_LENS, count * sizeof(__u32),
+			   RCL_SERVER);
+	req_capsule_shrink(pill, &RMF_EADATA, namelen, RCL_SERVER);
+
+	RETURN(0);
+}
+
 int mdt_getxattr(struct mdt_thread_info *info)
 {
 	struct ptlrpc_request  *req = mdt_info_req(info);
@@ -957,12 +957,13 @@ static struct obd_export *__class_new_export(struct obd_device *obd,
 
 	export->exp_conn_cnt = 0;
 	export->exp_lock_hash = NULL;
-	export->exp_flock_hash = NULL;
 	/* 2 = class_handle_hash + last */
 	refcount_set(&export->exp_handle.h_ref, 2);
 	atomic_set(&export->exp_rpc_count, 0);
 	atomic_set(&export->exp_cb_count, 0);
 	atomic_set(&export->exp_locks_count, 0);
+	atomic_set(&export->exp_granted_locks, 0);
+	INIT_LIST_HEAD(&export->exp_reclaim_list);
 #if LUSTRE_TRACKS_LOCK_EXP_REFS
 	INIT_LIST_HEAD(&export->exp_locks_list);
 	spin_lock_init(&export->exp_locks_list_guard);
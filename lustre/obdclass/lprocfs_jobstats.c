@@ -687,6 +687,8 @@ static int lprocfs_jobstats_seq_show(struct seq_file *p, void *v)
 		}
 		seq_puts(p, " }\n");
 	}
+	if (stats->ojs_show_fn)
+		stats->ojs_show_fn(p, stats->ojs_obd, job->js_jobid);
 	job_putref(job);
 
 	return 0;
@@ -856,6 +858,8 @@ int lprocfs_job_stats_init(struct obd_device *obd, int cntr_num,
 	stats->ojs_cleanup_last = ktime_get_real();
 	stats->ojs_cntr_num = cntr_num;
 	stats->ojs_cntr_init_fn = init_fn;
+	stats->ojs_show_fn = NULL;
+	stats->ojs_obd = obd;
 	atomic64_set(&stats->ojs_jobs, 0);
 
 	entry = lprocfs_add_simple(obd->obd_proc_entry, "job_stats", stats,
@@ -848,6 +848,11 @@ static const char *const obd_connect_names[] = {
 	"flr_immediate_mirror",	      /* 0x20000000000 */
 	"no_append",		      /* 0x40000000000 */
 	"flr_ec_wr",		      /* 0x80000000000 */
+	"batch_bl_ast",		     /* 0x100000000000 */
+	"lock_stride",		     /* 0x200000000000 */
+	"readdir_plus",		     /* 0x400000000000 */
+	"path_walk",		     /* 0x800000000000 */
+	"xattr_prefetch",	    /* 0x1000000000000 */
 	NULL
 };
 
@@ -2543,6 +2548,50 @@ void lprocfs_oh_clear(struct obd_histogram *oh)
 }
 EXPORT_SYMBOL(lprocfs_oh_clear);
 
+/**
+ * lprocfs_oh_halve() - Age a histogram
+ * @oh: histogram to age
+ *
+ * Halve every bucket so that older samples weigh less than new ones.
+ */
+void lprocfs_oh_halve(struct obd_histogram *oh)
+{
+	int i;
+
+	spin_lock(&oh->oh_lock);
+	for (i = 0; i < OBD_HIST_MAX; i++)
+		oh->oh_buckets[i] >>= 1;
+	spin_unlock(&oh->oh_lock);
+}
+EXPORT_SYMBOL(lprocfs_oh_halve);
+
+/**
+ * lprocfs_oh_pct_log2() - Percentile of a log2 histogram
+ * @oh: histogram filled by lprocfs_oh_tally_log2()
+ * @pct: percentile wanted, 1-100
+ *
+ * Return: upper bound of the bucket holding the @pct percentile,
+ * or 0 if the histogram is empty
+ */
+unsigned int lprocfs_oh_pct_log2(struct obd_histogram *oh, unsigned int pct)
+{
+	unsigned long total = lprocfs_oh_sum(oh);
+	unsigned long sum = 0;
+	int i;
+
+	if (total == 0)
+		return 0;
+
+	for (i = 0; i < OBD_HIST_MAX - 1; i++) {
+		sum += oh->oh_buckets[i];
+		if (sum * 100 >= total * pct)
+			break;
+	}
+
+	return 1U << i;
+}
+EXPORT_SYMBOL(lprocfs_oh_pct_log2);
+
 void lprocfs_oh_tally_pcpu(struct obd_hist_pcpu *oh,
 			   unsigned int value)
 {
@@ -184,6 +184,83 @@ static ssize_t atime_diff_store(struct kobject *kobj, struct attribute *attr,
 }
 LUSTRE_RW_ATTR(atime_diff);
 
+/**
+ * lvb_fresh_ms_show() - Show how recent a write must be to skip glimpses
+ * @kobj: Kernel object (OFD device)
+ * @attr: Pointer to struct attribute
+ * @buf: buffer where the output string will be written [out]
+ *
+ * Return:
+ * * %0 on success
+ * * %negative value on error
+ */
+static ssize_t lvb_fresh_ms_show(struct kobject *kobj, struct attribute *attr,
+				 char *buf)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct ofd_device *ofd = ofd_dev(obd->obd_lu_dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", ofd->ofd_lvb_fresh_ms);
+}
+
+/**
+ * lvb_fresh_ms_store() - Change how recent a write must be to skip glimpses
+ * @kobj: Kernel object (OFD device)
+ * @attr: Pointer to struct attribute
+ * @buffer: string which represents the window in milliseconds, 0 to disable
+ * @count: @buffer length
+ *
+ * A glimpse is answered from the LVB, without a glimpse AST, if the only
+ * client to glimpse refreshed the LVB by a write within that window.
+ *
+ * Return:
+ * * %@count on success
+ * * %negative number on error
+ */
+static ssize_t lvb_fresh_ms_store(struct kobject *kobj, struct attribute *attr,
+				  const char *buffer, size_t count)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct ofd_device *ofd = ofd_dev(obd->obd_lu_dev);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 0, &val);
+	if (rc)
+		return rc;
+
+	if (val > OFD_MAX_LVB_FRESH_MS)
+		return -EINVAL;
+
+	WRITE_ONCE(ofd->ofd_lvb_fresh_ms, val);
+	return count;
+}
+LUSTRE_RW_ATTR(lvb_fresh_ms);
+
+/**
+ * lvb_fresh_hits_show() - Show number of glimpses answered from the LVB
+ * @kobj: Kernel object (OFD device)
+ * @attr: Pointer to struct attribute
+ * @buf: buffer where the output string will be written [out]
+ *
+ * Return:
+ * * %0 on success
+ * * %negative value on error
+ */
+static ssize_t lvb_fresh_hits_show(struct kobject *kobj,
+				   struct attribute *attr, char *buf)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct ofd_device *ofd = ofd_dev(obd->obd_lu_dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%lld\n",
+			 (s64)atomic64_read(&ofd->ofd_lvb_fresh_hits));
+}
+LUSTRE_RO_ATTR(lvb_fresh_hits);
+
 /**
  * last_id_seq_show() - Show the last used ID for each FID sequence used by OFD.
  * @m: seq_file handle
@@ -1224,6 +1301,8 @@ static struct attribute *ofd_attrs[] = {
 	&lustre_attr_ir_factor.attr,
 	&lustre_attr_job_cleanup_interval.attr,
 	&lustre_attr_lfsck_speed_limit.attr,
+	&lustre_attr_lvb_fresh_hits.attr,
+	&lustre_attr_lvb_fresh_ms.attr,
 	&lustre_attr_no_create.attr,
 #if LUSTRE_VERSION_CODE < OBD_OCD_VERSION(2, 20, 53, 0)
 	&lustre_attr_no_precreate.attr,
@@ -1308,6 +1387,7 @@ int ofd_tunables_init(struct ofd_device *ofd)
 				    ofd_stats_counter_init);
 	if (rc)
 		GOTO(obd_free_stats, rc);
+	obd2obt(obd)->obt_jobstats.ojs_show_fn = ldlm_reclaim_job_seq_show;
 
 	RETURN(0);
 
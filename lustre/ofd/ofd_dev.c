@@ -3173,6 +3173,8 @@ static int ofd_init0(const struct lu_env *env, struct ofd_device *m,
 	    OFD_PRECREATE_SMALL_FS)
 		m->ofd_precreate_batch = OFD_PRECREATE_BATCH_SMALL;
 	m->ofd_atime_diff = OFD_DEF_ATIME_DIFF;
+	m->ofd_lvb_fresh_ms = OFD_DEF_LVB_FRESH_MS;
+	atomic64_set(&m->ofd_lvb_fresh_hits, 0);
 
 	rc = ofd_fs_setup(env, m, obd);
 	if (rc)
@@ -186,6 +186,7 @@ int ofd_intent_policy(const struct lu_env *env, struct ldlm_namespace *ns,
 	int idx, rc;
 	struct ldlm_interval_tree *tree;
 	struct ofd_intent_args arg;
+	bool fresh = false;
 	__u32 repsize[3] = {
 		[MSG_PTLRPC_BODY_OFF] = sizeof(struct ptlrpc_body),
 		[DLM_LOCKREPLY_OFF]   = sizeof(*rep),
@@ -300,6 +301,8 @@ int ofd_intent_policy(const struct lu_env *env, struct ldlm_namespace *ns,
 			GOTO(out, rc = arg.error);
 		}
 	}
+	if (!list_empty(&arg.gl_list) && !arg.no_glimpse_ast)
+		fresh = ofd_lvb_is_fresh(ns->ns_lvbp, res, &arg.gl_list);
 	unlock_res(res);
 
 	/* There were no PW locks beyond the size in the LVB; finished. */
@@ -312,6 +315,10 @@ int ofd_intent_policy(const struct lu_env *env, struct ldlm_namespace *ns,
 		GOTO(out, ELDLM_LOCK_ABORTED);
 	}
 
+	/* The glimpsed client has just written, reply_lvb is recent enough */
+	if (fresh)
+		GOTO(out, rc);
+
 	/* this will update the LVB */
 	ldlm_glimpse_locks(res, &arg.gl_list);
 
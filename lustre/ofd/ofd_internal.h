@@ -41,6 +41,13 @@
  */
 #define OFD_DEF_ATIME_DIFF	0 /* disabled */
 
+/*
+ * answer glimpses from an LVB refreshed by the lock holder's writes within
+ * OFD_DEF_LVB_FRESH_MS, instead of sending glimpse ASTs
+ */
+#define OFD_DEF_LVB_FRESH_MS	0 /* disabled */
+#define OFD_MAX_LVB_FRESH_MS	60000
+
 /* Special mode value for OST objects with unset attributes */
 #define OFD_UNSET_ATTRS_MODE (S_IFREG | S_ISUID | S_ISGID | S_ISVTX | 0666)
 
@@ -160,6 +167,12 @@ struct ofd_device {
 	struct attribute	*ofd_read_cache_max_filesize;
 	struct attribute	*ofd_write_cache_enable;
 	time64_t		 ofd_atime_diff;
+	/* glimpses are answered from an LVB refreshed by a write of the
+	 * lock holder within that many milliseconds, 0 to always glimpse
+	 */
+	unsigned int		 ofd_lvb_fresh_ms;
+	/* glimpse ASTs avoided thanks to ofd_lvb_fresh_ms */
+	atomic64_t		 ofd_lvb_fresh_hits;
 	/* Object ID repair */
 	struct task_struct	*ofd_id_repair_task;
 	struct list_head	 ofd_id_repair_list;
@@ -189,6 +202,18 @@ static inline char *ofd_name(struct ofd_device *ofd)
 	return ofd->ofd_dt_dev.dd_lu_dev.ld_obd->obd_name;
 }
 
+/**
+ * OFD LVB stored in ldlm_resource::lr_lvb_data: the ost_lvb sent to clients,
+ * followed by server-only state, protected by the resource lock.
+ */
+struct ofd_lvb {
+	struct ost_lvb		olvb_lvb;
+	/* when a client write last refreshed olvb_lvb from disk */
+	ktime_t			olvb_write_time;
+	/* export handle cookie of the client which did that write */
+	__u64			olvb_write_cookie;
+};
+
 /**
  * for compatibility, filter_fid could occupy more space in newer version and
  * downgraded Lustre would fail reading it with -ERANGE, so it can read it
@@ -454,6 +479,9 @@ int ofd_fid_fini(const struct lu_env *env, struct ofd_device *ofd);
 
 /* ofd_lvb.c */
 extern struct ldlm_valblock_ops ofd_lvbo;
+void ofd_lvb_write_update(struct ldlm_resource *res, struct obd_export *exp);
+bool ofd_lvb_is_fresh(struct ofd_device *ofd, struct ldlm_resource *res,
+		      struct list_head *gl_list);
 
 /* ofd_dlm.c */
 extern struct kmem_cache *ldlm_glimpse_work_kmem;
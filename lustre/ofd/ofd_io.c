@@ -1579,13 +1579,20 @@ int ofd_commitrw(const struct lu_env *env, int cmd, struct obd_export *exp,
 		 * local lock on a server namespace and this was the last
 		 * reference, lock will be destroyed directly thus there
 		 * is no chance for ldlm_request_cancel() to update lvb.
+		 *
+		 * Also refresh it after client writes when glimpses may be
+		 * answered from the LVB, see ofd_lvb_is_fresh().
 		 */
-		if (rc == 0 && (rnb[0].rnb_flags & OBD_BRW_SRVLOCK)) {
+		if (rc == 0 && ((rnb[0].rnb_flags & OBD_BRW_SRVLOCK) ||
+				READ_ONCE(ofd->ofd_lvb_fresh_ms))) {
 			ost_fid_build_resid(fid, &info->fti_resid);
 			rs = ldlm_resource_get(ns, &info->fti_resid,
 					       LDLM_EXTENT, 0);
 			if (!IS_ERR(rs)) {
-				ldlm_res_lvbo_update(rs, NULL, 1);
+				if (rnb[0].rnb_flags & OBD_BRW_SRVLOCK)
+					ldlm_res_lvbo_update(rs, NULL, 1);
+				else
+					ofd_lvb_write_update(rs, exp);
 				ldlm_resource_putref(rs);
 			}
 		}
@@ -76,6 +76,7 @@ static bool ofd_resync_allowed(struct ofd_device *ofd)
  */
 static int ofd_lvbo_init(struct ldlm_resource *res)
 {
+	struct ofd_lvb		*olvb;
 	struct ost_lvb		*lvb;
 	struct ofd_device	*ofd;
 	struct ofd_object	*fo;
@@ -99,14 +100,15 @@ static int ofd_lvbo_init(struct ldlm_resource *res)
 	env = lu_env_find();
 	LASSERT(env);
 
-	OBD_ALLOC_PTR(lvb);
-	if (lvb == NULL)
+	OBD_ALLOC_PTR(olvb);
+	if (olvb == NULL)
 		GOTO(out, rc = -ENOMEM);
 
 	info = ofd_info(env);
-	res->lr_lvb_data = lvb;
-	BUILD_BUG_ON(sizeof(*lvb) >= 1 << (sizeof(res->lr_lvb_len) * 8 - 1));
-	res->lr_lvb_len = sizeof(*lvb);
+	lvb = &olvb->olvb_lvb;
+	res->lr_lvb_data = olvb;
+	BUILD_BUG_ON(sizeof(*olvb) >= 1 << (sizeof(res->lr_lvb_len) * 8 - 1));
+	res->lr_lvb_len = sizeof(*olvb);
 
 	ost_fid_from_resid(&info->fti_fid, &res->lr_name,
 			   ofd->ofd_lut.lut_lsd.lsd_osd_index);
@@ -339,6 +341,76 @@ out:
 	return rc;
 }
 
+/**
+ * ofd_lvb_write_update() - Refresh the LVB after a client write.
+ * @res: LDLM resource of the written object
+ * @exp: export of the client which did the write
+ *
+ * The BRW carries the extent and mtime written by the client, which are on
+ * disk now. Copy them into the LVB and remember which client wrote and when,
+ * so that a glimpse which would only go to that client can be answered from
+ * the LVB, see ofd_lvb_is_fresh().
+ */
+void ofd_lvb_write_update(struct ldlm_resource *res, struct obd_export *exp)
+{
+	struct ofd_lvb *olvb;
+
+	if (ldlm_res_lvbo_update(res, NULL, 1))
+		return;
+
+	lock_res(res);
+	olvb = res->lr_lvb_data;
+	if (olvb != NULL) {
+		olvb->olvb_write_time = ktime_get();
+		olvb->olvb_write_cookie = exp->exp_handle.h_cookie;
+	}
+	unlock_res(res);
+}
+
+/**
+ * ofd_lvb_is_fresh() - Check if a glimpse can be answered from the LVB.
+ * @ofd: OFD device
+ * @res: LDLM resource, locked by the caller
+ * @gl_list: glimpse work list of the locks which would be glimpsed
+ *
+ * A file written by many clients and watched by others (tail -f, ls -l
+ * loops) gets a glimpse AST for every stat(). If all the locks to glimpse
+ * belong to the client which refreshed the LVB by a write within
+ * ofd_lvb_fresh_ms, the LVB is returned instead. The size and mtime may
+ * then miss the data cached by that client for up to ofd_lvb_fresh_ms.
+ *
+ * Return: true if the glimpse ASTs can be skipped
+ */
+bool ofd_lvb_is_fresh(struct ofd_device *ofd, struct ldlm_resource *res,
+		      struct list_head *gl_list)
+{
+	unsigned int fresh_ms = READ_ONCE(ofd->ofd_lvb_fresh_ms);
+	struct ofd_lvb *olvb = res->lr_lvb_data;
+	struct ldlm_glimpse_work *gl_work;
+
+	check_res_locked(res);
+
+	if (fresh_ms == 0 || olvb == NULL || olvb->olvb_write_cookie == 0)
+		return false;
+
+	if (ktime_ms_delta(ktime_get(), olvb->olvb_write_time) > fresh_ms)
+		return false;
+
+	list_for_each_entry(gl_work, gl_list, gl_list) {
+		struct obd_export *exp = gl_work->gl_lock->l_export;
+
+		if (exp == NULL ||
+		    exp->exp_handle.h_cookie != olvb->olvb_write_cookie)
+			return false;
+	}
+
+	atomic64_inc(&ofd->ofd_lvb_fresh_hits);
+	LDLM_DEBUG_NOLOCK("res: "DLDLMRES" glimpse answered from LVB",
+			  PLDLMRES(res));
+
+	return true;
+}
+
 /**
  * ofd_lvbo_size() - Implementation of ldlm_valblock_ops::lvbo_size for OFD.
  * @lock: LDLM lock
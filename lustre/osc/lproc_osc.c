@@ -472,6 +472,39 @@ static ssize_t resend_count_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(resend_count);
 
+static ssize_t read_hedge_percentile_show(struct kobject *kobj,
+					  struct attribute *attr,
+					  char *buf)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+
+	return sprintf(buf, "%u\n", obd->u.cli.cl_read_hedge_pct);
+}
+
+static ssize_t read_hedge_percentile_store(struct kobject *kobj,
+					   struct attribute *attr,
+					   const char *buffer,
+					   size_t count)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 10, &val);
+	if (rc)
+		return rc;
+
+	if (val > 100)
+		return -ERANGE;
+
+	WRITE_ONCE(obd->u.cli.cl_read_hedge_pct, val);
+
+	return count;
+}
+LUSTRE_RW_ATTR(read_hedge_percentile);
+
 static ssize_t checksum_dump_show(struct kobject *kobj,
 				  struct attribute *attr,
 				  char *buf)
@@ -857,6 +890,8 @@ static int osc_stats_seq_show(struct seq_file *seq, void *v)
 		   stats->os_lockless_writes);
 	seq_printf(seq, "lockless_read_bytes\t\t%llu\n",
 		   stats->os_lockless_reads);
+	seq_printf(seq, "hedged_reads\t\t\t%llu\n",
+		   stats->os_hedged_reads);
 	return 0;
 }
 
@@ -924,6 +959,7 @@ static struct attribute *osc_attrs[] = {
 	&lustre_attr_osc_unevict_cached_mb.attr,
 	&lustre_attr_short_io_bytes.attr,
 	&lustre_attr_resend_count.attr,
+	&lustre_attr_read_hedge_percentile.attr,
 	&lustre_attr_ost_conn_uuid.attr,
 	&lustre_attr_conn_uuid.attr,
 	&lustre_attr_pinger_recov.attr,
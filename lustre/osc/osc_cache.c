@@ -1976,7 +1976,8 @@ can_merge(const struct osc_extent *ext, const struct osc_extent *in_rpc)
 	if (ext->oe_srvlock != in_rpc->oe_srvlock)
 		return false;
 
-	if (ext->oe_ndelay != in_rpc->oe_ndelay)
+	if (ext->oe_ndelay != in_rpc->oe_ndelay ||
+	    ext->oe_hedge != in_rpc->oe_hedge)
 		return false;
 
 	if (!ext->oe_grants != !in_rpc->oe_grants)
@@ -2763,6 +2764,7 @@ int osc_queue_dio_pages(const struct lu_env *env, struct cl_io *io,
 	ext->oe_obj = obj;
 	ext->oe_srvlock = !!(brw_flags & OBD_BRW_SRVLOCK);
 	ext->oe_ndelay = !!(brw_flags & OBD_BRW_NDELAY);
+	ext->oe_hedge = ext->oe_ndelay && !io->ci_tried_all_mirrors;
 	ext->oe_dio = true;
 	if (ext->oe_dio) {
 		struct cl_sync_io *anchor;
@@ -2896,6 +2898,7 @@ int osc_queue_sync_pages(const struct lu_env *env, struct cl_io *io,
 	ext->oe_obj = obj;
 	ext->oe_srvlock = !!(brw_flags & OBD_BRW_SRVLOCK);
 	ext->oe_ndelay = !!(brw_flags & OBD_BRW_NDELAY);
+	ext->oe_hedge = ext->oe_ndelay && !io->ci_tried_all_mirrors;
 	ext->oe_dio = !!(brw_flags & OBD_BRW_NOCACHE);
 	if (ext->oe_dio) {
 		struct cl_sync_io *anchor;
@@ -1293,6 +1293,14 @@ int osc_lock_init(const struct lu_env *env,
 	if (io->ci_ndelay && cl_object_same(io->ci_obj, obj))
 		oscl->ols_flags |= LDLM_FL_NDELAY;
 	osc_lock_build_einfo(env, lock, cl2osc(obj), &oscl->ols_einfo);
+	if (lock->cll_descr.cld_stride.cls_length != 0 && !oscl->ols_glimpse) {
+		const struct cl_lock_stride *cls = &lock->cll_descr.cld_stride;
+
+		oscl->ols_stride.les_offset = cls->cls_offset;
+		oscl->ols_stride.les_length = cls->cls_length;
+		oscl->ols_stride.les_bytes = cls->cls_bytes;
+		oscl->ols_einfo.ei_stride = &oscl->ols_stride;
+	}
 
 	cl_lock_slice_add(lock, &oscl->ols_cl, obj, &osc_lock_ops);
 
@@ -2562,6 +2562,81 @@ static void osc_process_ar(struct osc_async_rc *ar, __u64 xid,
 		ar->ar_force_sync = 0;
 }
 
+/**
+ * osc_read_stats_update() - Account a completed read RPC
+ * @cli: client obd the read was sent to
+ * @latency_us: RPC latency in "binary usec"
+ * @bytes: bytes read by the RPC
+ *
+ * Update the recent latency and throughput of reads from this OST and
+ * the read cost that LOV compares across mirrors. The cost is the time
+ * to read 1MiB at the recent throughput, or the median latency if that
+ * is longer. Called with cl_loi_list_lock held; the sample count is
+ * atomic as osc_brw_hedge() and lprocfs read it without the lock.
+ */
+static void osc_read_stats_update(struct client_obd *cli,
+				  unsigned int latency_us,
+				  unsigned long bytes)
+{
+	u64 bw = div_u64((u64)bytes * USEC_PER_SEC, latency_us);
+	u64 cost;
+	u32 samples;
+
+	lprocfs_oh_tally_log2(&cli->cl_read_lat_recent, latency_us);
+	samples = atomic_inc_return(&cli->cl_read_lat_samples);
+	if (samples % OSC_READ_LAT_DECAY == 0)
+		lprocfs_oh_halve(&cli->cl_read_lat_recent);
+
+	if (cli->cl_read_bw == 0)
+		cli->cl_read_bw = bw;
+	else
+		cli->cl_read_bw += (bw >> 3) - (cli->cl_read_bw >> 3);
+
+	if (samples < OSC_READ_LAT_MIN)
+		return;
+
+	cost = div64_u64((u64)SZ_1M * USEC_PER_SEC, cli->cl_read_bw ?: 1);
+	cost = max_t(u64, cost,
+		     lprocfs_oh_pct_log2(&cli->cl_read_lat_recent, 50));
+	WRITE_ONCE(cli->cl_read_cost_us, min_t(u64, cost, UINT_MAX));
+}
+
+/**
+ * osc_brw_hedge() - Bound the wait for a read another mirror can serve
+ * @cli: client obd the read is sent to
+ * @req: non-delay read BRW request
+ *
+ * Once enough reads have completed to know this OST's recent latency,
+ * shorten the local timeout of @req to twice the cl_read_hedge_pct
+ * percentile of it. A read stuck on a slow but healthy OST then expires
+ * with -ETIMEDOUT, which brw_interpret() returns as -EAGAIN so that LOV
+ * retries it on the next mirror, instead of being kept alive by early
+ * replies for the whole adaptive timeout.
+ */
+static void osc_brw_hedge(struct client_obd *cli, struct ptlrpc_request *req)
+{
+	unsigned int pct = READ_ONCE(cli->cl_read_hedge_pct);
+	unsigned int latency_us;
+	timeout_t timeout;
+
+	if (pct == 0 ||
+	    atomic_read(&cli->cl_read_lat_samples) < OSC_READ_LAT_MIN)
+		return;
+
+	latency_us = lprocfs_oh_pct_log2(&cli->cl_read_lat_recent, pct);
+	if (latency_us == 0)
+		return;
+
+	timeout = DIV_ROUND_UP((u64)latency_us * 2, USEC_PER_SEC);
+	if (timeout >= req->rq_timeout)
+		return;
+
+	DEBUG_REQ(D_INODE, req, "hedged read, timeout %ds (p%u %uus)",
+		  timeout, pct, latency_us);
+	req->rq_timeout = timeout;
+	req->rq_hedged = 1;
+}
+
 static int brw_interpret(const struct lu_env *env,
 			 struct ptlrpc_request *req, void *args, int rc)
 {
@@ -2716,6 +2791,11 @@ static int brw_interpret(const struct lu_env *env,
 		cli->cl_r_in_flight--;
 	if (srvlock)
 		cli->cl_d_in_flight--;
+	if (req->rq_hedged && req->rq_timedout) {
+		struct osc_device *od = obd2osc_dev(req->rq_import->imp_obd);
+
+		od->osc_stats.os_hedged_reads++;
+	}
 	/* Calculate RPC latency in microseconds and update histogram */
 	if (ktime_to_ns(start_time)) {
 		/* binary convertion, must convert to decimal for display */
@@ -2738,6 +2818,10 @@ static int brw_interpret(const struct lu_env *env,
 		} else {
 			lprocfs_oh_tally_log2(&cli->cl_read_io_latency_hist,
 					      latency_us);
+			/* failed and abandoned reads would skew the hedge */
+			if (rc == 0)
+				osc_read_stats_update(cli, latency_us,
+						      transferred);
 
 			/* Update latency by size histogram */
 			if (cli->cl_read_io_latency_by_size && page_count) {
@@ -2808,6 +2892,7 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	int page_count = 0;
 	bool soft_sync = false;
 	bool ndelay = false;
+	bool hedge = false;
 	bool srvlock = false;
 	int grant = 0;
 	int i, rc;
@@ -2884,6 +2969,8 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 		}
 		if (ext->oe_ndelay)
 			ndelay = true;
+		if (ext->oe_hedge)
+			hedge = true;
 		if (ext->oe_srvlock)
 			srvlock = true;
 	}
@@ -2923,10 +3010,8 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	req->rq_memalloc = mem_tight != 0;
 	if (ndelay) {
 		req->rq_no_resend = req->rq_no_delay = 1;
-		/* probably set a shorter timeout value.
-		 * to handle ETIMEDOUT in brw_interpret() correctly.
-		 * lustre_msg_set_timeout(req, req->rq_timeout / 2);
-		 */
+		if (hedge && cmd == OBD_BRW_READ)
+			osc_brw_hedge(cli, req);
 	}
 
 	/* Need to update the timestamps after the request is built in case
@@ -3267,7 +3352,7 @@ int osc_enqueue_base(struct obd_export *exp, struct ldlm_res_id *res_id,
 	/* users of osc_enqueue() can pass this flag for ldlm_lock_match() */
 	*flags &= ~LDLM_FL_BLOCK_GRANTED;
 
-	req = ldlm_enqueue_pack(exp, sizeof(*lvb));
+	req = ldlm_enqueue_stride_pack(exp, sizeof(*lvb), einfo->ei_stride);
 	if (IS_ERR(req))
 		RETURN(PTR_ERR(req));
 
@@ -3859,11 +3944,9 @@ int osc_disconnect(struct obd_export *exp)
 }
 EXPORT_SYMBOL(osc_disconnect);
 
-int osc_ldlm_resource_invalidate(struct cfs_hash *hs, struct cfs_hash_bd *bd,
-				 struct hlist_node *hnode, void *arg)
+int osc_ldlm_resource_invalidate(struct ldlm_resource *res, void *arg)
 {
 	struct lu_env *env = arg;
-	struct ldlm_resource *res = cfs_hash_object(hs, hnode);
 	struct ldlm_lock *lock;
 	struct osc_object *osc = NULL;
 
@@ -3928,9 +4011,9 @@ static int osc_import_event(struct obd_device *obd, struct obd_import *imp,
 		if (!IS_ERR(env)) {
 			osc_io_unplug(env, &obd->u.cli, NULL);
 
-			cfs_hash_for_each_nolock(ns->ns_rs_hash,
-						 osc_ldlm_resource_invalidate,
-						 env, 0);
+			ldlm_namespace_res_walk(ns,
+						osc_ldlm_resource_invalidate,
+						env);
 			cl_env_put(env, &refcheck);
 
 			ldlm_namespace_cleanup(ns, LDLM_FL_LOCAL_ONLY);
@@ -558,6 +558,9 @@ __must_hold(&req->rq_lock)
 	 */
 	req->rq_deadline = req->rq_sent + req->rq_timeout +
 			   ptlrpc_at_get_net_latency(req);
+	/* a hedged request would rather be retried elsewhere than wait */
+	if (req->rq_hedged && req->rq_deadline > olddl)
+		req->rq_deadline = olddl;
 
 	/* The below message is checked in replay-single.sh test_65{a,b} */
 	/* The below message is checked in sanity-{gss,krb5} test_8 */
@@ -2463,6 +2466,22 @@ int ptlrpc_expire_one_request(struct ptlrpc_request *req, int async_unlink)
 	req->rq_timedout = 1;
 	spin_unlock(&req->rq_lock);
 
+	/*
+	 * A hedged request was abandoned because it is slower than its
+	 * peers, not because the server is gone; the caller retries it on
+	 * another replica, so neither report a timeout nor touch the import.
+	 */
+	if (req->rq_hedged && imp) {
+		DEBUG_REQ(D_RPCTRACE, req, "hedged request abandoned");
+		ptlrpc_unregister_reply(req, async_unlink);
+		ptlrpc_unregister_bulk(req, async_unlink);
+		spin_lock(&req->rq_lock);
+		req->rq_status = -ETIMEDOUT;
+		req->rq_err = 1;
+		spin_unlock(&req->rq_lock);
+		RETURN(1);
+	}
+
 	opc = lustre_msg_get_opc(req->rq_reqmsg);
 	if (ptlrpc_console_allow(req, opc,
 				 lustre_msg_get_status(req->rq_reqmsg)))
@@ -410,6 +410,12 @@ static const struct req_msg_field *ldlm_enqueue_client[] = {
 	&RMF_DLM_REQ
 };
 
+static const struct req_msg_field *ldlm_enqueue_stride_client[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_DLM_REQ,
+	&RMF_DLM_STRIDE
+};
+
 static const struct req_msg_field *ldlm_enqueue_server[] = {
 	&RMF_PTLRPC_BODY,
 	&RMF_DLM_REP
@@ -438,6 +444,11 @@ static const struct req_msg_field *ldlm_gl_callback_server[] = {
 	&RMF_DLM_LVB
 };
 
+static const struct req_msg_field *ldlm_bl_callback_batch_server[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_RCS
+};
+
 static const struct req_msg_field *ldlm_intent_basic_client[] = {
 	&RMF_PTLRPC_BODY,
 	&RMF_DLM_REQ,
@@ -501,6 +512,21 @@ static const struct req_msg_field *ldlm_intent_getattr_server[] = {
 	&RMF_FILE_SECCTX,
 	&RMF_DEFAULT_MDT_MD,
 	&RMF_FILE_ENCCTX,
+	&RMF_EADATA,	   /* OBD_CONNECT2_XATTR_PREFETCH */
+	&RMF_EAVALS,
+	&RMF_EAVALS_LENS,
+};
+
+static const struct req_msg_field *ldlm_intent_create_server[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_DLM_REP,
+	&RMF_MDT_BODY,
+	&RMF_MDT_MD,
+	&RMF_ACL,
+	&RMF_CAPA1,
+	&RMF_FILE_SECCTX,
+	&RMF_DEFAULT_MDT_MD,
+	&RMF_FILE_ENCCTX,
 };
 
 static const struct req_msg_field *ldlm_intent_create_client[] = {
@@ -878,11 +904,13 @@ static struct req_format *req_formats[] = {
 	&RQF_OST_SEEK,
 	&RQF_LDLM_ENQUEUE,
 	&RQF_LDLM_ENQUEUE_LVB,
+	&RQF_LDLM_ENQUEUE_STRIDE,
 	&RQF_LDLM_CONVERT,
 	&RQF_LDLM_CANCEL,
 	&RQF_LDLM_CALLBACK,
 	&RQF_LDLM_CP_CALLBACK,
 	&RQF_LDLM_BL_CALLBACK,
+	&RQF_LDLM_BL_CALLBACK_BATCH,
 	&RQF_LDLM_GL_CALLBACK,
 	&RQF_LDLM_GL_CALLBACK_DESC,
 	&RQF_LDLM_INTENT,
@@ -1177,6 +1205,10 @@ struct req_msg_field RMF_DLM_LVB =
 	DEFINE_MSGF("dlm_lvb", 0, -1, NULL, NULL);
 EXPORT_SYMBOL(RMF_DLM_LVB);
 
+struct req_msg_field RMF_DLM_STRIDE =
+	DEFINE_MSGF("dlm_stride", 0, -1, lustre_swab_ldlm_extent_stride, NULL);
+EXPORT_SYMBOL(RMF_DLM_STRIDE);
+
 struct req_msg_field RMF_DLM_GL_DESC =
 	DEFINE_MSGF("dlm_gl_desc", 0, sizeof(union ldlm_gl_desc), NULL, NULL);
 EXPORT_SYMBOL(RMF_DLM_GL_DESC);
@@ -1624,6 +1656,11 @@ struct req_format RQF_LDLM_ENQUEUE_LVB =
 			ldlm_enqueue_client, ldlm_enqueue_lvb_server);
 EXPORT_SYMBOL(RQF_LDLM_ENQUEUE_LVB);
 
+struct req_format RQF_LDLM_ENQUEUE_STRIDE =
+	DEFINE_REQ_FMT0("LDLM_ENQUEUE_STRIDE",
+			ldlm_enqueue_stride_client, ldlm_enqueue_lvb_server);
+EXPORT_SYMBOL(RQF_LDLM_ENQUEUE_STRIDE);
+
 struct req_format RQF_LDLM_CONVERT =
 	DEFINE_REQ_FMT0("LDLM_CONVERT",
 			ldlm_enqueue_client, ldlm_enqueue_server);
@@ -1645,6 +1682,11 @@ struct req_format RQF_LDLM_BL_CALLBACK =
 	DEFINE_REQ_FMT0("LDLM_BL_CALLBACK", ldlm_enqueue_client, empty);
 EXPORT_SYMBOL(RQF_LDLM_BL_CALLBACK);
 
+struct req_format RQF_LDLM_BL_CALLBACK_BATCH =
+	DEFINE_REQ_FMT0("LDLM_BL_CALLBACK_BATCH", ldlm_enqueue_client,
+			ldlm_bl_callback_batch_server);
+EXPORT_SYMBOL(RQF_LDLM_BL_CALLBACK_BATCH);
+
 struct req_format RQF_LDLM_GL_CALLBACK =
 	DEFINE_REQ_FMT0("LDLM_GL_CALLBACK", ldlm_enqueue_client,
 			ldlm_gl_callback_server);
@@ -1682,7 +1724,7 @@ EXPORT_SYMBOL(RQF_LDLM_INTENT_OPEN);
 
 struct req_format RQF_LDLM_INTENT_CREATE =
 	DEFINE_REQ_FMT0("LDLM_INTENT_CREATE",
-			ldlm_intent_create_client, ldlm_intent_getattr_server);
+			ldlm_intent_create_client, ldlm_intent_create_server);
 EXPORT_SYMBOL(RQF_LDLM_INTENT_CREATE);
 
 struct req_format RQF_LDLM_INTENT_GETXATTR =
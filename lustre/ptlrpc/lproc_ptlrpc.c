@@ -228,6 +228,16 @@ ptlrpc_ldebugfs_register(struct dentry *root, char *dir, char *name,
 			     config | LPROCFS_TYPE_SECS, "req_timeout");
 	lprocfs_counter_init_units(svc_stats, PTLRPC_REQBUF_AVAIL_CNTR,
 			     config, "reqbuf_avail", "bufs");
+	lprocfs_counter_init_units(svc_stats, PTLRPC_REQBUF_LOW_CNTR,
+				   0, "reqbuf_low", "events");
+	lprocfs_counter_init_units(svc_stats, PTLRPC_REQBUF_EMPTY_CNTR,
+				   0, "reqbuf_empty", "events");
+	lprocfs_counter_init_units(svc_stats, PTLRPC_REQBUF_REUSE_CNTR,
+				   0, "reqbuf_reuse", "bufs");
+	lprocfs_counter_init_units(svc_stats, PTLRPC_REQBUF_TRIM_CNTR,
+				   0, "reqbuf_trim", "bufs");
+	lprocfs_counter_init_units(svc_stats, PTLRPC_REPSTATE_MISS_CNTR,
+				   0, "repstate_cache_miss", "reqs");
 	for (i = 0; i < EXTRA_LAST_OPC; i++) {
 		enum lprocfs_counter_config extra_type = LPROCFS_TYPE_REQS;
 
@@ -1763,6 +1763,10 @@ int ptlrpc_nrs_init(void)
 	rc = ptlrpc_nrs_policy_register(&nrs_conf_tbf);
 	if (rc != 0)
 		GOTO(fail, rc);
+
+	rc = ptlrpc_nrs_policy_register(&nrs_conf_wfq);
+	if (rc != 0)
+		GOTO(fail, rc);
 #endif /* CONFIG_LUSTRE_FS_SERVER */
 
 	rc = ptlrpc_nrs_policy_register(&nrs_conf_delay);
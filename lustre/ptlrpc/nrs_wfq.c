@@ -0,0 +1,867 @@
+// SPDX-License-Identifier: GPL-2.0
+
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ *
+ * Network Request Scheduler (NRS) WFQ policy
+ *
+ * Byte-weighted fair queueing of ost_io requests over client NIDs or JobIDs
+ */
+
+#define DEBUG_SUBSYSTEM S_RPC
+#include <obd_support.h>
+#include <obd_class.h>
+#include <lustre_net.h>
+#include <lprocfs_status.h>
+#include "ptlrpc_internal.h"
+
+/*
+ * WFQ policy
+ *
+ * CRR-N and ORR share service between clients by counting RPCs, so a client
+ * sending 16MiB BRWs gets thousands of times the bandwidth of one sending 4KiB
+ * BRWs at the same rate. WFQ instead charges each flow (a client NID, or a
+ * JobID) for the bytes each of its RPCs moves, as given by the niobuf_remote
+ * lengths of OST_READ and OST_WRITE, plus a fixed per-RPC cost so that small
+ * and non-bulk RPCs are not free.
+ *
+ * This is Self-Clocked Fair Queueing: every request is tagged with a virtual
+ * start time, which is the later of the flow's previous finish tag and the
+ * current system virtual time, and a finish tag, which is the start tag plus
+ * the request's cost. Requests are served in finish tag order from a binary
+ * heap, and the system virtual time advances to the finish tag of each request
+ * that is dispatched. A flow that has been idle re-enters at the current
+ * virtual time, so it can not hoard credit for service it did not use.
+ */
+
+#define NRS_POL_NAME_WFQ	"wfq"
+
+static int wfq_flow_cache_size = 8192;
+module_param(wfq_flow_cache_size, int, 0644);
+MODULE_PARM_DESC(wfq_flow_cache_size, "The number of idle WFQ flows to keep");
+
+#define NRS_WFQ_FLOW_TYPE_NID	"nid"
+#define NRS_WFQ_FLOW_TYPE_JOBID	"jobid"
+
+/**
+ * Default per-RPC cost, in bytes; roughly the cost of a small RPC expressed
+ * as bulk bytes.
+ */
+#define NRS_WFQ_RPC_COST_DFLT	(64 * 1024)
+/**
+ * Upper bound of the per-RPC cost, in bytes.
+ */
+#define NRS_WFQ_RPC_COST_MAX	(64 * 1024 * 1024)
+
+#define NRS_LPROCFS_RPC_COST_NAME_REG	"reg_rpc_cost:"
+#define NRS_LPROCFS_RPC_COST_NAME_HP	"hp_rpc_cost:"
+
+#define LPROCFS_NRS_WR_RPC_COST_MAX_CMD					       \
+ sizeof(NRS_LPROCFS_RPC_COST_NAME_REG __stringify(NRS_WFQ_RPC_COST_MAX) " "    \
+	NRS_LPROCFS_RPC_COST_NAME_HP __stringify(NRS_WFQ_RPC_COST_MAX))
+
+/**
+ * wfq_req_compare() - Binary heap predicate.
+ * @e1: the first binheap node to compare
+ * @e2: the second binheap node to compare
+ *
+ * Uses ptlrpc_nrs_request::nr_u::wfq::wr_finish and
+ * ptlrpc_nrs_request::nr_u::wfq::wr_sequence to compare two binheap nodes, so
+ * that the request with the smallest virtual finish tag is served first.
+ *
+ * Return:
+ * * %0 if e1 > e2
+ * * %1 if e1 <= e2
+ */
+static int
+wfq_req_compare(struct binheap_node *e1, struct binheap_node *e2)
+{
+	struct ptlrpc_nrs_request *nrq1;
+	struct ptlrpc_nrs_request *nrq2;
+
+	nrq1 = container_of(e1, struct ptlrpc_nrs_request, nr_node);
+	nrq2 = container_of(e2, struct ptlrpc_nrs_request, nr_node);
+
+	if (nrq1->nr_u.wfq.wr_finish < nrq2->nr_u.wfq.wr_finish)
+		return 1;
+	else if (nrq1->nr_u.wfq.wr_finish > nrq2->nr_u.wfq.wr_finish)
+		return 0;
+
+	return nrq1->nr_u.wfq.wr_sequence < nrq2->nr_u.wfq.wr_sequence;
+}
+
+static struct binheap_ops nrs_wfq_heap_ops = {
+	.hop_enter	= NULL,
+	.hop_exit	= NULL,
+	.hop_compare	= wfq_req_compare,
+};
+
+static const struct rhashtable_params nrs_wfq_hash_params = {
+	.key_len	= sizeof(struct nrs_wfq_key),
+	.key_offset	= offsetof(struct nrs_wfq_flow, wf_key),
+	.head_offset	= offsetof(struct nrs_wfq_flow, wf_rhead),
+};
+
+static void nrs_wfq_exit(void *vflow, void *data)
+{
+	struct nrs_wfq_flow *flow = vflow;
+
+	LASSERTF(atomic_read(&flow->wf_ref) == 0,
+		 "Busy WFQ flow %s/%.*s, with %d refs\n",
+		 libcfs_nidstr(&flow->wf_key.wk_nid), LUSTRE_JOBID_SIZE,
+		 flow->wf_key.wk_jobid, atomic_read(&flow->wf_ref));
+
+	OBD_FREE_PTR(flow);
+}
+
+/**
+ * nrs_wfq_start() - Called when a WFQ policy instance is started.
+ * @policy: the policy
+ * @arg: flow type, either "nid" (the default) or "jobid"
+ *
+ * Return:
+ * * %-ENOMEM OOM error
+ * * %-EINVAL unknown flow type
+ * * %0 success
+ */
+static int nrs_wfq_start(struct ptlrpc_nrs_policy *policy, char *arg)
+{
+	struct nrs_wfq_net *net;
+	enum nrs_wfq_flow_type type;
+	int rc = 0;
+
+	ENTRY;
+
+	if (arg == NULL || strcmp(arg, NRS_WFQ_FLOW_TYPE_NID) == 0)
+		type = NRS_WFQ_FLOW_NID;
+	else if (strcmp(arg, NRS_WFQ_FLOW_TYPE_JOBID) == 0)
+		type = NRS_WFQ_FLOW_JOBID;
+	else
+		RETURN(-EINVAL);
+
+	OBD_CPT_ALLOC_PTR(net, nrs_pol2cptab(policy), nrs_pol2cptid(policy));
+	if (net == NULL)
+		RETURN(-ENOMEM);
+
+	net->wn_binheap = binheap_create(&nrs_wfq_heap_ops,
+					 CBH_FLAG_ATOMIC_GROW, 4096, NULL,
+					 nrs_pol2cptab(policy),
+					 nrs_pol2cptid(policy));
+	if (net->wn_binheap == NULL)
+		GOTO(out_net, rc = -ENOMEM);
+
+	rc = rhashtable_init(&net->wn_flow_hash, &nrs_wfq_hash_params);
+	if (rc)
+		GOTO(out_binheap, rc);
+
+	net->wn_rpc_cost = NRS_WFQ_RPC_COST_DFLT;
+	net->wn_flow_type = type;
+	INIT_LIST_HEAD(&net->wn_lru_list);
+	spin_lock_init(&net->wn_lru_lock);
+
+	policy->pol_private = net;
+
+	RETURN(rc);
+
+out_binheap:
+	binheap_destroy(net->wn_binheap);
+out_net:
+	OBD_FREE_PTR(net);
+
+	RETURN(rc);
+}
+
+/**
+ * nrs_wfq_stop() - Called when a WFQ policy instance is stopped.
+ * @policy: the policy
+ *
+ * Called when the policy has been instructed to transition to the
+ * ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPED state and has no more pending
+ * requests to serve.
+ */
+static void nrs_wfq_stop(struct ptlrpc_nrs_policy *policy)
+{
+	struct nrs_wfq_net *net = policy->pol_private;
+
+	ENTRY;
+
+	LASSERT(net != NULL);
+	LASSERT(net->wn_binheap != NULL);
+	LASSERT(binheap_is_empty(net->wn_binheap));
+
+	rhashtable_free_and_destroy(&net->wn_flow_hash, nrs_wfq_exit, NULL);
+	binheap_destroy(net->wn_binheap);
+
+	OBD_FREE_PTR(net);
+
+	EXIT;
+}
+
+/**
+ * nrs_wfq_ctl() - Performs a policy-specific ctl function on WFQ policy
+ * instances; similar to ioctl.
+ * @policy: the policy instance
+ * @opc: the opcode
+ * @arg: used for passing parameters and information
+ *
+ * \pre assert_spin_locked(&policy->pol_nrs->->nrs_lock)
+ * \post assert_spin_locked(&policy->pol_nrs->->nrs_lock)
+ *
+ * Return:
+ * * %0 operation carried out successfully
+ * * %negative on error
+ */
+static int nrs_wfq_ctl(struct ptlrpc_nrs_policy *policy,
+		       enum ptlrpc_nrs_ctl opc, void *arg)
+{
+	struct nrs_wfq_net *net = policy->pol_private;
+
+	assert_spin_locked(&policy->pol_nrs->nrs_lock);
+
+	switch (opc) {
+	default:
+		RETURN(-EINVAL);
+
+	/* Read the per-RPC cost of a policy instance. */
+	case NRS_CTL_WFQ_RD_RPC_COST:
+		*(__u32 *)arg = net->wn_rpc_cost;
+		break;
+
+	/* Write the per-RPC cost of a policy instance. */
+	case NRS_CTL_WFQ_WR_RPC_COST:
+		net->wn_rpc_cost = *(__u32 *)arg;
+		break;
+	}
+
+	RETURN(0);
+}
+
+/**
+ * nrs_wfq_key_fill() - Fills in the flow key of request @req
+ * @net: the WFQ policy instance
+ * @req: the request
+ * @key: the key is returned here [out]
+ */
+static void nrs_wfq_key_fill(struct nrs_wfq_net *net,
+			     struct ptlrpc_request *req,
+			     struct nrs_wfq_key *key)
+{
+	memset(key, 0, sizeof(*key));
+
+	if (net->wn_flow_type == NRS_WFQ_FLOW_JOBID) {
+		char *jobid = lustre_msg_get_jobid(req->rq_reqmsg);
+
+		/* RPCs without a JobID share a single, empty-named flow */
+		if (jobid != NULL)
+			strscpy(key->wk_jobid, jobid, sizeof(key->wk_jobid));
+	} else {
+		key->wk_nid = req->rq_peer.nid;
+	}
+}
+
+/**
+ * nrs_wfq_flow_tryget() - Takes a reference on a flow found in the hash
+ * @net: the WFQ policy instance
+ * @flow: the flow
+ *
+ * A flow with no references sits in the idle LRU and may be freed by
+ * nrs_wfq_lru_shrink() at any time; the 0 -> 1 transition is done under
+ * nrs_wfq_net::wn_lru_lock so that the two can not race.
+ *
+ * Return true if a reference was taken, false if @flow is being freed
+ */
+static bool nrs_wfq_flow_tryget(struct nrs_wfq_net *net,
+				struct nrs_wfq_flow *flow)
+{
+	bool found = true;
+
+	if (atomic_inc_not_zero(&flow->wf_ref))
+		return true;
+
+	spin_lock(&net->wn_lru_lock);
+	if (flow->wf_dead) {
+		found = false;
+	} else if (atomic_inc_return(&flow->wf_ref) == 1) {
+		list_del_init(&flow->wf_lru);
+		net->wn_lru_cnt--;
+	}
+	spin_unlock(&net->wn_lru_lock);
+
+	return found;
+}
+
+/**
+ * nrs_wfq_lru_shrink() - Frees idle flows beyond wfq_flow_cache_size
+ * @net: the WFQ policy instance
+ *
+ * Only flows whose last finish tag is not ahead of the system virtual time
+ * are freed: such a flow would re-enter at the system virtual time anyway,
+ * so dropping it loses no scheduling state. Flows still carrying service
+ * in the future are kept until virtual time catches up with them.
+ *
+ * \pre spin_is_locked(&net->wn_lru_lock)
+ */
+static void nrs_wfq_lru_shrink(struct nrs_wfq_net *net)
+{
+	struct nrs_wfq_flow *flow;
+	struct nrs_wfq_flow *tmp;
+	unsigned int low = 3 * wfq_flow_cache_size / 4;
+	__u64 vtime = READ_ONCE(net->wn_vtime);
+	int freed = 0;
+
+	assert_spin_locked(&net->wn_lru_lock);
+
+	if (net->wn_lru_cnt <= wfq_flow_cache_size)
+		return;
+
+	list_for_each_entry_safe(flow, tmp, &net->wn_lru_list, wf_lru) {
+		if (net->wn_lru_cnt <= low)
+			break;
+
+		if (flow->wf_finish > vtime)
+			continue;
+
+		flow->wf_dead = true;
+		list_del_init(&flow->wf_lru);
+		net->wn_lru_cnt--;
+		rhashtable_remove_fast(&net->wn_flow_hash, &flow->wf_rhead,
+				       nrs_wfq_hash_params);
+		OBD_FREE_RCU(flow, sizeof(*flow), wf_rcu_head);
+		freed++;
+	}
+
+	CDEBUG(D_RPCTRACE, "%d idle WFQ flows freed (cur: %u, high: %d)\n",
+	       freed, net->wn_lru_cnt, wfq_flow_cache_size);
+}
+
+/**
+ * nrs_wfq_res_get() - Obtains resources from WFQ policy instances
+ * @policy: the policy for which resources are being taken for request @nrq
+ * @nrq: the request for which resources are being taken
+ * @parent: parent resource, embedded in nrs_wfq_net for the WFQ policy
+ * @resp: resources references are placed in this array (out param)
+ * @moving_req: signifies limited caller context; used to perform memory
+ *		allocations in an atomic context in this policy
+ *
+ * Obtains resources from WFQ policy instances. The top-level resource lives
+ * inside @nrs_wfq_net and the second-level resource inside @nrs_wfq_flow
+ * object instances. Flows that have no requests left are put on an idle
+ * LRU and reclaimed by nrs_wfq_lru_shrink(), so that JobID churn does not
+ * grow the flow hash without bound.
+ *
+ * see @nrs_resource_get_safe()
+ *
+ * Return:
+ * * %0 we are returning a top-level, parent resource, one that is
+ *	embedded in an nrs_wfq_net object
+ * * %1 we are returning a bottom-level resource, one that is embedded
+ *	in an nrs_wfq_flow object
+ */
+static int nrs_wfq_res_get(struct ptlrpc_nrs_policy *policy,
+			   struct ptlrpc_nrs_request *nrq,
+			   const struct ptlrpc_nrs_resource *parent,
+			   struct ptlrpc_nrs_resource **resp, bool moving_req)
+{
+	struct nrs_wfq_net *net;
+	struct nrs_wfq_flow *flow;
+	struct nrs_wfq_flow *tmp;
+	struct ptlrpc_request *req;
+	struct nrs_wfq_key key;
+
+	if (parent == NULL) {
+		*resp = &((struct nrs_wfq_net *)policy->pol_private)->wn_res;
+		return 0;
+	}
+
+	net = container_of(parent, struct nrs_wfq_net, wn_res);
+	req = container_of(nrq, struct ptlrpc_request, rq_nrq);
+
+	nrs_wfq_key_fill(net, req, &key);
+
+again:
+	rcu_read_lock();
+	flow = rhashtable_lookup(&net->wn_flow_hash, &key,
+				 nrs_wfq_hash_params);
+	if (flow && !nrs_wfq_flow_tryget(net, flow))
+		flow = NULL;
+	rcu_read_unlock();
+	if (flow)
+		goto out;
+
+	OBD_CPT_ALLOC_GFP(flow, nrs_pol2cptab(policy), nrs_pol2cptid(policy),
+			  sizeof(*flow), moving_req ? GFP_ATOMIC : GFP_NOFS);
+	if (flow == NULL)
+		return -ENOMEM;
+
+	flow->wf_key = key;
+	INIT_LIST_HEAD(&flow->wf_lru);
+	atomic_set(&flow->wf_ref, 1);
+
+	rcu_read_lock();
+	tmp = rhashtable_lookup_get_insert_fast(&net->wn_flow_hash,
+						&flow->wf_rhead,
+						nrs_wfq_hash_params);
+	if (tmp && !IS_ERR(tmp) && !nrs_wfq_flow_tryget(net, tmp)) {
+		/* raced with nrs_wfq_lru_shrink() freeing the old flow */
+		rcu_read_unlock();
+		OBD_FREE_PTR(flow);
+		goto again;
+	}
+	rcu_read_unlock();
+	if (tmp) {
+		/* insertion failed */
+		OBD_FREE_PTR(flow);
+		if (IS_ERR(tmp))
+			return PTR_ERR(tmp);
+		flow = tmp;
+	}
+out:
+	*resp = &flow->wf_res;
+
+	return 1;
+}
+
+/**
+ * nrs_wfq_res_put() - Called when releasing references to the resource
+ * hierachy obtained for a request for scheduling using the WFQ policy.
+ * @policy: the policy the resource belongs to
+ * @res: the resource to be released
+ *
+ * The last reference moves the flow to the idle LRU.
+ */
+static void nrs_wfq_res_put(struct ptlrpc_nrs_policy *policy,
+			    const struct ptlrpc_nrs_resource *res)
+{
+	struct nrs_wfq_net *net;
+	struct nrs_wfq_flow *flow;
+
+	/* Do nothing for freeing parent, nrs_wfq_net resources */
+	if (res->res_parent == NULL)
+		return;
+
+	flow = container_of(res, struct nrs_wfq_flow, wf_res);
+	net = container_of(res->res_parent, struct nrs_wfq_net, wn_res);
+
+	if (!atomic_dec_and_lock(&flow->wf_ref, &net->wn_lru_lock))
+		return;
+
+	list_add_tail(&flow->wf_lru, &net->wn_lru_list);
+	net->wn_lru_cnt++;
+	nrs_wfq_lru_shrink(net);
+	spin_unlock(&net->wn_lru_lock);
+}
+
+/**
+ * nrs_wfq_req_bytes() - Returns the number of bulk bytes moved by @req
+ * @req: the request
+ *
+ * Only OST_READ and OST_WRITE carry niobuf_remote descriptors; their request
+ * pill has been initialized by the ost_io service's so_hpreq_handler by the
+ * time the request reaches NRS. All other RPCs are only charged the per-RPC
+ * cost.
+ *
+ * Return the sum of the niobuf_remote lengths of @req
+ */
+static __u64 nrs_wfq_req_bytes(struct ptlrpc_request *req)
+{
+	struct niobuf_remote *nb;
+	__u64 bytes = 0;
+	__u32 opc;
+	int niocount;
+	int i;
+
+	opc = lustre_msg_get_opc(req->rq_reqmsg);
+	if (opc != OST_READ && opc != OST_WRITE)
+		return 0;
+
+	if (!req_capsule_field_present(&req->rq_pill, &RMF_NIOBUF_REMOTE,
+				       RCL_CLIENT))
+		return 0;
+
+	nb = req_capsule_client_get(&req->rq_pill, &RMF_NIOBUF_REMOTE);
+	if (nb == NULL)
+		return 0;
+
+	niocount = req_capsule_get_size(&req->rq_pill, &RMF_NIOBUF_REMOTE,
+					RCL_CLIENT) / sizeof(*nb);
+	for (i = 0; i < niocount; i++)
+		bytes += nb[i].rnb_len;
+
+	return bytes;
+}
+
+/**
+ * nrs_wfq_req_get() - Called when getting a request from the WFQ policy for
+ * handling so that it can be served
+ * @policy: the policy being polled
+ * @peek: when set, signifies that we just want to examine the request,
+ *	and not handle it, so the request is not removed from the policy.
+ * @force: force the policy to return a request; unused in this policy
+ *
+ * see @ptlrpc_nrs_req_get_nolock()
+ * see @nrs_request_get()
+ *
+ * Return the request to be handled or NULL no request available
+ */
+static
+struct ptlrpc_nrs_request *nrs_wfq_req_get(struct ptlrpc_nrs_policy *policy,
+					   bool peek, bool force)
+{
+	struct nrs_wfq_net *net = policy->pol_private;
+	struct binheap_node *node = binheap_root(net->wn_binheap);
+	struct ptlrpc_nrs_request *nrq;
+
+	nrq = unlikely(node == NULL) ? NULL :
+	      container_of(node, struct ptlrpc_nrs_request, nr_node);
+
+	if (likely(!peek && nrq != NULL)) {
+		struct nrs_wfq_flow *flow;
+		struct ptlrpc_request *req = container_of(nrq,
+							  struct ptlrpc_request,
+							  rq_nrq);
+
+		flow = container_of(nrs_request_resource(nrq),
+				    struct nrs_wfq_flow, wf_res);
+
+		binheap_remove(net->wn_binheap, &nrq->nr_node);
+		flow->wf_active--;
+
+		/* Self-clocking: virtual time follows the request in service */
+		if (net->wn_vtime < nrq->nr_u.wfq.wr_finish)
+			net->wn_vtime = nrq->nr_u.wfq.wr_finish;
+
+		CDEBUG(D_RPCTRACE,
+		       "NRS: starting to handle %s request from %s, with start %llu finish %llu\n",
+		       NRS_POL_NAME_WFQ, libcfs_idstr(&req->rq_peer),
+		       nrq->nr_u.wfq.wr_start, nrq->nr_u.wfq.wr_finish);
+	}
+
+	return nrq;
+}
+
+/**
+ * nrs_wfq_req_add() - Adds request @nrq to a WFQ @policy instance's set of
+ * queued requests
+ * @policy: the policy
+ * @nrq: the request to add
+ *
+ * The request is charged the bytes it moves plus the per-RPC cost; its start
+ * tag is the later of the system virtual time and the finish tag of the
+ * previous request of its flow, and its finish tag is the start tag plus the
+ * charge. This makes a flow's share of the service proportional to bytes
+ * rather than to RPCs.
+ *
+ * Return:
+ * * %0 request successfully added
+ * * %!=0 on error
+ */
+static int nrs_wfq_req_add(struct ptlrpc_nrs_policy *policy,
+			   struct ptlrpc_nrs_request *nrq)
+{
+	struct nrs_wfq_net *net;
+	struct nrs_wfq_flow *flow;
+	struct ptlrpc_request *req;
+	__u64 cost;
+	int rc;
+
+	flow = container_of(nrs_request_resource(nrq),
+			    struct nrs_wfq_flow, wf_res);
+	net = container_of(nrs_request_resource(nrq)->res_parent,
+			   struct nrs_wfq_net, wn_res);
+	req = container_of(nrq, struct ptlrpc_request, rq_nrq);
+
+	cost = nrs_wfq_req_bytes(req) + net->wn_rpc_cost;
+	/* never let a request be free, or the flow would never advance */
+	if (cost == 0)
+		cost = 1;
+
+	nrq->nr_u.wfq.wr_start = max(net->wn_vtime, flow->wf_finish);
+	nrq->nr_u.wfq.wr_finish = nrq->nr_u.wfq.wr_start + cost;
+	nrq->nr_u.wfq.wr_sequence = net->wn_sequence++;
+
+	rc = binheap_insert(net->wn_binheap, &nrq->nr_node);
+	if (rc == 0) {
+		flow->wf_finish = nrq->nr_u.wfq.wr_finish;
+		flow->wf_charged += cost;
+		flow->wf_active++;
+	}
+
+	return rc;
+}
+
+/**
+ * nrs_wfq_req_del() - Removes request @nrq from a WFQ @policy instance's set
+ * of queued requests.
+ * @policy: the policy
+ * @nrq: the request to remove
+ *
+ * The flow keeps the finish tag of the removed request; it was charged for the
+ * request when it was enqueued, and the request is being served elsewhere
+ * (i.e. moved to the high-priority NRS head).
+ */
+static void nrs_wfq_req_del(struct ptlrpc_nrs_policy *policy,
+			    struct ptlrpc_nrs_request *nrq)
+{
+	struct nrs_wfq_net *net;
+	struct nrs_wfq_flow *flow;
+
+	flow = container_of(nrs_request_resource(nrq),
+			    struct nrs_wfq_flow, wf_res);
+	net = container_of(nrs_request_resource(nrq)->res_parent,
+			   struct nrs_wfq_net, wn_res);
+
+	binheap_remove(net->wn_binheap, &nrq->nr_node);
+	flow->wf_active--;
+}
+
+/**
+ * nrs_wfq_req_stop() - Called right after the request @nrq finishes being
+ * handled by WFQ policy instance @policy.
+ * @policy: the policy that handled the request
+ * @nrq: the request that was handled
+ */
+static void nrs_wfq_req_stop(struct ptlrpc_nrs_policy *policy,
+			     struct ptlrpc_nrs_request *nrq)
+{
+	struct ptlrpc_request *req = container_of(nrq, struct ptlrpc_request,
+						  rq_nrq);
+
+	CDEBUG(D_RPCTRACE,
+	       "NRS: finished handling %s request from %s, with finish %llu\n",
+	       NRS_POL_NAME_WFQ, libcfs_idstr(&req->rq_peer),
+	       nrq->nr_u.wfq.wr_finish);
+}
+
+/* debugfs interface */
+
+/*
+ * Retrieves the value of the per-RPC cost for WFQ policy instances on both the
+ * regular and high-priority NRS head of a service, as long as a policy instance
+ * is not in the ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPED state.
+ *
+ * Values are in bytes, and output is in YAML format.
+ *
+ * For example:
+ *  reg_rpc_cost:65536
+ *  hp_rpc_cost:65536
+ */
+static int
+ptlrpc_lprocfs_nrs_wfq_rpc_cost_seq_show(struct seq_file *m, void *data)
+{
+	struct ptlrpc_service *svc = m->private;
+	__u32 cost;
+	int rc;
+
+	rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_REG,
+				       NRS_POL_NAME_WFQ,
+				       NRS_CTL_WFQ_RD_RPC_COST,
+				       true, &cost);
+	if (rc == 0) {
+		seq_printf(m, NRS_LPROCFS_RPC_COST_NAME_REG"%u\n", cost);
+		/*
+		 * Ignore -ENODEV as the regular NRS head's policy may be in the
+		 * ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPED state.
+		 */
+	} else if (rc != -ENODEV) {
+		return rc;
+	}
+
+	if (!nrs_svc_has_hp(svc))
+		goto no_hp;
+
+	rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_HP,
+				       NRS_POL_NAME_WFQ,
+				       NRS_CTL_WFQ_RD_RPC_COST,
+				       true, &cost);
+	if (rc == 0) {
+		seq_printf(m, NRS_LPROCFS_RPC_COST_NAME_HP"%u\n", cost);
+		/*
+		 * Ignore -ENODEV as the high priority NRS head's policy may be
+		 * in the ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPED state.
+		 */
+	} else if (rc != -ENODEV) {
+		return rc;
+	}
+
+no_hp:
+	return rc;
+}
+
+/**
+ * ptlrpc_lprocfs_nrs_wfq_rpc_cost_seq_write() - Write operation debugfs file
+ * @file: file pointer to debugfs file
+ * @buffer: buffer (user space)
+ * @count: number of bytes in the buffer
+ * @off: offset
+ *
+ * Sets the per-RPC cost in bytes of WFQ policy instances of a service. The
+ * user can set the cost for the regular or high priority NRS head
+ * individually by specifying each value, or both together in a single
+ * invocation.
+ *
+ * For example:
+ *
+ * lctl set_param ost.OSS.ost_io.nrs_wfq_rpc_cost=reg_rpc_cost:4096, to set
+ * the regular request cost to 4096 bytes, and
+ *
+ * lctl set_param ost.OSS.ost_io.nrs_wfq_rpc_cost=1048576, to set the regular
+ * and high priority request costs to 1MiB.
+ *
+ * Return:
+ * * %>0 on success
+ * * %negative on failure
+ */
+static ssize_t
+ptlrpc_lprocfs_nrs_wfq_rpc_cost_seq_write(struct file *file,
+					  const char __user *buffer,
+					  size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct ptlrpc_service *svc = m->private;
+	enum ptlrpc_nrs_queue_type queue = 0;
+	char kernbuf[LPROCFS_NRS_WR_RPC_COST_MAX_CMD];
+	char *val;
+	unsigned int cost_reg;
+	unsigned int cost_hp;
+	/* lprocfs_find_named_value() modifies its argument, so keep a copy */
+	size_t count_copy;
+	int rc = 0;
+	int rc2 = 0;
+
+	if (count > (sizeof(kernbuf) - 1))
+		return -EINVAL;
+
+	if (copy_from_user(kernbuf, buffer, count))
+		return -EFAULT;
+
+	kernbuf[count] = '\0';
+
+	count_copy = count;
+
+	/* Check if the regular cost value has been specified */
+	val = lprocfs_find_named_value(kernbuf, NRS_LPROCFS_RPC_COST_NAME_REG,
+				       &count_copy);
+	if (val != kernbuf) {
+		rc = kstrtouint(val, 10, &cost_reg);
+		if (rc)
+			return rc;
+
+		queue |= PTLRPC_NRS_QUEUE_REG;
+	}
+
+	count_copy = count;
+
+	/* Check if the high priority cost value has been specified */
+	val = lprocfs_find_named_value(kernbuf, NRS_LPROCFS_RPC_COST_NAME_HP,
+				       &count_copy);
+	if (val != kernbuf) {
+		if (!nrs_svc_has_hp(svc))
+			return -ENODEV;
+
+		rc = kstrtouint(val, 10, &cost_hp);
+		if (rc)
+			return rc;
+
+		queue |= PTLRPC_NRS_QUEUE_HP;
+	}
+
+	/*
+	 * If none of the queues has been specified, look for a valid numerical
+	 * value
+	 */
+	if (queue == 0) {
+		rc = kstrtouint(kernbuf, 10, &cost_reg);
+		if (rc)
+			return rc;
+
+		queue = PTLRPC_NRS_QUEUE_REG;
+
+		if (nrs_svc_has_hp(svc)) {
+			queue |= PTLRPC_NRS_QUEUE_HP;
+			cost_hp = cost_reg;
+		}
+	}
+
+	if (((queue & PTLRPC_NRS_QUEUE_REG) != 0 &&
+	     cost_reg > NRS_WFQ_RPC_COST_MAX) ||
+	    ((queue & PTLRPC_NRS_QUEUE_HP) != 0 &&
+	     cost_hp > NRS_WFQ_RPC_COST_MAX))
+		return -EINVAL;
+
+	/*
+	 * Change the values on regular and HP NRS heads separately, ignoring
+	 * -ENODEV from a head the policy has not been started on, as
+	 * ptlrpc_lprocfs_nrs_crrn_quantum_seq_write() does.
+	 */
+	if ((queue & PTLRPC_NRS_QUEUE_REG) != 0) {
+		rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_REG,
+					       NRS_POL_NAME_WFQ,
+					       NRS_CTL_WFQ_WR_RPC_COST, false,
+					       &cost_reg);
+		if ((rc < 0 && rc != -ENODEV) ||
+		    (rc == -ENODEV && queue == PTLRPC_NRS_QUEUE_REG))
+			return rc;
+	}
+
+	if ((queue & PTLRPC_NRS_QUEUE_HP) != 0) {
+		rc2 = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_HP,
+						NRS_POL_NAME_WFQ,
+						NRS_CTL_WFQ_WR_RPC_COST, false,
+						&cost_hp);
+		if ((rc2 < 0 && rc2 != -ENODEV) ||
+		    (rc2 == -ENODEV && queue == PTLRPC_NRS_QUEUE_HP))
+			return rc2;
+	}
+
+	return rc == -ENODEV && rc2 == -ENODEV ? -ENODEV : count;
+}
+
+LDEBUGFS_SEQ_FOPS(ptlrpc_lprocfs_nrs_wfq_rpc_cost);
+
+/**
+ * nrs_wfq_lprocfs_init() - Initializes a WFQ policy's lprocfs interface for
+ * service @svc
+ * @svc: the service (PTLRPC service)
+ *
+ * Return:
+ * * %0 success
+ * * %!=0 error
+ */
+static int nrs_wfq_lprocfs_init(struct ptlrpc_service *svc)
+{
+	struct ldebugfs_vars nrs_wfq_lprocfs_vars[] = {
+		{ .name		= "nrs_wfq_rpc_cost",
+		  .fops		= &ptlrpc_lprocfs_nrs_wfq_rpc_cost_fops,
+		  .data		= svc },
+		{ NULL }
+	};
+
+	if (!svc->srv_debugfs_entry)
+		return 0;
+
+	ldebugfs_add_vars(svc->srv_debugfs_entry, nrs_wfq_lprocfs_vars, NULL);
+
+	return 0;
+}
+
+/* WFQ policy operations */
+static const struct ptlrpc_nrs_pol_ops nrs_wfq_ops = {
+	.op_policy_start	= nrs_wfq_start,
+	.op_policy_stop		= nrs_wfq_stop,
+	.op_policy_ctl		= nrs_wfq_ctl,
+	.op_res_get		= nrs_wfq_res_get,
+	.op_res_put		= nrs_wfq_res_put,
+	.op_req_get		= nrs_wfq_req_get,
+	.op_req_enqueue		= nrs_wfq_req_add,
+	.op_req_dequeue		= nrs_wfq_req_del,
+	.op_req_stop		= nrs_wfq_req_stop,
+	.op_lprocfs_init	= nrs_wfq_lprocfs_init,
+};
+
+/* WFQ policy configuration */
+struct ptlrpc_nrs_pol_conf nrs_conf_wfq = {
+	.nc_name		= NRS_POL_NAME_WFQ,
+	.nc_ops			= &nrs_wfq_ops,
+	.nc_compat		= nrs_policy_compat_one,
+	.nc_compat_svc_name	= "ost_io",
+};
@@ -285,6 +285,68 @@ void lustre_put_emerg_rs(struct ptlrpc_reply_state *rs)
 	wake_up(&svcpt->scp_rep_waitq);
 }
 
+static unsigned int rs_cache_max = 128;
+module_param(rs_cache_max, uint, 0644);
+MODULE_PARM_DESC(rs_cache_max, "Max small reply states cached per service partition");
+
+/*
+ * Small reply states are recycled through a per-partition list instead of
+ * going back to the slab on every reply; on a busy MDS the slab locks of the
+ * reply path are otherwise contended by all service threads. The buffers are
+ * allocated on the partition's CPT so they stay NUMA-local to the threads
+ * using them.
+ */
+struct ptlrpc_reply_state *
+lustre_get_cached_rs(struct ptlrpc_service_part *svcpt)
+{
+	struct ptlrpc_service *svc = svcpt->scp_service;
+	struct ptlrpc_reply_state *rs;
+
+	spin_lock(&svcpt->scp_rep_lock);
+	rs = list_first_entry_or_null(&svcpt->scp_rep_cache,
+				      struct ptlrpc_reply_state, rs_list);
+	if (rs) {
+		list_del(&rs->rs_list);
+		svcpt->scp_nreps_cached--;
+	}
+	spin_unlock(&svcpt->scp_rep_lock);
+
+	if (rs) {
+		memset(rs, 0, PTLRPC_RS_CACHE_SIZE);
+	} else {
+		if (svc->srv_stats)
+			lprocfs_counter_incr(svc->srv_stats,
+					     PTLRPC_REPSTATE_MISS_CNTR);
+		OBD_CPT_ALLOC_LARGE(rs, svc->srv_cptable, svcpt->scp_cpt,
+				    PTLRPC_RS_CACHE_SIZE);
+		if (!rs)
+			return NULL;
+	}
+
+	rs->rs_size = PTLRPC_RS_CACHE_SIZE;
+	rs->rs_svcpt = svcpt;
+	/* not rs_prealloc, which means the emergency pool is in use */
+	rs->rs_cached = 1;
+
+	return rs;
+}
+
+void lustre_put_cached_rs(struct ptlrpc_reply_state *rs)
+{
+	struct ptlrpc_service_part *svcpt = rs->rs_svcpt;
+
+	spin_lock(&svcpt->scp_rep_lock);
+	if (svcpt->scp_nreps_cached < rs_cache_max) {
+		list_add(&rs->rs_list, &svcpt->scp_rep_cache);
+		svcpt->scp_nreps_cached++;
+		rs = NULL;
+	}
+	spin_unlock(&svcpt->scp_rep_lock);
+
+	if (rs)
+		OBD_FREE_LARGE(rs, PTLRPC_RS_CACHE_SIZE);
+}
+
 int lustre_pack_reply_v2(struct ptlrpc_request *req, int count,
 			 __u32 *lens, char **bufs, int flags)
 {
@@ -2762,6 +2824,13 @@ void lustre_swab_ldlm_lock_desc(struct ldlm_lock_desc *l)
 	lustre_swab_ldlm_policy_data(&l->l_policy_data);
 }
 
+void lustre_swab_ldlm_extent_stride(struct ldlm_extent_stride *s)
+{
+	__swab64s(&s->les_offset);
+	__swab64s(&s->les_length);
+	__swab64s(&s->les_bytes);
+}
+
 void lustre_swab_ldlm_request(struct ldlm_request *rq)
 {
 	__swab32s(&rq->lock_flags);
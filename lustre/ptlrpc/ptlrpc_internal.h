@@ -37,6 +37,7 @@ extern struct ptlrpc_nrs_pol_conf nrs_conf_crrn;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_orr;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_trr;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_tbf;
+extern struct ptlrpc_nrs_pol_conf nrs_conf_wfq;
 #endif /* CONFIG_LUSTRE_FS_SERVER */
 
 /**
@@ -64,6 +65,8 @@ struct ptlrpc_bulk_desc *ptlrpc_new_bulk(unsigned npages, unsigned max_brw,
 						*ops);
 int ptlrpc_request_cache_init(void);
 void ptlrpc_request_cache_fini(void);
+int ptlrpc_rqbd_cache_init(void);
+void ptlrpc_rqbd_cache_fini(void);
 struct ptlrpc_request *ptlrpc_request_cache_alloc(gfp_t flags);
 void ptlrpc_request_cache_free(struct ptlrpc_request *req);
 void ptlrpc_init_xid(void);
@@ -252,6 +255,11 @@ void ptlrpc_fill_bulk_md(struct lnet_md *md, struct ptlrpc_bulk_desc *desc,
 struct ptlrpc_reply_state *
 lustre_get_emerg_rs(struct ptlrpc_service_part *svcpt);
 void lustre_put_emerg_rs(struct ptlrpc_reply_state *rs);
+/* size of the reply state buffers in ptlrpc_service_part::scp_rep_cache */
+#define PTLRPC_RS_CACHE_SIZE	PAGE_SIZE
+struct ptlrpc_reply_state *
+lustre_get_cached_rs(struct ptlrpc_service_part *svcpt);
+void lustre_put_cached_rs(struct ptlrpc_reply_state *rs);
 void lustre_msg_early_size_init(void); /* just for init */
 
 /* pinger.c */
@@ -53,10 +53,14 @@ static __init int ptlrpc_init(void)
 	if (rc)
 		GOTO(err_hr, rc);
 
-	rc = ptlrpc_init_portals();
+	rc = ptlrpc_rqbd_cache_init();
 	if (rc)
 		GOTO(err_cache, rc);
 
+	rc = ptlrpc_init_portals();
+	if (rc)
+		GOTO(err_rqbd_cache, rc);
+
 	rc = ptlrpc_lproc_init();
 	if (rc)
 		GOTO(err_portals, rc);
@@ -109,6 +113,8 @@ err_lproc:
 	ptlrpc_lproc_fini();
 err_portals:
 	ptlrpc_exit_portals();
+err_rqbd_cache:
+	ptlrpc_rqbd_cache_fini();
 err_cache:
 	ptlrpc_request_cache_fini();
 err_hr:
@@ -129,6 +135,7 @@ static void __exit ptlrpc_exit(void)
 	ldlm_exit();
 	ptlrpc_stop_pinger();
 	ptlrpc_exit_portals();
+	ptlrpc_rqbd_cache_fini();
 	ptlrpc_request_cache_fini();
 	ptlrpc_hr_fini();
 	ptlrpc_connection_fini();
@@ -2541,6 +2541,26 @@ int sptlrpc_svc_alloc_rs(struct ptlrpc_request *req, int msglen)
 	policy = req->rq_svc_ctx->sc_policy;
 	LASSERT(policy->sp_sops->alloc_rs);
 
+	/*
+	 * Small NULL-flavor replies are the common case; take them from the
+	 * partition's reply state cache, the NULL policy sizes the reply into
+	 * a preallocated reply state as is.
+	 */
+	if (req->rq_rqbd && !req->rq_reply_state &&
+	    SPTLRPC_FLVR_POLICY(req->rq_flvr.sf_rpc) == SPTLRPC_POLICY_NULL &&
+	    msglen + sizeof(*rs) <= PTLRPC_RS_CACHE_SIZE) {
+		rs = lustre_get_cached_rs(req->rq_rqbd->rqbd_svcpt);
+		if (rs) {
+			req->rq_reply_state = rs;
+			rc = policy->sp_sops->alloc_rs(req, msglen);
+			if (likely(rc == 0))
+				GOTO(out, rc);
+
+			lustre_put_cached_rs(rs);
+			req->rq_reply_state = NULL;
+		}
+	}
+
 	rc = policy->sp_sops->alloc_rs(req, msglen);
 	if (unlikely(rc == -ENOMEM)) {
 		struct ptlrpc_service_part *svcpt = req->rq_rqbd->rqbd_svcpt;
@@ -2566,7 +2586,7 @@ int sptlrpc_svc_alloc_rs(struct ptlrpc_request *req, int msglen)
 			req->rq_reply_state = NULL;
 		}
 	}
-
+out:
 	LASSERT(rc != 0 ||
 		(req->rq_reply_state && req->rq_reply_state->rs_msg));
 
@@ -2606,6 +2626,7 @@ void sptlrpc_svc_free_rs(struct ptlrpc_reply_state *rs)
 {
 	struct ptlrpc_sec_policy *policy;
 	unsigned int prealloc;
+	unsigned int cached;
 
 	ENTRY;
 
@@ -2616,9 +2637,12 @@ void sptlrpc_svc_free_rs(struct ptlrpc_reply_state *rs)
 	LASSERT(policy->sp_sops->free_rs);
 
 	prealloc = rs->rs_prealloc;
+	cached = rs->rs_cached;
 	policy->sp_sops->free_rs(rs);
 
-	if (prealloc)
+	if (cached)
+		lustre_put_cached_rs(rs);
+	else if (prealloc)
 		lustre_put_emerg_rs(rs);
 	EXIT;
 }
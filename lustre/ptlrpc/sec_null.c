@@ -326,7 +326,7 @@ void null_free_rs(struct ptlrpc_reply_state *rs)
 	LASSERT(atomic_read(&rs->rs_svc_ctx->sc_refcount) > 1);
 	atomic_dec(&rs->rs_svc_ctx->sc_refcount);
 
-	if (!rs->rs_prealloc)
+	if (!rs->rs_prealloc && !rs->rs_cached)
 		OBD_FREE_LARGE(rs, rs->rs_size);
 }
 
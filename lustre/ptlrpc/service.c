@@ -62,6 +62,27 @@ ptlrpc_alloc_rqbd(struct ptlrpc_service_part *svcpt)
 	struct ptlrpc_service		  *svc = svcpt->scp_service;
 	struct ptlrpc_request_buffer_desc *rqbd;
 
+	/* reuse a buffer retired after the last burst, if any */
+	spin_lock(&svcpt->scp_lock);
+	rqbd = list_first_entry_or_null(&svcpt->scp_rqbd_cache,
+					struct ptlrpc_request_buffer_desc,
+					rqbd_list);
+	if (rqbd) {
+		svcpt->scp_nrqbds_cached--;
+		list_move(&rqbd->rqbd_list, &svcpt->scp_rqbd_idle);
+		svcpt->scp_nrqbds_total++;
+	}
+	spin_unlock(&svcpt->scp_lock);
+
+	if (rqbd) {
+		LASSERT(rqbd->rqbd_refcount == 0);
+		LASSERT(list_empty(&rqbd->rqbd_reqs));
+		if (svc->srv_stats)
+			lprocfs_counter_incr(svc->srv_stats,
+					     PTLRPC_REQBUF_REUSE_CNTR);
+		return rqbd;
+	}
+
 	OBD_CPT_ALLOC_PTR(rqbd, svc->srv_cptable, svcpt->scp_cpt);
 	if (rqbd == NULL)
 		return NULL;
@@ -97,6 +118,91 @@ static void ptlrpc_free_rqbd(struct ptlrpc_request_buffer_desc *rqbd)
 	OBD_FREE_PTR(rqbd);
 }
 
+static struct shrinker *ptlrpc_rqbd_cache_shrinker;
+
+/*
+ * Request buffers kept in scp_rqbd_cache after a burst are full-size
+ * srv_buf_size allocations, give them back under memory pressure.
+ */
+static unsigned long ptlrpc_rqbd_cache_count(struct shrinker *sk,
+					     struct shrink_control *sc)
+{
+	struct ptlrpc_service_part *svcpt;
+	struct ptlrpc_service *svc;
+	unsigned long cached = 0;
+	int i;
+
+	if (!mutex_trylock(&ptlrpc_all_services_mutex))
+		return 0;
+	list_for_each_entry(svc, &ptlrpc_all_services, srv_list) {
+		ptlrpc_service_for_each_part(svcpt, i, svc)
+			cached += READ_ONCE(svcpt->scp_nrqbds_cached);
+	}
+	mutex_unlock(&ptlrpc_all_services_mutex);
+
+	return cached;
+}
+
+static unsigned long ptlrpc_rqbd_cache_scan(struct shrinker *sk,
+					    struct shrink_control *sc)
+{
+	struct ptlrpc_request_buffer_desc *rqbd;
+	struct ptlrpc_service_part *svcpt;
+	struct ptlrpc_service *svc;
+	unsigned long freed = 0;
+	LIST_HEAD(list);
+	int i;
+
+	if (!mutex_trylock(&ptlrpc_all_services_mutex))
+		return SHRINK_STOP;
+	list_for_each_entry(svc, &ptlrpc_all_services, srv_list) {
+		ptlrpc_service_for_each_part(svcpt, i, svc) {
+			spin_lock(&svcpt->scp_lock);
+			while (freed < sc->nr_to_scan &&
+			       (rqbd = list_first_entry_or_null(
+					&svcpt->scp_rqbd_cache,
+					struct ptlrpc_request_buffer_desc,
+					rqbd_list)) != NULL) {
+				list_move(&rqbd->rqbd_list, &list);
+				svcpt->scp_nrqbds_cached--;
+				freed++;
+			}
+			spin_unlock(&svcpt->scp_lock);
+
+			while ((rqbd = list_first_entry_or_null(&list,
+					struct ptlrpc_request_buffer_desc,
+					rqbd_list)) != NULL) {
+				list_del(&rqbd->rqbd_list);
+				if (svc->srv_stats)
+					lprocfs_counter_incr(svc->srv_stats,
+						PTLRPC_REQBUF_TRIM_CNTR);
+				ptlrpc_free_rqbd(rqbd);
+			}
+		}
+	}
+	mutex_unlock(&ptlrpc_all_services_mutex);
+
+	return freed;
+}
+
+int ptlrpc_rqbd_cache_init(void)
+{
+	ptlrpc_rqbd_cache_shrinker = ll_shrinker_alloc(0, "ptlrpc_rqbd_cache");
+	if (IS_ERR(ptlrpc_rqbd_cache_shrinker))
+		return PTR_ERR(ptlrpc_rqbd_cache_shrinker);
+
+	ptlrpc_rqbd_cache_shrinker->count_objects = ptlrpc_rqbd_cache_count;
+	ptlrpc_rqbd_cache_shrinker->scan_objects = ptlrpc_rqbd_cache_scan;
+	ll_shrinker_register(ptlrpc_rqbd_cache_shrinker);
+
+	return 0;
+}
+
+void ptlrpc_rqbd_cache_fini(void)
+{
+	ll_shrinker_free(ptlrpc_rqbd_cache_shrinker);
+}
+
 static int ptlrpc_grow_req_bufs(struct ptlrpc_service_part *svcpt, int post)
 {
 	struct ptlrpc_service *svc = svcpt->scp_service;
@@ -596,6 +702,7 @@ static int ptlrpc_service_part_init(struct ptlrpc_service *svc,
 	spin_lock_init(&svcpt->scp_lock);
 	mutex_init(&svcpt->scp_mutex);
 	INIT_LIST_HEAD(&svcpt->scp_rqbd_idle);
+	INIT_LIST_HEAD(&svcpt->scp_rqbd_cache);
 	INIT_LIST_HEAD(&svcpt->scp_rqbd_posted);
 	INIT_LIST_HEAD(&svcpt->scp_req_incoming);
 	init_waitqueue_head(&svcpt->scp_waitq);
@@ -610,6 +717,7 @@ static int ptlrpc_service_part_init(struct ptlrpc_service *svc,
 	spin_lock_init(&svcpt->scp_rep_lock);
 	INIT_LIST_HEAD(&svcpt->scp_rep_active);
 	INIT_LIST_HEAD(&svcpt->scp_rep_idle);
+	INIT_LIST_HEAD(&svcpt->scp_rep_cache);
 	init_waitqueue_head(&svcpt->scp_rep_waitq);
 	atomic_set(&svcpt->scp_nreps_difficult, 0);
 
@@ -984,9 +1092,7 @@ void ptlrpc_server_drop_request(struct ptlrpc_request *req)
 			 * or free it to drain some in excess.
 			 */
 			LASSERT(atomic_read(&rqbd->rqbd_req.rq_refcount) == 0);
-			if (svcpt->scp_nrqbds_posted >=
-			    svc->srv_nbuf_per_group ||
-			    (svc->srv_nrqbds_max != 0 &&
+			if ((svc->srv_nrqbds_max != 0 &&
 			     svcpt->scp_nrqbds_total > svc->srv_nrqbds_max) ||
 			    test_req_buffer_pressure) {
 				/* like in ptlrpc_free_rqbd() */
@@ -994,6 +1100,24 @@ void ptlrpc_server_drop_request(struct ptlrpc_request *req)
 				OBD_FREE_LARGE(rqbd->rqbd_buffer,
 					       svc->srv_buf_size);
 				OBD_FREE_PTR(rqbd);
+			} else if (svcpt->scp_nrqbds_posted >=
+				   svc->srv_nbuf_per_group) {
+				/*
+				 * Enough buffers are posted, keep this one
+				 * unposted for the next burst rather than
+				 * handing it back to the allocator.
+				 */
+				svcpt->scp_nrqbds_total--;
+				if (svcpt->scp_nrqbds_cached <
+				    svc->srv_nbuf_per_group) {
+					list_add(&rqbd->rqbd_list,
+						 &svcpt->scp_rqbd_cache);
+					svcpt->scp_nrqbds_cached++;
+				} else {
+					OBD_FREE_LARGE(rqbd->rqbd_buffer,
+						       svc->srv_buf_size);
+					OBD_FREE_PTR(rqbd);
+				}
 			} else {
 				list_add_tail(&rqbd->rqbd_list,
 					      &svcpt->scp_rqbd_idle);
@@ -2744,6 +2868,13 @@ static void ptlrpc_check_rqbd_pool(struct ptlrpc_service_part *svcpt)
 	if (svcpt->scp_service->srv_stats) {
 		lprocfs_counter_add(svcpt->scp_service->srv_stats,
 				    PTLRPC_REQBUF_AVAIL_CNTR, avail);
+		/* buffer pressure events */
+		if (avail <= low_water)
+			lprocfs_counter_incr(svcpt->scp_service->srv_stats,
+					     PTLRPC_REQBUF_LOW_CNTR);
+		if (avail == 0)
+			lprocfs_counter_incr(svcpt->scp_service->srv_stats,
+					     PTLRPC_REQBUF_EMPTY_CNTR);
 	}
 }
 
@@ -3785,6 +3916,16 @@ ptlrpc_service_purge_all(struct ptlrpc_service *svc)
 			ptlrpc_free_rqbd(rqbd);
 			spin_lock(&svcpt->scp_lock);
 		}
+		while ((rqbd = list_first_entry_or_null(&svcpt->scp_rqbd_cache,
+							struct ptlrpc_request_buffer_desc,
+							rqbd_list)) != NULL) {
+			list_del(&rqbd->rqbd_list);
+			svcpt->scp_nrqbds_cached--;
+			spin_unlock(&svcpt->scp_lock);
+
+			ptlrpc_free_rqbd(rqbd);
+			spin_lock(&svcpt->scp_lock);
+		}
 		spin_unlock(&svcpt->scp_lock);
 
 		ptlrpc_wait_replies(svcpt);
@@ -3795,6 +3936,14 @@ ptlrpc_service_purge_all(struct ptlrpc_service *svc)
 			list_del(&rs->rs_list);
 			OBD_FREE_LARGE(rs, svc->srv_max_reply_size);
 		}
+
+		while ((rs = list_first_entry_or_null(&svcpt->scp_rep_cache,
+						      struct ptlrpc_reply_state,
+						      rs_list)) != NULL) {
+			list_del(&rs->rs_list);
+			svcpt->scp_nreps_cached--;
+			OBD_FREE_LARGE(rs, PTLRPC_RS_CACHE_SIZE);
+		}
 	}
 }
 
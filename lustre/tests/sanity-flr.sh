@@ -1414,6 +1414,111 @@ test_33c() {
 }
 run_test 33c "keep reading among unhealthy mirrors"
 
+test_33d() {
+	[[ $OSTCOUNT -lt 2 ]] && skip "need >= 2 OSTs"
+
+	local tf=$DIR/$tfile
+	local osc=$($LCTL dl | awk '/OST0000-osc-[^M]/ { print $4 }')
+	local hedged
+	local t1
+
+	stack_trap "rm -f $tf" EXIT
+
+	# mirror 1 on OST0000 is preferred, mirror 2 on OST0001
+	$LFS setstripe -N -Eeof -o0 --flags=prefer -N -Eeof -o1 $tf ||
+		error "create mirrored file $tf failed"
+	dd if=/dev/urandom of=$tf bs=1M count=32 || error "write $tf failed"
+	$LFS mirror resync $tf || error "resync $tf failed"
+	verify_flr_state $tf "ro"
+
+	local pct=$($LCTL get_param -n osc.$osc.read_hedge_percentile)
+
+	$LCTL set_param osc.$osc.read_hedge_percentile=99
+	stack_trap "$LCTL set_param osc.$osc.read_hedge_percentile=$pct" EXIT
+	clear_stats osc.$osc.osc_stats
+
+	# 64KiB RPCs so that one read of $tf gives OST0000 enough latency
+	# samples (OSC_READ_LAT_MIN) for read hedging to be used
+	local mppr=$($LCTL get_param -n osc.$osc.max_pages_per_rpc)
+	local samples
+
+	$LCTL set_param osc.$osc.max_pages_per_rpc=16
+	stack_trap "$LCTL set_param osc.$osc.max_pages_per_rpc=$mppr" EXIT
+
+	# learn the normal read latency of OST0000
+	for i in {1..4}; do
+		cancel_lru_locks osc
+		cat $tf > /dev/null || error "read $tf failed"
+		samples=$($LCTL get_param -n lov.*-clilov-*.target_read_stats |
+			  awk '/^0:/ { print $4 }')
+		(( samples >= 64 )) && break
+	done
+	(( samples >= 64 )) ||
+		error "only $samples read latency samples from OST0000"
+
+	#define OBD_FAIL_OST_BRW_PAUSE_BULK	0x214
+	do_facet ost1 $LCTL set_param fail_loc=0x214 fail_val=30
+	stack_trap "do_facet ost1 $LCTL set_param fail_loc=0 fail_val=0" EXIT
+
+	cancel_lru_locks osc
+	t1=$SECONDS
+	cat $tf > /dev/null || error "read $tf with slow OST0000 failed"
+	t1=$((SECONDS - t1))
+	do_facet ost1 $LCTL set_param fail_loc=0 fail_val=0
+
+	hedged=$($LCTL get_param -n osc.$osc.osc_stats |
+		 awk '/hedged_reads/ { print $2 }')
+	echo "read took ${t1}s, $hedged hedged reads"
+	(( hedged > 0 )) || error "no read given up on slow OST0000"
+	(( t1 < 30 )) || error "read waited ${t1}s for slow OST0000"
+}
+run_test 33d "give up reads on a slow mirror with read hedging"
+
+test_33e() {
+	[[ $OSTCOUNT -lt 2 ]] && skip "need >= 2 OSTs"
+
+	local tf=$DIR/$tfile
+	local stats
+	local cost
+
+	stack_trap "rm -f $tf $TMP/$tfile" EXIT
+
+	$LFS setstripe -N -Eeof -o0 -N -Eeof -o1 $tf ||
+		error "create mirrored file $tf failed"
+	dd if=/dev/urandom of=$tf bs=1M count=16 || error "write $tf failed"
+	$LFS mirror resync $tf || error "resync $tf failed"
+	verify_flr_state $tf "ro"
+
+	$LCTL get_param -n lov.*.mirror_read_select | grep -q 0 ||
+		error "mirror read selection should be disabled by default"
+	$LCTL set_param lov.*.mirror_read_select=1
+	stack_trap "$LCTL set_param lov.*.mirror_read_select=0" EXIT
+
+	# 64KiB RPCs so each mirror gets enough samples to be measured
+	local mppr=$($LCTL get_param -n osc.*OST0000-osc-[^M]*.max_pages_per_rpc)
+
+	$LCTL set_param osc.*.max_pages_per_rpc=16
+	stack_trap "$LCTL set_param osc.*.max_pages_per_rpc=$mppr" EXIT
+
+	for m in 1 2; do
+		cancel_lru_locks osc
+		$LFS mirror read -N $m -o $TMP/$tfile $tf ||
+			error "read mirror $m of $tf failed"
+	done
+
+	stats=$($LCTL get_param -n lov.*-clilov-*.target_read_stats)
+	echo "$stats"
+	for idx in 0 1; do
+		cost=$(awk '/^'$idx':/ { print $NF }' <<< "$stats")
+		(( cost > 0 )) || error "no read cost measured for OST $idx"
+	done
+
+	cancel_lru_locks osc
+	cat $tf > /dev/null || error "read $tf failed"
+	$LCTL get_param lov.*.mirror_read_switches
+}
+run_test 33e "measure OST read cost for mirror selection"
+
 test_34a() {
 	(( $OSTCOUNT >= 4 )) || skip "need >= 4 OSTs"
 
@@ -4788,6 +4893,55 @@ test_212b() {
 }
 run_test 212b "Testing lfs mirror verify --stale option"
 
+test_213() {
+	local tf=$DIR/$tfile
+	local sync=$($LCTL get_param -n llite.*.mirror_write_sync | head -n1)
+	local count
+
+	stack_trap "rm -f $tf $TMP/$tfile" EXIT
+	$LCTL set_param llite.*.mirror_write_sync=1
+	stack_trap "$LCTL set_param llite.*.mirror_write_sync=$sync" EXIT
+
+	$LFS mirror create -N2 $tf || error "create mirrored file $tf failed"
+	dd if=/dev/urandom of=$tf bs=1M count=4 || error "write $tf failed"
+	$LFS mirror resync $tf || error "resync $tf failed"
+	verify_flr_state $tf "ro"
+
+	$LCTL set_param llite.*.stats=clear
+	dd if=/dev/urandom of=$TMP/$tfile bs=1M count=2
+	dd if=$TMP/$tfile of=$tf bs=1M seek=1 conv=notrunc ||
+		error "overwrite $tf failed"
+	# unaligned write
+	echo "unaligned" | dd of=$tf bs=1 seek=12345 conv=notrunc ||
+		error "unaligned write to $tf failed"
+	# many buffered writes share the lease and resync of their fd
+	dd if=/dev/urandom of=$tf bs=4k count=256 seek=768 conv=notrunc ||
+		error "buffered writes to $tf failed"
+
+	verify_flr_state $tf "ro"
+	$LFS mirror verify $tf || error "mirrors of $tf differ"
+
+	count=$($LCTL get_param -n llite.*.stats |
+		awk '/^mirror_write / { print $2 }')
+	(( count >= 2 )) || error "expected 2 mirror writes, got '$count'"
+
+	cancel_lru_locks osc
+	cmp -n 2097152 -i 0:1048576 $TMP/$tfile $tf ||
+		error "data of $tf is wrong"
+
+	# another writer prevents the write lease, so the write is done the
+	# normal way and the other mirrors become stale
+	exec 7>>$tf
+	echo "second writer" | dd of=$tf bs=1 seek=4096 conv=notrunc ||
+		error "write to $tf with a second writer failed"
+	exec 7>&-
+	verify_flr_state $tf "wp"
+	count=$($LCTL get_param -n llite.*.stats |
+		awk '/^mirror_write_fallback / { print $2 }')
+	(( count >= 1 )) || error "expected a fallback write, got '$count'"
+}
+run_test 213 "mirror_write_sync keeps all mirrors in sync"
+
 complete_test $SECONDS
 check_and_cleanup_lustre
 exit_status
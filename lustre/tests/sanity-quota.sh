@@ -7898,6 +7898,55 @@ test_97d() {
 }
 run_test 97d "LQA disk persistence using standard commands"
 
+test_98() {
+	(( MDS1_VERSION >= $(version_code 2.17.51) )) ||
+		skip "need MDS >= 2.17.51 for metadata writeback"
+
+	local param="llite.$FSNAME-*"
+	local save="$TMP/$TESTSUITE-$TESTNAME.parameters"
+	local testdir="$DIR/$tdir/cached"
+	local limit=256
+	local errors
+	local i
+
+	$LCTL get_param -n $param.metadata_writeback > /dev/null 2>&1 ||
+		skip "client does not support metadata writeback"
+
+	setup_quota_test || error "setup quota failed with $?"
+	stack_trap cleanup_quota_test EXIT
+
+	set_mdt_qtype $QTYPE || error "enable mdt quota failed"
+
+	save_lustre_params client "$param.intent_mkdir" > $save
+	stack_trap "restore_lustre_params < $save; rm -f $save" EXIT
+	stack_trap "$LCTL set_param $param.metadata_writeback=0" EXIT
+	$LCTL set_param $param.intent_mkdir=1 $param.metadata_writeback=1
+	$LCTL set_param -n $param.metadata_writeback_stats=clear
+
+	log "User quota (inode hardlimit:$limit files)"
+	$LFS setquota -u $TSTUSR -b 0 -B 0 -i 0 -I $limit $DIR ||
+		error "set user quota failed"
+
+	# creates past the quota fail at once, not on write back
+	$RUNAS mkdir $testdir || error "mkdir $testdir failed"
+	for ((i = 0; i < limit * 2; i++)); do
+		$RUNAS mkdir $testdir/d$i 2> /dev/null || break
+	done
+	(( i < limit * 2 )) ||
+		quota_error u $TSTUSR "user create success, but expect EDQUOT"
+	$RUNAS mkdir $testdir/d$i 2>&1 | grep -q "quota exceeded" ||
+		quota_error u $TSTUSR "create did not fail with EDQUOT"
+
+	sync
+	$LCTL get_param $param.metadata_writeback_stats
+	errors=$($LCTL get_param -n $param.metadata_writeback_stats |
+		 awk '/errors:/ { print $2 }')
+	(( ${errors:-0} == 0 )) || error "$errors creates failed on write back"
+	(( $(ls $testdir | wc -l) == i )) ||
+		error "$i creates succeeded, $(ls $testdir | wc -l) are there"
+}
+run_test 98 "metadata writeback does not cache creates over quota"
+
 quota_fini()
 {
 	do_nodes $(comma_list $(nodes_list)) \
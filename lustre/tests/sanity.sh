@@ -1628,6 +1628,39 @@ test_24H() {
 }
 run_test 24H "repeat FLD_QUERY rpc"
 
+test_24I() {
+	(( MDSCOUNT >= 2 )) || skip_env "needs >= 2 MDTs"
+	$LCTL get_param -n lmv.*.readdir_readahead_stats &> /dev/null ||
+		skip "Client does not support readdir readahead"
+
+	local dir=$DIR/$tdir
+	local num=5000
+	local ra_rpcs
+	local count
+
+	test_mkdir -c $MDSCOUNT $dir || error "mkdir $dir failed"
+	stack_trap "rm -rf $dir"
+	createmany -m $dir/f- $num || error "createmany $num failed"
+
+	cancel_lru_locks mdc
+	$LCTL set_param lmv.*.readdir_readahead_stats=clear
+	count=$(ls -f $dir | wc -l)
+	(( count == num + 2 )) || error "Expected $((num + 2)), got $count"
+
+	$LCTL get_param lmv.*.readdir_readahead_stats
+	ra_rpcs=$($LCTL get_param -n lmv.*.readdir_readahead_stats |
+		  awk '/readahead_rpcs:/ { sum += $NF } END { print sum + 0 }')
+	(( ra_rpcs > 0 )) || error "no stripe pages read ahead"
+
+	# listing without readahead returns the same entries
+	$LCTL set_param lmv.*.readdir_readahead=0
+	stack_trap "$LCTL set_param lmv.*.readdir_readahead=1"
+	cancel_lru_locks mdc
+	count=$(ls -f $dir | wc -l)
+	(( count == num + 2 )) || error "Expected $((num + 2)), got $count"
+}
+run_test 24I "readdir reads ahead the pages of all stripes"
+
 test_25a() {
 	echo '== symlink sanity ============================================='
 
@@ -13273,6 +13306,55 @@ test_101m()
 }
 run_test 101m "read ahead for small file and last stripe of the file"
 
+test_101n() {
+	local streams=$($LCTL get_param -n llite.*.read_ahead_streams |
+			head -n 1)
+	local max_per_file_mb=$($LCTL get_param -n \
+		llite.*.max_read_ahead_per_file_mb | head -n 1)
+	local cmd="o"
+	local miss1
+	local miss4
+	local i
+
+	[[ -n "$streams" ]] || skip "no multi-stream read-ahead support"
+	stack_trap "$LCTL set_param llite.*.read_ahead_streams=$streams"
+	stack_trap "$LCTL set_param llite.*.max_read_ahead_per_file_mb=$max_per_file_mb"
+	$LCTL set_param llite.*.max_read_ahead_per_file_mb=16
+
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=128 ||
+		error "dd 128M file failed"
+	stack_trap "rm -f $DIR/$tfile"
+
+	# two sequential streams, 64MiB apart, interleaved through one fd
+	for ((i = 0; i < 32; i++)); do
+		cmd+="z$((i * 1048576))r1048576"
+		cmd+="z$(((64 + i) * 1048576))r1048576"
+	done
+	cmd+="c"
+
+	$LCTL set_param llite.*.read_ahead_streams=1
+	cancel_lru_locks osc
+	$LCTL set_param llite.*.read_ahead_stats=0
+	$MULTIOP $DIR/$tfile $cmd || error "$MULTIOP single stream failed"
+	$LCTL get_param llite.*.read_ahead_stats
+	miss1=$($LCTL get_param -n llite.*.read_ahead_stats |
+		awk '/^misses/ { print $2 }' | calc_sum)
+
+	$LCTL set_param llite.*.read_ahead_streams=4
+	cancel_lru_locks osc
+	$LCTL set_param llite.*.read_ahead_stats=0
+	$MULTIOP $DIR/$tfile $cmd || error "$MULTIOP multiple streams failed"
+	$LCTL get_param llite.*.read_ahead_stats
+	miss4=$($LCTL get_param -n llite.*.read_ahead_stats |
+		awk '/^misses/ { print $2 }' | calc_sum)
+
+	$LCTL get_param -n llite.*.read_ahead_stats | grep -q stream1_hits ||
+		error "second stream got no read-ahead hits"
+	(( miss4 < miss1 )) ||
+		error "misses with 4 streams $miss4 >= $miss1 with 1 stream"
+}
+run_test 101n "read-ahead for streams interleaved through one fd"
+
 setup_test102() {
 	test_mkdir $DIR/$tdir
 	chown $RUNAS_ID $DIR/$tdir
@@ -13863,6 +13945,67 @@ test_102t() {
 }
 run_test 102t "zero length xattr values handled correctly"
 
+test_102u() {
+	$LCTL get_param mdc.*.import | grep -q "xattr_prefetch" ||
+		skip "MDS does not support xattr prefetch"
+
+	local save="$TMP/$TESTSUITE-$TESTNAME.parameters"
+	local value
+	local saved
+
+	save_lustre_params client "llite.*.xattr_cache" > $save
+	stack_trap "restore_lustre_params < $save; rm -f $save"
+	$LCTL set_param llite.*.xattr_cache=1
+
+	touch $DIR/$tfile || error "touch failed"
+	setfattr -n trusted.n102u -v prefetched $DIR/$tfile ||
+		error "setfattr failed"
+	cancel_lru_locks mdc
+	stat $DIR/$tfile > /dev/null || error "stat failed"
+
+	$LCTL set_param -n llite.*.stats=clear
+	value=$(getfattr --only-values -n trusted.n102u $DIR/$tfile)
+	[[ "$value" == "prefetched" ]] || error "wrong value '$value'"
+	getfattr -n security.n102u $DIR/$tfile &&
+		error "security.n102u should not exist"
+	saved=$($LCTL get_param -n llite.*.stats |
+		awk '/^getxattr_saved/ { print $2 }')
+	(( ${saved:-0} > 0 )) || error "no getxattr RPC saved"
+
+	# setxattr revokes the XATTR lock the prefetched values live under
+	setfattr -n trusted.n102u -v updated $DIR/$tfile ||
+		error "setfattr update failed"
+	stat $DIR/$tfile > /dev/null || error "stat failed"
+	value=$(getfattr --only-values -n trusted.n102u $DIR/$tfile)
+	[[ "$value" == "updated" ]] || error "stale value '$value'"
+
+	# the reply room grows once a file has larger xattrs
+	setfattr -n trusted.n102u -v $(printf "%01000d" 0) $DIR/$tfile ||
+		error "setfattr large failed"
+	cancel_lru_locks mdc
+	stat $DIR/$tfile > /dev/null || error "stat failed"
+	cancel_lru_locks mdc
+	stat $DIR/$tfile > /dev/null || error "stat failed"
+	$LCTL set_param -n llite.*.stats=clear
+	getfattr -n trusted.n102u $DIR/$tfile > /dev/null ||
+		error "getfattr large failed"
+	saved=$($LCTL get_param -n llite.*.stats |
+		awk '/^getxattr_saved/ { print $2 }')
+	(( ${saved:-0} > 0 )) || error "large xattr not prefetched"
+
+	# nothing is prefetched without the xattr cache
+	$LCTL set_param llite.*.xattr_cache=0
+	cancel_lru_locks mdc
+	stat $DIR/$tfile > /dev/null || error "stat failed"
+	$LCTL set_param -n llite.*.stats=clear
+	getfattr -n trusted.n102u $DIR/$tfile > /dev/null ||
+		error "getfattr failed"
+	saved=$($LCTL get_param -n llite.*.stats |
+		awk '/^getxattr_saved/ { print $2 }')
+	(( ${saved:-0} == 0 )) || error "xattrs prefetched without cache"
+}
+run_test 102u "xattrs prefetched with getattr save getxattr RPCs"
+
 run_acl_subtest()
 {
 	local test=$LUSTRE/tests/acl/$1.test
@@ -16600,6 +16743,104 @@ test_123l() {
 }
 run_test 123l "Avoid panic when revalidate a local cached entry"
 
+test_123m() {
+	(( MDSCOUNT >= 2 )) || skip_env "needs >= 2 MDTs"
+	$LCTL get_param -n mdc.*.connect_flags | grep -q batch_rpc ||
+		skip "Server does not support batch RPC"
+	$LCTL get_param -n llite.*.statahead_stats | grep -q striped_total ||
+		skip "Client does not support per-stripe statahead"
+
+	local dir=$DIR/$tdir
+	local num=2000
+	local batch_rpcs
+	local striped
+	local hit
+	local i
+
+	test_mkdir -c $MDSCOUNT -H all_char $dir || error "mkdir $dir failed"
+	stack_trap "rm -rf $dir"
+	createmany -o $dir/$tfile $num || error "createmany $num failed"
+
+	cancel_lru_locks mdc
+	cancel_lru_locks osc
+	$LCTL set_param llite.*.statahead_stats=clear
+	$LCTL set_param mdc.*.batch_stats=clear
+	$LCTL set_param mdc.*.stats=clear
+	ls -l $dir > /dev/null || error "ls -l $dir failed"
+	wait_update_facet client "pgrep ll_sa" "" 35 ||
+		error "ll_sa thread is still running"
+
+	$LCTL get_param llite.*.statahead_stats
+	striped=$($LCTL get_param -n llite.*.statahead_stats |
+		  awk '/striped_total:/ { sum += $NF } END { print sum + 0 }')
+	hit=$($LCTL get_param -n llite.*.statahead_stats |
+	      awk '/hit_total:/ { sum += $NF } END { print sum + 0 }')
+	batch_rpcs=$(calc_stats mdc.*.stats mds_batch)
+	echo "striped=$striped hit=$hit batch RPCs=$batch_rpcs"
+	(( striped > 0 )) || error "statahead did not run per stripe"
+	(( hit > num * 3 / 4 )) || error "statahead hit count $hit too low"
+	# every MDT of the stripes got its own batches
+	for ((i = 0; i < MDSCOUNT; i++)); do
+		local rpcs=$($LCTL get_param -n \
+			mdc.$FSNAME-MDT$(printf "%04x" $i)-mdc-*.stats |
+			awk '/mds_batch/ { print $2 }')
+
+		(( ${rpcs:-0} > 0 )) || error "no batch RPC sent to MDT$i"
+	done
+}
+run_test 123m "statahead sends batches to all MDTs of a striped directory"
+
+test_123n() {
+	$LCTL get_param -n llite.*.statahead_data_kb > /dev/null 2>&1 ||
+		skip "Client does not support statahead data prefetch"
+
+	local dir=$DIR/$tdir
+	local num=500
+	local data_kb
+	local agl
+	local pages
+	local i
+
+	agl=$($LCTL get_param -n llite.*.statahead_agl | head -n 1)
+	data_kb=$($LCTL get_param -n llite.*.statahead_data_kb | head -n 1)
+	stack_trap "$LCTL set_param llite.*.statahead_agl=$agl"
+	stack_trap "$LCTL set_param llite.*.statahead_data_kb=$data_kb"
+	$LCTL set_param llite.*.statahead_agl=1
+
+	test_mkdir $dir || error "mkdir $dir failed"
+	stack_trap "rm -rf $dir"
+	for ((i = 0; i < num; i++)); do
+		dd if=/dev/urandom of=$dir/$tfile.$i bs=64k count=1 \
+			status=none || error "dd $dir/$tfile.$i failed"
+	done
+
+	cancel_lru_locks mdc
+	cancel_lru_locks osc
+	$LCTL set_param llite.*.read_ahead_stats=clear
+	# tar stats then reads every file in readdir order
+	tar cf - -C $dir . | cat > /dev/null || error "tar $dir failed"
+	wait_update_facet client "pgrep ll_sa" "" 35 ||
+		error "ll_sa thread is still running"
+
+	$LCTL get_param llite.*.read_ahead_stats
+	pages=$($LCTL get_param -n llite.*.read_ahead_stats |
+		awk '/dir_prefetch_pages/ { sum += $2 } END { print sum + 0 }')
+	(( pages > 0 )) || error "no data prefetched during directory sweep"
+
+	# with the prefetch disabled, AGL only glimpses
+	cancel_lru_locks mdc
+	cancel_lru_locks osc
+	$LCTL set_param llite.*.statahead_data_kb=0
+	$LCTL set_param llite.*.read_ahead_stats=clear
+	tar cf - -C $dir . | cat > /dev/null || error "tar $dir failed"
+	wait_update_facet client "pgrep ll_sa" "" 35 ||
+		error "ll_sa thread is still running"
+	pages=$($LCTL get_param -n llite.*.read_ahead_stats |
+		awk '/dir_prefetch_pages/ { sum += $2 } END { print sum + 0 }')
+	(( pages == 0 )) || error "$pages pages prefetched while disabled"
+}
+run_test 123n "statahead prefetches file data when files are read in order"
+
 test_124a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
 	$LCTL get_param -n mdc.*.connect_flags | grep -q lru_resize ||
@@ -17042,6 +17283,40 @@ test_124g() {
 }
 run_test 124g "LFRU performance test"
 
+test_124h() {
+	[[ $PARALLEL != "yes" ]] || skip "skip parallel run"
+	(( $MDS1_VERSION >= $(version_code 2.17.50) )) ||
+		skip "Need MDS version with at least 2.17.50"
+
+	local nsdir="ldlm.namespaces.*-MDT0000-mdc-*"
+	$LCTL get_param -n $nsdir.lru_arc_target > /dev/null ||
+		skip "client does not support ARC lock cache policy"
+
+	local lru_size=$(default_lru_size)
+	lru_resize_disable mdc $lru_size
+	stack_trap "$LCTL set_param $nsdir.lock_cache_policy=LFRU"
+
+	local cli_nid="0@lo"
+	if remote_mds; then
+		cli_nid=$($LCTL list_nids | grep -v "@lo" | head -1)
+	fi
+	mkdir_on_mdt0 $DIR/$tdir
+	local enq_arc
+	local enq_lru
+	# test with arc
+	test_124g_run "$cli_nid" "$DIR/$tdir" $lru_size "ARC" enq_arc
+	local ghost_hits=$($LCTL get_param -n $nsdir.lock_lru_ghost_hits)
+	local target=$($LCTL get_param -n $nsdir.lru_arc_target)
+	# test with lru
+	test_124g_run "$cli_nid" "$DIR/$tdir" $lru_size "LRU" enq_lru
+
+	echo ">> arc=$enq_arc, lru=$enq_lru"
+	echo ">> ghost_hits=$ghost_hits, arc_target=$target"
+	(( $enq_arc <= $enq_lru )) ||
+		error "arc $enq_arc > lru $enq_lru"
+}
+run_test 124h "ARC lock cache policy performance test"
+
 test_125() { # 13358
 	$LCTL get_param -n llite.*.client_type | grep -q local ||
 		skip "must run as local client"
@@ -18500,6 +18775,50 @@ test_134b() {
 }
 run_test 134b "Server rejects lock request when reaching lock_limit_mb"
 
+test_134c() {
+	remote_mds_nodsh && skip "remote MDS with nodsh"
+	(( $MDS1_VERSION >= $(version_code 2.17.50) )) ||
+		skip "Need MDS version at least 2.17.50"
+
+	local -a cli_params=( $($LCTL get_param jobid_name jobid_var) )
+	local jobid="134c.$RANDOM"
+	local nr=300
+
+	$LCTL set_param jobid_var=nodelocal jobid_name=$jobid
+	stack_trap "$LCTL set_param ${cli_params[*]}" EXIT
+
+	mkdir_on_mdt0 $DIR/$tdir || error "failed to create $DIR/$tdir"
+	cancel_lru_locks mdc
+	createmany -o $DIR/$tdir/f $nr ||
+		error "failed to create $nr files in $DIR/$tdir"
+
+	local nsdir="ldlm.namespaces.*-MDT0000-mdc-*"
+	local unused=$($LCTL get_param -n $nsdir.lock_unused_count)
+	local granted=$(do_facet mds1 $LCTL get_param -n mdt.*-MDT0000.job_stats |
+			awk "/job_id:.*$jobid/ { found = 1 }
+			     found && /granted_locks:/ { print \$4; exit }")
+
+	echo "job $jobid: granted_locks=$granted, client unused=$unused"
+	(( ${granted%,} >= nr / 2 )) ||
+		error "job $jobid granted_locks ${granted%,} < $((nr / 2))"
+
+	# revoke the idle locks of the job once it is over its soft limit
+	local soft=$((nr / 3))
+
+	do_facet mds1 $LCTL set_param ldlm.lock_job_soft_limit=$soft
+	stack_trap "do_facet mds1 $LCTL set_param ldlm.lock_job_soft_limit=0"
+	echo "sleep 15 seconds ..."
+	sleep 15
+	touch $DIR/$tdir/m || error "touch $DIR/$tdir/m failed"
+	sleep 5
+
+	local lck_cnt=$($LCTL get_param -n $nsdir.lock_unused_count)
+
+	(( lck_cnt < unused )) ||
+		error "No locks reclaimed, before:$unused, after:$lck_cnt"
+}
+run_test 134c "Server reclaims locks of a job over lock_job_soft_limit"
+
 test_135() {
 	remote_mds_nodsh && skip "remote MDS with nodsh"
 	[[ $MDS1_VERSION -lt $(version_code 2.13.50) ]] &&
@@ -26931,6 +27250,49 @@ test_248d() {
 }
 run_test 248d "fast read serves tiny reads from cache without failures"
 
+test_248e() {
+	local fast_read_sav=$($LCTL get_param -n llite.*.fast_read 2>/dev/null)
+
+	[ -z "$fast_read_sav" ] && skip "no fast read support"
+	$LCTL get_param -n llite.*.stats | grep -q page_fault_around ||
+		skip "no mmap fault-around support"
+	(( PAGE_SIZE < 65536 )) || skip "fault-around needs PAGE_SIZE < 64KiB"
+	stack_trap "$LCTL set_param -n llite.*.fast_read=$fast_read_sav"
+
+	dd if=/dev/urandom of=$DIR/$tfile bs=1M count=4 2>/dev/null ||
+		error "dd write failed"
+	stack_trap "rm -f $DIR/$tfile"
+
+	# warm the page cache, the pages stay covered by the read lock
+	$LCTL set_param -n llite.*.fast_read=1
+	cat $DIR/$tfile > /dev/null || error "warmup read failed"
+
+	$LCTL set_param llite.*.stats=clear
+	$MULTIOP $DIR/$tfile OSMRUc || error "$MULTIOP $DIR/$tfile failed"
+	$LCTL get_param llite.*.stats | grep page_fault
+
+	local around=$($LCTL get_param -n llite.*.stats |
+		awk '/page_fault_around/ { print $2 }')
+	local faults=$($LCTL get_param -n llite.*.stats |
+		awk '/page_fault / { print $2 }')
+
+	# every fault-around pass maps a window of pages, so far fewer
+	# ->fault() calls than the 1024 pages touched should be needed
+	(( ${around:-0} > 0 )) || error "no fault-around on cached pages"
+	(( ${faults:-0} < 512 )) ||
+		error "$faults faults for 1024 cached pages"
+
+	# with fast_read disabled every page goes through ->fault()
+	$LCTL set_param -n llite.*.fast_read=0
+	$LCTL set_param llite.*.stats=clear
+	$MULTIOP $DIR/$tfile OSMRUc || error "$MULTIOP $DIR/$tfile failed"
+	around=$($LCTL get_param -n llite.*.stats |
+		awk '/page_fault_around/ { print $2 }')
+	(( ${around:-0} == 0 )) ||
+		error "fault-around with fast_read disabled: $around"
+}
+run_test 248e "mmap read maps cached pages around the fault"
+
 test_249() { # LU-7890
 	[ $MDS1_VERSION -lt $(version_code 2.8.53) ] &&
 		skip "Need at least version 2.8.54"
@@ -35852,6 +36214,96 @@ test_842() {
 }
 run_test 842 "Measure ldlm_extent performance"
 
+test_843() {
+	(( $MDS1_VERSION >= $(version_code 2.17.51) )) ||
+		skip "Need MDS version at least 2.17.51 for ldlm_flock module"
+
+	local mds1=$(facet_host mds1)
+	local out
+	local t
+
+	# Try to insert the module.  This will leave results in dmesg
+	now=$(date +%s)
+	log "STAMP $now" > /dev/kmsg
+	do_rpc_nodes $mds1 load_module kunit/ldlm_flock ||
+		error "$mds1 load_module ldlm_flock failed"
+
+	out=$(do_node $mds1 dmesg |
+	      sed -n -e "1,/STAMP $now/d" -e '/ldlm_flock:/p')
+	do_node $mds1 rmmod -v ldlm_flock ||
+		error "rmmod failed (may trigger a failure in a later test)"
+	echo "$out"
+
+	# each request conflicts with a whole chain of blocked owners
+	! grep -q "unexpected result\|setup failed\|leaked" <<< "$out" ||
+		error "wrong result of a blocked flock request"
+	for t in nowait block deadlock; do
+		grep -q "$t chain=10000 waiters=10000 " <<< "$out" ||
+			error "no $t result for a chain of 10000 waiters"
+	done
+}
+run_test 843 "Measure ldlm_flock deadlock detection with blocked owners"
+
+test_844() {
+	(( $MDS1_VERSION >= $(version_code 2.17.51) )) ||
+		skip "Need MDS version at least 2.17.51 for ldlm_bench module"
+
+	local mds1=$(facet_host mds1)
+	local max_locks=${LDLM_BENCH_LOCKS:-100000}
+
+	# Try to insert the module.  This will leave results in dmesg
+	now=$(date +%s)
+	log "STAMP $now" > /dev/kmsg
+	do_rpc_nodes $mds1 load_module kunit/ldlm_bench max_locks=$max_locks ||
+		error "$mds1 load_module ldlm_bench failed"
+
+	do_node $mds1 dmesg | sed -n -e "1,/STAMP $now/d" -e '/ldlm_bench:/p' |
+		tee $TMP/$tfile.log
+	do_node $mds1 rmmod -v ldlm_bench ||
+		error "rmmod failed (may trigger a failure in a later test)"
+
+	! grep -q "failed: rc" $TMP/$tfile.log ||
+		error "ldlm_bench failed"
+	rm -f $TMP/$tfile.log
+}
+run_test 844 "Measure ldlm lock manager scalability"
+
+mdt_reqbuf_stat() {
+	do_facet mds1 $LCTL get_param -n mds.MDS.mdt.stats |
+		awk -v name=$1 '$1 == name { print $2 }'
+}
+
+test_845() {
+	local burst
+	local reuse
+	local trim
+	local i
+
+	[[ -n "$(mdt_reqbuf_stat reqbuf_avail)" ]] ||
+		skip "no request buffer stats on MDS"
+
+	test_mkdir -c 1 -i 0 $DIR/$tdir
+	do_facet mds1 $LCTL set_param -n mds.MDS.mdt.stats=clear
+
+	# buffers retired after a burst are kept and reused by the next one
+	for burst in 1 2; do
+		for i in {1..16}; do
+			createmany -o $DIR/$tdir/f$burst-$i- 2000 > /dev/null &
+		done
+		wait
+	done
+	reuse=$(mdt_reqbuf_stat reqbuf_reuse)
+	echo "request buffers reused: ${reuse:-0}"
+	(( ${reuse:-0} > 0 )) || error "no request buffer reused"
+
+	# and are given back under memory pressure
+	do_facet mds1 "echo 2 > /proc/sys/vm/drop_caches"
+	trim=$(mdt_reqbuf_stat reqbuf_trim)
+	echo "request buffers trimmed: ${trim:-0}"
+	(( ${trim:-0} > 0 )) || error "no request buffer trimmed"
+}
+run_test 845 "request buffers cached per CPT are reused and trimmed"
+
 test_850() {
 	local dir=$DIR/$tdir
 	local file=$dir/$tfile
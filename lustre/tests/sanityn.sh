@@ -5576,6 +5576,39 @@ test_77s() { #LU-19597
 }
 run_test 77s "Check TBF LRU shrinker"
 
+test_77t() {
+	local osts=$(osts_nodes)
+	local flow
+	local rc
+
+	for flow in nid jobid; do
+		rc=0
+		do_nodes $osts lctl set_param \
+			ost.OSS.ost_io.nrs_policies="wfq\ $flow" || rc=$?
+		[[ $rc -eq 3 ]] && skip "no NRS exists" && return
+		[[ $rc -ne 0 ]] && error "failed to set wfq $flow policy"
+
+		do_nodes $osts lctl set_param \
+			ost.OSS.ost_io.nrs_wfq_rpc_cost=4096 ||
+			error "failed to set wfq_rpc_cost to 4096"
+		do_nodes $osts lctl get_param -n \
+			ost.OSS.ost_io.nrs_wfq_rpc_cost | grep -q "4096" ||
+			error "wfq_rpc_cost not 4096"
+
+		echo "policy: wfq $flow, wfq_rpc_cost 4096"
+		nrs_write_read
+	done
+
+	do_nodes $osts lctl set_param ost.OSS.ost_io.nrs_policies="wfq\ bogus" &&
+		error "wfq with bad flow type should fail"
+
+	# cleanup
+	do_nodes $osts lctl set_param ost.OSS.ost_io.nrs_policies="fifo" ||
+		error "failed to set fifo policy"
+	return 0
+}
+run_test 77t "check WFQ NRS policy"
+
 test_78() { #LU-6673
 	local rc
 	local osts=$(osts_nodes)
@@ -7262,6 +7295,365 @@ test_121() {
 }
 run_test 121 "trunc append race"
 
+test_122() {
+	local nlocks=16
+	local bl1
+	local bl2
+	local i
+
+	[[ $($LCTL get_param osc.$FSNAME-OST0000-osc-[^M]*.import) =~ \
+	   connect_flags.*batch_bl_ast ]] ||
+		skip "server does not support batched blocking ASTs"
+
+	$LFS setstripe -c 1 -i 0 $DIR1/$tfile || error "setstripe failed"
+	cancel_lru_locks osc
+
+	# lockahead locks are not expanded, so every 1MiB range gets its own
+	for ((i = 0; i < nlocks; i++)); do
+		$LFS ladvise -a lockahead --start ${i}M --length 1M \
+			--mode WRITE $DIR1/$tfile ||
+			error "lockahead $i failed"
+	done
+
+	bl1=$($LCTL get_param -n ldlm.services.ldlm_cbd.stats |
+	      awk '/ldlm_bl_callback/ { n = $2 } END { print n + 0 }')
+	# a single write from the 2nd client conflicts with all of them
+	dd if=/dev/zero of=$DIR2/$tfile bs=${nlocks}M count=1 conv=notrunc ||
+		error "dd failed"
+	bl2=$($LCTL get_param -n ldlm.services.ldlm_cbd.stats |
+	      awk '/ldlm_bl_callback/ { n = $2 } END { print n + 0 }')
+	echo "blocking AST RPCs for $nlocks locks: $((bl2 - bl1))"
+
+	(( bl2 - bl1 < nlocks )) ||
+		error "$((bl2 - bl1)) blocking ASTs sent for $nlocks locks"
+}
+run_test 122 "blocking ASTs for several locks of a client are batched"
+
+test_123_strided_write() {
+	local count=64
+	local cmd1="O"
+	local cmd2="Oz65536"
+	local bl1
+	local bl2
+	local i
+
+	for ((i = 0; i < count; i++)); do
+		cmd1+="w65536Z65536"
+		cmd2+="w65536Z65536"
+	done
+
+	rm -f $DIR1/$tfile
+	$LFS setstripe -c 1 -i 0 $DIR1/$tfile || error "setstripe failed"
+	cancel_lru_locks osc
+
+	bl1=$($LCTL get_param -n ldlm.services.ldlm_cbd.stats |
+	      awk '/ldlm_bl_callback/ { n = $2 } END { print n + 0 }')
+	# two clients writing interleaved 64KiB chunks with a 128KiB stride
+	$MULTIOP $DIR1/$tfile $cmd1 &
+	local pid1=$!
+	$MULTIOP $DIR2/$tfile $cmd2 &
+	local pid2=$!
+	wait $pid1 || error "multiop on $DIR1 failed"
+	wait $pid2 || error "multiop on $DIR2 failed"
+	bl2=$($LCTL get_param -n ldlm.services.ldlm_cbd.stats |
+	      awk '/ldlm_bl_callback/ { n = $2 } END { print n + 0 }')
+
+	echo $((bl2 - bl1))
+}
+
+test_123() {
+	local ns="ldlm.namespaces.filter-$FSNAME-OST0000_UUID"
+	local stride_lock=$($LCTL get_param -n llite.*.stride_lock | head -1)
+	local grants
+	local bl_off
+	local bl_on
+
+	[[ $($LCTL get_param osc.$FSNAME-OST0000-osc-[^M]*.import) =~ \
+	   connect_flags.*lock_stride ]] ||
+		skip "server does not support stride lock hints"
+
+	stack_trap "$LCTL set_param llite.*.stride_lock=$stride_lock" EXIT
+
+	$LCTL set_param llite.*.stride_lock=0
+	bl_off=$(test_123_strided_write | tail -1)
+
+	grants=$(do_facet ost1 $LCTL get_param -n $ns.lock_stride_grants)
+	$LCTL set_param llite.*.stride_lock=1
+	bl_on=$(test_123_strided_write | tail -1)
+	grants=$(($(do_facet ost1 $LCTL get_param -n \
+		  $ns.lock_stride_grants) - grants))
+
+	echo "blocking callbacks: $bl_off without stride hint, $bl_on with"
+	echo "stride trimmed grants: $grants"
+
+	(( bl_on <= bl_off )) ||
+		error "stride hint increased callbacks: $bl_off -> $bl_on"
+}
+run_test 123 "stride lock hint reduces lock callbacks for strided IO"
+
+test_124() {
+	local ns="ldlm.namespaces.filter-$FSNAME-OST0000_UUID"
+	local nlocks=16
+	local fanout
+	local max_ast
+	local i
+
+	fanout=$(do_facet ost1 $LCTL get_param -n $ns.ast_fanout) ||
+		skip "server does not support blocking AST fanout"
+	max_ast=$(do_facet ost1 $LCTL get_param -n $ns.max_parallel_ast)
+	stack_trap "do_facet ost1 $LCTL set_param $ns.ast_fanout=$fanout \
+		$ns.max_parallel_ast=$max_ast" EXIT
+
+	# revoke more locks than max_parallel_ast to use the fanout path
+	do_facet ost1 $LCTL set_param $ns.ast_fanout=4 $ns.max_parallel_ast=2
+	do_facet ost1 $LCTL set_param -n $ns.ast_fanout=17 &&
+		error "ast_fanout above the maximum should be refused"
+
+	$LFS setstripe -c 1 -i 0 $DIR1/$tfile || error "setstripe failed"
+	cancel_lru_locks osc
+
+	for ((i = 0; i < nlocks; i++)); do
+		$LFS ladvise -a lockahead --start ${i}M --length 1M \
+			--mode READ $DIR1/$tfile ||
+			error "lockahead $i failed"
+	done
+	$LCTL get_param ldlm.namespaces.$FSNAME-OST0000-osc-[^M]*.lock_count
+
+	dd if=/dev/zero of=$DIR2/$tfile bs=${nlocks}M count=1 conv=notrunc ||
+		error "dd failed"
+	cmp $DIR1/$tfile $DIR2/$tfile || error "file differs between mounts"
+}
+run_test 124 "blocking ASTs for many locks are sent through the fanout"
+
+test_125() {
+	local param="obdfilter.$FSNAME-OST0000.lvb_fresh_ms"
+	local hits="obdfilter.$FSNAME-OST0000.lvb_fresh_hits"
+	local fresh
+	local before
+	local after
+	local size
+	local i
+
+	fresh=$(do_facet ost1 $LCTL get_param -n $param) ||
+		skip "server does not support LVB freshness cache"
+	stack_trap "do_facet ost1 $LCTL set_param $param=$fresh" EXIT
+
+	do_facet ost1 $LCTL set_param -n $param=60001 &&
+		error "lvb_fresh_ms above the maximum should be refused"
+	do_facet ost1 $LCTL set_param $param=10000
+
+	$LFS setstripe -c 1 -i 0 $DIR1/$tfile || error "setstripe failed"
+	cancel_lru_locks osc
+
+	# the writer keeps its PW lock, its sync refreshes the server LVB
+	dd if=/dev/zero of=$DIR1/$tfile bs=1M count=4 conv=fsync ||
+		error "dd failed"
+
+	before=$(do_facet ost1 $LCTL get_param -n $hits)
+	# the glimpse lock conflicts with the writer's lock and is not cached,
+	# so every stat glimpses again
+	for ((i = 0; i < 5; i++)); do
+		size=$(stat -c %s $DIR2/$tfile)
+		(( size == 4 * 1048576 )) ||
+			error "wrong size $size on second mount"
+	done
+	after=$(do_facet ost1 $LCTL get_param -n $hits)
+	echo "glimpses answered from LVB: $before -> $after"
+	(( after > before )) || error "no glimpse was answered from the LVB"
+
+	# with the cache disabled every glimpse goes to the writer again
+	do_facet ost1 $LCTL set_param $param=0
+	dd if=/dev/zero of=$DIR1/$tfile bs=1M count=1 seek=4 conv=fsync ||
+		error "second dd failed"
+	before=$(do_facet ost1 $LCTL get_param -n $hits)
+	size=$(stat -c %s $DIR2/$tfile)
+	(( size == 5 * 1048576 )) || error "wrong size $size after append"
+	after=$(do_facet ost1 $LCTL get_param -n $hits)
+	(( after == before )) || error "glimpse answered from disabled cache"
+}
+run_test 125 "glimpses are answered from a recently written LVB"
+
+test_126() {
+	(( MDS1_VERSION >= $(version_code 2.17.51) )) ||
+		skip "need MDS >= 2.17.51 for readdir-plus"
+	$LCTL get_param -n mdc.$FSNAME-MDT0000-mdc-*.import |
+		grep -q readdir_plus || skip "server does not support readdir-plus"
+
+	local param="llite.*.readdir_plus_ms"
+	local stats="mdc.$FSNAME-MDT0000-mdc-*.stats"
+	local nfiles=100
+	local before
+	local after
+	local saved
+	local mtime
+	local i
+	local d
+
+	saved=$($LCTL get_param -n $param | head -n1)
+	stack_trap "$LCTL set_param $param=$saved" EXIT
+	$LCTL set_param -n $param=60001 &&
+		error "readdir_plus_ms above the maximum should be refused"
+
+	# only inodes not cached yet are instantiated from readdir, so the
+	# entries are created through the second mount
+	for d in $tdir $tdir-2 $tdir-3; do
+		test_mkdir -i 0 -c 1 $DIR2/$d
+		# symlinks need no glimpse, so stat only depends on the MDT
+		for ((i = 0; i < nfiles; i++)); do
+			ln -s $tfile-$i $DIR2/$d/$tfile-$i ||
+				error "symlink $d/$i failed"
+		done
+	done
+	cancel_lru_locks mdc
+	$LCTL set_param $param=10000
+
+	ls -U $DIR1/$tdir > /dev/null || error "ls failed"
+	# the dentries are instantiated by a work item
+	sleep 1
+	$LCTL set_param -n $stats=clear
+	ls -l $DIR1/$tdir > /dev/null || error "ls -l failed"
+	after=$($LCTL get_param -n $stats |
+		awk '/ldlm_ibits_enqueue|mds_getattr/ { sum += $2 }
+		     END { print sum + 0 }')
+	echo "MDT RPCs for ls -l of $nfiles entries: $after"
+	(( after < nfiles / 10 )) ||
+		error "$after RPCs to stat $nfiles entries listed by readdir"
+
+	# without locks, changes from another mount are seen after expiry
+	$LCTL set_param $param=3000
+	ls -U $DIR1/$tdir-2 > /dev/null || error "second ls failed"
+	touch -h -d @1000000000 $DIR2/$tdir-2/$tfile-0 || error "touch failed"
+	sleep 4
+	mtime=$(stat -c %Y $DIR1/$tdir-2/$tfile-0)
+	(( mtime == 1000000000 )) || error "stale mtime $mtime after expiry"
+
+	# disabled, every entry is looked up
+	$LCTL set_param $param=0
+	ls -U $DIR1/$tdir-3 > /dev/null || error "third ls failed"
+	$LCTL set_param -n $stats=clear
+	ls -l $DIR1/$tdir-3 > /dev/null || error "second ls -l failed"
+	before=$($LCTL get_param -n $stats |
+		awk '/ldlm_ibits_enqueue|mds_getattr/ { sum += $2 }
+		     END { print sum + 0 }')
+	echo "MDT RPCs for ls -l without readdir-plus: $before"
+}
+run_test 126 "readdir-plus attributes avoid per-entry getattr"
+
+test_127() {
+	(( MDS1_VERSION >= $(version_code 2.17.51) )) ||
+		skip "need MDS >= 2.17.51 for batched path walk"
+	$LCTL get_param -n mdc.$FSNAME-MDT0000-mdc-*.import |
+		grep -q path_walk || skip "server does not support path walk"
+
+	local stats="mdc.$FSNAME-MDT0000-mdc-*.stats"
+	local path=$DIR1/$tdir
+	local depth=8
+	local count
+	local rpcs
+	local i
+
+	test_mkdir -i 0 -c 1 $path
+	for ((i = 0; i < depth; i++)); do
+		path=$path/d$i
+		mkdir $path || error "mkdir $path failed"
+	done
+	touch $path/$tfile || error "touch $path/$tfile failed"
+
+	# look up the tree from the second mount, which has nothing cached
+	path=${path/$DIR1/$DIR2}
+	cancel_lru_locks mdc
+	$LCTL set_param -n llite.*.stats=clear
+	$LCTL set_param -n $stats=clear
+	count=$($LFS path_walk $path/$tfile | awk '{ print $NF }') ||
+		error "path_walk $path/$tfile failed"
+	rpcs=$($LCTL get_param -n $stats |
+	       awk '/mds_batch/ { print $2 }')
+	$LCTL get_param llite.*.stats | grep path_walk
+	echo "looked up $count components with ${rpcs:-0} batch RPCs"
+	# the walk starts at the mountpoint: $tdir, d0..d$((depth - 1)) and
+	# $tfile, none of them is valid on the second mount after the cancel
+	(( count == depth + 2 )) ||
+		error "looked up $count components, expected $((depth + 2))"
+	(( ${rpcs:-0} == 1 )) || error "used ${rpcs:-0} batch RPCs, expected 1"
+
+	# everything is cached now, so the stat does not need an MDT RPC
+	$LCTL set_param -n $stats=clear
+	stat $path/$tfile > /dev/null || error "stat $path/$tfile failed"
+	rpcs=$($LCTL get_param -n $stats |
+	       awk '/ldlm_ibits_enqueue|mds_getattr/ { sum += $2 }
+		    END { print sum + 0 }')
+	(( rpcs == 0 )) || error "$rpcs RPCs to stat $path/$tfile after walk"
+
+	# a missing component just ends the walk
+	count=$($LFS path_walk $path/nonexist/$tfile | awk '{ print $NF }') ||
+		error "path_walk of a missing component failed"
+	(( count == 0 )) || error "looked up $count missing components"
+}
+run_test 127 "look up a deep path with one batched RPC"
+
+test_128() {
+	(( MDS1_VERSION >= $(version_code 2.17.51) )) ||
+		skip "need MDS >= 2.17.51 for metadata writeback"
+
+	local save="$TMP/$TESTSUITE-$TESTNAME.parameters"
+	local instance
+	local param
+	local cached
+	local i
+	local j
+
+	instance=$($LFS getname -i $DIR1) ||
+		error "cannot get instance of $DIR1"
+	param="llite.*-$instance"
+	$LCTL get_param -n $param.metadata_writeback > /dev/null 2>&1 ||
+		skip "client does not support metadata writeback"
+
+	save_lustre_params client "$param.intent_mkdir" > $save
+	stack_trap "restore_lustre_params < $save; rm -f $save" EXIT
+	stack_trap "$LCTL set_param $param.metadata_writeback=0" EXIT
+	$LCTL set_param $param.intent_mkdir=1 $param.metadata_writeback=1
+	$LCTL set_param -n $param.metadata_writeback_stats=clear
+
+	test_mkdir -i 0 -c 1 $DIR1/$tdir
+	for ((i = 0; i < 4; i++)); do
+		mkdir -p $DIR1/$tdir/d$i/a/b ||
+			error "mkdir -p $DIR1/$tdir/d$i/a/b failed"
+		for ((j = 0; j < 8; j++)); do
+			mknod $DIR1/$tdir/d$i/a/b/p$j p ||
+				error "mknod $DIR1/$tdir/d$i/a/b/p$j failed"
+		done
+	done
+	$LCTL get_param $param.metadata_writeback_stats
+	cached=$($LCTL get_param -n $param.metadata_writeback_stats |
+		 awk '/cached:/ { print $2 }')
+	(( ${cached:-0} > 0 )) || error "no create was cached"
+
+	# open(O_CREAT) only writes back the cached parents of the new file
+	touch $DIR1/$tdir/d0/a/b/f || error "touch $DIR1/$tdir/d0/a/b/f failed"
+	(( $($LCTL get_param -n $param.metadata_writeback_stats |
+	     awk '/pending:/ { print $2 }') > 0 )) ||
+		error "open(O_CREAT) wrote back the whole cache"
+
+	# the other mount revokes the EX lock, which writes the creates back
+	for ((i = 0; i < 4; i++)); do
+		for ((j = 0; j < 8; j++)); do
+			[[ -p $DIR2/$tdir/d$i/a/b/p$j ]] ||
+				error "$DIR2/$tdir/d$i/a/b/p$j is missing"
+		done
+	done
+	[[ -f $DIR2/$tdir/d0/a/b/f ]] || error "$DIR2/$tdir/d0/a/b/f is missing"
+	(( $(find $DIR2/$tdir | wc -l) == 1 + 4 * (3 + 8) + 1 )) ||
+		error "wrong number of entries in $DIR2/$tdir"
+
+	$LCTL get_param $param.metadata_writeback_stats
+	(( $($LCTL get_param -n $param.metadata_writeback_stats |
+	     awk '/errors:/ { print $2 }') == 0 )) ||
+		error "cached creates failed to be written back"
+
+	rm -rf $DIR2/$tdir || error "rm -rf $DIR2/$tdir failed"
+}
+run_test 128 "creates cached under an EX lock are written back"
+
 test_200() {
 	remote_ost_nodsh && skip "remote OST with nodsh" && return
 
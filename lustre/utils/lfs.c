@@ -101,6 +101,7 @@ static int lfs_changelog(int argc, char **argv);
 static int lfs_changelog_clear(int argc, char **argv);
 static int lfs_fid2path(int argc, char **argv);
 static int lfs_path2fid(int argc, char **argv);
+static int lfs_path_walk(int argc, char **argv);
 static int lfs_rmfid(int argc, char **argv);
 static int lfs_data_version(int argc, char **argv);
 static int lfs_hsm(int argc, char **argv);
@@ -576,6 +577,9 @@ command_t cmdlist[] = {
 	 "[--link|-l <linkno>] [--name|-n] <fsname|root> <fid>..."},
 	{"path2fid", lfs_path2fid, 0, "Display the fid(s) for a given path(s).\n"
 	 "usage: path2fid [--parents] <path> ..."},
+	{"path_walk", lfs_path_walk, 0,
+	 "Look up all directories of the given path(s) with batched RPCs.\n"
+	 "usage: path_walk <path> ..."},
 	{"rmfid", lfs_rmfid, 0, "Remove file(s) by FID(s)\n"
 	 "usage: rmfid <fsname|rootpath> <fid> ..."},
 	{"data_version", lfs_data_version, 0, "Display file data version, "
@@ -12284,6 +12288,54 @@ static int lfs_path2fid(int argc, char **argv)
 	return rc;
 }
 
+static int lfs_path_walk(int argc, char **argv)
+{
+	char cwd[PATH_MAX];
+	char path[PATH_MAX];
+	int rc = 0;
+	int i;
+
+	if (argc < 2) {
+		fprintf(stderr, "%s path_walk: PATH... must be specified\n",
+			progname);
+		return CMD_HELP;
+	}
+
+	if (!getcwd(cwd, sizeof(cwd)))
+		cwd[0] = '\0';
+
+	for (i = 1; i < argc; i++) {
+		int count = 0;
+		int err = 0;
+
+		if (argv[i][0] == '/')
+			err = snprintf(path, sizeof(path), "%s", argv[i]);
+		else if (cwd[0] != '\0')
+			err = snprintf(path, sizeof(path), "%s/%s", cwd,
+				       argv[i]);
+		else
+			err = -ENOENT;
+
+		if (err >= (int)sizeof(path))
+			err = -ENAMETOOLONG;
+		else if (err > 0)
+			err = llapi_path_walk(path, &count);
+
+		if (err) {
+			fprintf(stderr,
+				"%s path_walk: cannot walk '%s': %s\n",
+				progname, argv[i], strerror(-err));
+			if (rc == 0)
+				rc = err;
+			continue;
+		}
+
+		printf("%s: %d\n", argv[i], count);
+	}
+
+	return rc;
+}
+
 #define MAX_ERRNO	4095
 #define IS_ERR_VALUE(x) ((unsigned long)(x) >= (unsigned long)-MAX_ERRNO)
 
@@ -378,6 +378,75 @@ int llapi_path2parent(const char *path, unsigned int linkno,
 	return rc;
 }
 
+/**
+ * llapi_path_walk() - look up the components of @path in batched RPCs
+ * @path: absolute pathname in a Lustre filesystem
+ * @count: number of components looked up on the MDT [out], may be NULL
+ *
+ * Populate the client dentry cache for @path, e.g. before the processes of
+ * a job open files deep in a directory tree, so that the kernel path walk
+ * does not need one lookup RPC per uncached directory. A missing component
+ * just ends the walk, it is not reported as an error.
+ *
+ * Return:
+ * * %0 on success
+ * * %negative errno on failure
+ */
+int llapi_path_walk(const char *path, int *count)
+{
+	char mntdir[PATH_MAX];
+	struct lu_path_walk *lpw;
+	const char *rel;
+	size_t size;
+	int fd;
+	int rc;
+
+	if (count)
+		*count = 0;
+
+	if (!path || path[0] != '/')
+		return -EINVAL;
+
+	if (strlen(path) >= sizeof(mntdir))
+		return -ENAMETOOLONG;
+
+	rc = llapi_search_mounts(path, 0, mntdir, NULL);
+	if (rc)
+		return rc;
+
+	/* only the part below the mountpoint is looked up by the client */
+	rel = path + strlen(mntdir);
+	while (*rel == '/')
+		rel++;
+	if (*rel == '\0')
+		return 0;
+
+	size = strlen(rel) + 1;
+	lpw = calloc(1, sizeof(*lpw) + size);
+	if (!lpw)
+		return -ENOMEM;
+
+	lpw->lpw_path_size = size;
+	memcpy(lpw->lpw_path, rel, size);
+
+	fd = open(mntdir, O_RDONLY | O_DIRECTORY | O_NONBLOCK);
+	if (fd < 0) {
+		rc = -errno;
+		goto out_free;
+	}
+
+	rc = ioctl(fd, LL_IOC_PATH_WALK, lpw);
+	if (rc < 0)
+		rc = -errno;
+	else if (count)
+		*count = lpw->lpw_count;
+	close(fd);
+
+out_free:
+	free(lpw);
+	return rc;
+}
+
 /**
  * llapi_fid_to_handle() - Convert a struct lu_fid into a struct file_handle
  * @_handle: a newly allocated struct file_handle on success [out]
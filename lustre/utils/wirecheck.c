@@ -349,6 +349,7 @@ check_lu_dirent(void)
 	CHECK_VALUE_X(LUDA_FID);
 	CHECK_VALUE_X(LUDA_TYPE);
 	CHECK_VALUE_X(LUDA_64BITHASH);
+	CHECK_VALUE_X(LUDA_ATTRS);
 }
 
 static void
@@ -359,6 +360,28 @@ check_luda_type(void)
 	CHECK_MEMBER(luda_type, lt_type);
 }
 
+static void
+check_luda_attrs(void)
+{
+	BLANK_LINE();
+	CHECK_STRUCT(luda_attrs);
+	CHECK_MEMBER(luda_attrs, lda_valid);
+	CHECK_MEMBER(luda_attrs, lda_size);
+	CHECK_MEMBER(luda_attrs, lda_blocks);
+	CHECK_MEMBER(luda_attrs, lda_mtime);
+	CHECK_MEMBER(luda_attrs, lda_atime);
+	CHECK_MEMBER(luda_attrs, lda_ctime);
+	CHECK_MEMBER(luda_attrs, lda_btime);
+	CHECK_MEMBER(luda_attrs, lda_mode);
+	CHECK_MEMBER(luda_attrs, lda_uid);
+	CHECK_MEMBER(luda_attrs, lda_gid);
+	CHECK_MEMBER(luda_attrs, lda_projid);
+	CHECK_MEMBER(luda_attrs, lda_nlink);
+	CHECK_MEMBER(luda_attrs, lda_flags);
+	CHECK_MEMBER(luda_attrs, lda_rdev);
+	CHECK_MEMBER(luda_attrs, lda_padding);
+}
+
 static void
 check_lu_dirpage(void)
 {
@@ -690,6 +713,11 @@ check_obd_connect_data(void)
 	CHECK_DEFINE_64X(OBD_CONNECT2_FLR_IMMED_MIRROR);
 	CHECK_DEFINE_64X(OBD_CONNECT2_NO_APPEND);
 	CHECK_DEFINE_64X(OBD_CONNECT2_FLR_EC_WR);
+	CHECK_DEFINE_64X(OBD_CONNECT2_BATCH_BL_AST);
+	CHECK_DEFINE_64X(OBD_CONNECT2_LOCK_STRIDE);
+	CHECK_DEFINE_64X(OBD_CONNECT2_READDIR_PLUS);
+	CHECK_DEFINE_64X(OBD_CONNECT2_PATH_WALK);
+	CHECK_DEFINE_64X(OBD_CONNECT2_XATTR_PREFETCH);
 
 	BLANK_LINE();
 	CHECK_VALUE_X(OBD_CKSUM_CRC32);
@@ -1237,6 +1265,8 @@ check_mds_op_bias(void)
 	CHECK_VALUE_X(MDS_CLOSE_LAYOUT_SWAP_HSM);
 	CHECK_VALUE_X(MDS_RENAME_AGAIN);
 	CHECK_VALUE_X(MDS_NAMEHASH);
+	CHECK_VALUE_X(MDS_WBC_LOCK);
+	CHECK_VALUE_X(MDS_WBC_FLUSH);
 }
 
 static void
@@ -1649,6 +1679,16 @@ check_ldlm_extent(void)
 	CHECK_MEMBER(ldlm_extent, gid);
 }
 
+static void
+check_ldlm_extent_stride(void)
+{
+	BLANK_LINE();
+	CHECK_STRUCT(ldlm_extent_stride);
+	CHECK_MEMBER(ldlm_extent_stride, les_offset);
+	CHECK_MEMBER(ldlm_extent_stride, les_length);
+	CHECK_MEMBER(ldlm_extent_stride, les_bytes);
+}
+
 static void
 check_ldlm_inodebits(void)
 {
@@ -3723,6 +3763,7 @@ main(int argc, char **argv)
 	check_ost_id();
 	check_lu_dirent();
 	check_luda_type();
+	check_luda_attrs();
 	check_lu_dirpage();
 	check_lu_ladvise();
 	check_ladvise_hdr();
@@ -3767,6 +3808,7 @@ main(int argc, char **argv)
 	check_lov_desc();
 	check_ldlm_res_id();
 	check_ldlm_extent();
+	check_ldlm_extent_stride();
 	check_ldlm_inodebits();
 	check_ldlm_flock();
 	check_ldlm_intent();
@@ -707,6 +707,8 @@ void lustre_assert_wire_constants(void)
 		 (unsigned)LUDA_TYPE);
 	LASSERTF(LUDA_64BITHASH == 0x00000004UL, "found 0x%.8xUL\n",
 		 (unsigned)LUDA_64BITHASH);
+	LASSERTF(LUDA_ATTRS == 0x00000008UL, "found 0x%.8xUL\n",
+		 (unsigned)LUDA_ATTRS);
 
 	/* Checks for struct luda_type */
 	LASSERTF((int)sizeof(struct luda_type) == 2, "found %lld\n",
@@ -716,6 +718,70 @@ void lustre_assert_wire_constants(void)
 	LASSERTF((int)sizeof(((struct luda_type *)0)->lt_type) == 2, "found %lld\n",
 		 (long long)(int)sizeof(((struct luda_type *)0)->lt_type));
 
+	/* Checks for struct luda_attrs */
+	LASSERTF((int)sizeof(struct luda_attrs) == 88, "found %lld\n",
+		 (long long)(int)sizeof(struct luda_attrs));
+	LASSERTF((int)offsetof(struct luda_attrs, lda_valid) == 0, "found %lld\n",
+		 (long long)(int)offsetof(struct luda_attrs, lda_valid));
+	LASSERTF((int)sizeof(((struct luda_attrs *)0)->lda_valid) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct luda_attrs *)0)->lda_valid));
+	LASSERTF((int)offsetof(struct luda_attrs, lda_size) == 8, "found %lld\n",
+		 (long long)(int)offsetof(struct luda_attrs, lda_size));
+	LASSERTF((int)sizeof(((struct luda_attrs *)0)->lda_size) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct luda_attrs *)0)->lda_size));
+	LASSERTF((int)offsetof(struct luda_attrs, lda_blocks) == 16, "found %lld\n",
+		 (long long)(int)offsetof(struct luda_attrs, lda_blocks));
+	LASSERTF((int)sizeof(((struct luda_attrs *)0)->lda_blocks) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct luda_attrs *)0)->lda_blocks));
+	LASSERTF((int)offsetof(struct luda_attrs, lda_mtime) == 24, "found %lld\n",
+		 (long long)(int)offsetof(struct luda_attrs, lda_mtime));
+	LASSERTF((int)sizeof(((struct luda_attrs *)0)->lda_mtime) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct luda_attrs *)0)->lda_mtime));
+	LASSERTF((int)offsetof(struct luda_attrs, lda_atime) == 32, "found %lld\n",
+		 (long long)(int)offsetof(struct luda_attrs, lda_atime));
+	LASSERTF((int)sizeof(((struct luda_attrs *)0)->lda_atime) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct luda_attrs *)0)->lda_atime));
+	LASSERTF((int)offsetof(struct luda_attrs, lda_ctime) == 40, "found %lld\n",
+		 (long long)(int)offsetof(struct luda_attrs, lda_ctime));
+	LASSERTF((int)sizeof(((struct luda_attrs *)0)->lda_ctime) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct luda_attrs *)0)->lda_ctime));
+	LASSERTF((int)offsetof(struct luda_attrs, lda_btime) == 48, "found %lld\n",
+		 (long long)(int)offsetof(struct luda_attrs, lda_btime));
+	LASSERTF((int)sizeof(((struct luda_attrs *)0)->lda_btime) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct luda_attrs *)0)->lda_btime));
+	LASSERTF((int)offsetof(struct luda_attrs, lda_mode) == 56, "found %lld\n",
+		 (long long)(int)offsetof(struct luda_attrs, lda_mode));
+	LASSERTF((int)sizeof(((struct luda_attrs *)0)->lda_mode) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct luda_attrs *)0)->lda_mode));
+	LASSERTF((int)offsetof(struct luda_attrs, lda_uid) == 60, "found %lld\n",
+		 (long long)(int)offsetof(struct luda_attrs, lda_uid));
+	LASSERTF((int)sizeof(((struct luda_attrs *)0)->lda_uid) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct luda_attrs *)0)->lda_uid));
+	LASSERTF((int)offsetof(struct luda_attrs, lda_gid) == 64, "found %lld\n",
+		 (long long)(int)offsetof(struct luda_attrs, lda_gid));
+	LASSERTF((int)sizeof(((struct luda_attrs *)0)->lda_gid) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct luda_attrs *)0)->lda_gid));
+	LASSERTF((int)offsetof(struct luda_attrs, lda_projid) == 68, "found %lld\n",
+		 (long long)(int)offsetof(struct luda_attrs, lda_projid));
+	LASSERTF((int)sizeof(((struct luda_attrs *)0)->lda_projid) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct luda_attrs *)0)->lda_projid));
+	LASSERTF((int)offsetof(struct luda_attrs, lda_nlink) == 72, "found %lld\n",
+		 (long long)(int)offsetof(struct luda_attrs, lda_nlink));
+	LASSERTF((int)sizeof(((struct luda_attrs *)0)->lda_nlink) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct luda_attrs *)0)->lda_nlink));
+	LASSERTF((int)offsetof(struct luda_attrs, lda_flags) == 76, "found %lld\n",
+		 (long long)(int)offsetof(struct luda_attrs, lda_flags));
+	LASSERTF((int)sizeof(((struct luda_attrs *)0)->lda_flags) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct luda_attrs *)0)->lda_flags));
+	LASSERTF((int)offsetof(struct luda_attrs, lda_rdev) == 80, "found %lld\n",
+		 (long long)(int)offsetof(struct luda_attrs, lda_rdev));
+	LASSERTF((int)sizeof(((struct luda_attrs *)0)->lda_rdev) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct luda_attrs *)0)->lda_rdev));
+	LASSERTF((int)offsetof(struct luda_attrs, lda_padding) == 84, "found %lld\n",
+		 (long long)(int)offsetof(struct luda_attrs, lda_padding));
+	LASSERTF((int)sizeof(((struct luda_attrs *)0)->lda_padding) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct luda_attrs *)0)->lda_padding));
+
 	/* Checks for struct lu_dirpage */
 	LASSERTF((int)sizeof(struct lu_dirpage) == 24, "found %lld\n",
 		 (long long)(int)sizeof(struct lu_dirpage));
@@ -1485,6 +1551,18 @@ void lustre_assert_wire_constants(void)
 		 OBD_CONNECT2_FLR_IMMED_MIRROR);
 	LASSERTF(OBD_CONNECT2_NO_APPEND == 0x40000000000ULL, "found 0x%.16llxULL\n",
 		 OBD_CONNECT2_NO_APPEND);
+	LASSERTF(OBD_CONNECT2_FLR_EC_WR == 0x80000000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_FLR_EC_WR);
+	LASSERTF(OBD_CONNECT2_BATCH_BL_AST == 0x100000000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_BATCH_BL_AST);
+	LASSERTF(OBD_CONNECT2_LOCK_STRIDE == 0x200000000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_LOCK_STRIDE);
+	LASSERTF(OBD_CONNECT2_READDIR_PLUS == 0x400000000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_READDIR_PLUS);
+	LASSERTF(OBD_CONNECT2_PATH_WALK == 0x800000000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_PATH_WALK);
+	LASSERTF(OBD_CONNECT2_XATTR_PREFETCH == 0x1000000000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_XATTR_PREFETCH);
 
 	LASSERTF(OBD_CKSUM_CRC32 == 0x00000001UL, "found 0x%.8xUL\n",
 		 (unsigned)OBD_CKSUM_CRC32);
@@ -3770,6 +3848,22 @@ void lustre_assert_wire_constants(void)
 	LASSERTF((int)sizeof(((struct ldlm_extent *)0)->gid) == 8, "found %lld\n",
 		 (long long)(int)sizeof(((struct ldlm_extent *)0)->gid));
 
+	/* Checks for struct ldlm_extent_stride */
+	LASSERTF((int)sizeof(struct ldlm_extent_stride) == 24, "found %lld\n",
+		 (long long)(int)sizeof(struct ldlm_extent_stride));
+	LASSERTF((int)offsetof(struct ldlm_extent_stride, les_offset) == 0, "found %lld\n",
+		 (long long)(int)offsetof(struct ldlm_extent_stride, les_offset));
+	LASSERTF((int)sizeof(((struct ldlm_extent_stride *)0)->les_offset) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct ldlm_extent_stride *)0)->les_offset));
+	LASSERTF((int)offsetof(struct ldlm_extent_stride, les_length) == 8, "found %lld\n",
+		 (long long)(int)offsetof(struct ldlm_extent_stride, les_length));
+	LASSERTF((int)sizeof(((struct ldlm_extent_stride *)0)->les_length) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct ldlm_extent_stride *)0)->les_length));
+	LASSERTF((int)offsetof(struct ldlm_extent_stride, les_bytes) == 16, "found %lld\n",
+		 (long long)(int)offsetof(struct ldlm_extent_stride, les_bytes));
+	LASSERTF((int)sizeof(((struct ldlm_extent_stride *)0)->les_bytes) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct ldlm_extent_stride *)0)->les_bytes));
+
 	/* Checks for struct ldlm_inodebits */
 	LASSERTF((int)sizeof(struct ldlm_inodebits) == 32, "found %lld\n",
 		 (long long)(int)sizeof(struct ldlm_inodebits));